@@ -1,6 +1,7 @@
 /**
  * @File    : exec_function.cpp
  * @Brief   : The 'exec' system call is used to override the existing process with a completely new process.
+ * @Command : g++ -std=c++2a -O2 -I../include exec_function.cpp -o exec_function
  * @Author  : Wei Li
  * @Date    : 2021-11-02
 */
@@ -9,17 +10,34 @@
 #include <sys/wait.h>
 #include <iostream>
 
+#include "launcher.hpp"
+
 
 // example 3 for 'fork' function and 'exec' function together
+/** fork() copies the page tables of the parent, only for exec() to throw them away:
+ * proc::run() (include/launcher.hpp) starts the program with posix_spawn() instead,
+ * and waits for it through a pidfd. The fork() + exec() version was:
+ *
+ *   if (fork() == 0)
+ *   {
+ *       execlp(command, command, nullptr);
+ *   }
+ *   else
+ *   {
+ *       wait(nullptr);
+ *   }
+ */
 void mysystem(const char *command)
 {
-    if (fork() == 0)
+    // a program that cannot be started is reported, as the failed execlp() went unnoticed before:
+    // main() goes on with the next example
+    try
     {
-        execlp(command, command, nullptr);
+        proc::run(proc::command{command});
     }
-    else
+    catch (const std::runtime_error &e)
     {
-        wait(nullptr);
+        std::cerr << command << ": " << e.what() << std::endl;
     }
 }
 
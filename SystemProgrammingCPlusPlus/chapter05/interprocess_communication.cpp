@@ -1,70 +1,24 @@
 /**
  * @File    : interprocess_communication.cpp
  * @Brief   : Interprocess communication (IPC)
+ * @Command : g++ -std=c++2a -O2 -I../include interprocess_communication.cpp -o interprocess_communication -lpthread
  * @Author  : Wei Li
  * @Date    : 2021-11-02
 */
 
 #include <unistd.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
-#include <sys/shm.h>
+#include <atomic>
 #include <string>
 #include <array>
 #include <string_view>
 #include <iostream>
 
+#include "shm_channel.hpp"
+#include "shm_segment.hpp"
 
-// example 2 Unix pipe for IPC
-class mypipe
-{
-private:
-    std::array<int, 2> m_handles;
-
-public:
-    mypipe()
-    {
-        // man 2 pipe
-        /** The pipe itself is an array of two file handles. 
-         * The first handle is used to read from the pipe,
-         * while the second handle is used to write to the pipe. 
-         * The pipe() function will return -1 if an error occurs.
-         */
-        if (pipe(m_handles.data()) < 0)
-        {
-            exit(1);
-        }
-    }
-
-    ~mypipe()
-    {
-        close(m_handles.at(0));
-        close(m_handles.at(1));
-    }
-
-    // std::string readWithPipe()
-    std::string read()
-    {
-        std::array<char, 256> buf;
-        // std::size_t bytes = read(m_handles.at(0), buf.data(), buf.size());
-        // man 2 read; system call function
-        std::size_t bytes = ::read(m_handles.at(0), buf.data(), buf.size());
-
-        if (bytes > 0)
-        {
-            return {buf.data(), bytes};
-        }
 
-        return {};
-    }
-
-    // void writeWithPipe(const std::string &msg)
-    void write(const std::string &msg)
-    {
-        // write(m_handles.at(1), msg.data(), msg.size());
-        // man 2 write; system call function
-        ::write(m_handles.at(1), msg.data(), msg.size());
-    }
-};
 /** :: 是作用域符，是运算符中等级最高的
  * 
  * 1. global scope(全局作用域符），用法（::name)
@@ -78,18 +32,50 @@ public:
  */
 
 // Example 3 Unix shared memory for IPC
-char *get_shared_memory()
+/** The SysV version, ftok("myfile", 42) + shmget(key, 0x1000, 0666 | IPC_CREAT) + shmat(),
+ * checked no error, could not grow, and left the segment in the system after the program exited.
+ * shm::segment (include/shm_segment.hpp) is a memfd: created before fork(), the child inherits it,
+ * and it disappears with the last process that has it open.
+ */
+shm::segment get_shared_memory()
 {
-    // man 3 ftok; generate unique key for shared memory
-    auto key = ftok("myfile" , 42);
-    // man 2 shmget; open the shared memory
-    auto shm = shmget(key, 0x1000, 0666 | IPC_CREAT);
-
-    // man 2 shmat; return pointer to the shared memory
-    return static_cast<char *>(shmat(shm, nullptr, 0));
+    shm::options opts;
+    opts.size = 0x1000;
+    return shm::segment::create(opts);
 }
-    
 
+// Example 4 a lookup table shared read-mostly, grown while it is in use
+struct lookup_table
+{
+    shm::seqlock lock;
+    std::atomic<std::uint64_t> entries;
+
+    std::uint64_t *values()
+    {
+        return reinterpret_cast<std::uint64_t *>(this + 1);
+    }
+};
+
+// entry count and sum, read consistently; maps the pages another process added
+std::pair<std::uint64_t, std::uint64_t> read_table(shm::segment &segment)
+{
+    auto table = segment.as<lookup_table>();
+    return table->lock.read([&]
+                            {
+                                auto entries = table->entries.load(std::memory_order_relaxed);
+                                if (sizeof(lookup_table) + entries * sizeof(std::uint64_t) > segment.size())
+                                {
+                                    segment.refresh();
+                                }
+
+                                std::uint64_t sum = 0;
+                                for (std::uint64_t i = 0; i < entries; i++)
+                                {
+                                    sum += table->values()[i];
+                                }
+                                return std::pair{entries, sum};
+                            });
+}
 
 int main(int argc, char** argv)
 {
@@ -149,44 +135,119 @@ int main(int argc, char** argv)
      * pipe is a file (in RAM) that one process can write to, and the other can read from.
      * The file starts out empty, and no bytes can be read from the pipe until bytes are written to it.
      * 
+     * Every message through a pipe is copied into the kernel by write() and out again by read().
+     * ipc::channel (include/shm_channel.hpp) keeps the messages in a ring in shared memory instead:
+     * created before fork(), the child inherits it; receive() waits (on a futex) until there is a message,
+     * the way read() blocks on an empty pipe. ipc_benchmark.cpp compares both.
+     * 
      * Using this simple example, 
      * we are able to send information from one process to another. 
      * In this case, we use this communication to synchronize the parent and child processes.
      */
-    mypipe p;
+    auto channel = ipc::channel::create(4096);
     if (fork() != 0)
     {
         sleep(1);
         std::cout << "Parent" << std::endl;
 
-        p.write("Done");
+        ipc::producer producer{channel};
+        producer.send("Done");
+        producer.flush();
         wait(nullptr);
     }
     else
     {
-        auto msg = p.read();
+        ipc::consumer consumer{channel};
+        auto msg = consumer.receive();
         std::cout << "Child" << std::endl;
-        std::cout << "msg: " << msg << std::endl;
+        std::cout << "msg: " << msg.value_or("") << std::endl;
     }
 
     // ------------ Example 3 ------------
     // Unix shared memory for IPC
+    auto segment = get_shared_memory();
+    auto flag = segment.as<std::atomic<char>>();
     if (fork() != 0)
     {
         sleep(1);
         std::cout << "Parent" << std::endl;
 
-        auto msg = get_shared_memory();
-        msg[0] = 42;
+        flag->store(42, std::memory_order_release);
         wait(nullptr);
     }
     else
     {
-        auto msg = get_shared_memory();
-        while (msg[0] != 42);
+        while (flag->load(std::memory_order_acquire) != 42);
 
         std::cout << "Child" << std::endl;
+        return 0;
+    }
+
+    // ------------ Example 4 ------------
+    /** The worker process exists before the table: it cannot inherit the memfd,
+     * it gets a descriptor of it over a UNIX socket (SCM_RIGHTS), as an unrelated process would.
+     * Once the worker acknowledged its first read, the table grows from 256 to 1M entries while the worker
+     * has it mapped: the segment keeps its address, the worker maps the new pages with refresh().
+     */
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0)
+    {
+        return 1;
+    }
+
+    if (fork() == 0)
+    {
+        close(sockets[0]);
+        auto table = shm::segment::receive(sockets[1], 1);
+        auto [entries, sum] = read_table(table);
+        std::cout << "worker: " << entries << " entries, sum " << sum << std::endl;
+
+        // tell the parent it may grow the table, then wait until it did
+        char done = 'r';
+        ::write(sockets[1], &done, 1);
+        ::read(sockets[1], &done, 1);
+        std::tie(entries, sum) = read_table(table);
+        std::cout << "worker: " << entries << " entries, sum " << sum << ", generation " << table.generation() << std::endl;
+        return 0;
+    }
+    close(sockets[1]);
+
+    shm::options opts;
+    opts.size = sizeof(lookup_table) + 256 * sizeof(std::uint64_t);
+    opts.version = 1;
+    auto table_segment = shm::segment::create(opts);
+
+    auto fill = [&](std::uint64_t entries)
+    {
+        table_segment.grow(sizeof(lookup_table) + entries * sizeof(std::uint64_t));
+
+        // the writers of the table take the mutex of the segment
+        std::lock_guard writer{table_segment.mutex()};
+        auto table = table_segment.as<lookup_table>();
+        table->lock.write([&]
+                          {
+                              for (std::uint64_t i = 0; i < entries; i++)
+                              {
+                                  table->values()[i] = i;
+                              }
+                              table->entries.store(entries, std::memory_order_relaxed);
+                          });
+    };
+
+    fill(256);
+    table_segment.send(sockets[0]);
+
+    // the worker has read the first version before the table grows under it
+    char ready;
+    if (::read(sockets[0], &ready, 1) != 1)
+    {
+        return 1;
     }
+
+    fill(1 << 20);
+    ::write(sockets[0], "x", 1);
+    wait(nullptr);
+    close(sockets[0]);
     
     return 0;
 }
@@ -0,0 +1,498 @@
+/**
+ * @File    : ipc_benchmark.cpp
+ * @Brief   : Messages per second and round-trip latency: mypipe, pipes, UNIX sockets and a shared-memory ring
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include ipc_benchmark.cpp -o ipc_benchmark
+ * @Command : ./ipc_benchmark
+ * @Command : ./ipc_benchmark --messages=10000000 --round-trips=1000000
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Moving messages between two processes
+ * The parent process sends '--messages' messages (2M by default) of 16 to 240 bytes to a child
+ * created with fork(), which checks the length and the content of each one:
+ * 1. mypipe from interprocess_communication.cpp: one write() per message, read() into a std::string
+ *    of at most 256 bytes (a pipe is a byte stream, the messages run together: only the bytes are counted),
+ * 2. a pipe with a length prefix: one write() per message, the reader parses the messages out of 64KB read()s,
+ * 3. a UNIX socket pair (SOCK_SEQPACKET, which keeps the message boundaries): one send() and one recv() per message,
+ * 4. ipc::channel (include/shm_channel.hpp): messages written and read in place in a shared ring,
+ *    the indices published every 4KB,
+ * 5. ipc::channel publishing every message.
+ *
+ * Then '--round-trips' ping-pongs of a 64-byte message measure the latency: the child sends every
+ * message back, the parent records the time of each round trip and reports the median and the 99th percentile.
+ * On a machine with a single CPU the two processes take turns, every round trip includes two context switches.
+ */
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "shm_channel.hpp"
+
+using steady = std::chrono::steady_clock;
+
+// Step 1. the pipe of interprocess_communication.cpp, as it is
+class mypipe
+{
+private:
+    std::array<int, 2> m_handles;
+
+public:
+    mypipe()
+    {
+        if (pipe(m_handles.data()) < 0)
+        {
+            exit(1);
+        }
+    }
+
+    ~mypipe()
+    {
+        close(m_handles.at(0));
+        close(m_handles.at(1));
+    }
+
+    std::string read()
+    {
+        std::array<char, 256> buf;
+        std::size_t bytes = ::read(m_handles.at(0), buf.data(), buf.size());
+
+        if (bytes > 0)
+        {
+            return {buf.data(), bytes};
+        }
+
+        return {};
+    }
+
+    void write(const std::string &msg)
+    {
+        ::write(m_handles.at(1), msg.data(), msg.size());
+    }
+};
+
+// the messages: lengths from 16 to 240 bytes, every byte of message i is (i & 0xFF)
+std::size_t message_size(std::uint64_t i)
+{
+    return 16 + (i * 2654435761U >> 7) % 225;
+}
+
+void fill(char *data, std::uint64_t i)
+{
+    std::memset(data, static_cast<int>(i & 0xFF), message_size(i));
+}
+
+bool valid(const char *data, std::size_t size, std::uint64_t i)
+{
+    return size == message_size(i) && static_cast<unsigned char>(data[0]) == (i & 0xFF) &&
+           static_cast<unsigned char>(data[size - 1]) == (i & 0xFF);
+}
+
+std::uint64_t total_bytes(std::uint64_t messages)
+{
+    std::uint64_t total = 0;
+    for (std::uint64_t i = 0; i < messages; i++)
+    {
+        total += message_size(i);
+    }
+
+    return total;
+}
+
+// runs 'child' in a new process and 'parent' in this one, returns the time until the child exited
+double run_pair(const std::function<bool()> &parent, const std::function<bool()> &child)
+{
+    auto start = steady::now();
+    auto pid = fork();
+    if (pid < 0)
+    {
+        throw std::runtime_error(std::string{"fork: "} + strerror(errno));
+    }
+
+    if (pid == 0)
+    {
+        _exit(child() ? 0 : 1);
+    }
+
+    auto ok = parent();
+
+    int status;
+    waitpid(pid, &status, 0);
+    auto secs = std::chrono::duration<double>(steady::now() - start).count();
+
+    if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        throw std::runtime_error("the messages were not received correctly");
+    }
+
+    return secs;
+}
+
+// Step 2. one-way throughput
+double throughput_mypipe(std::uint64_t messages)
+{
+    mypipe p;
+    auto expected = total_bytes(messages);
+
+    return run_pair([&]
+                    {
+                        std::string msg;
+                        for (std::uint64_t i = 0; i < messages; i++)
+                        {
+                            msg.assign(message_size(i), static_cast<char>(i & 0xFF));
+                            p.write(msg);
+                        }
+                        return true;
+                    },
+                    [&]
+                    {
+                        std::uint64_t received = 0;
+                        while (received < expected)
+                        {
+                            auto msg = p.read();
+                            if (msg.empty())
+                            {
+                                return false;
+                            }
+                            received += msg.size();
+                        }
+                        return true;
+                    });
+}
+
+double throughput_pipe(std::uint64_t messages)
+{
+    int fds[2];
+    if (pipe(fds) < 0)
+    {
+        throw std::runtime_error(std::string{"pipe: "} + strerror(errno));
+    }
+
+    auto secs = run_pair([&]
+                         {
+                             close(fds[0]);
+                             char buffer[256];
+                             for (std::uint64_t i = 0; i < messages; i++)
+                             {
+                                 auto size = static_cast<std::uint32_t>(message_size(i));
+                                 std::memcpy(buffer, &size, sizeof(size));
+                                 fill(buffer + sizeof(size), i);
+                                 if (write(fds[1], buffer, sizeof(size) + size) < 0)
+                                 {
+                                     return false;
+                                 }
+                             }
+                             close(fds[1]);
+                             return true;
+                         },
+                         [&]
+                         {
+                             close(fds[1]);
+                             std::vector<char> buffer(64 << 10);
+                             std::size_t used = 0;
+                             std::uint64_t i = 0;
+
+                             for (ssize_t n; (n = read(fds[0], buffer.data() + used, buffer.size() - used)) > 0;)
+                             {
+                                 used += static_cast<std::size_t>(n);
+
+                                 // every complete message in the buffer, the rest moves to the front
+                                 std::size_t pos = 0;
+                                 std::uint32_t size;
+                                 while (used - pos >= sizeof(size) &&
+                                        (std::memcpy(&size, buffer.data() + pos, sizeof(size)), used - pos - sizeof(size) >= size))
+                                 {
+                                     if (!valid(buffer.data() + pos + sizeof(size), size, i++))
+                                     {
+                                         return false;
+                                     }
+                                     pos += sizeof(size) + size;
+                                 }
+
+                                 std::memmove(buffer.data(), buffer.data() + pos, used - pos);
+                                 used -= pos;
+                             }
+                             return i == messages;
+                         });
+
+    close(fds[0]);
+    close(fds[1]);
+    return secs;
+}
+
+double throughput_socket(std::uint64_t messages)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) < 0)
+    {
+        throw std::runtime_error(std::string{"socketpair: "} + strerror(errno));
+    }
+
+    auto secs = run_pair([&]
+                         {
+                             close(fds[1]);
+                             char buffer[256];
+                             for (std::uint64_t i = 0; i < messages; i++)
+                             {
+                                 fill(buffer, i);
+                                 if (send(fds[0], buffer, message_size(i), 0) < 0)
+                                 {
+                                     return false;
+                                 }
+                             }
+                             shutdown(fds[0], SHUT_WR);
+                             return true;
+                         },
+                         [&]
+                         {
+                             close(fds[0]);
+                             char buffer[256];
+                             std::uint64_t i = 0;
+                             for (ssize_t n; (n = recv(fds[1], buffer, sizeof(buffer), 0)) > 0; i++)
+                             {
+                                 if (!valid(buffer, static_cast<std::size_t>(n), i))
+                                 {
+                                     return false;
+                                 }
+                             }
+                             return i == messages;
+                         });
+
+    close(fds[0]);
+    close(fds[1]);
+    return secs;
+}
+
+double throughput_channel(std::uint64_t messages, std::size_t batch_bytes)
+{
+    auto ch = ipc::channel::create(1 << 20);
+    ipc::options opts;
+    opts.batch_bytes = batch_bytes;
+
+    return run_pair([&]
+                    {
+                        ipc::producer out{ch, opts};
+                        for (std::uint64_t i = 0; i < messages; i++)
+                        {
+                            // written in place in the ring
+                            auto size = message_size(i);
+                            fill(out.claim(size).data(), i);
+                            out.commit(size);
+                        }
+                        out.close();
+                        return true;
+                    },
+                    [&]
+                    {
+                        ipc::consumer in{ch, opts};
+                        std::uint64_t i = 0;
+                        while (auto msg = in.receive())
+                        {
+                            if (!valid(msg->data(), msg->size(), i++))
+                            {
+                                return false;
+                            }
+                        }
+                        return i == messages;
+                    });
+}
+
+// Step 3. round trips
+struct latency
+{
+    double p50_us;
+    double p99_us;
+};
+
+latency summarize(std::vector<double> &samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return {samples[samples.size() / 2] / 1000.0, samples[samples.size() * 99 / 100] / 1000.0};
+}
+
+template <typename SEND, typename RECEIVE>
+std::vector<double> ping(std::uint64_t round_trips, SEND send_message, RECEIVE receive_message)
+{
+    std::vector<double> samples;
+    samples.reserve(round_trips);
+
+    char message[64] = {};
+    for (std::uint64_t i = 0; i < round_trips; i++)
+    {
+        auto start = steady::now();
+        send_message(message, sizeof(message));
+        receive_message(message, sizeof(message));
+        samples.push_back(std::chrono::duration<double, std::nano>(steady::now() - start).count());
+    }
+
+    return samples;
+}
+
+latency round_trip_fd(std::uint64_t round_trips, bool socket)
+{
+    int there[2], back[2];
+    auto make = [socket](int *fds)
+    {
+        if ((socket ? socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) : pipe(fds)) < 0)
+        {
+            throw std::runtime_error(std::string{"pipe: "} + strerror(errno));
+        }
+    };
+    make(there);
+    make(back);
+
+    std::vector<double> samples;
+    run_pair([&]
+             {
+                 samples = ping(
+                     round_trips, [&](const char *data, std::size_t size)
+                     { return write(there[1], data, size); },
+                     [&](char *data, std::size_t size)
+                     { return read(back[0], data, size); });
+                 close(there[1]);
+                 return true;
+             },
+             [&]
+             {
+                 close(there[1]);
+                 char message[64];
+                 for (ssize_t n; (n = read(there[0], message, sizeof(message))) > 0;)
+                 {
+                     if (write(back[1], message, static_cast<std::size_t>(n)) != n)
+                     {
+                         return false;
+                     }
+                 }
+                 return true;
+             });
+
+    for (auto fd : {there[0], there[1], back[0], back[1]})
+    {
+        close(fd);
+    }
+
+    return summarize(samples);
+}
+
+latency round_trip_channel(std::uint64_t round_trips)
+{
+    auto there = ipc::channel::create(1 << 16);
+    auto back = ipc::channel::create(1 << 16);
+
+    // every message is published at once
+    ipc::options opts;
+    opts.batch_bytes = 0;
+
+    std::vector<double> samples;
+    run_pair([&]
+             {
+                 ipc::producer out{there, opts};
+                 ipc::consumer in{back, opts};
+                 samples = ping(
+                     round_trips, [&](const char *data, std::size_t size)
+                     { out.send(data, size); },
+                     [&](char *data, std::size_t size)
+                     {
+                         auto msg = in.receive();
+                         std::memcpy(data, msg->data(), std::min(size, msg->size()));
+                     });
+                 out.close();
+                 return true;
+             },
+             [&]
+             {
+                 ipc::consumer in{there, opts};
+                 ipc::producer out{back, opts};
+                 while (auto msg = in.receive())
+                 {
+                     out.send(*msg);
+                 }
+                 return true;
+             });
+
+    return summarize(samples);
+}
+
+int protected_main(int argc, char **argv)
+{
+    std::uint64_t messages = 2000000;
+    std::uint64_t round_trips = 200000;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--messages="))
+        {
+            messages = std::stoull(arg.substr(11));
+        }
+        else if (arg.starts_with("--round-trips="))
+        {
+            round_trips = std::stoull(arg.substr(14));
+        }
+    }
+
+    auto bytes = static_cast<double>(total_bytes(messages));
+    std::cout << messages << " messages, " << bytes / 1e6 << " MB, " << sysconf(_SC_NPROCESSORS_ONLN) << " CPUs\n\n";
+    std::cout << std::left << std::setw(36) << "throughput" << std::right << std::setw(10) << "time s"
+              << std::setw(14) << "Mmsg/s" << std::setw(10) << "MB/s" << '\n';
+
+    auto report = [&](const std::string &name, double secs)
+    {
+        std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(10) << secs << std::setw(14) << static_cast<double>(messages) / secs / 1e6
+                  << std::setw(10) << std::setprecision(0) << bytes / secs / 1e6 << '\n';
+    };
+
+    report("mypipe", throughput_mypipe(messages));
+    report("pipe, length prefix", throughput_pipe(messages));
+    report("socketpair SOCK_SEQPACKET", throughput_socket(messages));
+    report("ipc::channel, batches of 4KB", throughput_channel(messages, 4096));
+    report("ipc::channel, every message", throughput_channel(messages, 0));
+
+    std::cout << '\n'
+              << std::left << std::setw(36) << "round trip, 64 bytes" << std::right << std::setw(10) << "p50 us"
+              << std::setw(14) << "p99 us" << '\n';
+
+    auto report_latency = [](const std::string &name, latency l)
+    {
+        std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(10) << l.p50_us << std::setw(14) << l.p99_us << '\n';
+    };
+
+    report_latency("pipe", round_trip_fd(round_trips, false));
+    report_latency("socketpair SOCK_SEQPACKET", round_trip_fd(round_trips, true));
+    report_latency("ipc::channel", round_trip_channel(round_trips));
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
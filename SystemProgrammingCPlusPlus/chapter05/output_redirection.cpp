@@ -1,6 +1,7 @@
 /**
  * @File    : output_redirection.cpp
  * @Brief   : Output redirection to shell
+ * @Command : g++ -std=c++2a -O2 -I../include output_redirection.cpp -o output_redirection
  * @Author  : Wei Li
  * @Date    : 2021-11-02
 */
@@ -12,6 +13,12 @@
 #include <string_view>
 #include <iostream>
 
+#include "launcher.hpp"
+
+/** The output of another program has to go through a file descriptor: after exec() the child only
+ * knows write(STDOUT_FILENO), so this stays a pipe. ipc::channel (include/shm_channel.hpp, used in
+ * interprocess_communication.cpp) is a ring in shared memory that both sides must access as such.
+ */
 class mypipe
 {
 private:
@@ -70,5 +77,28 @@ int main(int argc, char **argv)
         std::cout << p.read() << std::endl;
     }
 
+    /** The same without fork(): the redirection is a file action of the command,
+     * the child gets the write end of the pipe as its stdout (dup2 in the child, before exec).
+     */
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0)
+    {
+        return 1;
+    }
+
+    auto child = proc::spawn(proc::command{"ls"}.redirect(STDOUT_FILENO, fds[1]));
+    close(fds[1]);
+
+    std::string output;
+    std::array<char, 256> buf;
+    for (ssize_t bytes; (bytes = ::read(fds[0], buf.data(), buf.size())) > 0;)
+    {
+        output.append(buf.data(), static_cast<std::size_t>(bytes));
+    }
+    close(fds[0]);
+    child.wait();
+
+    std::cout << output << std::endl;
+
     return 0;
 }
@@ -0,0 +1,172 @@
+/**
+ * @File    : process_supervisor.cpp
+ * @Brief   : Supervising hundreds of worker processes from one epoll loop: pidfd, signalfd, timerfd, wait4
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include process_supervisor.cpp -o process_supervisor
+ * @Command : ./process_supervisor
+ * @Command : ./process_supervisor --workers=500 --seconds=10
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** The supervisor of include/supervisor.hpp, instead of wait() in a loop (wait_function.cpp)
+ * '--workers' shell processes (200 by default) that sleep 0.1s to 0.5s, then exit; one in three fails.
+ * The failing ones restart with a growing backoff (100ms, 200ms, ...), the others are restarted
+ * after a run as well (policy 'always'), every 10th one is never restarted.
+ * Every second the loop reports how many workers run, after '--seconds' (5 by default), or Ctrl+C,
+ * it shuts down: SIGTERM to every worker, SIGKILL after one second.
+ * The summary adds the resource usage wait4() returned for every run.
+ * One more worker names a program that does not exist: every spawn fails at once, and the summary
+ * checks that its restarts backed off instead of spinning.
+ */
+
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "supervisor.hpp"
+
+// the most runs a worker failing at once can make in 'elapsed' with a doubling backoff
+unsigned max_failing_runs(const proc::restart_policy &policy, std::chrono::steady_clock::duration elapsed)
+{
+    unsigned runs = 1;
+    auto delay = policy.initial_backoff;
+    for (auto waited = delay; waited <= elapsed; waited += delay)
+    {
+        runs++;
+        delay = std::min(delay * 2, policy.max_backoff);
+    }
+    return runs;
+}
+
+int protected_main(int argc, char **argv)
+{
+    auto workers = 200;
+    auto seconds = 5;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--workers="))
+        {
+            workers = std::stoi(arg.substr(10));
+        }
+        else if (arg.starts_with("--seconds="))
+        {
+            seconds = std::stoi(arg.substr(10));
+        }
+    }
+
+    proc::supervisor supervisor;
+
+    // Step 1. the workers
+    for (auto i = 0; i < workers; i++)
+    {
+        auto script = "sleep 0." + std::to_string(i % 5 + 1) + "; exit " + std::to_string(i % 3 == 0 ? 1 : 0);
+
+        proc::restart_policy policy;
+        policy.restart = i % 10 == 9 ? proc::restart_policy::never
+                         : i % 3 == 0 ? proc::restart_policy::on_failure
+                                      : proc::restart_policy::always;
+        policy.max_backoff = std::chrono::seconds{2};
+
+        supervisor.add("worker-" + std::to_string(i), proc::command{"sh"}.args({"-c", script}), policy);
+    }
+
+    proc::restart_policy broken_policy;
+    broken_policy.max_backoff = std::chrono::seconds{2};
+    auto broken = supervisor.add("broken", proc::command{"./no_such_program"}, broken_policy);
+
+    // Step 2. timers and signals, all events of the same loop
+    auto start = std::chrono::steady_clock::now();
+    auto tick = 0;
+    supervisor.every(std::chrono::seconds{1}, [&]
+                     {
+                         std::cout << ++tick << "s: " << supervisor.running() << " running" << std::endl;
+                         if (tick == seconds)
+                         {
+                             supervisor.shutdown(std::chrono::seconds{1});
+                         }
+                     });
+
+    supervisor.on_signal([&](int sig)
+                         {
+                             std::cout << "signal " << sig << ", shutting down" << std::endl;
+                             supervisor.shutdown(std::chrono::seconds{1});
+                         });
+
+    supervisor.run();
+    auto duration = std::chrono::steady_clock::now() - start;
+    auto elapsed = std::chrono::duration<double>(duration).count();
+
+    // Step 3. what the workers did
+    unsigned runs = 0, failed = 0;
+    proc::resource_usage total;
+    const proc::worker *busiest = nullptr;
+    for (auto &w : supervisor.workers())
+    {
+        if (w.id == broken)
+        {
+            continue;
+        }
+        runs += w.runs;
+        failed += w.failures;
+        total.user_seconds += w.usage.user_seconds;
+        total.system_seconds += w.usage.system_seconds;
+        total.max_rss_kb = std::max(total.max_rss_kb, w.usage.max_rss_kb);
+        total.minor_faults += w.usage.minor_faults;
+        total.context_switches += w.usage.context_switches;
+        if (busiest == nullptr || w.runs > busiest->runs)
+        {
+            busiest = &w;
+        }
+    }
+
+    std::cout << '\n'
+              << std::left << std::setw(28) << "workers" << workers << '\n'
+              << std::setw(28) << "runs" << runs << " in " << std::fixed << std::setprecision(2) << elapsed << " s\n"
+              << std::setw(28) << "consecutive failures" << failed << '\n'
+              << std::setw(28) << "user / system CPU" << total.user_seconds << " s / " << total.system_seconds << " s\n"
+              << std::setw(28) << "largest peak RSS" << total.max_rss_kb << " KB\n"
+              << std::setw(28) << "minor faults" << total.minor_faults << '\n'
+              << std::setw(28) << "context switches" << total.context_switches << '\n';
+    if (busiest != nullptr)
+    {
+        std::cout << std::setw(28) << "most runs" << busiest->name << " (" << busiest->runs << ")\n";
+    }
+
+    // Step 4. the worker that never starts: its delay doubled with every failed spawn
+    auto &w = supervisor.workers()[broken];
+    auto limit = max_failing_runs(broken_policy, duration);
+    std::cout << std::setw(28) << "failed spawns" << w.runs << " (backoff allows " << limit << "), "
+              << w.failures << " consecutive\n";
+    if (w.runs > limit)
+    {
+        std::cerr << "the restarts of a worker that cannot start did not back off\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,124 @@
+/**
+ * @File    : spawn_benchmark.cpp
+ * @Brief   : Process start rate of fork + exec, posix_spawn and clone(CLONE_VM | CLONE_VFORK) against the size of the parent
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include spawn_benchmark.cpp -o spawn_benchmark
+ * @Command : ./spawn_benchmark
+ * @Command : ./spawn_benchmark --rss=10240 --count=200
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** How much does the parent cost
+ * The same command (/bin/true, stdout redirected to /dev/null) is started and waited for '--count' times
+ * (500 by default) with each backend of proc::spawn() (include/launcher.hpp), twice:
+ * from the small process the program starts as, then after it allocated and touched '--rss' MB (1GB by default).
+ *
+ * fork() copies the page tables of the parent: its time grows with the resident size,
+ * posix_spawn() and clone(CLONE_VM | CLONE_VFORK) share the address space and should not move.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "launcher.hpp"
+
+double spawn_rate(const proc::command &cmd, proc::backend how, int count)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (auto i = 0; i < count; i++)
+    {
+        if (!proc::run(cmd, how).success())
+        {
+            throw std::runtime_error("the command failed");
+        }
+    }
+
+    return count / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int protected_main(int argc, char **argv)
+{
+    std::size_t rss_mb = 1024;
+    auto count = 500;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--rss="))
+        {
+            rss_mb = std::stoull(arg.substr(6));
+        }
+        else if (arg.starts_with("--count="))
+        {
+            count = std::stoi(arg.substr(8));
+        }
+    }
+
+    proc::command cmd{"/bin/true"};
+    cmd.redirect(STDOUT_FILENO, "/dev/null", O_WRONLY);
+
+    const std::pair<const char *, proc::backend> backends[] = {
+        {"fork + exec", proc::backend::fork_exec},
+        {"posix_spawn", proc::backend::posix_spawn},
+        {"clone(CLONE_VM | CLONE_VFORK)", proc::backend::clone_vfork},
+    };
+
+    double small[3];
+    for (auto i = 0; i < 3; i++)
+    {
+        small[i] = spawn_rate(cmd, backends[i].second, count);
+    }
+
+    // every page touched: resident, with page table entries fork() has to copy
+    auto size = rss_mb << 20;
+    std::unique_ptr<char[]> memory{new char[size]};
+    std::memset(memory.get(), 1, size);
+
+    double large[3];
+    for (auto i = 0; i < 3; i++)
+    {
+        large[i] = spawn_rate(cmd, backends[i].second, count);
+    }
+
+    std::cout << count << " x /bin/true\n\n";
+    std::cout << std::left << std::setw(32) << "backend" << std::right << std::setw(16) << "small parent"
+              << std::setw(16) << (std::to_string(rss_mb) + "MB parent") << std::setw(16) << "us per spawn" << '\n';
+    for (auto i = 0; i < 3; i++)
+    {
+        std::cout << std::left << std::setw(32) << backends[i].first << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(12) << small[i] << " /s " << std::setw(12) << large[i] << " /s "
+                  << std::setw(16) << std::setprecision(1) << 1e6 / large[i] << '\n';
+    }
+
+    // keeps the memory alive until here
+    std::cout << "\n(" << static_cast<int>(memory[size - 1]) << ")\n";
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
@@ -1,6 +1,7 @@
 /**
  * @File    : unix_signals.cpp
  * @Brief   : Unix signals, Interrupt, handle specific types of control flow and errors, segmentation fault; kill command
+ * @Command : g++ -std=c++2a -O2 -I../include unix_signals.cpp -o unix_signals
  * @Author  : Wei Li
  * @Date    : 2021-11-02
 */
@@ -10,6 +11,9 @@
 #include <sys/wait.h>
 #include <iostream>
 
+#include "launcher.hpp"
+#include "supervisor.hpp"
+
 // example 2
 void handler_1(int sig)
 {
@@ -32,17 +36,23 @@ void handler(int sig)
 }
 
 // example 4
+/** The child is started with posix_spawn() and signalled through its pidfd (pidfd_send_signal):
+ * kill(pid) could hit another process if the child had already exited and its pid was reused.
+ * The destructor of proc::child waits for it, the child does not stay a zombie.
+ */
 void mysystem(const char *command)
 {
-    if (auto id = fork(); id > 0)
+    // a program that cannot be started (b.out is not built) is reported, main() goes on
+    try
     {
+        auto child = proc::spawn(proc::command{command});
         sleep(2);
-        // man 2 kill
-        kill(id, SIGINT);
+        // man 2 pidfd_send_signal
+        child.kill(SIGINT);
     }
-    else
+    catch (const std::runtime_error &e)
     {
-        execlp(command, command, nullptr);
+        std::cerr << command << ": " << e.what() << std::endl;
     }
 }
 
@@ -79,5 +89,19 @@ int main(int argc, char** argv)
     // ------------ Example 4 ------------
     mysystem("b.out");
 
+    // ------------ Example 5 ------------
+    /** Without a handler and a global flag: SIGINT is blocked and read from a signalfd
+     * in the event loop of proc::supervisor (include/supervisor.hpp), which also notices
+     * the exit of the child through its pidfd. Ctrl + C stops the child and the loop.
+     */
+    proc::supervisor supervisor{SIGINT};
+    supervisor.add("b.out", proc::command{"b.out"}, {proc::restart_policy::never});
+    supervisor.on_signal([&supervisor](int)
+                         {
+                             std::cout << "SIGINT received" << std::endl;
+                             supervisor.shutdown();
+                         });
+    supervisor.run();
+
     return 0;
 }
@@ -0,0 +1,435 @@
+/**
+ * @File    : format_benchmark.cpp
+ * @Brief   : fastfmt versus iostreams, printf and std::to_chars for formatting and parsing 100M numbers
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include format_benchmark.cpp -o format_benchmark
+ * @Command : ./format_benchmark
+ * @Command : ./format_benchmark --count=10000000 --format=json
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Formatting numbers
+ * Each case formats '--count' numbers (100M by default), one per line, into a 64KB buffer that is
+ * discarded when it is full, so that only the formatting is measured and not the terminal or a file.
+ * The numbers are processed in blocks of 1M, one block per sample of the benchmark harness.
+ *
+ * Three kinds of numbers:
+ * - uint64_t with a uniform number of digits (1 to 20),
+ * - the same numbers in the format of usr::hex (0x and 16 zero-padded digits),
+ * - doubles, with 17 significant digits for iostreams and printf (round-trip precision),
+ *   and the shortest round-trip representation for std::to_chars and fastfmt.
+ *
+ * Five ways to format them:
+ * - std::ostream with the manipulators of performance_stream.cpp,
+ * - snprintf(),
+ * - std::to_chars() (no padding: for hex it writes the digits only),
+ * - fastfmt::write() with a run-time spec,
+ * - fastfmt::format_to<"...">() with a compile-time format string.
+ *
+ * The text of the uint64_t and double cases is then parsed back with operator>>, strtoull()/strtod(),
+ * std::from_chars() and fastfmt::parse(), checking every value.
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "fast_format.hpp"
+
+constexpr std::size_t block = 1 << 20;
+
+// Step 1. the destination: a buffer that is thrown away when it is full
+class sink
+{
+public:
+    static constexpr std::size_t room = 128;
+
+    char *ptr()
+    {
+        return m_ptr;
+    }
+
+    char *end()
+    {
+        return m_buffer + sizeof(m_buffer);
+    }
+
+    // called with the end of the last value, makes sure the next value has 'room' bytes
+    void advance(char *next)
+    {
+        m_ptr = next;
+        if (static_cast<std::size_t>(end() - m_ptr) < room)
+        {
+            m_bytes += static_cast<std::size_t>(m_ptr - m_buffer);
+            m_ptr = m_buffer;
+        }
+    }
+
+    std::uint64_t bytes() const
+    {
+        return m_bytes + static_cast<std::size_t>(m_ptr - m_buffer);
+    }
+
+private:
+    char m_buffer[64 << 10];
+    char *m_ptr{m_buffer};
+    std::uint64_t m_bytes{};
+};
+
+// the same for std::ostream
+class null_buf : public std::streambuf
+{
+public:
+    null_buf()
+    {
+        setp(m_buffer, m_buffer + sizeof(m_buffer));
+    }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        setp(m_buffer, m_buffer + sizeof(m_buffer));
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+
+        return traits_type::not_eof(ch);
+    }
+
+private:
+    char m_buffer[64 << 10];
+};
+
+namespace usr
+{
+    class hex_t
+    {
+    } hex;
+}
+
+std::ostream &operator<<(std::ostream &os, const usr::hex_t &)
+{
+    os << std::hex << std::showbase << std::internal
+       << std::setfill('0') << std::setw(18);
+
+    return os;
+}
+
+// Step 2. the text of a block, one number per line
+template <typename T>
+std::string make_text(const std::vector<T> &values)
+{
+    std::string text;
+    char buffer[64];
+    for (auto v : values)
+    {
+        auto result = fastfmt::format_to<"{}\n">(buffer, buffer + sizeof(buffer), v);
+        text.append(buffer, result.ptr);
+    }
+
+    return text;
+}
+
+template <typename T>
+void check(const std::vector<T> &parsed, const std::vector<T> &values, const std::string &name)
+{
+    if (parsed != values)
+    {
+        throw std::runtime_error(name + ": the parsed values differ");
+    }
+}
+
+int protected_main(int argc, char **argv)
+{
+    std::uint64_t count = 100000000;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--count="))
+        {
+            count = std::stoull(arg.substr(8));
+        }
+    }
+
+    // one block per sample, 'count' numbers per case
+    auto opts = bench::parse_args(argc, argv);
+    opts.samples = std::max<std::uint64_t>(count / block, 3);
+    opts.warmup_time = std::chrono::nanoseconds{0};
+    opts.min_sample_time = std::chrono::nanoseconds{0};
+
+    std::mt19937_64 rng{42};
+    std::vector<std::uint64_t> integers(block);
+    std::vector<double> doubles(block);
+    for (std::size_t i = 0; i < block; i++)
+    {
+        integers[i] = rng() >> (rng() % 64);
+        doubles[i] = std::ldexp(static_cast<double>(rng() >> 11), static_cast<int>(rng() % 80) - 100);
+    }
+
+    bench::reporter reporter{opts};
+    sink out;
+
+    null_buf discard;
+    std::ostream os{&discard};
+
+    // Step 3. formatting
+    reporter.run("u64 iostream", [&]
+                 {
+                     for (auto v : integers)
+                     {
+                         os << v << '\n';
+                     }
+                 });
+    reporter.run("u64 snprintf", [&]
+                 {
+                     for (auto v : integers)
+                     {
+                         out.advance(out.ptr() + snprintf(out.ptr(), sink::room, "%" PRIu64 "\n", v));
+                     }
+                 });
+    reporter.run("u64 std::to_chars", [&]
+                 {
+                     for (auto v : integers)
+                     {
+                         auto end = std::to_chars(out.ptr(), out.end(), v).ptr;
+                         *end++ = '\n';
+                         out.advance(end);
+                     }
+                 });
+    reporter.run("u64 fastfmt::write", [&]
+                 {
+                     for (auto v : integers)
+                     {
+                         auto end = fastfmt::write(out.ptr(), out.end(), v).ptr;
+                         *end++ = '\n';
+                         out.advance(end);
+                     }
+                 });
+    reporter.run("u64 fastfmt::format_to", [&]
+                 {
+                     for (auto v : integers)
+                     {
+                         out.advance(fastfmt::format_to<"{}\n">(out.ptr(), out.end(), v).ptr);
+                     }
+                 });
+
+    reporter.run("hex iostream usr::hex", [&]
+                 {
+                     auto flags = os.flags();
+                     for (auto v : integers)
+                     {
+                         os << usr::hex << v << '\n';
+                     }
+                     os.flags(flags);
+                 });
+    reporter.run("hex snprintf", [&]
+                 {
+                     for (auto v : integers)
+                     {
+                         out.advance(out.ptr() + snprintf(out.ptr(), sink::room, "%#018" PRIx64 "\n", v));
+                     }
+                 });
+    reporter.run("hex std::to_chars (digits only)", [&]
+                 {
+                     for (auto v : integers)
+                     {
+                         auto end = std::to_chars(out.ptr(), out.end(), v, 16).ptr;
+                         *end++ = '\n';
+                         out.advance(end);
+                     }
+                 });
+    reporter.run("hex fastfmt::write", [&]
+                 {
+                     for (auto v : integers)
+                     {
+                         auto end = fastfmt::write(out.ptr(), out.end(), v, fastfmt::hex).ptr;
+                         *end++ = '\n';
+                         out.advance(end);
+                     }
+                 });
+    reporter.run("hex fastfmt::format_to", [&]
+                 {
+                     for (auto v : integers)
+                     {
+                         out.advance(fastfmt::format_to<"{:#018x}\n">(out.ptr(), out.end(), v).ptr);
+                     }
+                 });
+
+    reporter.run("double iostream", [&]
+                 {
+                     auto precision = os.precision(17);
+                     for (auto v : doubles)
+                     {
+                         os << v << '\n';
+                     }
+                     os.precision(precision);
+                 });
+    reporter.run("double snprintf", [&]
+                 {
+                     for (auto v : doubles)
+                     {
+                         out.advance(out.ptr() + snprintf(out.ptr(), sink::room, "%.17g\n", v));
+                     }
+                 });
+    reporter.run("double std::to_chars", [&]
+                 {
+                     for (auto v : doubles)
+                     {
+                         auto end = std::to_chars(out.ptr(), out.end(), v).ptr;
+                         *end++ = '\n';
+                         out.advance(end);
+                     }
+                 });
+    reporter.run("double fastfmt::write", [&]
+                 {
+                     for (auto v : doubles)
+                     {
+                         auto end = fastfmt::write(out.ptr(), out.end(), v).ptr;
+                         *end++ = '\n';
+                         out.advance(end);
+                     }
+                 });
+    reporter.run("double fastfmt::format_to", [&]
+                 {
+                     for (auto v : doubles)
+                     {
+                         out.advance(fastfmt::format_to<"{}\n">(out.ptr(), out.end(), v).ptr);
+                     }
+                 });
+
+    // Step 4. parsing the text back
+    auto integer_text = make_text(integers);
+    auto double_text = make_text(doubles);
+    std::vector<std::uint64_t> parsed_integers(block);
+    std::vector<double> parsed_doubles(block);
+
+    reporter.run("u64 parse iostream", [&]
+                 {
+                     std::istringstream is{integer_text};
+                     for (auto &v : parsed_integers)
+                     {
+                         is >> v;
+                     }
+                 });
+    check(parsed_integers, integers, "iostream");
+    reporter.run("u64 parse strtoull", [&]
+                 {
+                     auto ptr = integer_text.c_str();
+                     for (auto &v : parsed_integers)
+                     {
+                         char *end;
+                         v = strtoull(ptr, &end, 10);
+                         ptr = end + 1;
+                     }
+                 });
+    check(parsed_integers, integers, "strtoull");
+    reporter.run("u64 parse std::from_chars", [&]
+                 {
+                     const char *ptr = integer_text.data();
+                     auto end = integer_text.data() + integer_text.size();
+                     for (auto &v : parsed_integers)
+                     {
+                         ptr = std::from_chars(ptr, end, v).ptr + 1;
+                     }
+                 });
+    check(parsed_integers, integers, "from_chars");
+    reporter.run("u64 parse fastfmt::parse", [&]
+                 {
+                     std::string_view text{integer_text};
+                     for (auto &v : parsed_integers)
+                     {
+                         auto line = text.find('\n');
+                         v = fastfmt::parse<std::uint64_t>(text.substr(0, line));
+                         text.remove_prefix(line + 1);
+                     }
+                 });
+    check(parsed_integers, integers, "fastfmt");
+
+    reporter.run("double parse iostream", [&]
+                 {
+                     std::istringstream is{double_text};
+                     for (auto &v : parsed_doubles)
+                     {
+                         is >> v;
+                     }
+                 });
+    check(parsed_doubles, doubles, "iostream");
+    reporter.run("double parse strtod", [&]
+                 {
+                     auto ptr = double_text.c_str();
+                     for (auto &v : parsed_doubles)
+                     {
+                         char *end;
+                         v = strtod(ptr, &end);
+                         ptr = end + 1;
+                     }
+                 });
+    check(parsed_doubles, doubles, "strtod");
+    reporter.run("double parse std::from_chars", [&]
+                 {
+                     const char *ptr = double_text.data();
+                     auto end = double_text.data() + double_text.size();
+                     for (auto &v : parsed_doubles)
+                     {
+                         ptr = std::from_chars(ptr, end, v).ptr + 1;
+                     }
+                 });
+    check(parsed_doubles, doubles, "from_chars");
+    reporter.run("double parse fastfmt::parse", [&]
+                 {
+                     std::string_view text{double_text};
+                     for (auto &v : parsed_doubles)
+                     {
+                         auto line = text.find('\n');
+                         v = fastfmt::parse<double>(text.substr(0, line));
+                         text.remove_prefix(line + 1);
+                     }
+                 });
+    check(parsed_doubles, doubles, "fastfmt");
+
+    reporter.print();
+
+    std::cout << '\n'
+              << std::left << std::setw(36) << "per number" << std::right << std::setw(12) << "ns" << '\n';
+    for (const auto &r : reporter.results())
+    {
+        std::cout << std::left << std::setw(36) << r.name << std::right << std::setw(12) << std::fixed << std::setprecision(2)
+                  << r.median_ns / static_cast<double>(block) << '\n';
+    }
+
+    bench::do_not_optimize(out.bytes());
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
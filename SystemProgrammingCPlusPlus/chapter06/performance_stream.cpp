@@ -1,6 +1,7 @@
 /**
  * @File    : performance_stream.cpp
  * @Brief   : Performance of C++ streams and Control manipulators
+ * @Command : g++ -std=c++2a -I../include performance_stream.cpp
  * @Author  : Wei Li
  * @Date    : 2021-11-03
 */
@@ -9,6 +10,8 @@
 #include <iostream>
 #include <iomanip>
 
+#include "fast_format.hpp"
+
 template <typename FUNC>
 void cout_transaction(FUNC f)
 {
@@ -125,5 +128,18 @@ int main(int argc, char **argv)
     std::cout << "-----------------------------" << '\n';
     std::cout << "The answer is: " << usr::hex << 42 << '\n';
 
+    // Without stream state: the spec goes with each value, nothing has to be restored afterwards,
+    // the format string is parsed at compile time and the digits come from std::to_chars-style tables
+    // (include/fast_format.hpp, measured against iostreams and printf in format_benchmark.cpp).
+    std::cout << "-----------------------------" << '\n';
+    std::cout << fastfmt::format<"The answer is: {:#018x}\n">(42);
+    std::cout << fastfmt::format<"The answer is: {:#018x}\n">(&num);
+    std::cout << fastfmt::format<"The answer is: {:>18} {:<8}|\n">(42, true);
+
+    // or into a buffer owned by the caller, with the usr::hex equivalent
+    char buffer[32];
+    auto result = fastfmt::write(buffer, buffer + sizeof(buffer), 42, fastfmt::hex);
+    std::cout.write(buffer, result.ptr - buffer) << '\n';
+
     return 0;
 }
@@ -0,0 +1,169 @@
+/**
+ * @File    : tracing_example.cpp
+ * @Brief   : Hot-path tracing with per-thread binary ring buffers instead of iostream debugging
+ * -------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include tracing_example.cpp -lpthread -o tracing_example
+ * @Command : ./tracing_example
+ * @Command : g++ -std=c++2a -O2 -I../include ../tools/trace_decode.cpp -o trace_decode
+ * @Command : ./trace_decode trace.bin > trace.json
+ * -------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** From debug<LEVEL>() to trace points
+ * The debug<LEVEL>() template of debugging_patterns.cpp formats its message through std::cout
+ * on the calling thread. That is fine while debugging, but far too slow to leave enabled on a server.
+ *
+ * A trace point (include/trace.hpp) only stores a timestamp, a pointer to its static descriptor
+ * and the raw argument values into a ring buffer of the calling thread.
+ * The formatting happens offline in tools/trace_decode.cpp, which writes Chrome trace JSON.
+ *
+ * This example:
+ * 1. measures the cost of a trace point against the iostream debug pattern,
+ * 2. traces a small multi-threaded workload and writes it to trace.bin.
+ */
+
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+#include "benchmark.hpp"
+#include "trace.hpp"
+
+// Step 1. the debug pattern of debugging_patterns.cpp, writing into a string stream
+// so that the terminal does not dominate the measurement
+std::stringstream g_debug_stream;
+
+template <std::size_t LEVEL, typename FUNC>
+void debug(FUNC func)
+{
+    g_debug_stream << "\033[1;32mDEBUG\033[0m ";
+    func();
+}
+
+// Step 2. a workload with trace points: every call is a complete event with nested instant events
+std::uint64_t work(int id, std::uint64_t n)
+{
+    TRACE_SCOPE("example", "work");
+
+    std::uint64_t total = 0;
+    for (std::uint64_t i = 0; i < n; i++)
+    {
+        total += i * i;
+
+        if (i % 1000 == 0)
+        {
+            TRACE_INSTANT("example", "progress", id, i, total);
+        }
+    }
+
+    return total;
+}
+
+// events dropped so far by every thread
+std::uint64_t dropped_events()
+{
+    std::uint64_t dropped = 0;
+    trace::registry::instance().for_each([&dropped](trace::ring &r)
+                                         { dropped += r.dropped(); });
+    return dropped;
+}
+
+// A ring holds trace::ring_size events: bench::run() would fill it within a sample and then time the
+// drop path. Each sample here is half a ring, and the session drains the ring before every sample.
+template <typename FUNC>
+bench::result run_traced(std::string_view name, trace::session &session, const bench::options &opts, FUNC func)
+{
+    constexpr std::uint64_t batch = trace::ring_size / 2;
+
+    std::vector<double> samples;
+    for (std::size_t i = 0; i <= std::max<std::size_t>(opts.samples, 1); i++)
+    {
+        session.flush();
+
+        auto d = bench::detail::time_batch(func, batch);
+
+        // the first batch warms up
+        if (i != 0)
+        {
+            samples.push_back(std::chrono::duration<double, std::nano>(d).count() / static_cast<double>(batch));
+        }
+    }
+
+    return bench::summarize(name, batch, std::move(samples), opts.outlier_k);
+}
+
+int protected_main(int argc, char **argv)
+{
+    // the session opens the trace file and flushes the rings every 100ms from a background thread
+    trace::session session{"trace.bin"};
+    session.start();
+
+    // Step 3. cost of one call site on the calling thread
+    bench::reporter reporter{bench::parse_args(argc, argv)};
+
+    std::uint64_t value = 42;
+    reporter.run("debug<0> iostream", [&value]
+                 {
+                     debug<0>([&value]
+                              { g_debug_stream << __FILE__ << " [" << __LINE__ << "]: " << value << '\n'; });
+                     g_debug_stream.str({});
+                 });
+
+    auto dropped_before = dropped_events();
+    reporter.add(run_traced("TRACE_INSTANT 1 arg", session, reporter.opts(), [&value]
+                            { TRACE_INSTANT("bench", "one", value); }));
+
+    reporter.add(run_traced("TRACE_INSTANT 4 args", session, reporter.opts(), [&value]
+                            { TRACE_INSTANT("bench", "four", value, value + 1, 3.14, &value); }));
+
+    reporter.print();
+    std::cout << "events dropped during the benchmark: " << dropped_events() - dropped_before << "\n\n";
+
+    // Step 4. a traced multi-threaded workload
+
+    std::vector<std::thread> threads;
+    for (auto id = 0; id < 4; id++)
+    {
+        threads.emplace_back([id]
+                             {
+                                 for (auto i = 0; i < 10; i++)
+                                 {
+                                     bench::do_not_optimize(work(id, 100000));
+                                 }
+                             });
+    }
+
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    session.stop();
+    session.flush();
+
+    std::cout << "trace written to trace.bin, decode with: trace_decode trace.bin > trace.json\n";
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
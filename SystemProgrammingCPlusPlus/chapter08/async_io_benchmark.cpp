@@ -0,0 +1,414 @@
+/**
+ * @File    : async_io_benchmark.cpp
+ * @Brief   : fio-like benchmark of the asynchronous file I/O engine (io_uring and thread pool)
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include async_io_benchmark.cpp -lpthread -o async_io_benchmark
+ * @Command : ./async_io_benchmark
+ * @Command : ./async_io_benchmark --rw=randread --bs=4K --iodepth=32 --direct=1 --runtime=5
+ * @Command : ./async_io_benchmark --rw=write --bs=128K --iodepth=8 --engine=threads
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Queue depth and throughput
+ * A single synchronous reader has one request in flight: every request waits for the previous one,
+ * and the throughput is block size / latency. An NVMe SSD serves many requests in parallel,
+ * so the throughput grows with the number of requests in flight until the device saturates,
+ * after which only the latency grows (Little's law: in flight = throughput x latency).
+ *
+ * With --rw the benchmark runs one job like fio does: one file, one access pattern, a fixed
+ * queue depth, for --runtime seconds, and prints IOPS, bandwidth and the latency distribution.
+ * Without --rw it sweeps the queue depth from 1 to 128 for 4KB random reads with O_DIRECT,
+ * on both back ends of include/async_file.hpp, to show where the device saturates.
+ *
+ * The options follow fio: --rw=read|write|randread|randwrite, --bs, --iodepth, --size,
+ * --runtime (seconds), --direct=0|1, --engine=uring|threads, --fixed=0|1 (registered
+ * file and buffers, io_uring only), --filename.
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "async_file.hpp"
+
+// Step 1. the job description, with the defaults of the queue depth sweep
+struct job
+{
+    std::string rw{"randread"};
+    std::uint64_t bs{4 << 10};
+    unsigned iodepth{32};
+    std::uint64_t size{1ULL << 30};
+    double runtime{5};
+    bool direct{true};
+    bool fixed{true};
+    aio::backend engine{aio::backend::uring};
+    std::string filename{"aio_bench.dat"};
+};
+
+struct result
+{
+    double seconds{};
+    std::uint64_t ios{};
+    std::uint64_t errors{};
+    std::vector<std::uint32_t> latencies_ns;
+};
+
+std::uint64_t parse_size(const std::string &str)
+{
+    auto value = std::stoull(str);
+    switch (str.back())
+    {
+    case 'G':
+    case 'g':
+        return value << 30;
+    case 'M':
+    case 'm':
+        return value << 20;
+    case 'K':
+    case 'k':
+        return value << 10;
+    default:
+        return value;
+    }
+}
+
+// Step 2. the data file, filled once with random data (reads of a sparse file never reach the disk)
+void create_file(const std::string &filename, std::uint64_t size)
+{
+    struct stat st{};
+    if (stat(filename.c_str(), &st) == 0 && static_cast<std::uint64_t>(st.st_size) >= size)
+    {
+        return;
+    }
+
+    std::cout << "laying out " << filename << " (" << size / (1 << 20) << " MB)...\n";
+
+    auto fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+    {
+        throw std::runtime_error(filename + ": " + strerror(errno));
+    }
+
+    std::vector<std::uint64_t> buf((1 << 20) / sizeof(std::uint64_t));
+    std::mt19937_64 rng{1};
+
+    for (std::uint64_t pos = 0; pos < size; pos += (1 << 20))
+    {
+        for (auto &word : buf)
+        {
+            word = rng();
+        }
+
+        auto len = std::min<std::uint64_t>(1 << 20, size - pos);
+        if (write(fd, buf.data(), len) != static_cast<ssize_t>(len))
+        {
+            close(fd);
+            throw std::runtime_error(filename + ": " + strerror(errno));
+        }
+    }
+
+    fsync(fd);
+    close(fd);
+}
+
+// Step 3. run a job: 'iodepth' requests are kept in flight, every completion issues the next request
+result run(const job &j)
+{
+    using namespace std::chrono;
+
+    auto write = j.rw == "write" || j.rw == "randwrite";
+    auto random = j.rw == "randread" || j.rw == "randwrite";
+
+    auto fd = open(j.filename.c_str(), (write ? O_RDWR : O_RDONLY) | (j.direct ? O_DIRECT : 0));
+    if (fd == -1 && j.direct && errno == EINVAL)
+    {
+        std::clog << "O_DIRECT is not supported here, using the page cache\n";
+        fd = open(j.filename.c_str(), write ? O_RDWR : O_RDONLY);
+    }
+
+    if (fd == -1)
+    {
+        throw std::runtime_error(j.filename + ": " + strerror(errno));
+    }
+
+    if (!j.direct)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    auto engine = aio::make_engine(aio::options{.queue_depth = j.iodepth, .use = j.engine, .threads = j.iodepth});
+
+    // one buffer per request slot, in a single allocation that is registered once
+    auto buf_size = j.bs * j.iodepth;
+    auto buffers = static_cast<char *>(std::aligned_alloc(4096, buf_size));
+    std::mt19937_64 rng{42};
+    for (std::uint64_t i = 0; i < buf_size; i++)
+    {
+        buffers[i] = static_cast<char>(rng());
+    }
+
+    auto file = fd;
+    if (j.fixed)
+    {
+        iovec iov{buffers, buf_size};
+        engine->register_buffers({&iov, 1});
+        engine->register_files({&fd, 1});
+        file = 0;
+    }
+
+    result res;
+    res.latencies_ns.reserve(1 << 20);
+
+    auto blocks = j.size / j.bs;
+    std::uint64_t next_block = 0;
+    std::vector<steady_clock::time_point> issued(j.iodepth);
+
+    auto start = steady_clock::now();
+    auto deadline = start + duration_cast<steady_clock::duration>(duration<double>(j.runtime));
+    auto stop = false;
+
+    std::function<void(unsigned)> issue = [&](unsigned slot)
+    {
+        auto block = random ? rng() % blocks : next_block++ % blocks;
+        auto buf = buffers + slot * j.bs;
+        auto len = static_cast<unsigned>(j.bs);
+
+        issued[slot] = steady_clock::now();
+
+        auto done = [&, slot, len](int result)
+        {
+            auto now = steady_clock::now();
+            res.latencies_ns.push_back(static_cast<std::uint32_t>(std::min<std::int64_t>(duration_cast<nanoseconds>(now - issued[slot]).count(), UINT32_MAX)));
+            res.ios++;
+            res.errors += result != static_cast<int>(len);
+
+            stop = stop || now >= deadline;
+            if (!stop)
+            {
+                issue(slot);
+            }
+        };
+
+        if (write)
+        {
+            engine->write(file, buf, len, block * j.bs, done);
+        }
+        else
+        {
+            engine->read(file, buf, len, block * j.bs, done);
+        }
+    };
+
+    for (unsigned slot = 0; slot < j.iodepth; slot++)
+    {
+        issue(slot);
+    }
+
+    engine->submit();
+    engine->wait();
+
+    res.seconds = duration<double>(steady_clock::now() - start).count();
+
+    std::free(buffers);
+    close(fd);
+
+    return res;
+}
+
+double percentile(std::vector<std::uint32_t> &values, double p)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+
+    auto nth = values.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+
+    return *nth / 1e3;
+}
+
+const char *engine_name(aio::backend b)
+{
+    return b == aio::backend::threads ? "threads" : "io_uring";
+}
+
+// Step 4. fio-like report of one job
+void report(const job &j, result &res)
+{
+    auto iops = static_cast<double>(res.ios) / res.seconds;
+    auto bw = iops * static_cast<double>(j.bs);
+
+    double avg = 0;
+    for (auto l : res.latencies_ns)
+    {
+        avg += l;
+    }
+    avg /= std::max<std::size_t>(1, res.latencies_ns.size()) * 1e3;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << j.rw << ": engine=" << engine_name(j.engine) << ", bs=" << j.bs / 1024 << "K, iodepth=" << j.iodepth
+              << ", direct=" << j.direct << ", fixed=" << j.fixed << '\n';
+    std::cout << "  " << (j.rw.find("write") != std::string::npos ? "write" : "read")
+              << ": IOPS=" << iops / 1e3 << "k, BW=" << bw / (1 << 20) << "MiB/s ("
+              << static_cast<double>(res.ios * j.bs) / (1 << 20) << "MiB/" << res.seconds * 1e3 << "msec)";
+    if (res.errors != 0)
+    {
+        std::cout << ", errors=" << res.errors;
+    }
+    std::cout << '\n';
+
+    std::cout << "    lat (usec): avg=" << avg << ", p50=" << percentile(res.latencies_ns, 0.5)
+              << ", p99=" << percentile(res.latencies_ns, 0.99) << ", p99.9=" << percentile(res.latencies_ns, 0.999)
+              << ", max=" << percentile(res.latencies_ns, 1.0) << '\n';
+}
+
+int protected_main(int argc, char **argv)
+{
+    job j;
+    auto sweep = true;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        auto value = arg.substr(arg.find('=') + 1);
+
+        if (arg.starts_with("--rw="))
+        {
+            j.rw = value;
+            sweep = false;
+        }
+        else if (arg.starts_with("--bs="))
+        {
+            j.bs = parse_size(value);
+        }
+        else if (arg.starts_with("--iodepth="))
+        {
+            j.iodepth = static_cast<unsigned>(std::stoul(value));
+        }
+        else if (arg.starts_with("--size="))
+        {
+            j.size = parse_size(value);
+        }
+        else if (arg.starts_with("--runtime="))
+        {
+            j.runtime = std::stod(value);
+        }
+        else if (arg.starts_with("--direct="))
+        {
+            j.direct = value == "1";
+        }
+        else if (arg.starts_with("--fixed="))
+        {
+            j.fixed = value == "1";
+        }
+        else if (arg.starts_with("--engine="))
+        {
+            j.engine = value == "threads" ? aio::backend::threads : aio::backend::uring;
+        }
+        else if (arg.starts_with("--filename="))
+        {
+            j.filename = value;
+        }
+        else
+        {
+            // --help included: running the sweep instead would write a 1GB file
+            if (arg != "--help")
+            {
+                std::cerr << "unknown argument: " << arg << '\n';
+            }
+            std::cerr << "usage: async_io_benchmark [--rw=read|write|randread|randwrite] [--bs=N] [--iodepth=N]\n"
+                         "                          [--size=N] [--runtime=SECONDS] [--direct=0|1] [--fixed=0|1]\n"
+                         "                          [--engine=uring|threads] [--filename=FILE]\n";
+            return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (!uring::supported() && j.engine == aio::backend::uring)
+    {
+        std::clog << "io_uring is not available, using the thread pool\n";
+        j.engine = aio::backend::threads;
+    }
+
+    // registered files and buffers only exist for io_uring
+    j.fixed = j.fixed && j.engine == aio::backend::uring;
+
+    create_file(j.filename, j.size);
+
+    if (!sweep)
+    {
+        auto res = run(j);
+        report(j, res);
+
+        return EXIT_SUCCESS;
+    }
+
+    // Step 5. queue depth sweep: 4KB random reads, both back ends
+    j.runtime = std::min(j.runtime, 2.0);
+
+    std::cout << std::left << std::setw(10) << "engine" << std::right << std::setw(8) << "iodepth"
+              << std::setw(12) << "IOPS" << std::setw(12) << "MiB/s" << std::setw(12) << "avg us" << std::setw(12) << "p99 us" << '\n';
+    std::cout << std::string(66, '-') << '\n';
+
+    for (auto engine : {aio::backend::uring, aio::backend::threads})
+    {
+        if (engine == aio::backend::uring && !uring::supported())
+        {
+            continue;
+        }
+
+        for (unsigned depth = 1; depth <= 128; depth *= 2)
+        {
+            auto current = j;
+            current.engine = engine;
+            current.iodepth = depth;
+            current.fixed = engine == aio::backend::uring;
+
+            auto res = run(current);
+
+            auto iops = static_cast<double>(res.ios) / res.seconds;
+            double avg = 0;
+            for (auto l : res.latencies_ns)
+            {
+                avg += l;
+            }
+            avg /= std::max<std::size_t>(1, res.latencies_ns.size()) * 1e3;
+
+            std::cout << std::left << std::setw(10) << engine_name(engine) << std::right << std::setw(8) << depth
+                      << std::fixed << std::setprecision(0) << std::setw(12) << iops
+                      << std::setprecision(1) << std::setw(12) << iops * static_cast<double>(current.bs) / (1 << 20)
+                      << std::setw(12) << avg << std::setw(12) << percentile(res.latencies_ns, 0.99) << '\n';
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,193 @@
+/**
+ * @File    : binary_logger_example.cpp
+ * @Brief   : Deferred-formatting binary logger versus the iostream log<LEVEL>() template
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include binary_logger_example.cpp -lpthread -o binary_logger
+ * @Command : ./binary_logger
+ * @Command : cat binary_log.txt
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Deferred formatting
+ * The original log<LEVEL>() of logger_example.cpp (now ported to the binary logger) formats every message
+ * on the calling thread: std::clog is redirected into a std::stringstream, the message is formatted,
+ * buf.str() is copied twice and written to std::clog and to the log file.
+ *
+ * The binary logger of include/binary_logger.hpp only copies the format string pointer,
+ * a timestamp and the raw arguments into a buffer of the calling thread.
+ * A background thread formats the records and writes them to the file.
+ *
+ * This example measures:
+ * 1. the latency of one log call on the calling thread (bench::run),
+ * 2. the throughput in messages per second with several threads logging at the same time.
+ *
+ * The latency benchmark logs far more messages than fit into one thread buffer,
+ * so it measures the sustained rate. With a single CPU the background thread runs on the same core,
+ * and its formatting time shows up in the wall time of the caller.
+ */
+
+#include <atomic>
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+#include "benchmark.hpp"
+#include "binary_logger.hpp"
+
+#ifdef DEBUG_LEVEL
+constexpr auto g_debug_level = DEBUG_LEVEL;
+#else
+constexpr auto g_debug_level = 0;
+#endif
+
+#ifdef NDEBUG
+constexpr auto g_ndebug = true;
+#else
+constexpr auto g_ndebug = false;
+#endif
+
+// Step 1. the original iostream log<LEVEL>() template of logger_example.cpp
+std::fstream g_log{"iostream_log.txt", std::ios::out | std::ios::app};
+
+template <std::size_t LEVEL, typename FUNC>
+constexpr void log(FUNC func)
+{
+    if constexpr (!g_ndebug && (LEVEL <= g_debug_level))
+    {
+        std::stringstream buf;
+
+        auto g_buf = std::clog.rdbuf();
+        std::clog.rdbuf(buf.rdbuf());
+
+        func();
+
+        std::clog.rdbuf(g_buf);
+
+        std::clog << "\033[1;32mDEBUG\033[0m: ";
+        std::clog << buf.str();
+
+        g_log << "\033[1;32mDEBUG\033[0m: ";
+        g_log << buf.str();
+    };
+}
+
+// Step 2. the same interface on top of the binary logger, the format string is checked at compile time
+template <std::size_t LEVEL, typename... ARGS>
+constexpr void log(binlog::format_string<std::type_identity_t<ARGS>...> fmt, const ARGS &...args)
+{
+    if constexpr (!g_ndebug && (LEVEL <= g_debug_level))
+    {
+        binlog::debug(fmt, args...);
+    }
+}
+
+// a stream buffer that discards everything, so that the terminal is not measured
+class null_buffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override
+    {
+        return c;
+    }
+
+    std::streamsize xsputn(const char *, std::streamsize n) override
+    {
+        return n;
+    }
+};
+
+int protected_main(int argc, char **argv)
+{
+    null_buffer null;
+    auto clog_buf = std::clog.rdbuf(&null);
+
+    bench::reporter reporter{bench::parse_args(argc, argv)};
+
+    // Step 3. latency on the calling thread
+    {
+        binlog::logger logger{"binary_log.txt", false};
+
+        std::uint64_t i = 0;
+        reporter.run("log<0> iostream", [&i]
+                     {
+                         static std::uint64_t value;
+                         value = i++;
+                         log<0>([]
+                                { std::clog << "request " << value << " took " << 0.25 << " ms\n"; });
+                     });
+
+        reporter.run("log<0> binary", [&i]
+                     { log<0>("request {} took {} ms", i++, 0.25); });
+
+        reporter.run("log<0> binary string arg", [&i]
+                     { log<0>("request {} from {}", i++, "client"); });
+    }
+
+    // Step 4. throughput with several threads, until the back end has written every record
+    constexpr const auto num_threads = 4;
+    constexpr const auto num_messages = 1000000;
+    {
+        binlog::logger logger{"binary_log.txt", false};
+
+        auto stime = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (auto t = 0; t < num_threads; t++)
+        {
+            threads.emplace_back([t]
+                                 {
+                                     for (auto i = 0; i < num_messages; i++)
+                                     {
+                                         log<0>("thread {} message {}", t, i);
+                                     }
+                                 });
+        }
+
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+
+        auto front = std::chrono::steady_clock::now();
+
+        while (logger.written() < std::uint64_t{num_threads} * num_messages)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        auto back = std::chrono::steady_clock::now();
+
+        auto total = static_cast<double>(num_threads) * num_messages;
+        std::cout << "[TEST] " << num_threads << " threads x " << num_messages << " messages:\n";
+        std::cout << "  - front end: " << total / std::chrono::duration<double>(front - stime).count() << " msg/s\n";
+        std::cout << "  - written:   " << total / std::chrono::duration<double>(back - stime).count() << " msg/s\n";
+    }
+
+    std::clog.rdbuf(clog_buf);
+    reporter.print();
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
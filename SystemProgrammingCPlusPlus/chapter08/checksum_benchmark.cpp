@@ -0,0 +1,293 @@
+/**
+ * @File    : checksum_benchmark.cpp
+ * @Brief   : Throughput of the CRC32C, XXH3 and LZ4 kernels, and of checksumming inside the stream path
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include checksum_benchmark.cpp -o checksum_benchmark
+ * @Command : ./checksum_benchmark
+ * @Command : ./checksum_benchmark --size=1G --format=json
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Checksumming the data on its way
+ * Part 1 measures every kernel over a 64MB buffer of log text, in GB/s:
+ * - CRC32C: slicing-by-8 tables, one chain of SSE4.2 crc32 instructions,
+ *   three chains recombined with PCLMULQDQ (include/crc32c.hpp),
+ * - XXH3: scalar, AVX2, and AVX2 streamed in 64KB pieces (include/xxh3.hpp),
+ * - integrity::digest, both checksums over the same 32KB slices,
+ * - LZ4 block compression and decompression (include/lz4_block.hpp), with the ratio.
+ *
+ * Part 2 reads and writes a file (256MB by default, warm page cache) through std::ifstream/std::ofstream:
+ * - without a checksum,
+ * - followed by a second pass that checksums the file (what verifying costs today),
+ * - through integrity::ifstream/ofstream (include/integrity_stream.hpp), checksummed on the way,
+ * - through the same streams with LZ4 blocks.
+ */
+
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "crc32c.hpp"
+#include "integrity_stream.hpp"
+#include "lz4_block.hpp"
+#include "xxh3.hpp"
+
+// Step 1. log text, compressible like real logs
+std::vector<char> make_log(std::size_t size)
+{
+    std::vector<char> data;
+    data.reserve(size + 256);
+
+    for (std::uint64_t i = 0; data.size() < size; i++)
+    {
+        auto line = "2026-10-19T12:" + std::to_string(10 + i % 50) + ":" + std::to_string(10 + i % 49) + "." +
+                    std::to_string(100000 + i * 7919 % 900000) + (i % 100 == 42 ? " ERROR request " : " INFO  request ") +
+                    std::to_string(i) + " from 10.0." + std::to_string(i * 31 % 256) + ".7 took 0." + std::to_string(i * 13 % 997) + " ms\n";
+        data.insert(data.end(), line.begin(), line.end());
+    }
+
+    data.resize(size);
+    return data;
+}
+
+void print_throughput(const bench::reporter &reporter, const std::vector<std::uint64_t> &bytes)
+{
+    std::cout << '\n'
+              << std::left << std::setw(40) << "throughput" << std::right << std::setw(12) << "GB/s" << '\n';
+
+    for (std::size_t i = 0; i < reporter.results().size(); i++)
+    {
+        const auto &r = reporter.results()[i];
+        std::cout << std::left << std::setw(40) << r.name << std::right << std::setw(12) << std::fixed << std::setprecision(2)
+                  << static_cast<double>(bytes[i]) / r.median_ns << '\n';
+    }
+}
+
+int protected_main(int argc, char **argv)
+{
+    std::size_t file_size = 256 << 20;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--size="))
+        {
+            file_size = std::stoull(arg.substr(7));
+            auto unit = arg.back();
+            file_size <<= unit == 'G' ? 30 : unit == 'M' ? 20 : unit == 'K' ? 10 : 0;
+        }
+    }
+
+    auto opts = bench::parse_args(argc, argv);
+    opts.samples = 7;
+
+    // Step 2. the kernels
+    bench::reporter kernels{opts};
+    std::vector<std::uint64_t> kernel_bytes;
+
+    auto data = make_log(64 << 20);
+    auto measure = [&](const std::string &name, auto func)
+    {
+        kernels.run(name, func);
+        kernel_bytes.push_back(data.size());
+    };
+
+    measure("crc32c table", [&]
+            { bench::do_not_optimize(crc32c::compute(data.data(), data.size(), crc32c::isa::table)); });
+    measure("crc32c sse4.2", [&]
+            { bench::do_not_optimize(crc32c::compute(data.data(), data.size(), crc32c::isa::sse42)); });
+    measure("crc32c sse4.2 3-way + pclmul", [&]
+            { bench::do_not_optimize(crc32c::compute(data.data(), data.size(), crc32c::isa::pclmul)); });
+    measure("xxh3 scalar", [&]
+            { bench::do_not_optimize(xxh3::hash64(data.data(), data.size(), xxh3::isa::generic)); });
+    measure("xxh3 avx2", [&]
+            { bench::do_not_optimize(xxh3::hash64(data.data(), data.size(), xxh3::isa::avx2)); });
+    measure("xxh3 avx2, streamed 64KB", [&]
+            {
+                xxh3::state state;
+                for (std::size_t pos = 0; pos < data.size(); pos += 64 << 10)
+                {
+                    state.update(data.data() + pos, std::min<std::size_t>(64 << 10, data.size() - pos));
+                }
+                bench::do_not_optimize(state.digest());
+            });
+    measure("integrity::digest (crc32c + xxh3)", [&]
+            {
+                integrity::digest d;
+                d.update(data.data(), data.size());
+                bench::do_not_optimize(d.value());
+            });
+
+    // LZ4 in 64KB blocks, as the integrity streams store them
+    constexpr std::size_t block = 64 << 10;
+    std::vector<char> packed(data.size() / block * lz4::compress_bound(block) + lz4::compress_bound(block));
+    std::vector<std::pair<std::size_t, std::size_t>> blocks;
+    std::size_t packed_size = 0;
+
+    measure("lz4 compress", [&]
+            {
+                blocks.clear();
+                packed_size = 0;
+                for (std::size_t pos = 0; pos < data.size(); pos += block)
+                {
+                    auto len = std::min(block, data.size() - pos);
+                    auto n = lz4::compress(data.data() + pos, len, packed.data() + packed_size);
+                    blocks.emplace_back(packed_size, n);
+                    packed_size += n;
+                }
+            });
+
+    std::vector<char> unpacked(data.size());
+    measure("lz4 decompress", [&]
+            {
+                std::size_t out = 0;
+                for (const auto &[offset, len] : blocks)
+                {
+                    out += lz4::decompress(packed.data() + offset, len, unpacked.data() + out, unpacked.size() - out);
+                }
+                bench::do_not_optimize(out);
+            });
+
+    if (unpacked != data)
+    {
+        throw std::runtime_error("lz4 round trip failed");
+    }
+
+    kernels.print();
+    print_throughput(kernels, kernel_bytes);
+    std::cout << "lz4 ratio: " << std::setprecision(2) << static_cast<double>(data.size()) / static_cast<double>(packed_size) << "\n\n";
+
+    // Step 3. the stream paths over a file
+    auto file_data = make_log(file_size);
+    {
+        std::ofstream out{"checksum_data.log", std::ios::binary};
+        out.write(file_data.data(), static_cast<std::streamsize>(file_data.size()));
+    }
+
+    auto expected = crc32c::compute(file_data.data(), file_data.size());
+    bench::reporter streams{opts};
+    std::vector<std::uint64_t> stream_bytes;
+
+    std::vector<char> buffer(64 << 10);
+    auto read_all = [&buffer](std::istream &in)
+    {
+        std::uint64_t total = 0;
+        while (in.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || in.gcount() > 0)
+        {
+            total += static_cast<std::uint64_t>(in.gcount());
+        }
+        return total;
+    };
+
+    auto check = [expected](std::uint32_t crc)
+    {
+        if (crc != expected)
+        {
+            throw std::runtime_error("checksum mismatch");
+        }
+    };
+
+    auto stream = [&](const std::string &name, auto func)
+    {
+        streams.run(name, func);
+        stream_bytes.push_back(file_data.size());
+    };
+
+    stream("read: std::ifstream", [&]
+           {
+               std::ifstream in{"checksum_data.log", std::ios::binary};
+               bench::do_not_optimize(read_all(in));
+           });
+    stream("read: std::ifstream + 2nd pass", [&]
+           {
+               std::ifstream in{"checksum_data.log", std::ios::binary};
+               bench::do_not_optimize(read_all(in));
+
+               std::ifstream again{"checksum_data.log", std::ios::binary};
+               integrity::digest d;
+               while (again.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || again.gcount() > 0)
+               {
+                   d.update(buffer.data(), static_cast<std::size_t>(again.gcount()));
+               }
+               check(d.value().crc32c);
+           });
+    stream("read: integrity::ifstream", [&]
+           {
+               integrity::ifstream in{"checksum_data.log"};
+               bench::do_not_optimize(read_all(in));
+               check(in.value().crc32c);
+           });
+
+    stream("write: std::ofstream", [&]
+           {
+               std::ofstream out{"checksum_copy.log", std::ios::binary};
+               out.write(file_data.data(), static_cast<std::streamsize>(file_data.size()));
+           });
+    stream("write: std::ofstream + 2nd pass", [&]
+           {
+               {
+                   std::ofstream out{"checksum_copy.log", std::ios::binary};
+                   out.write(file_data.data(), static_cast<std::streamsize>(file_data.size()));
+               }
+
+               std::ifstream again{"checksum_copy.log", std::ios::binary};
+               integrity::digest d;
+               while (again.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || again.gcount() > 0)
+               {
+                   d.update(buffer.data(), static_cast<std::size_t>(again.gcount()));
+               }
+               check(d.value().crc32c);
+           });
+    stream("write: integrity::ofstream", [&]
+           {
+               integrity::ofstream out{"checksum_copy.log"};
+               out.write(file_data.data(), static_cast<std::streamsize>(file_data.size()));
+               check(out.close().crc32c);
+           });
+    stream("write: integrity::ofstream + lz4", [&]
+           {
+               integrity::ofstream out{"checksum_copy.lz4", integrity::compression::lz4};
+               out.write(file_data.data(), static_cast<std::streamsize>(file_data.size()));
+               check(out.close().crc32c);
+           });
+    stream("read: integrity::ifstream + lz4", [&]
+           {
+               integrity::ifstream in{"checksum_copy.lz4", integrity::compression::lz4};
+               bench::do_not_optimize(read_all(in));
+               check(in.value().crc32c);
+           });
+
+    streams.print();
+    print_throughput(streams, stream_bytes);
+
+    unlink("checksum_data.log");
+    unlink("checksum_copy.log");
+    unlink("checksum_copy.lz4");
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
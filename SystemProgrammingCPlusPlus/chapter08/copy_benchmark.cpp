@@ -0,0 +1,288 @@
+/**
+ * @File    : copy_benchmark.cpp
+ * @Brief   : Bulk tree copy (reflink, copy_file_range, sparse files, deduplication) versus std::filesystem::copy
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include copy_benchmark.cpp -lpthread -o copy_benchmark
+ * @Command : ./copy_benchmark
+ * @Command : ./copy_benchmark --size=8G --files=20000 --duplicates=40 --dir=/mnt/btrfs/copy_data
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Copying an artifact tree
+ * file_utility.cpp creates, renames and removes paths, this example copies a whole tree.
+ * The benchmark generates a synthetic artifact tree once (2GB in 4000 files by default):
+ * - file sizes spread from 4KB to 16MB, plus a few 256MB files that are split into extents,
+ * - 25% of the files are copies of other files (--duplicates=PERCENT), like the same library
+ *   shipped in several packages,
+ * - two sparse files of 1GB with 32MB of data each, and a few symbolic links.
+ *
+ * It then copies the tree with:
+ * 1. std::filesystem::copy(recursive),
+ * 2. copier::bulk (include/file_copier.hpp) on 1 thread without deduplication,
+ * 3. copier::bulk on all threads without deduplication,
+ * 4. copier::bulk with deduplication (duplicates copied from the first copy, or cloned),
+ * 5. copier::bulk with deduplication and hard links for the duplicates.
+ *
+ * The copy is removed before every run, the time includes a sync() so that the page cache
+ * does not hide the writes. Every copy is checked against the XXH3 hashes of the source files.
+ * On a file system with reflinks (Btrfs, XFS) most of the data is cloned instead of copied.
+ */
+
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "file_copier.hpp"
+#include "xxh3.hpp"
+
+namespace fs = std::filesystem;
+
+// Step 1. the synthetic artifact tree, reused when a previous run created the same one
+void generate(const std::string &root, std::uint64_t size, std::uint64_t num_files, unsigned duplicates)
+{
+    auto marker = root + ".complete";
+    auto description = std::to_string(size) + " " + std::to_string(num_files) + " " + std::to_string(duplicates);
+
+    std::string previous;
+    if (std::ifstream in{marker}; std::getline(in, previous) && previous == description)
+    {
+        return;
+    }
+
+    std::cout << "generating " << size / (1 << 20) << " MB in " << num_files << " files in " << root << "...\n";
+    fs::remove_all(root);
+    fs::remove(marker);
+
+    std::mt19937_64 rng{7};
+    std::vector<char> data(256 << 20);
+    for (std::size_t i = 0; i < data.size(); i += 8)
+    {
+        auto value = rng();
+        std::memcpy(data.data() + i, &value, 8);
+    }
+
+    // log-uniform sizes from 4KB to 16MB, scaled to the requested total
+    std::vector<std::uint64_t> sizes(num_files);
+    std::uniform_real_distribution<double> exponent{12.0, 24.0};
+    double sum = 0;
+    for (auto &s : sizes)
+    {
+        s = static_cast<std::uint64_t>(std::exp2(exponent(rng)));
+        sum += static_cast<double>(s);
+    }
+
+    // the large files, about a quarter of the total
+    auto large = std::max<std::uint64_t>(1, size / 4 / (256 << 20));
+    auto scale = static_cast<double>(size - std::min(size / 2, large * (256 << 20))) / sum;
+
+    std::vector<std::string> written;
+    std::uniform_int_distribution<unsigned> percent{0, 99};
+
+    for (std::uint64_t i = 0; i < num_files + large; i++)
+    {
+        auto dir = root + "/pkg" + std::to_string(i % 37) + "/lib" + std::to_string(i % 5);
+        fs::create_directories(dir);
+        auto name = dir + "/artifact" + std::to_string(i) + ".bin";
+
+        if (!written.empty() && i < num_files && percent(rng) < duplicates)
+        {
+            // a duplicate of an earlier file
+            fs::copy_file(written[rng() % written.size()], name, fs::copy_options::overwrite_existing);
+            continue;
+        }
+
+        auto len = i < num_files ? std::max<std::uint64_t>(4096, static_cast<std::uint64_t>(static_cast<double>(sizes[i]) * scale))
+                                 : std::uint64_t{256 << 20};
+        len = std::min<std::uint64_t>(len, data.size());
+
+        // a different window of the random data for every file
+        auto offset = (i * 4099) % (data.size() - len + 1);
+        std::ofstream out{name, std::ios::binary};
+        out.write(data.data() + offset, static_cast<std::streamsize>(len));
+        out.write(reinterpret_cast<const char *>(&i), sizeof(i));
+        written.push_back(name);
+    }
+
+    // sparse files: 1GB with 32 data extents of 1MB
+    for (auto s = 0; s < 2; s++)
+    {
+        auto name = root + "/images/disk" + std::to_string(s) + ".img";
+        fs::create_directories(root + "/images");
+
+        auto fd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1 || ftruncate(fd, 1LL << 30) == -1)
+        {
+            throw std::runtime_error(name + ": " + strerror(errno));
+        }
+
+        for (auto e = 0; e < 32; e++)
+        {
+            if (pwrite(fd, data.data() + (s * 32 + e) * (1 << 20), 1 << 20, static_cast<off_t>(e) * (32 << 20)) == -1)
+            {
+                throw std::runtime_error(name + ": " + strerror(errno));
+            }
+        }
+        close(fd);
+    }
+
+    fs::create_symlink("pkg0", root + "/current");
+    fs::create_symlink("../pkg1/lib1", root + "/pkg0/lib1-link");
+
+    std::ofstream{marker} << description << '\n';
+}
+
+// Step 2. path -> XXH3 of every regular file, symbolic links as their target
+std::map<std::string, std::uint64_t> fingerprint(const std::string &root)
+{
+    std::map<std::string, std::uint64_t> hashes;
+    for (const auto &e : fs::recursive_directory_iterator(root))
+    {
+        auto rel = fs::relative(e.path(), root).string();
+        if (e.is_symlink())
+        {
+            auto target = fs::read_symlink(e.path()).string();
+            hashes[rel] = xxh3::hash64(target.data(), target.size());
+        }
+        else if (e.is_regular_file())
+        {
+            std::ifstream in{e.path(), std::ios::binary};
+            std::string content{std::istreambuf_iterator<char>(in), {}};
+            hashes[rel] = xxh3::hash64(content.data(), content.size());
+        }
+    }
+
+    return hashes;
+}
+
+int protected_main(int argc, char **argv)
+{
+    std::uint64_t size = 2ULL << 30;
+    std::uint64_t num_files = 4000;
+    unsigned duplicates = 25;
+    std::string dir = "copy_data";
+
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--size="))
+        {
+            size = std::stoull(arg.substr(7));
+            auto unit = arg.back();
+            size <<= unit == 'G' ? 30 : unit == 'M' ? 20 : unit == 'K' ? 10 : 0;
+        }
+        else if (arg.starts_with("--files="))
+        {
+            num_files = std::stoull(arg.substr(8));
+        }
+        else if (arg.starts_with("--duplicates="))
+        {
+            duplicates = static_cast<unsigned>(std::stoul(arg.substr(13)));
+        }
+        else if (arg.starts_with("--dir="))
+        {
+            dir = arg.substr(6);
+        }
+    }
+
+    auto from = dir + "/source";
+    auto to = dir + "/copy";
+    generate(from, size, num_files, duplicates);
+
+    auto expected = fingerprint(from);
+    std::uint64_t logical = 0;
+    for (const auto &e : fs::recursive_directory_iterator(from))
+    {
+        logical += e.is_regular_file() && !e.is_symlink() ? e.file_size() : 0;
+    }
+
+    std::cout << "[TEST] " << expected.size() << " entries, " << std::fixed << std::setprecision(2)
+              << static_cast<double>(logical) / (1 << 30) << " GB (sparse files at their full size)\n";
+    std::cout << std::left << std::setw(36) << "copy" << std::right << std::setw(10) << "time s" << std::setw(10) << "GB/s"
+              << std::setw(14) << "copied GB" << std::setw(12) << "dup files" << std::setw(10) << "cloned" << '\n';
+
+    // Step 3. one copy: remove the old copy, copy, sync, check
+    auto measure = [&](const std::string &name, auto func)
+    {
+        using namespace std::chrono;
+
+        fs::remove_all(to);
+        sync();
+
+        auto start = steady_clock::now();
+        copier::stats st = func();
+        sync();
+        auto secs = duration<double>(steady_clock::now() - start).count();
+
+        if (fingerprint(to) != expected)
+        {
+            throw std::runtime_error(name + ": the copy differs from the source");
+        }
+
+        std::cout << std::left << std::setw(36) << name << std::right << std::fixed
+                  << std::setw(10) << std::setprecision(2) << secs
+                  << std::setw(10) << std::setprecision(2) << static_cast<double>(logical) / secs / 1e9;
+
+        if (st.files != 0)
+        {
+            std::cout << std::setw(14) << std::setprecision(2) << static_cast<double>(st.copied_bytes) / 1e9
+                      << std::setw(12) << st.duplicate_files << std::setw(10) << st.cloned_files;
+        }
+        std::cout << '\n';
+    };
+
+    measure("std::filesystem::copy", [&]
+            {
+                fs::copy(from, to, fs::copy_options::recursive | fs::copy_options::copy_symlinks);
+                return copier::stats{};
+            });
+
+    auto bulk = [&](unsigned threads, bool dedup, bool hardlinks)
+    {
+        return [&, threads, dedup, hardlinks]
+        {
+            copier::options opts;
+            opts.threads = threads;
+            opts.dedup = dedup;
+            opts.hardlink_duplicates = hardlinks;
+
+            return copier::bulk{opts}.run(from, to);
+        };
+    };
+
+    measure("copier::bulk, 1 thread", bulk(1, false, false));
+    measure("copier::bulk", bulk(0, false, false));
+    measure("copier::bulk + dedup", bulk(0, true, false));
+    measure("copier::bulk + dedup + hard links", bulk(0, true, true));
+
+    fs::remove_all(to);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
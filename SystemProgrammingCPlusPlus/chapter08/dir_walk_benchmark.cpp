@@ -0,0 +1,284 @@
+/**
+ * @File    : dir_walk_benchmark.cpp
+ * @Brief   : Parallel getdents64() directory walker versus std::filesystem::recursive_directory_iterator
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include dir_walk_benchmark.cpp -lpthread -o dir_walk_benchmark
+ * @Command : ./dir_walk_benchmark
+ * @Command : ./dir_walk_benchmark --files=100000 --threads=1,4,16
+ * @Command : sudo ./dir_walk_benchmark --cold
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Walking a tree of a million files
+ * The benchmark creates a synthetic tree (1M empty files by default, 1000 files per directory,
+ * 32 directories per level) once, and walks it with:
+ * 1. std::filesystem::recursive_directory_iterator, counting the regular files
+ *    (directory_entry caches the d_type, is_regular_file() does not call stat()),
+ * 2. the same with directory_entry::file_size(), one stat() per file,
+ * 3. walk::walker of include/dir_walker.hpp with 1 and more threads,
+ * 4. walk::walker with statx(STATX_SIZE).
+ *
+ * With a warm dentry/inode cache all of them are bound by the CPU, the walker saves the path objects,
+ * the small readdir() buffer and the full path resolution of stat().
+ * With --cold the caches are dropped before every walk (/proc/sys/vm/drop_caches, needs root):
+ * then the walk waits for the disk, and the threads of the walker keep several directory reads in flight.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dir_walker.hpp"
+
+// Step 1. the synthetic tree: root/D/D/file-N, reused when a previous run created it
+std::uint64_t generate(const std::string &root, std::uint64_t num_files)
+{
+    constexpr std::uint64_t files_per_dir = 1000;
+    constexpr std::uint64_t fanout = 32;
+
+    // next to the tree, so that it is not walked
+    auto marker = root + ".complete";
+    if (std::ifstream in{marker})
+    {
+        std::uint64_t count = 0;
+        if (in >> count && count == num_files)
+        {
+            return count;
+        }
+    }
+
+    std::cout << "creating " << num_files << " files in " << root << "...\n";
+    std::filesystem::remove_all(root);
+    std::filesystem::remove(marker);
+
+    auto num_dirs = (num_files + files_per_dir - 1) / files_per_dir;
+    std::uint64_t created = 0;
+
+    for (std::uint64_t d = 0; d < num_dirs; d++)
+    {
+        auto dir = root + "/" + std::to_string(d / fanout) + "/" + std::to_string(d % fanout);
+        std::filesystem::create_directories(dir);
+
+        auto dir_fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir_fd == -1)
+        {
+            throw std::runtime_error(dir + ": " + strerror(errno));
+        }
+
+        for (std::uint64_t f = 0; f < files_per_dir && created < num_files; f++, created++)
+        {
+            auto name = "file-" + std::to_string(f);
+            auto fd = openat(dir_fd, name.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+            if (fd == -1)
+            {
+                close(dir_fd);
+                throw std::runtime_error(dir + "/" + name + ": " + strerror(errno));
+            }
+            close(fd);
+        }
+
+        close(dir_fd);
+    }
+
+    std::ofstream{marker} << num_files;
+    return created;
+}
+
+// Step 2. drops the page, dentry and inode caches, false without the permission
+bool drop_caches()
+{
+    sync();
+    std::ofstream out{"/proc/sys/vm/drop_caches"};
+    return static_cast<bool>(out << "3" << std::flush);
+}
+
+struct result
+{
+    std::uint64_t files{};
+    std::uint64_t bytes{};
+};
+
+// Step 3. best of 'repeat' walks
+template <typename FUNC>
+void measure(const std::string &name, int repeat, bool cold, FUNC func)
+{
+    using namespace std::chrono;
+
+    auto best = 1e30;
+    result r{};
+
+    for (auto i = 0; i < repeat; i++)
+    {
+        if (cold)
+        {
+            drop_caches();
+        }
+
+        auto start = steady_clock::now();
+        r = func();
+        best = std::min(best, duration<double>(steady_clock::now() - start).count());
+    }
+
+    std::cout << std::left << std::setw(42) << name << std::right
+              << std::setw(10) << r.files
+              << std::setw(12) << std::fixed << std::setprecision(1) << best * 1e3 << " ms"
+              << std::setw(12) << std::setprecision(2) << static_cast<double>(r.files) / best / 1e6 << " M files/s\n";
+}
+
+std::vector<unsigned> parse_list(const std::string &list)
+{
+    std::vector<unsigned> values;
+    std::stringstream ss{list};
+    for (std::string item; std::getline(ss, item, ',');)
+    {
+        values.push_back(static_cast<unsigned>(std::stoul(item)));
+    }
+
+    return values;
+}
+
+int protected_main(int argc, char **argv)
+{
+    std::uint64_t num_files = 1'000'000;
+    std::string root = "walk_tree";
+    std::vector<unsigned> thread_counts{1, 4, 16};
+    auto repeat = 3;
+    auto cold = false;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--files="))
+        {
+            num_files = std::stoull(arg.substr(8));
+        }
+        else if (arg.starts_with("--dir="))
+        {
+            root = arg.substr(6);
+        }
+        else if (arg.starts_with("--threads="))
+        {
+            thread_counts = parse_list(arg.substr(10));
+        }
+        else if (arg.starts_with("--repeat="))
+        {
+            repeat = std::stoi(arg.substr(9));
+        }
+        else if (arg == "--cold")
+        {
+            cold = true;
+        }
+    }
+
+    generate(root, num_files);
+
+    if (cold && !drop_caches())
+    {
+        std::cout << "cannot write /proc/sys/vm/drop_caches, measuring with warm caches\n";
+        cold = false;
+    }
+
+    std::cout << "[TEST] " << num_files << " files, " << (cold ? "cold" : "warm") << " caches, best of " << repeat << '\n';
+    std::cout << std::left << std::setw(42) << "walk" << std::right << std::setw(10) << "files"
+              << std::setw(15) << "time" << std::setw(22) << "throughput" << '\n';
+
+    // Step 4. std::filesystem
+    measure("recursive_directory_iterator", repeat, cold, [&root]
+            {
+                result r{};
+                for (const auto &e : std::filesystem::recursive_directory_iterator(root))
+                {
+                    r.files += e.is_regular_file() ? 1 : 0;
+                }
+
+                return r;
+            });
+
+    measure("recursive_directory_iterator + file_size", repeat, cold, [&root]
+            {
+                result r{};
+                for (const auto &e : std::filesystem::recursive_directory_iterator(root))
+                {
+                    if (e.is_regular_file())
+                    {
+                        r.files++;
+                        r.bytes += e.file_size();
+                    }
+                }
+
+                return r;
+            });
+
+    // Step 5. the walker, per-thread counters indexed by entry::worker
+    struct alignas(64) counter
+    {
+        std::uint64_t files{};
+        std::uint64_t bytes{};
+    };
+
+    for (auto threads : thread_counts)
+    {
+        for (auto with_stat : {false, true})
+        {
+            auto name = "walk::walker, " + std::to_string(threads) + " thread(s)" + (with_stat ? " + statx" : "");
+            measure(name, repeat, cold, [&root, threads, with_stat]
+                    {
+                        std::vector<counter> counters(threads);
+                        walk::options opts;
+                        opts.threads = threads;
+                        opts.statx_mask = with_stat ? STATX_SIZE : 0;
+
+                        walk::walker walker{opts};
+
+                        walker.run(root, [&counters](const walk::entry &e)
+                                   {
+                                       if (e.type == std::filesystem::file_type::regular)
+                                       {
+                                           counters[e.worker].files++;
+                                           counters[e.worker].bytes += e.stat != nullptr ? e.stat->stx_size : 0;
+                                       }
+                                   });
+
+                        result r{};
+                        for (const auto &c : counters)
+                        {
+                            r.files += c.files;
+                            r.bytes += c.bytes;
+                        }
+
+                        return r;
+                    });
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
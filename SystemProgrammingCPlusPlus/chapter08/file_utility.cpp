@@ -2,7 +2,7 @@
  * @File    : file_utility.cpp
  * @Brief   : Understanding file utilities.
  * ------------------------
- * @Command : g++ -std=c++2a file_utility.cpp -lstdc++fs
+ * @Command : g++ -std=c++2a -I../include file_utility.cpp -lstdc++fs -lpthread
  * ------------------------
  * @Author  : Wei Li
  * @Date    : 2021-11-06
@@ -33,10 +33,13 @@
  * 7. Files : The path refers to a regular file
  */
 
+#include <atomic>
 #include <fstream>
 #include <filesystem>
 #include <iostream>
 
+#include "dir_walker.hpp"
+
 int main(int argc, char **argv)
 {
     // To determine what type a path is, C++17
@@ -205,6 +208,26 @@ int main(int argc, char **argv)
     std::cout << std::experimental::filesystem::remove_all(path) << '\n';
     */
 
+    // recursive_directory_iterator walks a whole tree, one entry at a time from one thread.
+    // walk::walker (include/dir_walker.hpp) reads the directories with getdents64() on several threads
+    // and streams the entries to a callback, see dir_walk_benchmark.cpp
+    std::cout << "----------------------" << '\n';
+    std::uint64_t serial_count = 0;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator("..", std::filesystem::directory_options::skip_permission_denied))
+    {
+        serial_count += entry.is_regular_file() ? 1 : 0;
+    }
+
+    std::atomic<std::uint64_t> parallel_count{0};
+    walk::walker{}.run("..", [&parallel_count](const walk::entry &entry)
+                       {
+                           if (entry.type == std::filesystem::file_type::regular)
+                           {
+                               parallel_count.fetch_add(1, std::memory_order_relaxed);
+                           }
+                       });
+    std::cout << serial_count << ' ' << parallel_count << '\n';
+
     // C++17 provides a convenient function for determining 
     // the path to the temporary directory, 
     // which can be used to create temporary directories
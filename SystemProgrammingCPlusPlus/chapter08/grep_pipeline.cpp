@@ -0,0 +1,364 @@
+/**
+ * @File    : grep_pipeline.cpp
+ * @Brief   : Parallel multi-file grep pipeline versus std::getline, the file follower and grep
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include grep_pipeline.cpp -lpthread -o grep_pipeline
+ * @Command : ./grep_pipeline --size=10G --files=16
+ * @Command : ./grep_pipeline --grep=ERROR grep_data/0.log grep_data/1.log
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Searching a set of log files
+ * tail_file_example.cpp originally read its file with std::getline() on a std::fstream,
+ * one file and one line at a time. The pipeline of include/line_pipeline.hpp reads several
+ * files at once, splits the lines with AVX2 on a pool of worker threads, filters them
+ * and writes the matching lines in file order, without copying them out of the read buffers.
+ *
+ * The benchmark generates a synthetic log set (1GB by default, --size=10G for the full run),
+ * then measures the throughput in GB/s of:
+ * 1. std::getline() on a std::fstream, file after file (the original tail loop),
+ * 2. follow::follower reading the files from the start (file_follower.hpp, single thread),
+ * 3. the pipeline counting lines, with a substring filter stage, with a required literal (AVX2 substring search),
+ *    and with a required literal followed by a regex stage,
+ * 4. grep -c (LC_ALL=C) on the same files.
+ *
+ * Every case runs on a warm page cache (the first pass is not measured),
+ * so the numbers show the CPU cost of the line handling and not the disk.
+ * With more data than memory, all of them converge to the read bandwidth of the disk.
+ */
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "file_follower.hpp"
+#include "line_pipeline.hpp"
+
+// Step 1. generate the synthetic log set, 1% of the lines are errors
+std::vector<std::string> generate(const std::string &dir, std::uint64_t size, std::size_t num_files)
+{
+    std::filesystem::create_directories(dir);
+
+    std::string block;
+    for (auto i = 0; block.size() < (1 << 20); i++)
+    {
+        block += "2026-10-19T12:";
+        block += std::to_string(10 + i % 50) + ":" + std::to_string(10 + i % 49) + "." + std::to_string(100000 + i * 7 % 900000);
+        if (i % 100 == 42)
+        {
+            block += " ERROR request " + std::to_string(i) + " from 10.0." + std::to_string(i % 256) + ".7 failed: timeout after 30 s\n";
+        }
+        else
+        {
+            block += " INFO  request " + std::to_string(i) + " from 10.0." + std::to_string(i % 256) + ".7 took 0." + std::to_string(i % 97) + " ms\n";
+        }
+    }
+
+    std::vector<std::string> files;
+    auto per_file = size / num_files;
+
+    for (std::size_t f = 0; f < num_files; f++)
+    {
+        auto name = dir + "/" + std::to_string(f) + ".log";
+        files.push_back(name);
+
+        if (std::filesystem::exists(name) && std::filesystem::file_size(name) >= per_file)
+        {
+            continue;
+        }
+
+        std::fstream file{name, std::ios::out | std::ios::trunc | std::ios::binary};
+        for (std::uint64_t written = 0; written < per_file; written += block.size())
+        {
+            file.write(block.data(), static_cast<std::streamsize>(block.size()));
+        }
+
+        if (!file)
+        {
+            throw std::runtime_error("failed to write " + name);
+        }
+    }
+
+    return files;
+}
+
+std::uint64_t total_size(const std::vector<std::string> &files)
+{
+    std::uint64_t total = 0;
+    for (const auto &f : files)
+    {
+        total += std::filesystem::file_size(f);
+    }
+
+    return total;
+}
+
+// Step 2. one line of the result table per case, the best of 'repeat' passes
+template <typename FUNC>
+void measure(const std::string &name, std::uint64_t bytes, int repeat, FUNC func)
+{
+    double best = 0;
+    std::uint64_t matches = 0;
+
+    for (auto i = 0; i < repeat; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        matches = func();
+        auto secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        best = i == 0 ? secs : std::min(best, secs);
+    }
+
+    std::cout << std::left << std::setw(34) << name << std::right
+              << std::setw(10) << std::fixed << std::setprecision(3) << best << " s"
+              << std::setw(10) << std::setprecision(2) << static_cast<double>(bytes) / best / 1e9 << " GB/s"
+              << std::setw(14) << matches << " matches\n";
+}
+
+// Step 3. the original way: std::getline() on a std::fstream
+std::uint64_t getline_grep(const std::vector<std::string> &files, const std::string &pattern)
+{
+    std::uint64_t matches = 0;
+    for (const auto &name : files)
+    {
+        std::fstream file{name, std::ios::in};
+
+        std::string buf;
+        while (std::getline(file, buf, '\n'))
+        {
+            matches += buf.find(pattern) != std::string::npos;
+        }
+    }
+
+    return matches;
+}
+
+// Step 4. the inotify follower of tail_file_example.cpp, reading every file from the start
+std::uint64_t follower_grep(const std::vector<std::string> &files, const std::string &pattern)
+{
+    std::uint64_t matches = 0;
+
+    follow::follower follower{follow::options{.from_start = true}};
+    for (const auto &name : files)
+    {
+        follower.add(name, [&](std::string_view line)
+                     { matches += line.find(pattern) != std::string_view::npos; });
+    }
+
+    follower.poll(0);
+    return matches;
+}
+
+// Step 5. the pipeline
+std::uint64_t pipeline_grep(const std::vector<std::string> &files, std::vector<pipeline::filter> filters, bool collect,
+                            const std::string &literal = {})
+{
+    pipeline::grep grep{pipeline::options{.collect = collect}};
+    grep.require(literal);
+
+    auto filtered = !filters.empty() || !literal.empty();
+    for (auto &filter : filters)
+    {
+        grep.add(std::move(filter));
+    }
+
+    std::uint64_t bytes = 0;
+    auto stats = grep.run(files, [&bytes](std::size_t, std::span<const std::string_view> lines)
+                          {
+                              for (auto line : lines)
+                              {
+                                  bytes += line.size();
+                              }
+                          });
+
+    bench::do_not_optimize(bytes);
+    return filtered ? stats.matches : stats.lines;
+}
+
+// Step 6. grep -c, the per-file counts added up
+std::uint64_t system_grep(const std::vector<std::string> &files, const std::string &pattern)
+{
+    // -H: "file:count" lines, also for a single file
+    std::string cmd = "LC_ALL=C grep -cH '" + pattern + "'";
+    for (const auto &f : files)
+    {
+        cmd += " " + f;
+    }
+
+    auto pipe = ::popen(cmd.c_str(), "r");
+    if (pipe == nullptr)
+    {
+        throw std::runtime_error(std::string{"popen: "} + strerror(errno));
+    }
+
+    std::uint64_t count = 0;
+    char line[4096];
+    while (std::fgets(line, sizeof(line), pipe) != nullptr)
+    {
+        if (auto colon = std::strrchr(line, ':'); colon != nullptr)
+        {
+            count += std::strtoull(colon + 1, nullptr, 10);
+        }
+    }
+
+    // 0: matches, 1: no match, 2 and more: an error
+    auto status = ::pclose(pipe);
+    if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) > 1)
+    {
+        throw std::runtime_error("grep failed with status " + std::to_string(status));
+    }
+
+    return count;
+}
+
+// Step 7. the grep mode: prints the matching lines of the files, prefixed with the file name
+int grep_files(const std::string &pattern, const std::vector<std::string> &files)
+{
+    pipeline::grep grep;
+    grep.require(pattern);
+
+    std::string out;
+    auto stats = grep.run(files, [&](std::size_t file, std::span<const std::string_view> lines)
+                          {
+                              for (auto line : lines)
+                              {
+                                  out.append(files[file]).append(":").append(line).append("\n");
+                              }
+
+                              if (out.size() > (1 << 20))
+                              {
+                                  std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+                                  out.clear();
+                              }
+                          });
+
+    std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+    return stats.matches != 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+std::uint64_t parse_size(const std::string &str)
+{
+    auto value = std::stoull(str);
+    switch (str.back())
+    {
+    case 'G':
+        return value << 30;
+    case 'M':
+        return value << 20;
+    case 'K':
+        return value << 10;
+    default:
+        return value;
+    }
+}
+
+int protected_main(int argc, char **argv)
+{
+    std::uint64_t size = 1ULL << 30;
+    std::size_t num_files = 8;
+    auto repeat = 3;
+    std::string dir = "grep_data";
+    std::string pattern;
+    std::vector<std::string> files;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.starts_with("--size="))
+        {
+            size = parse_size(arg.substr(7));
+        }
+        else if (arg.starts_with("--files="))
+        {
+            num_files = std::stoul(arg.substr(8));
+        }
+        else if (arg.starts_with("--repeat="))
+        {
+            repeat = std::stoi(arg.substr(9));
+        }
+        else if (arg.starts_with("--dir="))
+        {
+            dir = arg.substr(6);
+        }
+        else if (arg.starts_with("--grep="))
+        {
+            pattern = arg.substr(7);
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+
+    if (!pattern.empty())
+    {
+        std::ios::sync_with_stdio(false);
+        return grep_files(pattern, files);
+    }
+
+    files = generate(dir, size, num_files);
+    auto bytes = total_size(files);
+
+    std::cout << "[TEST] " << files.size() << " files, " << bytes / (1 << 20) << " MB, "
+              << std::thread::hardware_concurrency() << " CPUs, "
+              << (lines::best_isa() == lines::isa::avx2 ? "AVX2" : "SSE2") << " line scanner\n";
+
+    // warm the page cache
+    pipeline_grep(files, {}, false);
+
+    measure("std::getline + find", bytes, repeat, [&]
+            { return getline_grep(files, "ERROR"); });
+
+    measure("follow::follower + find", bytes, repeat, [&]
+            { return follower_grep(files, "ERROR"); });
+
+    measure("pipeline count lines", bytes, repeat, [&]
+            { return pipeline_grep(files, {}, false); });
+
+    measure("pipeline contains \"ERROR\"", bytes, repeat, [&]
+            { return pipeline_grep(files, {pipeline::contains("ERROR")}, true); });
+
+    measure("pipeline literal \"ERROR\"", bytes, repeat, [&]
+            { return pipeline_grep(files, {}, true, "ERROR"); });
+
+    // the literal finds the candidate lines, std::regex only sees the error lines
+    measure("pipeline literal \"ERROR\" + regex", bytes, repeat, [&]
+            { return pipeline_grep(files, {pipeline::matches("failed: time(out)? after [0-9]+")}, true, "ERROR"); });
+
+    measure("grep -c ERROR", bytes, repeat, [&]
+            { return system_grep(files, "ERROR"); });
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
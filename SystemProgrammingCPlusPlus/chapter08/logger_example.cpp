@@ -2,17 +2,27 @@
  * @File    : logger_example.cpp
  * @Brief   : Example for logger to debug
  * ----------------------------
- * @Command : g++ -std=c++2a logger_example.cpp -o logger
+ * @Command : g++ -std=c++2a -I../include logger_example.cpp -lpthread -o logger
  * @Command : ./logger
- * @Command : cat log.txt
+ * @Command : cat log.txt.*
  * ----------------------------
  * @Author  : Wei Li
  * @Date    : 2021-11-06
 */
 
-#include <sstream>
-#include <fstream>
+/** The log<LEVEL>() function below does not format on the calling thread:
+ * it hands the format string and the arguments to the deferred-formatting logger
+ * of include/binary_logger.hpp, a background thread formats the lines.
+ * The format string is checked against the arguments at compile time.
+ * binary_logger_example.cpp compares it with the former iostream version,
+ * which redirected std::clog into a std::stringstream for every message.
+ */
+
 #include <iostream>
+#include <string_view>
+
+#include "binary_logger.hpp"
+#include "log_sink.hpp"
 
 /** Step 1. To create two constant expressions
  * one for the debug level, 
@@ -30,33 +40,22 @@ constexpr auto g_ndebug = true;
 constexpr auto g_ndebug = false;
 #endif
 
-// Step 2. create a global variable is the log file stream
-std::fstream g_log{"log.txt", std::ios::out | std::ios::app};
+// Step 2. create a global variable is the log file
+// log_sink::rotating_file (include/log_sink.hpp) buffers the messages in large blocks,
+// writes them from a background thread and rotates the file into log.txt.000000, log.txt.000001, ...
+log_sink::rotating_file g_log{log_sink::options{.path = "log.txt"}};
 
 /** Step 3. log function
- * This function needs to be able to output to both std::clog and
- * to our log file stream without executing the dubug logic more than once.
+ * The message goes to both std::clog and the log file, formatted once by the background thread
+ * of the binlog::logger in protected_main(). The arguments are only copied here.
  */
-template <std::size_t LEVEL>
-constexpr void log(void (*func)())
+template <std::size_t LEVEL, typename... ARGS>
+constexpr void log(binlog::format_string<std::type_identity_t<ARGS>...> fmt, const ARGS &...args)
 {
     if constexpr (!g_ndebug && (LEVEL <= g_debug_level))
     {
-        std::stringstream buf;
-
-        auto g_buf = std::clog.rdbuf();
-        std::clog.rdbuf(buf.rdbuf());
-
-        func();
-
-        std::clog.rdbuf(g_buf);
-
-        std::clog << "\033[1;32mDEBUG\033[0m: ";
-        std::clog << buf.str();
-
-        g_log << "\033[1;32mDEBUG\033[0m: ";
-        g_log << buf.str();
-    };
+        binlog::debug(fmt, args...);
+    }
 }
 
 // Step 4. protected_main function
@@ -65,8 +64,14 @@ int protected_main(int argc, char **argv)
     (void)argc;
     (void)argv;
 
-    log<0>([]
-           { std::clog << "Hello World\n"; });
+    {
+        // formats the records on its thread and writes every line to std::clog and to g_log,
+        // the destructor writes what is left
+        binlog::logger logger{[](std::string_view line)
+                              { g_log.write(line); }};
+
+        log<0>("Hello {}", "World");
+    }
 
     std::clog << "Hello World\n";
 
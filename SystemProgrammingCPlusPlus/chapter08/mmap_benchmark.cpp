@@ -6,73 +6,798 @@
 */
 
 /** Comparing C++ versus mmap benchmark
- * In this example, we will benchmark the difference 
+ * In this example, we will benchmark the difference
  * between reading the contents of a file using std::fstream and reading them using mmap().
- * It should be noted that the mmap() function leverages a system call to directly map a file into the program, 
- * and we expect mmap() to be faster than the C++ APIs highlighted in this chapter. 
- * This is because the C++ APIs have to perform an additional memory copy, 
+ * It should be noted that the mmap() function leverages a system call to directly map a file into the program,
+ * and we expect mmap() to be faster than the C++ APIs highlighted in this chapter.
+ * This is because the C++ APIs have to perform an additional memory copy,
  * which is obviously slower.
+ *
+ * Timing only the mmap() call says nothing about reading a file: mmap() just creates the mapping,
+ * the data is read by the page faults when the pages are touched. A fair comparison
+ * reads (or touches) every page of the file, for several file sizes and access patterns:
+ * - sequential: the whole file from the beginning to the end,
+ * - random: 4KB blocks in a random order (at most 1GB worth of blocks per pass),
+ * and with the page cache in two states:
+ * - cold: the pages of the file are dropped first (posix_fadvise(POSIX_FADV_DONTNEED)),
+ *   so the data comes from the disk,
+ * - warm: the file is in the page cache, so only the CPU cost of each strategy remains.
+ *
+ * Every strategy reads one word of every page of the data it got. For read() that is on top
+ * of the copy into the buffer, mmap() has no copy at all: the warm mmap() numbers are the cost
+ * of the page faults (the kernel maps up to 16 cached pages per fault, "fault-around").
+ *
+ * The strategies:
+ * 1. std::fstream::read() with a 64KB buffer (seekg() + read() of 4KB for random),
+ * 2. read() with 4KB, 64KB and 1MB buffers, pread() for random access,
+ * 3. mmap() touching every page, plain, with MAP_POPULATE and with madvise() hints,
+ * 4. pread() on a file opened with O_DIRECT (no page cache, aligned buffers),
+ * 5. io_uring (include/uring.hpp) with 32 requests in flight, buffered and with O_DIRECT.
+ *
+ * With '--perf' the hardware counters of include/perf_counters.hpp are read around the passes
+ * and reported per pass: the page faults and dTLB misses show where mmap() spends its time.
+ * Only the calling thread is counted, not the kernel workers that complete io_uring requests.
  */
 
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <fcntl.h>
+#include <unistd.h>
 #include <chrono>
+#include <cstdlib>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
 
-// Step 1. define the size of the file to read
-constexpr auto size = 0x1000;
+#include "benchmark.hpp"
+#include "perf_counters.hpp"
+#include "uring.hpp"
 
-// Step 2. define a 'benchmark' function to recored how long it takes to perform an action
-template <typename FUNC>
-auto benchmark(FUNC func)
+// Step 1. define the sizes of the file to read, and the block size of random access
+constexpr std::uint64_t page_size = 0x1000;
+constexpr std::uint64_t max_random_blocks = (1ULL << 30) / page_size;
+
+struct config
+{
+    std::vector<std::uint64_t> sizes{4 << 10, 1 << 20, 64 << 20, 1 << 30};
+    bool sequential{true};
+    bool random{true};
+    bool cold{true};
+    bool warm{true};
+    int repeat{3};
+    std::string filename{"mmap_bench.dat"};
+};
+
+// Step 2. one pass of a strategy reads 'size' bytes of the file in the order of 'blocks'
+// (empty for sequential access) and returns a checksum of one word per page,
+// so that every page is really touched and nothing is optimized away
+struct pass
 {
-    auto startTime = std::chrono::high_resolution_clock::now();
-    func();
-    auto endTime = std::chrono::high_resolution_clock::now();
+    const std::string &filename;
+    std::uint64_t size;
+    const std::vector<std::uint64_t> &blocks;
+};
+
+inline std::uint64_t touch(const char *data, std::size_t len)
+{
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < len; i += page_size)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        sum += word;
+    }
 
-    return endTime - startTime;
+    return sum;
 }
 
-// Step 3. create a file read, and then read the file using std::fstream and mmap function
-int protected_main(int argc, char **argv)
+struct aligned_buffer
+{
+    explicit aligned_buffer(std::size_t size) : data{static_cast<char *>(std::aligned_alloc(page_size, size))}
+    {
+        if (data == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    ~aligned_buffer()
+    {
+        std::free(data);
+    }
+
+    char *data;
+};
+
+int open_file(const std::string &filename, int flags = 0)
+{
+    auto fd = open(filename.c_str(), O_RDONLY | flags);
+    if (fd == -1)
+    {
+        throw std::runtime_error(filename + ": " + strerror(errno));
+    }
+
+    return fd;
+}
+
+// Step 3. the strategies
+std::uint64_t fstream_read(const pass &p)
+{
+    std::uint64_t sum = 0;
+    std::vector<char> buf(64 << 10);
+
+    if (auto file = std::fstream(p.filename, std::ios::in | std::ios::binary))
+    {
+        if (p.blocks.empty())
+        {
+            for (std::uint64_t pos = 0; pos < p.size; pos += buf.size())
+            {
+                auto len = std::min<std::uint64_t>(buf.size(), p.size - pos);
+                file.read(buf.data(), static_cast<std::streamsize>(len));
+                sum += touch(buf.data(), len);
+            }
+        }
+        else
+        {
+            for (auto block : p.blocks)
+            {
+                file.seekg(static_cast<std::streamoff>(block * page_size));
+                file.read(buf.data(), page_size);
+                sum += touch(buf.data(), page_size);
+            }
+        }
+    }
+
+    return sum;
+}
+
+std::function<std::uint64_t(const pass &)> posix_read(std::size_t buf_size)
+{
+    return [buf_size](const pass &p)
+    {
+        std::uint64_t sum = 0;
+        aligned_buffer buf{buf_size};
+
+        auto fd = open_file(p.filename);
+        if (p.blocks.empty())
+        {
+            for (std::uint64_t pos = 0; pos < p.size;)
+            {
+                auto len = read(fd, buf.data, std::min<std::uint64_t>(buf_size, p.size - pos));
+                if (len <= 0)
+                {
+                    break;
+                }
+
+                sum += touch(buf.data, static_cast<std::size_t>(len));
+                pos += static_cast<std::uint64_t>(len);
+            }
+        }
+        else
+        {
+            for (auto block : p.blocks)
+            {
+                if (pread(fd, buf.data, page_size, static_cast<off_t>(block * page_size)) > 0)
+                {
+                    sum += touch(buf.data, page_size);
+                }
+            }
+        }
+
+        close(fd);
+        return sum;
+    };
+}
+
+std::function<std::uint64_t(const pass &)> direct_read(std::size_t buf_size)
+{
+    return [buf_size](const pass &p)
+    {
+        std::uint64_t sum = 0;
+        aligned_buffer buf{buf_size};
+
+        auto fd = open_file(p.filename, O_DIRECT);
+        if (p.blocks.empty())
+        {
+            for (std::uint64_t pos = 0; pos < p.size; pos += buf_size)
+            {
+                auto len = std::min<std::uint64_t>(buf_size, p.size - pos);
+                if (pread(fd, buf.data, len, static_cast<off_t>(pos)) <= 0)
+                {
+                    break;
+                }
+
+                sum += touch(buf.data, len);
+            }
+        }
+        else
+        {
+            for (auto block : p.blocks)
+            {
+                if (pread(fd, buf.data, page_size, static_cast<off_t>(block * page_size)) > 0)
+                {
+                    sum += touch(buf.data, page_size);
+                }
+            }
+        }
+
+        close(fd);
+        return sum;
+    };
+}
+
+enum class mmap_mode
+{
+    plain,
+    populate,
+    advise
+};
+
+std::function<std::uint64_t(const pass &)> mmap_read(mmap_mode mode)
+{
+    return [mode](const pass &p)
+    {
+        auto fd = open_file(p.filename);
+
+        // MAP_PRIVATE or MAP_SHARED is mandatory, a read-only mapping behaves the same with both
+        auto flags = MAP_PRIVATE | (mode == mmap_mode::populate ? MAP_POPULATE : 0);
+        auto ptr = mmap(nullptr, p.size, PROT_READ, flags, fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error(std::string("mmap: ") + strerror(errno));
+        }
+
+        if (mode == mmap_mode::advise)
+        {
+            // the advice values are not flags, one call per advice
+            if (p.blocks.empty())
+            {
+                madvise(ptr, p.size, MADV_SEQUENTIAL);
+                madvise(ptr, p.size, MADV_WILLNEED);
+            }
+            else
+            {
+                madvise(ptr, p.size, MADV_RANDOM);
+            }
+        }
+
+        std::uint64_t sum = 0;
+        auto data = static_cast<const char *>(ptr);
+
+        if (p.blocks.empty())
+        {
+            sum = touch(data, p.size);
+        }
+        else
+        {
+            for (auto block : p.blocks)
+            {
+                sum += touch(data + block * page_size, page_size);
+            }
+        }
+
+        munmap(ptr, p.size);
+        close(fd);
+
+        return sum;
+    };
+}
+
+// reads with 'depth' requests in flight, every request has its own buffer
+std::function<std::uint64_t(const pass &)> uring_read(std::size_t buf_size, int flags)
+{
+    return [buf_size, flags](const pass &p)
+    {
+        constexpr unsigned depth = 32;
+
+        uring::ring ring{depth};
+        aligned_buffer buf{depth * buf_size};
+
+        auto fd = open_file(p.filename, flags);
+        auto block_size = p.blocks.empty() ? buf_size : page_size;
+        auto count = p.blocks.empty() ? (p.size + buf_size - 1) / buf_size : p.blocks.size();
+
+        std::vector<unsigned> free_slots;
+        for (unsigned i = 0; i < depth; i++)
+        {
+            free_slots.push_back(i);
+        }
+
+        std::uint64_t sum = 0;
+        std::uint64_t next = 0;
+        std::uint64_t done = 0;
+
+        // the first failed read, reported once no request uses the buffers any more
+        int error = 0;
+
+        while (done < count)
+        {
+            while (next < count && !free_slots.empty())
+            {
+                auto slot = free_slots.back();
+                auto offset = p.blocks.empty() ? next * buf_size : p.blocks[next] * page_size;
+                auto len = std::min<std::uint64_t>(block_size, p.size - offset);
+
+                // the ring has at least 'depth' entries, but never lose a block if it is full
+                if (!ring.read(fd, buf.data + slot * buf_size, static_cast<unsigned>(len), offset, slot))
+                {
+                    break;
+                }
+                free_slots.pop_back();
+                next++;
+            }
+
+            ring.submit(1);
+            done += ring.for_each_completion([&](const io_uring_cqe &cqe)
+                                             {
+                                                 auto slot = static_cast<unsigned>(cqe.user_data);
+                                                 if (cqe.res < 0 && error == 0)
+                                                 {
+                                                     error = -cqe.res;
+                                                 }
+                                                 else if (cqe.res > 0)
+                                                 {
+                                                     sum += touch(buf.data + slot * buf_size, static_cast<std::size_t>(cqe.res));
+                                                 }
+
+                                                 free_slots.push_back(slot);
+                                             });
+        }
+
+        close(fd);
+        if (error != 0)
+        {
+            throw std::runtime_error(p.filename + ": io_uring read: " + strerror(error));
+        }
+
+        return sum;
+    };
+}
+
+struct strategy
+{
+    std::string name;
+    // the name for random access, empty when the strategy is not run for random access
+    std::string random_name;
+    std::function<std::uint64_t(const pass &)> func;
+    bool needs_direct{};
+    bool needs_uring{};
+};
+
+// Step 4. the test file, and the control of the page cache
+void create_file(const std::string &filename, std::uint64_t size)
+{
+    struct stat st{};
+    if (stat(filename.c_str(), &st) == 0 && static_cast<std::uint64_t>(st.st_size) >= size)
+    {
+        return;
+    }
+
+    std::cout << "creating " << filename << " (" << size / (1 << 20) << " MB)...\n";
+
+    auto fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+    {
+        throw std::runtime_error(filename + ": " + strerror(errno));
+    }
+
+    std::vector<std::uint64_t> buf((1 << 20) / sizeof(std::uint64_t));
+    std::mt19937_64 rng{42};
+
+    for (std::uint64_t pos = 0; pos < size; pos += buf.size() * sizeof(std::uint64_t))
+    {
+        for (auto &word : buf)
+        {
+            word = rng();
+        }
+
+        auto len = std::min<std::uint64_t>(buf.size() * sizeof(std::uint64_t), size - pos);
+        if (write(fd, buf.data(), len) != static_cast<ssize_t>(len))
+        {
+            close(fd);
+            throw std::runtime_error(filename + ": " + strerror(errno));
+        }
+    }
+
+    fsync(fd);
+    close(fd);
+}
+
+// drops the clean pages of the file from the page cache, no root needed
+void drop_cache(const std::string &filename)
+{
+    auto fd = open_file(filename);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+bool direct_supported(const std::string &filename)
+{
+    auto fd = open(filename.c_str(), O_RDONLY | O_DIRECT);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    aligned_buffer buf{page_size};
+    auto ok = pread(fd, buf.data, page_size, 0) == static_cast<ssize_t>(page_size);
+    close(fd);
+
+    return ok;
+}
+
+// Step 5. run a strategy: warm passes repeat until 20ms have passed (small files take microseconds),
+// cold passes drop the cache before every pass. The best pass is reported.
+struct row
+{
+    std::uint64_t size;
+    std::string pattern;
+    std::string cache;
+    std::string name;
+    double seconds;
+    std::uint64_t bytes;
+
+    // per pass, of the best repetition; only filled with --perf
+    perf::sample counters{};
+};
+
+struct measurement
+{
+    double seconds;
+    perf::sample counters;
+};
+
+// 'pmu' is nullptr without --perf
+measurement measure(const strategy &s, const pass &p, bool cold, int repeat, perf::counters *pmu)
 {
-    (void)argc;
-    (void)argv;
+    using namespace std::chrono;
 
+    measurement best{};
+    for (auto r = 0; r < repeat; r++)
     {
-        char buf[size] = {};
-        if (auto file = std::fstream("test.txt", std::ios::out))
+        if (cold)
         {
-            file.write(buf, size);
+            drop_cache(p.filename);
+        }
+        else
+        {
+            bench::do_not_optimize(s.func(p));
+        }
+
+        std::uint64_t passes = 0;
+        if (pmu)
+        {
+            pmu->start();
+        }
+        auto start = steady_clock::now();
+        auto elapsed = 0.0;
+
+        do
+        {
+            bench::do_not_optimize(s.func(p));
+            passes++;
+            elapsed = duration<double>(steady_clock::now() - start).count();
+        } while (!cold && elapsed < 0.02);
+
+        perf::sample counters{};
+        if (pmu)
+        {
+            counters = pmu->stop();
+            for (auto &value : counters.values)
+            {
+                value /= static_cast<double>(passes);
+            }
+        }
+
+        auto secs = elapsed / static_cast<double>(passes);
+        if (r == 0 || secs < best.seconds)
+        {
+            best = {secs, counters};
         }
     }
 
+    return best;
+}
+
+std::string size_name(std::uint64_t size)
+{
+    if (size >= (1ULL << 30) && size % (1ULL << 30) == 0)
     {
-        char buf[size];
-        if (auto file = std::fstream("test.txt", std::ios::in))
+        return std::to_string(size >> 30) + "GB";
+    }
+    if (size >= (1ULL << 20) && size % (1ULL << 20) == 0)
+    {
+        return std::to_string(size >> 20) + "MB";
+    }
+
+    return std::to_string(size >> 10) + "KB";
+}
+
+void print(const std::vector<row> &rows, bench::format format, bool counters)
+{
+    auto &os = std::cout;
+    switch (format)
+    {
+    case bench::format::csv:
+        os << "size,pattern,cache,strategy,seconds,bytes,gb_per_s";
+        if (counters)
         {
-            auto time = benchmark([&file, &buf]
-                                  { file.read(buf, size); });
+            for (auto name : perf::event_names)
+            {
+                os << ',' << name;
+            }
+        }
+        os << '\n';
+
+        for (const auto &r : rows)
+        {
+            os << r.size << ',' << r.pattern << ',' << r.cache << ',' << r.name << ','
+               << r.seconds << ',' << r.bytes << ',' << static_cast<double>(r.bytes) / r.seconds / 1e9;
+            if (counters)
+            {
+                for (std::size_t idx = 0; idx < perf::num_events; idx++)
+                {
+                    // an empty field marks a counter that was not available
+                    os << ',';
+                    if (r.counters.valid[idx])
+                    {
+                        os << r.counters.values[idx];
+                    }
+                }
+            }
+            os << '\n';
+        }
+        break;
 
-            std::cout << "c++ time: " << std::chrono::duration_cast<std::chrono::microseconds>(time).count() << '\n';
+    case bench::format::json:
+        os << "[\n";
+        for (std::size_t i = 0; i < rows.size(); i++)
+        {
+            const auto &r = rows[i];
+            os << "  {\"size\": " << r.size << ", \"pattern\": \"" << r.pattern << "\", \"cache\": \"" << r.cache
+               << "\", \"strategy\": \"" << r.name << "\", \"seconds\": " << r.seconds << ", \"bytes\": " << r.bytes
+               << ", \"gb_per_s\": " << static_cast<double>(r.bytes) / r.seconds / 1e9;
+            if (counters)
+            {
+                os << ", \"counters\": {";
+                for (std::size_t idx = 0; idx < perf::num_events; idx++)
+                {
+                    os << (idx == 0 ? "" : ", ") << '"' << perf::event_names[idx] << "\": ";
+                    if (r.counters.valid[idx])
+                    {
+                        os << r.counters.values[idx];
+                    }
+                    else
+                    {
+                        os << "null";
+                    }
+                }
+                os << '}';
+            }
+            os << '}' << (i + 1 < rows.size() ? ",\n" : "\n");
         }
+        os << "]\n";
+        break;
+
+    default:
+        os << std::left << std::setw(8) << "size" << std::setw(12) << "pattern" << std::setw(8) << "cache"
+           << std::setw(24) << "strategy" << std::right << std::setw(14) << "time/pass" << std::setw(12) << "GB/s" << '\n';
+        os << std::string(78, '-') << '\n';
+
+        for (const auto &r : rows)
+        {
+            std::ostringstream time;
+            if (r.seconds < 1e-3)
+            {
+                time << std::fixed << std::setprecision(1) << r.seconds * 1e6 << " us";
+            }
+            else
+            {
+                time << std::fixed << std::setprecision(2) << r.seconds * 1e3 << " ms";
+            }
+
+            os << std::left << std::setw(8) << size_name(r.size) << std::setw(12) << r.pattern << std::setw(8) << r.cache
+               << std::setw(24) << r.name << std::right << std::setw(14) << time.str()
+               << std::setw(12) << std::fixed << std::setprecision(2) << static_cast<double>(r.bytes) / r.seconds / 1e9 << '\n';
+        }
+
+        if (counters)
+        {
+            os << '\n'
+               << std::left << std::setw(52) << "counters per pass" << std::right;
+            for (auto name : perf::event_names)
+            {
+                os << std::setw(15) << name;
+            }
+            os << '\n';
+
+            for (const auto &r : rows)
+            {
+                os << std::left << std::setw(8) << size_name(r.size) << std::setw(12) << r.pattern << std::setw(8) << r.cache
+                   << std::setw(24) << r.name << std::right << std::setprecision(0);
+                for (std::size_t idx = 0; idx < perf::num_events; idx++)
+                {
+                    if (r.counters.valid[idx])
+                    {
+                        os << std::setw(15) << r.counters.values[idx];
+                    }
+                    else
+                    {
+                        os << std::setw(15) << "n/a";
+                    }
+                }
+                os << '\n';
+            }
+        }
+        break;
+    }
+}
+
+std::uint64_t parse_size(const std::string &str)
+{
+    auto value = std::stoull(str);
+    switch (str.back())
+    {
+    case 'G':
+        value <<= 30;
+        break;
+    case 'M':
+        value <<= 20;
+        break;
+    case 'K':
+        value <<= 10;
+        break;
+    default:
+        break;
+    }
+
+    // every size is a whole number of pages, for mmap() and O_DIRECT
+    return std::max<std::uint64_t>(page_size, value / page_size * page_size);
+}
+
+// ----Usage:
+// g++ -std=c++2a -O2 -I../include mmap_benchmark.cpp -o mmap_benchmark
+// ./mmap_benchmark
+// ./mmap_benchmark --sizes=4K,1M,64M,1G,10G --pattern=seq --cache=cold --format=csv
+// ./mmap_benchmark --repeat=1 --file=/mnt/ssd/mmap_bench.dat
+// ./mmap_benchmark --sizes=64M --pattern=random --perf
+
+// Step 6. parse the options, create the test file and print the comparison table
+int protected_main(int argc, char **argv)
+{
+    auto opts = bench::parse_args(argc, argv);
+
+    config cfg;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--sizes="))
+        {
+            cfg.sizes.clear();
+
+            std::stringstream list{arg.substr(8)};
+            for (std::string item; std::getline(list, item, ',');)
+            {
+                cfg.sizes.push_back(parse_size(item));
+            }
+        }
+        else if (arg.starts_with("--pattern="))
+        {
+            cfg.sequential = arg.substr(10) != "random";
+            cfg.random = arg.substr(10) != "seq";
+        }
+        else if (arg.starts_with("--cache="))
+        {
+            cfg.cold = arg.substr(8) != "warm";
+            cfg.warm = arg.substr(8) != "cold";
+        }
+        else if (arg.starts_with("--repeat="))
+        {
+            cfg.repeat = std::max(1, std::stoi(arg.substr(9)));
+        }
+        else if (arg.starts_with("--file="))
+        {
+            cfg.filename = arg.substr(7);
+        }
+    }
+
+    auto max_size = *std::max_element(cfg.sizes.begin(), cfg.sizes.end());
+    create_file(cfg.filename, max_size);
+
+    auto has_direct = direct_supported(cfg.filename);
+    auto has_uring = uring::supported();
+
+    if (!has_direct)
+    {
+        std::clog << "O_DIRECT is not supported by the filesystem of " << cfg.filename << ", skipped\n";
     }
+    if (!has_uring)
+    {
+        std::clog << "io_uring is not available, skipped\n";
+    }
+
+    std::vector<strategy> strategies{
+        {"fstream 64KB", "fstream 4KB", fstream_read},
+        {"read 4KB", "pread 4KB", posix_read(4 << 10)},
+        {"read 64KB", "", posix_read(64 << 10)},
+        {"read 1MB", "", posix_read(1 << 20)},
+        {"mmap", "mmap", mmap_read(mmap_mode::plain)},
+        {"mmap MAP_POPULATE", "mmap MAP_POPULATE", mmap_read(mmap_mode::populate)},
+        {"mmap madvise", "mmap madvise", mmap_read(mmap_mode::advise)},
+        {"O_DIRECT pread 1MB", "O_DIRECT pread 4KB", direct_read(1 << 20), true},
+        {"io_uring QD32 128KB", "io_uring QD32 4KB", uring_read(128 << 10, 0), false, true},
+        {"io_uring O_DIRECT 128KB", "io_uring O_DIRECT 4KB", uring_read(128 << 10, O_DIRECT), true, true},
+    };
 
+    // the passes run on this thread, its counters are enough
+    perf::counters *pmu = nullptr;
+    if (opts.perf_counters)
     {
-        void *buf;
-        if (int fd = open("test.txt", O_RDONLY); fd != 0)
+        pmu = &perf::thread_counters();
+        if (auto msg = perf::unavailable(*pmu); !msg.empty())
         {
-            auto time = benchmark([&fd, &buf]
-                                  { buf = mmap(NULL, size, PROT_READ, 0, fd, 0); });
+            std::clog << "perf counters not available:\n"
+                      << msg;
+        }
+    }
 
-            munmap(buf, size);
+    std::vector<row> rows;
+    std::mt19937_64 rng{7};
 
-            std::cout << "mmap time: " << std::chrono::duration_cast<std::chrono::microseconds>(time).count() << '\n';
+    for (auto size : cfg.sizes)
+    {
+        // random access: a permutation of the 4KB blocks of the file
+        std::vector<std::uint64_t> blocks(std::min(size / page_size, max_random_blocks));
+        for (std::uint64_t i = 0; i < blocks.size(); i++)
+        {
+            blocks[i] = i * (size / page_size / blocks.size());
+        }
+        std::shuffle(blocks.begin(), blocks.end(), rng);
+
+        const std::vector<std::uint64_t> none;
+
+        for (auto random : {false, true})
+        {
+            if ((random && !cfg.random) || (!random && !cfg.sequential))
+            {
+                continue;
+            }
+
+            for (auto cold : {true, false})
+            {
+                if ((cold && !cfg.cold) || (!cold && !cfg.warm))
+                {
+                    continue;
+                }
+
+                pass p{cfg.filename, size, random ? blocks : none};
+                auto bytes = random ? blocks.size() * page_size : size;
+
+                for (const auto &s : strategies)
+                {
+                    if ((s.needs_direct && !has_direct) || (s.needs_uring && !has_uring) || (random && s.random_name.empty()))
+                    {
+                        continue;
+                    }
+
+                    auto m = measure(s, p, cold, cfg.repeat, pmu);
+                    rows.push_back({size, random ? "random 4KB" : "sequential", cold ? "cold" : "warm",
+                                    random ? s.random_name : s.name, m.seconds, bytes, m.counters});
+                }
+            }
         }
     }
 
+    print(rows, opts.format, opts.perf_counters);
+
     return EXIT_SUCCESS;
 }
 
@@ -2,10 +2,12 @@
  * @File    : read_write_file.cpp
  * @Brief   : Reading and writing to a file 
  * -----------------------------
+ * @Command : g++ -std=c++2a -I../include read_write_file.cpp
  * @Command : echo "Hello World" > test.txt
  * @Command : echo "42" > test.txt
  * @Command : echo "" > test_write.txt
  * @Command : cat test_write.txt
+ * @Command : ls -l test_integrity.lz4
  * -----------------------------
  * @Author  : Wei Li
  * @Date    : 2021-11-06
@@ -17,6 +19,9 @@
  * includeing by field, by line, and by number of bytes.
  * 
  * std::fstream can be overloaded to provide support for user-defined types.
+ * Instead of one hand-written operator>> and operator<< per struct, the structs here declare
+ * their fields once (serial::fields, include/serialize.hpp), and the stream operators, a binary
+ * and a JSON serializer are generated from that list at compile time (see serialize_benchmark.cpp).
  * 
  * Writing to a file
  * several defferent modes of tile writing,
@@ -28,34 +33,37 @@
  * 2. eof() function
  * 3. fail() function
  * 4. bad() function
+ *
+ * The file streams accept any stream buffer in between: integrity::ofstream and integrity::ifstream
+ * (include/integrity_stream.hpp) checksum the bytes on their way through (CRC32C and XXH3), optionally
+ * LZ4-compressed, so a file can be verified without reading it a second time.
  */
 
 #include <fstream>
 #include <string.h>
 #include <iostream>
 
+#include "integrity_stream.hpp"
+#include "serialize.hpp"
+
+// operator<< and operator>> for every struct with a serial::fields list
+using namespace serial::operators;
+
+// Reading and writing field by field formats and parses text on every access.
+// For large data sets of fixed-width records, see record_file_example.cpp:
+// a binary record file (include/record_file.hpp) is mapped with mmap()
+// and used in place as a std::span of records, without parsing or copying.
 struct myclass
 {
     std::string hello;
     std::string world;
 };
 
-std::fstream &operator>>(std::fstream &is, myclass &obj)
-{
-    is >> obj.hello;
-    is >> obj.world;
-
-    return is;
-}
-
-std::ostream &operator<<(std::ostream &os, myclass &obj)
-{
-    os << obj.hello;
-    os << ' ';
-    os << obj.world;
-
-    return os;
-}
+// one declaration replaces the field-by-field operator>> and operator<<
+template <>
+inline constexpr auto serial::fields<myclass> = std::tuple{
+    serial::field("hello", &myclass::hello),
+    serial::field("world", &myclass::world)};
 
 /** Reading by bytes
  * We need to ensure that the total number of bytes being read does not exceed the total size of the buffer itself
@@ -82,14 +90,10 @@ struct mycalss_write
     std::string world{"Wrold"};
 };
 
-std::fstream &operator<<(std::fstream &os, const mycalss_write &obj)
-{
-    os << obj.hello;
-    os << ' ';
-    os << obj.world;
-
-    return os;
-}
+template <>
+inline constexpr auto serial::fields<mycalss_write> = std::tuple{
+    serial::field("hello", &mycalss_write::hello),
+    serial::field("world", &mycalss_write::world)};
 
 // buffer overflow issue
 // To overcome this, a wrapper should be used whenever using these types of unsafe functions
@@ -224,6 +228,19 @@ int main(int argc, char **argv)
         file << mycalss_write{} << '\n';
     }
 
+    // the same field list gives a binary and a JSON form
+    if (auto file = std::fstream("test_write.txt"))
+    {
+        serial::output json;
+        serial::json::write(json, mycalss_write{});
+        file.write(json.data(), static_cast<std::streamsize>(json.size()));
+        file << '\n';
+
+        serial::output binary;
+        serial::binary::write(binary, mycalss_write{});
+        std::cout << "binary: " << binary.size() << " bytes, JSON: " << json.view() << '\n';
+    }
+
     // writit by byrtes
     if (auto file = std::fstream("test_write.txt"))
     {
@@ -273,5 +290,33 @@ int main(int argc, char **argv)
         file.flush();
     }
 
+    // ----------------------------------------
+    // Writing and reading through an integrity stage
+    std::cout << "----------------------" << '\n';
+    integrity::digest_value written{};
+    if (auto file = integrity::ofstream("test_integrity.lz4", integrity::compression::lz4))
+    {
+        for (auto i = 0; i < 1000; i++)
+        {
+            file << mycalss_write{} << " line " << i << '\n';
+        }
+        // close() flushes the last block and returns the checksums of the uncompressed text
+        written = file.close();
+        std::cout << "written: " << written << '\n';
+    }
+
+    if (auto file = integrity::ifstream("test_integrity.lz4", integrity::compression::lz4))
+    {
+        std::string line;
+        std::getline(file, line);
+        std::cout << line << '\n';
+
+        // the checksums cover what was read, the whole file once the stream reached its end
+        while (std::getline(file, line))
+        {
+        }
+        std::cout << "read:    " << file.value() << (file.value() == written ? ", intact" : ", CORRUPTED") << '\n';
+    }
+
     return 0;
 }
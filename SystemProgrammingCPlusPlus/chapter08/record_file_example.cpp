@@ -0,0 +1,246 @@
+/**
+ * @File    : record_file_example.cpp
+ * @Brief   : Memory-mapped binary record files versus reading objects field by field with std::fstream
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include record_file_example.cpp -o record_file
+ * @Command : ./record_file
+ * @Command : ./record_file --records=50000000
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Record files for replay data sets
+ * read_write_file.cpp reads and writes user-defined types field by field
+ * with operator>> and operator<< on a std::fstream. Every field is formatted as text
+ * on writing and parsed again on reading.
+ *
+ * include/record_file.hpp stores fixed-width binary records after a versioned header.
+ * The reader maps the file and returns a std::span<const replay_record> over the mapped pages.
+ *
+ * This example writes the same records in both formats and measures:
+ * 1. writing: operator<< per field versus the batch writer,
+ * 2. open time: the stream path has to parse every record before the first one can be used,
+ *    the record file only checks its header,
+ * 3. scan speed: summing a field over all records (warm page cache),
+ * 4. random access: reading records at random positions.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "record_file.hpp"
+
+// Step 1. the record type: fixed-width fields, no padding, a type id and a version
+struct replay_record
+{
+    static constexpr std::uint32_t type_id = 1;
+    static constexpr std::uint32_t version = 1;
+
+    std::uint64_t timestamp;
+    std::uint64_t order_id;
+    std::int64_t price;
+    std::uint32_t quantity;
+    std::uint16_t side;
+    std::uint16_t flags;
+};
+
+static_assert(sizeof(replay_record) == 32);
+
+// Step 2. the stream path of read_write_file.cpp, field by field
+std::fstream &operator>>(std::fstream &is, replay_record &obj)
+{
+    is >> obj.timestamp;
+    is >> obj.order_id;
+    is >> obj.price;
+    is >> obj.quantity;
+    is >> obj.side;
+    is >> obj.flags;
+
+    return is;
+}
+
+std::fstream &operator<<(std::fstream &os, const replay_record &obj)
+{
+    os << obj.timestamp << ' ' << obj.order_id << ' ' << obj.price << ' '
+       << obj.quantity << ' ' << obj.side << ' ' << obj.flags << '\n';
+
+    return os;
+}
+
+replay_record make_record(std::uint64_t i)
+{
+    return replay_record{1'700'000'000'000'000'000ULL + i * 1000, i, static_cast<std::int64_t>(10000 + i % 977),
+                         static_cast<std::uint32_t>(1 + i % 100), static_cast<std::uint16_t>(i & 1), 0};
+}
+
+// Step 3. a wall-clock measurement, repeated until it took at least 20ms
+template <typename FUNC>
+void measure(const std::string &name, std::uint64_t records, FUNC func)
+{
+    using namespace std::chrono;
+
+    std::uint64_t passes = 0;
+    auto start = steady_clock::now();
+    auto elapsed = 0.0;
+
+    do
+    {
+        bench::do_not_optimize(func());
+        passes++;
+        elapsed = duration<double>(steady_clock::now() - start).count();
+    } while (elapsed < 0.02);
+
+    auto secs = elapsed / static_cast<double>(passes);
+
+    std::ostringstream time;
+    if (secs < 1e-3)
+    {
+        time << std::fixed << std::setprecision(2) << secs * 1e6 << " us";
+    }
+    else
+    {
+        time << std::fixed << std::setprecision(2) << secs * 1e3 << " ms";
+    }
+
+    std::cout << std::left << std::setw(36) << name << std::right << std::setw(14) << time.str()
+              << std::setw(12) << std::fixed << std::setprecision(1) << static_cast<double>(records) / secs / 1e6 << " M records/s\n";
+}
+
+int protected_main(int argc, char **argv)
+{
+    std::uint64_t num_records = 5'000'000;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--records="))
+        {
+            num_records = std::stoull(arg.substr(10));
+        }
+    }
+
+    std::cout << "[TEST] " << num_records << " records of " << sizeof(replay_record) << " bytes\n";
+
+    // Step 4. writing
+    measure("write: fstream operator<<", num_records, [num_records]
+            {
+                if (auto file = std::fstream("replay.txt", std::ios::out | std::ios::trunc))
+                {
+                    for (std::uint64_t i = 0; i < num_records; i++)
+                    {
+                        file << make_record(i);
+                    }
+                }
+
+                return 0;
+            });
+
+    measure("write: records::writer", num_records, [num_records]
+            {
+                records::writer<replay_record> writer{"replay.rec"};
+                for (std::uint64_t i = 0; i < num_records; i++)
+                {
+                    writer.append(make_record(i));
+                }
+
+                return writer.size();
+            });
+
+    // Step 5. open: the stream path has to parse the whole file before it can be used
+    std::vector<replay_record> parsed;
+    measure("open: fstream operator>> (all)", num_records, [&parsed]
+            {
+                parsed.clear();
+                if (auto file = std::fstream("replay.txt", std::ios::in))
+                {
+                    replay_record r{};
+                    while (file >> r)
+                    {
+                        parsed.push_back(r);
+                    }
+                }
+
+                return parsed.size();
+            });
+
+    measure("open: records::reader (mmap)", num_records, []
+            {
+                records::reader<replay_record> reader{"replay.rec"};
+                return reader.size();
+            });
+
+    records::reader<replay_record> reader{"replay.rec", records::access::sequential};
+    if (reader.size() != parsed.size())
+    {
+        throw std::runtime_error("the two formats hold a different number of records");
+    }
+
+    // Step 6. scanning, the vector of the stream path is already in memory
+    measure("scan: parsed std::vector", num_records, [&parsed]
+            {
+                std::int64_t sum = 0;
+                for (const auto &r : parsed)
+                {
+                    sum += r.price * r.quantity;
+                }
+
+                return sum;
+            });
+
+    measure("scan: mapped std::span", num_records, [&reader]
+            {
+                std::int64_t sum = 0;
+                for (const auto &r : reader.records())
+                {
+                    sum += r.price * r.quantity;
+                }
+
+                return sum;
+            });
+
+    // Step 7. random access, 1M lookups
+    std::vector<std::uint64_t> positions(1'000'000);
+    std::mt19937_64 rng{42};
+    for (auto &pos : positions)
+    {
+        pos = rng() % reader.size();
+    }
+
+    measure("random: mapped std::span", positions.size(), [&reader, &positions]
+            {
+                std::uint64_t sum = 0;
+                for (auto pos : positions)
+                {
+                    sum += reader[pos].order_id;
+                }
+
+                return sum;
+            });
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
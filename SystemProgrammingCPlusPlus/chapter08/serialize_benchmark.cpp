@@ -0,0 +1,287 @@
+/**
+ * @File    : serialize_benchmark.cpp
+ * @Brief   : Field-list serializers (binary, text, JSON) versus hand-written iostream operators
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include serialize_benchmark.cpp -o serialize_benchmark
+ * @Command : ./serialize_benchmark
+ * @Command : ./serialize_benchmark --records=1000000 --format=json
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Serializing records
+ * Two record types, each declared once with a serial::fields list (include/serialize.hpp):
+ * - myclass from read_write_file.cpp: two strings, the iostream operators of that file are the baseline,
+ * - reading: four numbers without padding, which the binary serializer copies with memcpy().
+ *
+ * Every case writes (or reads back) 'records' records into memory, so the numbers measure
+ * the formatting and parsing alone, not the file system:
+ * - iostream: the hand-written operator<< / operator>> with std::ostringstream / std::istringstream,
+ * - serial::text: the same text, with std::to_chars() / std::from_chars(),
+ * - serial::binary: per record, and for the whole std::vector at once,
+ * - serial::json: writing only,
+ * - memcpy: the bytes of the array, the upper bound.
+ * The table reports nanoseconds per record next to the statistics of each case.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "serialize.hpp"
+
+struct myclass
+{
+    std::string hello;
+    std::string world;
+};
+
+template <>
+inline constexpr auto serial::fields<myclass> = std::tuple{
+    serial::field("hello", &myclass::hello),
+    serial::field("world", &myclass::world)};
+
+struct reading
+{
+    std::uint64_t id;
+    double value;
+    std::int32_t sensor;
+    std::uint32_t flags;
+};
+
+template <>
+inline constexpr auto serial::fields<reading> = std::tuple{
+    serial::field("id", &reading::id),
+    serial::field("value", &reading::value),
+    serial::field("sensor", &reading::sensor),
+    serial::field("flags", &reading::flags)};
+
+static_assert(serial::memcpy_able<reading>());
+static_assert(!serial::memcpy_able<myclass>());
+
+// Step 1. the hand-written operators, one pair per struct
+std::ostream &operator<<(std::ostream &os, const myclass &obj)
+{
+    os << obj.hello;
+    os << ' ';
+    os << obj.world;
+
+    return os;
+}
+
+std::istream &operator>>(std::istream &is, myclass &obj)
+{
+    is >> obj.hello;
+    is >> obj.world;
+
+    return is;
+}
+
+std::ostream &operator<<(std::ostream &os, const reading &obj)
+{
+    os << obj.id << ' ' << obj.value << ' ' << obj.sensor << ' ' << obj.flags;
+
+    return os;
+}
+
+std::istream &operator>>(std::istream &is, reading &obj)
+{
+    is >> obj.id >> obj.value >> obj.sensor >> obj.flags;
+
+    return is;
+}
+
+template <typename T>
+void check_equal(const std::vector<T> &a, const std::vector<T> &b, const char *what)
+{
+    std::string x, y;
+    serial::output ox, oy;
+    serial::binary::write(ox, a);
+    serial::binary::write(oy, b);
+    if (ox.view() != oy.view())
+    {
+        throw std::runtime_error(std::string{"round trip failed: "} + what);
+    }
+}
+
+// Step 2. the same cases for both record types
+template <typename T>
+void run_cases(bench::reporter &reporter, std::vector<std::size_t> &counts, const std::string &type, const std::vector<T> &records)
+{
+    auto measure = [&](const std::string &name, auto func)
+    {
+        reporter.run(type + ": " + name, func);
+        counts.push_back(records.size());
+    };
+
+    // iostream
+    std::string iostream_text;
+    measure("iostream write", [&]
+            {
+                std::ostringstream os;
+                for (const auto &r : records)
+                {
+                    os << r << '\n';
+                }
+                iostream_text = std::move(os).str();
+            });
+
+    std::vector<T> parsed(records.size());
+    measure("iostream read", [&]
+            {
+                std::istringstream is{iostream_text};
+                for (auto &r : parsed)
+                {
+                    is >> r;
+                }
+            });
+
+    // serial::text
+    serial::output text;
+    measure("serial::text write", [&]
+            {
+                text.clear();
+                for (const auto &r : records)
+                {
+                    serial::text::write(text, r);
+                    text.put('\n');
+                }
+            });
+
+    measure("serial::text read", [&]
+            {
+                serial::input in{text.view()};
+                for (auto &r : parsed)
+                {
+                    serial::text::read(in, r);
+                }
+            });
+    check_equal(records, parsed, "text");
+
+    // serial::binary
+    serial::output binary;
+    measure("serial::binary write", [&]
+            {
+                binary.clear();
+                for (const auto &r : records)
+                {
+                    serial::binary::write(binary, r);
+                }
+            });
+
+    measure("serial::binary read", [&]
+            {
+                serial::input in{binary.view()};
+                for (auto &r : parsed)
+                {
+                    serial::binary::read(in, r);
+                }
+            });
+    check_equal(records, parsed, "binary");
+
+    measure("serial::binary write vector", [&]
+            {
+                binary.clear();
+                serial::binary::write(binary, records);
+            });
+
+    std::vector<T> whole;
+    measure("serial::binary read vector", [&]
+            {
+                serial::input in{binary.view()};
+                serial::binary::read(in, whole);
+            });
+    check_equal(records, whole, "binary vector");
+
+    // serial::json
+    serial::output json;
+    measure("serial::json write", [&]
+            {
+                json.clear();
+                serial::json::write(json, records);
+            });
+
+    // the bytes alone
+    if constexpr (std::is_trivially_copyable_v<T>)
+    {
+        std::vector<T> copy(records.size());
+        measure("memcpy", [&]
+                {
+                    std::memcpy(copy.data(), records.data(), records.size() * sizeof(T));
+                    bench::clobber_memory();
+                });
+    }
+
+    std::cout << type << ": iostream " << iostream_text.size() << " bytes, text " << text.size() << " bytes, binary "
+              << binary.size() << " bytes, json " << json.size() << " bytes\n";
+}
+
+int protected_main(int argc, char **argv)
+{
+    std::size_t count = 100000;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--records="))
+        {
+            count = std::stoull(arg.substr(10));
+        }
+    }
+
+    auto opts = bench::parse_args(argc, argv);
+
+    std::vector<myclass> words;
+    std::vector<reading> readings;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        words.push_back({"Hello" + std::to_string(i % 1000), "World" + std::to_string(i)});
+        readings.push_back({i, static_cast<double>(i) * 0.25 + 1.0 / static_cast<double>(i + 3),
+                            static_cast<std::int32_t>(i % 64) - 32, static_cast<std::uint32_t>(i * 2654435761U)});
+    }
+
+    // Step 3. run and report per record
+    bench::reporter reporter{opts};
+    std::vector<std::size_t> counts;
+
+    run_cases(reporter, counts, "myclass", words);
+    run_cases(reporter, counts, "reading", readings);
+
+    reporter.print();
+
+    std::cout << '\n'
+              << std::left << std::setw(44) << "per record" << std::right << std::setw(12) << "ns" << '\n';
+    for (std::size_t i = 0; i < reporter.results().size(); i++)
+    {
+        const auto &r = reporter.results()[i];
+        std::cout << std::left << std::setw(44) << r.name << std::right << std::setw(12) << std::fixed << std::setprecision(2)
+                  << r.median_ns / static_cast<double>(counts[i]) << '\n';
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
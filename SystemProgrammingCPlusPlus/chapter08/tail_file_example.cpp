@@ -12,83 +12,90 @@
  * The -f argument tells the tail to follow the file 
  * and -n0 tells tail to only output to stdout new additions.
  * 
+ * The first version polled the file: sleep(1), clear() the stream, sync() and std::getline() again.
+ * Every line waited up to a second, and the process woke up every second even for an idle file.
+ * The follower of include/file_follower.hpp is event driven (inotify): it sleeps until the kernel
+ * reports a change, reads the new bytes with pread() and splits them with a SIMD newline scanner.
+ * It also follows the file across a rotation (rename + new file) and a truncation, like tail -F,
+ * and follows any number of files from a single thread.
+ *
  * How to test the program:
- * 0. g++ -std=c++2a tail_file_example.cpp -o tail_file
+ * 0. g++ -std=c++2a -O2 -I../include tail_file_example.cpp -o tail_file
  * 1. touch test_tail.txt
  * 2. ./tail_file test_tail.txt
- * 3. echo "Hello World" > test_tail.txt
- * 4. ./tail_file test_tail.txt
- * 5. echo -n "Hello World" > test_tail.txt
- * 6. ./tail_file test_tail.txt
+ * 3. echo "Hello World" >> test_tail.txt  (in another terminal)
+ * 4. echo -n "Hello " >> test_tail.txt; echo "World" >> test_tail.txt
+ * 5. mv test_tail.txt test_tail.txt.1; echo "rotated" > test_tail.txt
+ * 6. ./tail_file test_tail.txt other.txt  (several files, each line prefixed with its file name)
  */
 
-#include <unistd.h>
-#include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include <gsl/gsl>
 
-// Step 1. define the mode plan to use when opening the file to tail
-// the file as read-only and move the read pointer to the end of file on open.
-constexpr auto mode = std::ios::in | std::ios::ate;
+#include "file_follower.hpp"
 
-// Step 2. 'tail' function that watches for changes to a file
-// and outputs the changes to stdout
-[[noreturn]] void tail(std::fstream &file)
+// Step 1. 'tail' function that watches for changes to the files
+// and outputs the new lines to stdout, starting at the current end of every file (tail -f -n0).
+// The follower sleeps in poll() until inotify reports a change, there is no polling interval.
+[[noreturn]] void tail(const std::vector<std::string> &filenames)
 {
-    while (true)
+    follow::options opts;
+    opts.notice = [](const std::string &path, const char *what)
     {
-        // checks whether the end of the file has been reached by first peeking the file
-        file.peek();
-        while (!file.eof())
-        {
-            auto pos = file.tellg();
+        std::cerr << "tail_file: " << path << ": file " << what << '\n';
+    };
 
-            std::string buf;
-            std::getline(file, buf, '\n');
-            // the read pointer is not at the end of the file
-            if (file.eof() && !file.good())
-            {
-                file.seekg(pos);
-                break;
-            }
+    follow::follower follower{std::move(opts)};
 
-            std::cout << buf << '\n';
+    for (const auto &filename : filenames)
+    {
+        if (filenames.size() == 1)
+        {
+            follower.add(filename, [](std::string_view line)
+                         { std::cout << line << '\n'; });
         }
-        //  sleeps for a second, clears all status bits,
-        // resyncs with the filesystem to see if any new changes have been made
-        sleep(1);
+        else
+        {
+            follower.add(filename, [filename](std::string_view line)
+                         { std::cout << filename << ": " << line << '\n'; });
+        }
+    }
 
-        file.clear();
-        file.sync();
+    while (true)
+    {
+        follower.poll();
+        std::cout.flush();
     }
 }
 
-// Step 3. Parse the arguments provided to our program
-// to get the file name to tail, open the file,
-// and then call the 'tail' function with the newly opened file.
+// Step 2. Parse the arguments provided to our program
+// to get the file names to tail, and then call the 'tail' function.
 int protected_main(int argc, char **argv)
 {
-    std::string filename;
+    std::vector<std::string> filenames;
     // parse the arguments using a gsl::span
     // to ensure safety and remain compliant with C++ Core Guidelines.
     auto args = gsl::make_span(argv, argc);
 
     if (args.size() < 2)
     {
+        std::string filename;
         std::cin >> filename;
+        filenames.push_back(filename);
     }
     else
     {
-        filename = gsl::ensure_z(args[1]).data();
-    }
-
-    if (auto file = std::fstream(filename, mode))
-    {
-        tail(file);
+        for (std::size_t i = 1; i < args.size(); i++)
+        {
+            filenames.emplace_back(gsl::ensure_z(args[i]).data());
+        }
     }
 
-    throw std::runtime_error("failed to open file");
+    std::ios::sync_with_stdio(false);
+    tail(filenames);
 }
 
 int main(int argc, char **argv)
@@ -42,10 +42,11 @@
 
 #include <list>
 #include <stack>
-#include <chrono>
 #include <iostream>
 #include <gsl/gsl>
 
+#include "benchmark.hpp"
+
 // ---------------------------------------
 // Pool memory to fast and performance
 // ---------------------------------------
@@ -223,73 +224,80 @@ bool operator!=(const myallocator<T1> &lhs, const myallocator<T2> &rhs)
 // -----------------------
 // Tests
 // -----------------------
-template <typename FUNC>
-auto benchmark(FUNC func)
-{
-    auto stime = std::chrono::high_resolution_clock::now();
-    func();
-    auto etime = std::chrono::high_resolution_clock::now();
-
-    return (etime - stime).count();
-}
 
+/** ----Usage:
+ * g++ -std=c++2a -O2 -I../include stateful_memory_pool_alloctor.cpp -o pool_allocator
+ * ./pool_allocator
+ * ./pool_allocator --format=json
+ * ./pool_allocator --perf
+ *
+ * The lists are created once, outside of the timed region, because every
+ * construction of a list (and every rebind of myallocator) prints a line.
+ * Each iteration adds 'num' elements and then removes them again,
+ * so the list is empty at the start of every iteration.
+ *
+ * With --perf the cache misses and dTLB misses per iteration show where the difference comes from:
+ * the pool hands out neighbouring chunks of one 4KB block, while malloc() spreads the nodes out.
+ */
 int main(int argc, char **argv)
 {
-    std::cout << "======== compare add many ==========\n";
     constexpr const auto num = 100000;
+    bench::reporter reporter{bench::parse_args(argc, argv)};
 
+    std::cout << "======== compare add/remove many ==========\n";
     std::list<int> mylist1;
     std::list<int, myallocator<int>> mylist2;
 
-    auto time1 = benchmark([&]
-                           {
-                               for (auto i = 0; i < num; i++)
-                               {
-                                   mylist1.emplace_back(42);
-                               }
-                           });
-
-    auto time2 = benchmark([&]
-                           {
-                               for (auto i = 0; i < num; i++)
-                               {
-                                   mylist2.emplace_back(42);
-                               }
-                           });
-
-    std::cout << "[TEST] add many:\n";
-    std::cout << "  - time1: " << time1 << '\n';
-    std::cout << "  - time2: " << time2 << '\n';
-
-    std::cout << "======== compare remove many ==========\n";
-    std::list<int> mylist_remove1;
-    std::list<int, myallocator<int>> mylist_remove2;
-
-    for (auto i = 0; i < num; i++)
-    {
-        mylist_remove1.emplace_back(42);
-        mylist_remove2.emplace_back(42);
-    }
-
-    auto time_remove1 = benchmark([&]
-                                  {
-                                      for (auto i = 0; i < num; i++)
-                                      {
-                                          mylist_remove1.pop_front();
-                                      }
-                                  });
-
-    auto time_remove2 = benchmark([&]
-                                  {
-                                      for (auto i = 0; i < num; i++)
-                                      {
-                                          mylist_remove2.pop_front();
-                                      }
-                                  });
-
-    std::cout << "[TEST] remove many:\n";
-    std::cout << "  - time1: " << time_remove1 << '\n';
-    std::cout << "  - time2: " << time_remove2 << '\n';
+    reporter.run("std::allocator add+pop_front", [&]
+                 {
+                     for (auto i = 0; i < num; i++)
+                     {
+                         mylist1.emplace_back(42);
+                     }
+                     for (auto i = 0; i < num; i++)
+                     {
+                         mylist1.pop_front();
+                     }
+                 });
+
+    reporter.run("myallocator add+pop_front", [&]
+                 {
+                     for (auto i = 0; i < num; i++)
+                     {
+                         mylist2.emplace_back(42);
+                     }
+                     for (auto i = 0; i < num; i++)
+                     {
+                         mylist2.pop_front();
+                     }
+                 });
+
+    reporter.run("std::allocator add+pop_back", [&]
+                 {
+                     for (auto i = 0; i < num; i++)
+                     {
+                         mylist1.emplace_back(42);
+                     }
+                     for (auto i = 0; i < num; i++)
+                     {
+                         mylist1.pop_back();
+                     }
+                 });
+
+    reporter.run("myallocator add+pop_back", [&]
+                 {
+                     for (auto i = 0; i < num; i++)
+                     {
+                         mylist2.emplace_back(42);
+                     }
+                     for (auto i = 0; i < num; i++)
+                     {
+                         mylist2.pop_back();
+                     }
+                 });
+
+    std::cout << "[TEST] add/remove many:\n";
+    reporter.print();
 
     std::cout << "======== std::list verify ==========\n";
     std::list<int, myallocator<int>> mylist;
@@ -0,0 +1,259 @@
+/**
+ * @File    : prefork_benchmark.cpp
+ * @Brief   : Requests per second of prefork_echo_server against the number of workers, SO_REUSEPORT and shared socket
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include prefork_echo_server.cpp -lpthread -o prefork_echo_server
+ * @Command : g++ -std=c++2a -O2 -I../include prefork_benchmark.cpp -lpthread -o prefork_benchmark
+ * @Command : ./prefork_benchmark
+ * @Command : ./prefork_benchmark --max-workers=16 --connections=256 --seconds=5
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Does it scale
+ * For 1, 2, 4, ... '--max-workers' workers (the number of CPUs by default), in both modes,
+ * the benchmark starts prefork_echo_server (include/launcher.hpp), found next to its own executable
+ * or given with '--server', opens '--connections' connections (64)
+ * from as many client threads as there are CPUs, and keeps one 64-byte request in flight on each of them
+ * for '--seconds' (2): a request is done when its echo is back.
+ * The clients run on the same machine and take their share of the CPUs: the server scales as long as
+ * there are cores left over; on a single CPU more workers only add context switches.
+ */
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <climits>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "launcher.hpp"
+
+constexpr std::size_t request_size = 64;
+
+int connect_to(std::uint16_t port)
+{
+    auto fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+// one client thread: its connections, each with one request in flight, until 'stop'
+std::uint64_t client(std::uint16_t port, int connections, const std::atomic<bool> &stop)
+{
+    auto epoll = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<int> fds;
+    std::vector<std::size_t> received(static_cast<std::size_t>(connections));
+    char request[request_size];
+    std::memset(request, 'x', sizeof(request));
+
+    for (auto i = 0; i < connections; i++)
+    {
+        auto fd = connect_to(port);
+        if (fd == -1)
+        {
+            throw std::runtime_error(std::string{"connect: "} + strerror(errno));
+        }
+        fds.push_back(fd);
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = static_cast<std::uint32_t>(i);
+        epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+        ::send(fd, request, sizeof(request), MSG_NOSIGNAL);
+    }
+
+    std::uint64_t done = 0;
+    char buf[4096];
+    epoll_event events[64];
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        auto count = epoll_wait(epoll, events, 64, 10);
+        for (auto i = 0; i < count; i++)
+        {
+            auto index = events[i].data.u32;
+            auto len = ::recv(fds[index], buf, sizeof(buf), MSG_DONTWAIT);
+            if (len <= 0)
+            {
+                continue;
+            }
+
+            // the whole echo is back: next request
+            received[index] += static_cast<std::size_t>(len);
+            if (received[index] >= request_size)
+            {
+                received[index] -= request_size;
+                done++;
+                ::send(fds[index], request, sizeof(request), MSG_NOSIGNAL);
+            }
+        }
+    }
+
+    for (auto fd : fds)
+    {
+        close(fd);
+    }
+    close(epoll);
+    return done;
+}
+
+double requests_per_second(std::uint16_t port, int threads, int connections, int seconds)
+{
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> clients;
+    std::vector<std::uint64_t> done(static_cast<std::size_t>(threads));
+    for (auto t = 0; t < threads; t++)
+    {
+        auto share = connections / threads + (t < connections % threads ? 1 : 0);
+        clients.emplace_back([&, t, share]
+                             { done[static_cast<std::size_t>(t)] = client(port, share, stop); });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto &c : clients)
+    {
+        c.join();
+    }
+
+    std::uint64_t total = 0;
+    for (auto d : done)
+    {
+        total += d;
+    }
+
+    return static_cast<double>(total) / seconds;
+}
+
+// prefork_echo_server next to this executable, not in whatever the current directory is
+std::string default_server()
+{
+    char self[PATH_MAX];
+    auto len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (len == -1)
+    {
+        throw std::runtime_error(std::string("/proc/self/exe: ") + strerror(errno));
+    }
+
+    std::string path{self, static_cast<std::size_t>(len)};
+    return path.substr(0, path.rfind('/') + 1) + "prefork_echo_server";
+}
+
+int protected_main(int argc, char **argv)
+{
+    auto cpus = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+    auto max_workers = std::max(cpus, 2);
+    auto connections = 64;
+    auto seconds = 2;
+    std::uint16_t port = 22100;
+    std::string server;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--max-workers="))
+        {
+            max_workers = std::stoi(arg.substr(14));
+        }
+        else if (arg.starts_with("--connections="))
+        {
+            connections = std::stoi(arg.substr(14));
+        }
+        else if (arg.starts_with("--seconds="))
+        {
+            seconds = std::stoi(arg.substr(10));
+        }
+        else if (arg.starts_with("--server="))
+        {
+            server = arg.substr(9);
+        }
+    }
+
+    if (server.empty())
+    {
+        server = default_server();
+    }
+
+    std::cout << cpus << " CPUs, " << connections << " connections, " << request_size << "-byte requests\n\n"
+              << std::setw(8) << "workers" << std::setw(20) << "SO_REUSEPORT req/s" << std::setw(20) << "shared req/s" << '\n';
+
+    for (auto workers = 1; workers <= max_workers; workers *= 2)
+    {
+        std::cout << std::setw(8) << workers;
+        for (auto shared : {false, true})
+        {
+            proc::command cmd{server};
+            cmd.arg("--workers=" + std::to_string(workers)).arg("--port=" + std::to_string(port));
+            cmd.redirect(STDERR_FILENO, "/dev/null", O_WRONLY);
+            if (shared)
+            {
+                cmd.arg("--shared");
+            }
+            else if (workers <= cpus)
+            {
+                cmd.arg("--pin");
+            }
+
+            auto child = proc::spawn(cmd);
+
+            // until the workers listen
+            for (auto attempt = 0; attempt < 100; attempt++)
+            {
+                if (auto fd = connect_to(port); fd != -1)
+                {
+                    close(fd);
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+
+            auto rate = requests_per_second(port, std::min(cpus, connections), connections, seconds);
+            std::cout << std::setw(20) << std::fixed << std::setprecision(0) << rate << std::flush;
+
+            child.kill(SIGTERM);
+            child.wait();
+        }
+        std::cout << '\n';
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,226 @@
+/**
+ * @File    : prefork_echo_server.cpp
+ * @Brief   : echo server on several cores: a master and pre-forked workers (SO_REUSEPORT), crash restart, zero-downtime upgrade
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Usage Command
+ * g++ -std=c++2a -O2 -I../include prefork_echo_server.cpp -lpthread -o prefork_echo_server
+ * ./prefork_echo_server --workers=4 --pin          one SO_REUSEPORT socket per worker, worker i on CPU i
+ * ./prefork_echo_server --workers=4 --shared       one listening socket for every worker (EPOLLEXCLUSIVE)
+ * ./echo_client_tcp
+ *
+ * kill -USR1 <master pid>     counters of every worker (shared memory page)
+ * kill -9 <worker pid>        the master restarts the worker on the same socket
+ * ./prefork_echo_server       while another one runs on the port: takes over its sockets, the old one drains and exits
+ * kill -TERM <master pid>     the workers finish their connections (at most 5 seconds), then everything exits
+ *
+ * prefork_benchmark.cpp measures the requests per second against the number of workers.
+ */
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+#include "prefork.hpp"
+
+// Step 1. one worker: accepts on its listening socket and echoes, until SIGTERM
+class echo_worker
+{
+public:
+    explicit echo_worker(prefork::worker_context &context) : m_context{context}
+    {
+    }
+
+    void run()
+    {
+        // EPOLLEXCLUSIVE: a connection on the shared socket wakes one worker, not all of them
+        m_loop.add(m_context.listen_fd, EPOLLIN | (m_context.shared_socket ? EPOLLEXCLUSIVE : 0u), [this](std::uint32_t)
+                   { accept(); });
+
+        auto drain = [this](const signalfd_siginfo &)
+        {
+            // the master keeps the socket open: the connections that arrive meanwhile wait for the next worker
+            m_loop.remove(m_context.listen_fd);
+            close(m_context.listen_fd);
+            m_draining = true;
+            m_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            if (m_connections.empty())
+            {
+                m_loop.stop();
+            }
+        };
+        m_context.signals.on(SIGTERM, drain);
+        m_context.signals.on(SIGINT, drain);
+        m_loop.add(m_context.signals);
+
+        while (!m_draining || (!m_connections.empty() && std::chrono::steady_clock::now() < m_deadline))
+        {
+            m_loop.run_once(m_draining ? 100 : -1);
+            if (m_draining && m_connections.empty())
+            {
+                break;
+            }
+        }
+
+        for (auto &[fd, pending] : m_connections)
+        {
+            close(fd);
+        }
+    }
+
+private:
+    void accept()
+    {
+        int fd;
+        while ((fd = ::accept4(m_context.listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1)
+        {
+            m_context.stats.connections.fetch_add(1, std::memory_order_relaxed);
+            m_connections[fd];
+            m_loop.add(fd, EPOLLIN, [this, fd](std::uint32_t events)
+                       { serve(fd, events); });
+        }
+    }
+
+    void serve(int fd, std::uint32_t events)
+    {
+        auto &pending = m_connections[fd];
+
+        // the rest of an echo the socket buffer could not take
+        if ((events & EPOLLOUT) != 0)
+        {
+            if (!flush(fd, pending))
+            {
+                return;
+            }
+            m_loop.modify(fd, EPOLLIN);
+        }
+
+        std::array<char, 16384> buf;
+        while (pending.empty())
+        {
+            auto len = ::recv(fd, buf.data(), buf.size(), 0);
+            if (len > 0)
+            {
+                m_context.stats.requests.fetch_add(1, std::memory_order_relaxed);
+                m_context.stats.bytes.fetch_add(static_cast<std::uint64_t>(len), std::memory_order_relaxed);
+                pending.assign(buf.data(), static_cast<std::size_t>(len));
+                if (!flush(fd, pending))
+                {
+                    return;
+                }
+                continue;
+            }
+
+            if (len == -1 && errno == EAGAIN)
+            {
+                return;
+            }
+
+            disconnect(fd);
+            return;
+        }
+    }
+
+    // false when the connection is gone or the rest waits for EPOLLOUT
+    bool flush(int fd, std::string &pending)
+    {
+        while (!pending.empty())
+        {
+            auto sent = ::send(fd, pending.data(), pending.size(), MSG_NOSIGNAL);
+            if (sent == -1)
+            {
+                if (errno == EAGAIN)
+                {
+                    m_loop.modify(fd, EPOLLIN | EPOLLOUT);
+                    return false;
+                }
+                disconnect(fd);
+                return false;
+            }
+            pending.erase(0, static_cast<std::size_t>(sent));
+        }
+
+        return true;
+    }
+
+    void disconnect(int fd)
+    {
+        m_loop.remove(fd);
+        close(fd);
+        m_connections.erase(fd);
+        if (m_draining && m_connections.empty())
+        {
+            m_loop.stop();
+        }
+    }
+
+    prefork::worker_context &m_context;
+    events::loop m_loop;
+    std::unordered_map<int, std::string> m_connections; // descriptor -> bytes still to echo
+    bool m_draining{false};
+    std::chrono::steady_clock::time_point m_deadline;
+};
+
+int protected_main(int argc, char **argv)
+{
+    // Step 2. the options
+    prefork::options opts;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--workers="))
+        {
+            opts.workers = static_cast<unsigned>(std::stoul(arg.substr(10)));
+        }
+        else if (arg.starts_with("--port="))
+        {
+            opts.port = static_cast<std::uint16_t>(std::stoul(arg.substr(7)));
+        }
+        else if (arg == "--pin")
+        {
+            opts.pin = true;
+        }
+        else if (arg == "--shared")
+        {
+            opts.reuseport = false;
+        }
+    }
+
+    // Step 3. the master: sockets, workers, restarts, handover
+    prefork::master master{opts, [](prefork::worker_context &context)
+                           {
+                               echo_worker worker{context};
+                               worker.run();
+                           }};
+    master.run();
+    master.print(std::cerr);
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
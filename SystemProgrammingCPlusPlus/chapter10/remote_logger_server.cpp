@@ -6,12 +6,19 @@
 */
 
 /** Usage
- * g++ -std=c++2a remote_logger_server.cpp -o remote_logger_server
+ * g++ -std=c++2a -I../include remote_logger_server.cpp -lpthread -o remote_logger_server
  * g++ -std=c++2a remote_logger_client.cpp -o remote_logger_client
  * 
  * ./remote_logger_server
  * ./remote_logger_client
- * 
+ *
+ * kill -TERM <pid>   graceful drain: no new clients, the connected ones are read until they are done
+ *                    (DRAIN_SECONDS at most, then they are dropped), the log is flushed
+ * kill -HUP <pid>    log reopen: the log continues in a new segment file
+ * kill -USR1 <pid>   statistics on stderr
+ *
+ * The signals are read from a signalfd in the same epoll loop as the sockets (include/event_loop.hpp):
+ * no handler interrupts a write to the log, no recv() fails with EINTR.
  */
 
 #include <array>
@@ -21,15 +28,27 @@
 #include <stdexcept>
 #include <unistd.h>
 #include <string.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
 #include <netinet/in.h>
 
+#include "event_loop.hpp"
+#include "log_sink.hpp"
+
 // TCP connecting for port application and buffer maximum size
 #define PORT 22000
 #define MAX_SIZE 0x1000
 
-// define the log file
-std::fstream g_log{"server_log.txt", std::ios::out | std::ios::app};
+// a client that keeps its connection open does not hold up the shutdown longer than this
+#define DRAIN_SECONDS 10
+
+// blocked before g_log starts its background threads: they inherit the mask, only the signalfd sees the signals
+events::signals g_signals{SIGINT, SIGTERM, SIGHUP, SIGUSR1};
+
+// define the log file, written in large blocks by a background thread
+// and rotated into server_log.txt.000000, server_log.txt.000001, ... (include/log_sink.hpp)
+log_sink::rotating_file g_log{log_sink::options{.path = "server_log.txt", .max_age = std::chrono::hours(24)}};
 
 // using RAII design pattern for server
 class remote_logger_server
@@ -57,51 +76,142 @@ public:
         return ::bind(m_fd, reinterpret_cast<struct sockaddr *>(&m_addr), sizeof(m_addr));
     }
 
-    ssize_t recv(std::array<char, MAX_SIZE> &buf)
-    {
-        return ::recv(m_client, buf.data(), buf.size(), 0);
-    }
-
     void log()
     {
-        if (::listen(m_fd, 0) == -1)
+        if (::listen(m_fd, SOMAXCONN) == -1)
         {
             throw std::runtime_error(strerror(errno));
         }
+        fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+
+        m_loop.add(m_fd, EPOLLIN, [this](std::uint32_t)
+                   { accept(); });
 
-        if (m_client = ::accept(m_fd, nullptr, nullptr); m_client == -1)
+        // SIGINT / SIGTERM: graceful drain
+        auto drain = [this](const signalfd_siginfo &)
         {
-            throw std::runtime_error(strerror(errno));
+            if (m_draining)
+            {
+                return;
+            }
+            std::cerr << "draining " << m_clients << " client(s)" << std::endl;
+            m_draining = true;
+
+            // closed, not only removed from the loop: the kernel would go on completing connections into the backlog
+            m_loop.remove(m_fd);
+            close(m_fd);
+            m_fd = -1;
+
+            // the deadline of the drain, in the same loop
+            m_deadline = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (m_deadline == -1)
+            {
+                throw std::runtime_error(strerror(errno));
+            }
+            itimerspec due{};
+            due.it_value.tv_sec = DRAIN_SECONDS;
+            timerfd_settime(m_deadline, 0, &due, nullptr);
+            m_loop.add(m_deadline, EPOLLIN, [this](std::uint32_t)
+                       {
+                           std::cerr << "drain timed out, dropping " << m_clients << " client(s)" << std::endl;
+                           m_loop.stop();
+                       });
+
+            stop_when_drained();
+        };
+        g_signals.on(SIGINT, drain);
+        g_signals.on(SIGTERM, drain);
+
+        // SIGHUP: the log continues in a new file (log rotation)
+        g_signals.on(SIGHUP, [](const signalfd_siginfo &)
+                     { g_log.rotate(); });
+
+        // SIGUSR1: statistics
+        g_signals.on(SIGUSR1, [this](const signalfd_siginfo &)
+                     { std::cerr << "clients: " << m_clients << " connected, " << m_accepted << " accepted, "
+                                 << m_messages << " reads, " << m_bytes << " bytes" << std::endl; });
+
+        m_loop.add(g_signals);
+        m_loop.run();
+
+        // the rest of the log reaches the disk before the program exits
+        g_log.flush();
+    }
+    ~remote_logger_server()
+    {
+        if (m_fd != -1)
+        {
+            close(m_fd);
         }
+        if (m_deadline != -1)
+        {
+            close(m_deadline);
+        }
+    }
+
+private:
+    void accept()
+    {
+        int client;
+        while ((client = ::accept4(m_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1)
+        {
+            m_clients++;
+            m_accepted++;
+            m_loop.add(client, EPOLLIN, [this, client](std::uint32_t)
+                       { receive(client); });
+        }
+    }
 
+    // everything the client sent so far; the connection ends when the client closes it
+    void receive(int client)
+    {
+        std::array<char, MAX_SIZE> buf;
         while (true)
         {
-            std::array<char, MAX_SIZE> buf{};
-            if (auto len = recv(buf); len != 0)
+            auto len = ::recv(client, buf.data(), buf.size(), 0);
+            if (len > 0)
             {
-                g_log.write(buf.data(), len);
+                m_messages++;
+                m_bytes += static_cast<std::size_t>(len);
+                g_log.write(buf.data(), static_cast<std::size_t>(len));
                 std::clog.write(buf.data(), len);
+                continue;
             }
-            else
+
+            if (len == -1 && errno == EAGAIN)
             {
-                break;
+                return;
             }
-        }
 
-        close(m_client);
+            // closed by the client, or an error
+            m_loop.remove(client);
+            close(client);
+            m_clients--;
+            stop_when_drained();
+            return;
+        }
     }
 
-    ~remote_logger_server()
+    void stop_when_drained()
     {
-        close(m_fd);
+        if (m_draining && m_clients == 0)
+        {
+            m_loop.stop();
+        }
     }
 
-private:
     int m_fd{};
-    int m_client{};
     struct sockaddr_in m_addr
     {
     };
+
+    events::loop m_loop;
+    bool m_draining{false};
+    int m_deadline{-1};
+    std::size_t m_clients{};
+    std::size_t m_accepted{};
+    std::size_t m_messages{};
+    std::size_t m_bytes{};
 };
 
 int protected_main(int argc, char **argv)
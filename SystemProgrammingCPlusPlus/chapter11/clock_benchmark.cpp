@@ -0,0 +1,118 @@
+/**
+ * @File    : clock_benchmark.cpp
+ * @Brief   : Nanoseconds per timestamp and per formatted log prefix, for every clock source of include/fast_clock.hpp
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include clock_benchmark.cpp -lpthread -o clock_benchmark
+ * @Command : ./clock_benchmark
+ * @Command : ./clock_benchmark --format=json
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** A timestamp per log line
+ * read_system_clock.cpp, chrono_API.cpp and time_interfaces.cpp read the time with
+ * std::chrono::system_clock::now() or time() and print it with ctime(), localtime() and strftime().
+ * Once per program that is nothing, once per log line it is most of the cost of the line.
+ *
+ * Part 1 reads the time: the C and C++ interfaces, then every clk::source.
+ * Part 2 formats "YYYY-MM-DD HH:MM:SS.uuuuuu": localtime_r() and strftime() on every call, as the
+ * examples of this chapter do, against clk::prefix_formatter which only redoes the microseconds
+ * within a second, fed by the vDSO clock and by the cached clock.
+ */
+
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+
+#include "benchmark.hpp"
+#include "fast_clock.hpp"
+
+int protected_main(int argc, char **argv)
+{
+    bench::reporter reporter{bench::parse_args(argc, argv)};
+
+    // Step 1. where the clocks come from
+    auto env = clk::environment();
+    std::cout << "vDSO " << (env.vdso ? "mapped" : "missing") << ", clocksource " << env.clocksource
+              << ", invariant TSC " << (env.invariant_tsc ? "yes" : "no")
+              << ", coarse resolution " << env.coarse_resolution_ns << "ns\n";
+    if (env.clocksource != "tsc" && env.clocksource != "kvm-clock" && env.clocksource != "arch_sys_counter")
+    {
+        std::cout << "(the vDSO cannot read this clocksource, clock_gettime() falls back to a system call)\n";
+    }
+
+    clk::cached_clock cache;
+    clk::clock clocks[] = {clk::clock{clk::source::syscall}, clk::clock{clk::source::vdso},
+                           clk::clock{clk::source::realtime_coarse}, clk::clock{clk::source::monotonic_coarse},
+                           clk::clock{clk::source::tsc}, clk::clock{clk::source::cached, &cache}};
+
+    for (auto &c : clocks)
+    {
+        std::cout << "  " << clk::name(c.from()) << ": " << clk::prefix_formatter{}.format(c.now()) << '\n';
+    }
+
+    // Step 2. one timestamp
+    reporter.run("time()", []
+                 { bench::do_not_optimize(time(nullptr)); });
+
+    reporter.run("system_clock::now()", []
+                 { bench::do_not_optimize(std::chrono::system_clock::now()); });
+
+    for (auto &c : clocks)
+    {
+        reporter.run(std::string{"clk "} + clk::name(c.from()), [&c]
+                     { bench::do_not_optimize(c.now()); });
+    }
+
+    // Step 3. one log prefix
+    reporter.run("localtime_r + strftime", []
+                 {
+                     char buf[64];
+                     timespec ts;
+                     clock_gettime(CLOCK_REALTIME, &ts);
+                     tm local;
+                     localtime_r(&ts.tv_sec, &local);
+                     auto len = std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &local);
+                     std::snprintf(buf + len, sizeof(buf) - len, ".%06ld", ts.tv_nsec / 1000);
+                     bench::do_not_optimize(buf);
+                 });
+
+    clk::prefix_formatter formatter;
+    reporter.run("prefix_formatter vdso", [&]
+                 {
+                     char buf[clk::prefix_formatter::size];
+                     formatter.format(clocks[1].now(), buf);
+                     bench::do_not_optimize(buf);
+                 });
+
+    reporter.run("prefix_formatter cached", [&]
+                 {
+                     char buf[clk::prefix_formatter::size];
+                     formatter.format(cache.now(), buf);
+                     bench::do_not_optimize(buf);
+                 });
+
+    reporter.print();
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
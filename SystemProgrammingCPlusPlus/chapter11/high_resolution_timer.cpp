@@ -2,54 +2,51 @@
  * @File    : high_resolution_timer.cpp
  * @Brief   : Studying an example on high-resolution timer
  * ---------------------------------
- * @Command : g++ high_resolution_timer.cpp -o high_resolution_time
+ * @Command : g++ -std=c++2a -O2 -I../include high_resolution_timer.cpp -o high_resolution_time
  * @Command : ./high_resolution_time 10000000
+ * @Command : ./high_resolution_time 10000000 --format=json
  * ---------------------------------
  * @Author  : Wei Li
  * @Date    : 2021-11-09
 */
 
-#include <chrono>
+#include <cstdint>
 #include <iostream>
 
 #include <gsl/gsl>
 
-/** A simple benchmark using hig_resolution_clock{}
- * 
- * functional programming to wrap a function call
- * (likely a lambda) between two calls to the high-resolution  clock. 
- * define a 'benchmark' function as following:
- */
-template <typename FUNC>
-auto benchmark(FUNC func)
-{
-    auto start_time = std::chrono::high_resolution_clock::now();
-    func();
-    auto end_time = std::chrono::high_resolution_clock::now();
+#include "benchmark.hpp"
 
-    return end_time - start_time;
-}
+/** A benchmark using the high-resolution clock
+ * Wrapping one call between two calls to std::chrono::high_resolution_clock::now() times exactly
+ * one call, so the result includes the cold caches of the first call and whatever else the scheduler
+ * did at that moment: a single measurement is not a benchmark.
+ * bench::reporter from include/benchmark.hpp warms up, calibrates the number of iterations,
+ * takes repeated samples and reports the median together with its spread.
+ */
 
 int protected_main(int argc, char **argv)
 {
     auto args = gsl::make_span(argv, argc);
-    if (args.size() != 2)
+    if (args.size() < 2)
     {
         std::cerr << "wrong number of arguments\n";
         ::exit(1);
     }
 
     gsl::cstring_span<> arg = gsl::ensure_z(args.at(1));
+    auto num = std::stoull(arg.data());
 
     // functional programming and lambda expression
-    auto d = benchmark([&arg]
-                       {
-                           for (uint64_t i = 0; i < std::stoi(arg.data()); i++);
-                       });
-
-    std::cout << "time: " << std::chrono::duration_cast<std::chrono::seconds>(d).count() << '\n';
-    std::cout << "time: " << std::chrono::duration_cast<std::chrono::milliseconds>(d).count() << '\n';
-    std::cout << "time: " << std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() << '\n';
+    bench::reporter reporter{bench::parse_args(argc, argv)};
+    reporter.run("empty loop", [num]
+                 {
+                     for (uint64_t i = 0; i < num; i++)
+                     {
+                         bench::do_not_optimize(i);
+                     }
+                 });
+    reporter.print();
 
     return EXIT_SUCCESS;
 }
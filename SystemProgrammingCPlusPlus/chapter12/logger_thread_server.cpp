@@ -15,14 +15,24 @@
  * In this example, we will fix that issue.
  * 
  * ----Usage:
- * g++ -std=c++2a logger_thread_server.cpp -lpthread -o logger_thread_server
+ * g++ -std=c++2a -I../include logger_thread_server.cpp -lpthread -o logger_thread_server
  * g++ -std=c++2a logger_thread_client.cpp -lpthread -o logger_thread_client
  * ./logger_thread_server
  * ./logger_thread_client
  * ./logger_thread_client
  * 
  * cat client_log.txt
- * cat server_log.txt
+ * cat server_log.txt.*
+ *
+ * The receive path is instrumented with trace points (include/trace.hpp),
+ * the events are written to server_trace.bin and decoded with tools/trace_decode.cpp.
+ * Compile with -DTRACE_DISABLED to remove them.
+ *
+ * kill -TERM <pid>   graceful drain: no new clients, 5 seconds for the connected ones to finish, the log is flushed
+ * kill -HUP <pid>    log reopen: the log continues in a new segment file
+ * kill -USR1 <pid>   statistics on stderr
+ * The main thread reads the signals from a signalfd, in an epoll loop with the listening socket
+ * (include/event_loop.hpp); the client threads never see a signal and their recv() never fails with EINTR.
  * 
  */
 
@@ -31,6 +41,10 @@
 #define MAX_SIZE 0X1000
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <unordered_set>
 #include <unordered_map>
 #include <sstream>
 #include <fstream>
@@ -42,11 +56,30 @@
 #include <netinet/in.h>
 #include <iostream>
 
+#include "event_loop.hpp"
+#include "log_sink.hpp"
+#include "trace.hpp"
+
 // ----Step 2.
+// The signals are blocked before any thread exists (g_log starts its threads in its constructor),
+// every thread inherits the mask and only the signalfd of the main thread receives them.
+events::signals g_signals{SIGINT, SIGTERM, SIGHUP, SIGUSR1};
+
 // the log file will be defined as global,
-// and a mutex will be added to synchronize access to the log:
+// and a mutex will be added to synchronize access to the console.
+// The log file (include/log_sink.hpp) is thread-safe on its own, it is written in large blocks
+// by a background thread instead of being flushed after every message.
 std::mutex log_mutex;
-std::fstream g_log{"server_log.txt", std::ios::out | std::ios::app};
+log_sink::rotating_file g_log{log_sink::options{.path = "server_log.txt", .max_age = std::chrono::hours(24), .compress = true}};
+
+// ----Step 3.
+// the connected clients, for the drain on SIGTERM, and the statistics for SIGUSR1
+std::mutex clients_mutex;
+std::condition_variable clients_done;
+std::unordered_set<int> clients;
+std::atomic<std::size_t> total_clients{0};
+std::atomic<std::size_t> total_reads{0};
+std::atomic<std::size_t> total_bytes{0};
 
 // -----Step 4.
 // Instead of the recv() function being defined in the server,
@@ -61,18 +94,21 @@ ssize_t recv(int handle, std::array<char, MAX_SIZE> &buf)
 // spawn a new thread (the log() function), which is implemented as follows:
 void log(int handle)
 {
+    TRACE_SCOPE("server", "client");
+
     while (true)
     {
         std::array<char, MAX_SIZE> buf{};
 
-        if (auto len = recv(handle, buf); len != 0)
+        if (auto len = recv(handle, buf); len > 0)
         {
-            std::unique_lock lock(log_mutex);
-
+            TRACE_INSTANT("server", "recv", handle, len);
+            total_reads.fetch_add(1, std::memory_order_relaxed);
+            total_bytes.fetch_add(static_cast<std::size_t>(len), std::memory_order_relaxed);
             g_log.write(buf.data(), len);
-            std::clog.write(buf.data(), len);
 
-            g_log.flush();
+            std::unique_lock lock(log_mutex);
+            std::clog.write(buf.data(), len);
         }
         else
         {
@@ -80,7 +116,11 @@ void log(int handle)
         }
     }
 
+    // closed under the lock: the drain never shuts down a descriptor number that was reused meanwhile
+    std::unique_lock lock(clients_mutex);
+    clients.erase(handle);
     close(handle);
+    clients_done.notify_all();
 }
 
 // ----Step 6.
@@ -115,28 +155,72 @@ public:
 
     void listen()
     {
-        if (::listen(m_fd, 0) == -1)
+        if (::listen(m_fd, SOMAXCONN) == -1)
         {
             throw std::runtime_error(strerror(errno));
         }
 
-        while (true)
+        // accepting and the signals are events of the same loop
+        events::loop loop;
+        loop.add(m_fd, EPOLLIN, [this](std::uint32_t)
+                 {
+                     if (int c = ::accept4(m_fd, nullptr, nullptr, SOCK_CLOEXEC); c != -1)
+                     {
+                         {
+                             std::unique_lock lock(clients_mutex);
+                             clients.insert(c);
+                         }
+                         total_clients.fetch_add(1, std::memory_order_relaxed);
+
+                         std::thread t{log, c};
+                         t.detach();
+                     }
+                 });
+
+        auto drain = [&loop](const signalfd_siginfo &)
+        { loop.stop(); };
+        g_signals.on(SIGINT, drain);
+        g_signals.on(SIGTERM, drain);
+        g_signals.on(SIGHUP, [](const signalfd_siginfo &)
+                     { g_log.rotate(); });
+        g_signals.on(SIGUSR1, [](const signalfd_siginfo &)
+                     {
+                         std::unique_lock lock(clients_mutex);
+                         std::cerr << "clients: " << clients.size() << " connected, " << total_clients << " accepted, "
+                                   << total_reads << " reads, " << total_bytes << " bytes" << std::endl;
+                     });
+
+        loop.add(g_signals);
+        loop.run();
+
+        // ----Step 7.
+        // graceful drain: no new connections, the clients get some time to finish, then their sockets
+        // are shut down (recv() returns 0 in their threads), and the log is flushed
+        close(m_fd);
+        m_fd = -1;
+
+        std::unique_lock lock(clients_mutex);
+        std::cerr << "draining " << clients.size() << " client(s)" << std::endl;
+        if (!clients_done.wait_for(lock, std::chrono::seconds(5), []
+                                   { return clients.empty(); }))
         {
-            if (int c = ::accept(m_fd, nullptr, nullptr); c != -1)
+            for (auto c : clients)
             {
-                std::thread t{log, c};
-                t.detach();
-
-                continue;
+                shutdown(c, SHUT_RDWR);
             }
-
-            throw std::runtime_error(strerror(errno));
+            clients_done.wait(lock, []
+                              { return clients.empty(); });
         }
+
+        g_log.flush();
     }
 
     ~myserver()
     {
-        close(m_fd);
+        if (m_fd != -1)
+        {
+            close(m_fd);
+        }
     }
 
 private:
@@ -149,6 +233,9 @@ int protected_main(int argc, char **argv)
     (void)argc;
     (void)argv;
 
+    trace::session session{"server_trace.bin"};
+    session.start();
+
     myserver server{PORT};
     server.listen();
 
@@ -61,6 +61,8 @@
 #include <iostream>
 #include <stdexcept>
 
+#include "error.hpp"
+
 // ----- Step 1. -----
 void myfunc(int val)
 {
@@ -86,12 +88,16 @@ int nested1(int val)
 {
     myfunc(val);
     std::cout << "nested1 success\n";
+
+    return 0;
 }
 
 int nested2(int val)
 {
     nested1(val);
     std::cout << "nested2 success\n";
+
+    return 0;
 }
 
 // ----- Step 4. -----
@@ -222,6 +228,30 @@ void myfunc10(int val)
     }
 }
 
+// ----- Step 11. -----
+// the context of myexception2 without building a string: err::error (include/error.hpp) records the
+// code, where it was created and where it passed, the text is only formatted if somebody prints it
+void myfunc111(int val)
+{
+    if (val == 42)
+    {
+        err::raise(err::error{err::posix_category, EINVAL});
+    }
+}
+
+void myfunc112(int val)
+{
+    try
+    {
+        myfunc111(val);
+    }
+    catch (err::exception &e)
+    {
+        e.error().context("checking the value", val);
+        throw;
+    }
+}
+
 int main(int argc, char **argv)
 {
     //  ------------------------- Step 1. -------------------------
@@ -360,5 +390,20 @@ int main(int argc, char **argv)
         std::cout << "failure: " << strerror(ret) << '\n';
     }
 
+    //  ------------------------- Step 11. -------------------------
+    try
+    {
+        myfunc112(1);
+        std::cout << "success\n";
+
+        myfunc112(42);
+        std::cout << "success\n";
+    }
+    catch (const err::exception &e)
+    {
+        std::cout << "failure: " << e.what() << '\n'
+                  << e.error() << '\n';
+    }
+
     return 0;
 }
@@ -21,8 +21,27 @@
  *  to the extreme that most of these issues are washed out in the noise, and any performance-related issues 
  *  with any approach are easily identifiable.
  * 
+ * A fourth contender is err::result<T, E> of include/result.hpp, an error value returned in registers
+ * and propagated with RESULT_TRY: the check of POSIX return codes without writing it by hand.
+ *
+ * The recursion above never fails. The second part makes a call fail at the bottom of '--depth' frames
+ * (64 by default) for 0%, 1%, 10% and 50% of the calls, in a fixed pseudo-random pattern:
+ * exceptions are free while nothing is thrown and cost about a microsecond per throw, the error values
+ * cost a check per frame whatever the error rate. RESULT_TRY takes the value unchecked once it tested
+ * the flag, there is no second test and no call of the cold throw path left in the frame. What remains is
+ * the packing: result<int> returns the value and the flag together in rax, every frame shifts the flag
+ * out to test it and shifts it back in to return, where a bare int is compared with -1. On the recursion
+ * above that measures about 1.5 times the POSIX codes (30us against 20us), still far from a throw.
+ *
+ * The third part compares the error objects themselves: myexception and myexception2 of
+ * cpp_style_error.cpp (the latter formats a std::string on every throw) against err::error of
+ * include/error.hpp (code, source location and context, formatted only when printed), created,
+ * thrown through '--depth' frames, or returned through them with a context entry per frame.
+ *
  * ----Usage:
- * g++ -std=c++2a exception_benchmark.cpp
+ * g++ -std=c++2a -O2 -I../include exception_benchmark.cpp
+ * ./a.out --format=json
+ * ./a.out --depth=1024
  * 
  * ----Summary
  * Learned three different methods for performing error handling when system programming. 
@@ -38,23 +57,18 @@
  */
 
 #include <csetjmp>
-#include <chrono>
 #include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "error.hpp"
+#include "result.hpp"
 
 jmp_buf jb;
 
 constexpr const auto bad = 0x10000000;
-constexpr const auto num_iterations = 100000;
-
-template <typename FUNC>
-auto benchmark(FUNC func)
-{
-    auto stime = std::chrono::high_resolution_clock::now();
-    func();
-    auto etime = std::chrono::high_resolution_clock::now();
-
-    return (etime - stime).count();
-}
 
 int myfunc1(int val)
 {
@@ -69,6 +83,8 @@ int myfunc1(int val)
         {
             return ret;
         }
+        // a side effect after the call: the recursion cannot be folded away
+        bench::clobber_memory();
     }
 
     return 0;
@@ -84,6 +100,7 @@ void myfunc2(int val)
     if (val < 0x1000)
     {
         myfunc2(val + 1);
+        bench::clobber_memory();
     }
 }
 
@@ -97,10 +114,142 @@ void myfunc3(int val)
     if (val < 0x1000)
     {
         myfunc3(val + 1);
+        bench::clobber_memory();
+    }
+}
+
+err::result<int> myfunc4(int val)
+{
+    if (val >= bad)
+    {
+        return err::failure{std::errc::result_out_of_range};
+    }
+
+    if (val < 0x1000)
+    {
+        RESULT_TRY(myfunc4(val + 1));
+        bench::clobber_memory();
+    }
+
+    return 0;
+}
+
+// the same four, failing at the bottom of 'depth' frames when 'fail' is set
+int posix_path(int val, int depth, bool fail)
+{
+    if (val == depth)
+    {
+        return fail ? -1 : 0;
+    }
+
+    if (auto ret = posix_path(val + 1, depth, fail); ret == -1)
+    {
+        return ret;
+    }
+
+    return 0;
+}
+
+void longjmp_path(int val, int depth, bool fail)
+{
+    if (val == depth)
+    {
+        if (fail)
+        {
+            std::longjmp(jb, -1);
+        }
+        return;
+    }
+
+    longjmp_path(val + 1, depth, fail);
+}
+
+void exception_path(int val, int depth, bool fail)
+{
+    if (val == depth)
+    {
+        if (fail)
+        {
+            throw -1;
+        }
+        return;
+    }
+
+    exception_path(val + 1, depth, fail);
+}
+
+err::result<int> result_path(int val, int depth, bool fail)
+{
+    if (val == depth)
+    {
+        if (fail)
+        {
+            return err::failure{std::errc::resource_unavailable_try_again};
+        }
+        return 0;
+    }
+
+    RESULT_TRY(result_path(val + 1, depth, fail));
+
+    return 0;
+}
+
+// the exception classes of cpp_style_error.cpp
+class myexception : public std::exception
+{
+private:
+    int m_error{0};
+
+public:
+    myexception(int error) noexcept : m_error{error}
+    {
+    }
+
+    const char *what() const noexcept
+    {
+        return "error";
+    }
+
+    int error() const noexcept
+    {
+        return m_error;
+    }
+};
+
+class myexception2 : public std::runtime_error
+{
+public:
+    myexception2(int error) : std::runtime_error("error: " + std::to_string(error))
+    {
+    }
+};
+
+// throws 'make()' at the bottom of 'depth' frames
+template <typename MAKE>
+void throw_path(int val, int depth, MAKE make)
+{
+    if (val == depth)
+    {
+        throw make();
     }
+
+    throw_path(val + 1, depth, make);
+    bench::clobber_memory();
+}
+
+// returns an err::error from the bottom of 'depth' frames, each frame adds its context
+err::result<int, err::error> context_path(int val, int depth)
+{
+    if (val == depth)
+    {
+        return err::failure{err::error{err::posix_category, EAGAIN}};
+    }
+
+    auto ret = ERROR_TRY(context_path(val + 1, depth), "reading level", val);
+    return ret;
 }
 
-void test_func1()
+void test_func1(bench::reporter &reporter)
 {
     if (auto ret = myfunc1(0); ret == 0)
     {
@@ -120,30 +269,26 @@ void test_func1()
         std::cout << "myfunc1: failure\n";
     }
 
-    uint64_t total = 0;
-    for (auto i = 0; i < num_iterations; i++)
-    {
-        total += benchmark([&]
-                           { myfunc1(0); });
-    }
-
-    std::cout << "time1: " << total << '\n';
+    reporter.run("posix return codes", []
+                 {
+                     auto val = 0;
+                     bench::do_not_optimize(val);
+                     bench::do_not_optimize(myfunc1(val));
+                 });
 }
 
-void test_func2()
+void test_func2(bench::reporter &reporter)
 {
     if (setjmp(jb) == -1)
     {
         std::cout << "myfunc2: failure\n";
 
-        uint64_t total = 0;
-        for (auto i = 0; i < num_iterations; i++)
-        {
-            total += benchmark([&]
-                               { myfunc2(0); });
-        }
-
-        std::cout << "time2: " << total << '\n';
+        reporter.run("setjmp/longjmp", []
+                     {
+                         auto val = 0;
+                         bench::do_not_optimize(val);
+                         myfunc2(val);
+                     });
         return;
     }
 
@@ -154,7 +299,7 @@ void test_func2()
     std::cout << "myfunc2: success\n";
 }
 
-void test_func3()
+void test_func3(bench::reporter &reporter)
 {
     try
     {
@@ -169,24 +314,185 @@ void test_func3()
         std::cout << "myfunc3: failure\n";
     }
 
-    uint64_t total = 0;
-    for (auto i = 0; i < num_iterations; i++)
+    reporter.run("c++ exceptions", []
+                 {
+                     auto val = 0;
+                     bench::do_not_optimize(val);
+                     myfunc3(val);
+                 });
+}
+
+void test_func4(bench::reporter &reporter)
+{
+    if (auto ret = myfunc4(0); ret)
+    {
+        std::cout << "myfunc4: success\n";
+    }
+    else
+    {
+        std::cout << "myfunc4: failure\n";
+    }
+
+    if (auto ret = myfunc4(bad); ret)
+    {
+        std::cout << "myfunc4: success\n";
+    }
+    else
+    {
+        std::cout << "myfunc4: failure (" << std::make_error_code(ret.error()).message() << ")\n";
+    }
+
+    reporter.run("result + RESULT_TRY", []
+                 {
+                     auto val = 0;
+                     bench::do_not_optimize(val);
+                     bench::do_not_optimize(myfunc4(val));
+                 });
+}
+
+void test_error_rates(bench::reporter &reporter, int depth)
+{
+    for (auto percent : {0, 1, 10, 50})
     {
-        total += benchmark([&]
-                           { myfunc3(0); });
+        // which calls fail: random, so that the branch predictor cannot learn the pattern
+        std::vector<char> pattern(1024);
+        std::mt19937 gen{42};
+        std::bernoulli_distribution fails{percent / 100.0};
+        for (auto &p : pattern)
+        {
+            p = fails(gen);
+        }
+
+        auto suffix = " " + std::to_string(percent) + "% errors";
+        std::size_t next = 0;
+        auto fail = [&]
+        {
+            bool f = pattern[next++ % pattern.size()];
+            bench::do_not_optimize(f);
+            return f;
+        };
+
+        reporter.run("posix return codes" + suffix, [&]
+                     { bench::do_not_optimize(posix_path(0, depth, fail())); });
+
+        reporter.run("setjmp/longjmp" + suffix, [&]
+                     {
+                         auto f = fail();
+                         if (setjmp(jb) == 0)
+                         {
+                             longjmp_path(0, depth, f);
+                         }
+                     });
+
+        reporter.run("c++ exceptions" + suffix, [&]
+                     {
+                         try
+                         {
+                             exception_path(0, depth, fail());
+                         }
+                         catch (int)
+                         {
+                             bench::clobber_memory();
+                         }
+                     });
+
+        reporter.run("result + RESULT_TRY" + suffix, [&]
+                     { bench::do_not_optimize(result_path(0, depth, fail())); });
     }
+}
 
-    std::cout << "time3: " << total << '\n';
+void test_error_objects(bench::reporter &reporter, int depth)
+{
+    if (auto ret = context_path(0, 3); !ret)
+    {
+        std::cout << ret.error() << '\n';
+    }
+
+    // creating
+    reporter.run("create myexception", []
+                 { bench::do_not_optimize(myexception(EAGAIN)); });
+
+    reporter.run("create myexception2", []
+                 { bench::do_not_optimize(myexception2(EAGAIN)); });
+
+    reporter.run("create err::error", []
+                 { bench::do_not_optimize(err::error{err::posix_category, EAGAIN}); });
+
+    // what err::error defers to the moment it is printed
+    auto printed = context_path(0, depth).error();
+    reporter.run("format err::error", [&]
+                 {
+                     char buf[1024];
+                     bench::do_not_optimize(printed.format(buf, sizeof(buf)));
+                     bench::clobber_memory();
+                 });
+
+    // propagating through 'depth' frames
+    reporter.run("throw myexception", [depth]
+                 {
+                     try
+                     {
+                         throw_path(0, depth, []
+                                    { return myexception(EAGAIN); });
+                     }
+                     catch (const myexception &e)
+                     {
+                         bench::do_not_optimize(e.error());
+                     }
+                 });
+
+    reporter.run("throw myexception2", [depth]
+                 {
+                     try
+                     {
+                         throw_path(0, depth, []
+                                    { return myexception2(EAGAIN); });
+                     }
+                     catch (const std::exception &e)
+                     {
+                         bench::do_not_optimize(e.what());
+                     }
+                 });
+
+    reporter.run("throw err::exception", [depth]
+                 {
+                     try
+                     {
+                         throw_path(0, depth, []
+                                    { return err::exception{err::error{err::posix_category, EAGAIN}}; });
+                     }
+                     catch (const err::exception &e)
+                     {
+                         bench::do_not_optimize(e.error().code());
+                     }
+                 });
+
+    reporter.run("return result<int, err::error>", [depth]
+                 { bench::do_not_optimize(context_path(0, depth)); });
 }
 
 int protected_main(int argc, char **argv)
 {
-    (void)argc;
-    (void)argv;
+    bench::reporter reporter{bench::parse_args(argc, argv)};
+
+    auto depth = 64;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--depth="))
+        {
+            depth = std::stoi(arg.substr(8));
+        }
+    }
+
+    test_func1(reporter);
+    test_func2(reporter);
+    test_func3(reporter);
+    test_func4(reporter);
+    test_error_rates(reporter, depth);
+    test_error_objects(reporter, depth);
 
-    test_func1();
-    test_func2();
-    test_func3();
+    reporter.print();
 
     return EXIT_SUCCESS;
 }
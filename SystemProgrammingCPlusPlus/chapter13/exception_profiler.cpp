@@ -0,0 +1,478 @@
+/**
+ * @File    : exception_profiler.cpp
+ * @Brief   : Cost of a C++ throw under concurrency: throws per second, latency percentiles, unwind table sizes
+ * ----------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include exception_profiler.cpp -lpthread -o exception_profiler
+ * @Command : ./exception_profiler
+ * @Command : ./exception_profiler --max-threads=64 --ms=500
+ * @Command : ./exception_profiler --binary=with_exceptions --binary=without_exceptions
+ * ----------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** What a throw costs in a real program
+ * exception_benchmark.cpp throws from one thread. A throw is:
+ *
+ * 1. __cxa_allocate_exception(): malloc() of the exception object,
+ * 2. phase 1, search: for every frame from the throw upwards, find the FDE (frame description entry)
+ *    of the return address in .eh_frame, run its CFI program to compute the caller's registers,
+ *    and call the personality routine, which reads .gcc_except_table to see whether the frame catches,
+ * 3. phase 2, cleanup: the same walk again up to the handler, this time running the destructors.
+ *
+ * Finding the FDE means finding the loaded object that contains the address. Before glibc 2.35 and
+ * GCC 12, libgcc did it with dl_iterate_phdr(), which holds the loader lock for the duration of the walk,
+ * so every frame of every throw of every thread serialized on one lock. glibc 2.35 added _dl_find_object(),
+ * a lock-free lookup in a table the loader keeps up to date, which libgcc 12 uses when it exists.
+ *
+ * Part 1: 1, 2, 4, ... '--max-threads' (64) threads throw for '--ms' (200) milliseconds each, starting
+ * 0 or 256 frames deep ('stack'), the catch 1, 16 or 128 frames above the throw ('distance'), every frame
+ * with a destructor to run. Throws per second for all threads together, latency percentiles of one throw.
+ *
+ * Part 2: the frame lookup alone, one per frame of a throw, from the same numbers of threads:
+ * dl_iterate_phdr() (the loader lock, no cache) against _dl_find_object() (lock-free, cached).
+ *
+ * Part 3: the size of the unwind tables in this executable, or in the '--binary' files: compile a program
+ * with and without -fno-exceptions -fno-asynchronous-unwind-tables to see what they cost on disk.
+ */
+
+#include <dlfcn.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unwind.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <latch>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+// the exception thrown: no message, so the only allocation is the exception object itself
+struct io_error : std::exception
+{
+    explicit io_error(int c) : code{c}
+    {
+    }
+
+    const char *what() const noexcept override
+    {
+        return "io_error";
+    }
+
+    int code;
+};
+
+// a frame with something to clean up, like most frames of a real program
+struct guard
+{
+    ~guard()
+    {
+        bench::clobber_memory();
+    }
+};
+
+[[gnu::noinline]] void throw_at(int distance)
+{
+    guard g;
+    if (distance <= 1)
+    {
+        throw io_error{EAGAIN};
+    }
+
+    throw_at(distance - 1);
+    bench::clobber_memory();
+}
+
+struct sample
+{
+    std::uint64_t count{0};
+    std::vector<double> latency_ns;
+};
+
+// 'stack' frames deeper, then the loop: one try, 'distance' frames up to the throw
+[[gnu::noinline]] void thrower(int stack, int distance, const std::atomic<bool> &stop, sample &out)
+{
+    if (stack > 0)
+    {
+        guard g;
+        thrower(stack - 1, distance, stop, out);
+        bench::clobber_memory();
+        return;
+    }
+
+    // keep the first samples only, the counter covers the whole run
+    constexpr std::size_t max_samples = 20000;
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            throw_at(distance);
+        }
+        catch (const io_error &e)
+        {
+            bench::do_not_optimize(e.code);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        out.count++;
+        if (out.latency_ns.size() < max_samples)
+        {
+            out.latency_ns.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        }
+    }
+}
+
+// runs 'func(stop, sample)' on 'threads' threads for 'ms' milliseconds
+template <typename FUNC>
+std::vector<sample> run_threads(int threads, int ms, FUNC func)
+{
+    std::atomic<bool> stop{false};
+    std::latch ready{threads + 1};
+    std::vector<sample> samples(static_cast<std::size_t>(threads));
+    std::vector<std::thread> workers;
+    for (auto t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t]
+                             {
+                                 ready.arrive_and_wait();
+                                 func(stop, samples[static_cast<std::size_t>(t)]);
+                             });
+    }
+
+    ready.arrive_and_wait();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    stop = true;
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+
+    return samples;
+}
+
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+
+    return sorted[static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1))];
+}
+
+void profile_throws(int max_threads, int ms)
+{
+    std::cout << "Part 1. throws\n"
+              << std::setw(6) << "stack" << std::setw(10) << "distance" << std::setw(9) << "threads"
+              << std::setw(14) << "throws/s" << std::setw(11) << "p50(ns)" << std::setw(11) << "p90(ns)"
+              << std::setw(11) << "p99(ns)" << std::setw(12) << "max(ns)" << '\n';
+
+    for (auto stack : {0, 256})
+    {
+        for (auto distance : {1, 16, 128})
+        {
+            for (auto threads = 1; threads <= max_threads; threads *= 2)
+            {
+                auto samples = run_threads(threads, ms, [&](const std::atomic<bool> &stop, sample &out)
+                                           { thrower(stack, distance, stop, out); });
+
+                std::uint64_t throws = 0;
+                std::vector<double> latency;
+                for (auto &s : samples)
+                {
+                    throws += s.count;
+                    latency.insert(latency.end(), s.latency_ns.begin(), s.latency_ns.end());
+                }
+                std::sort(latency.begin(), latency.end());
+
+                std::cout << std::setw(6) << stack << std::setw(10) << distance << std::setw(9) << threads
+                          << std::fixed << std::setprecision(0)
+                          << std::setw(14) << static_cast<double>(throws) * 1000.0 / ms
+                          << std::setw(11) << percentile(latency, 0.5) << std::setw(11) << percentile(latency, 0.9)
+                          << std::setw(11) << percentile(latency, 0.99) << std::setw(12) << percentile(latency, 1.0) << '\n';
+            }
+        }
+    }
+}
+
+// ---------------------------------------
+// Part 2. FDE lookup: which object contains an address, and where is its PT_GNU_EH_FRAME
+// ---------------------------------------
+struct lookup
+{
+    std::uintptr_t pc;
+    const void *eh_frame_hdr;
+};
+
+// what libgcc did before _dl_find_object(): walk every loaded object under the loader lock
+const void *find_with_dl_iterate_phdr(const void *pc)
+{
+    lookup l{reinterpret_cast<std::uintptr_t>(pc), nullptr};
+    dl_iterate_phdr([](dl_phdr_info *info, std::size_t, void *data)
+                    {
+                        auto l = static_cast<lookup *>(data);
+                        const ElfW(Phdr) *eh = nullptr;
+                        auto found = false;
+                        for (auto i = 0; i < info->dlpi_phnum; i++)
+                        {
+                            auto &ph = info->dlpi_phdr[i];
+                            auto start = info->dlpi_addr + ph.p_vaddr;
+                            if (ph.p_type == PT_LOAD && l->pc >= start && l->pc < start + ph.p_memsz)
+                            {
+                                found = true;
+                            }
+                            else if (ph.p_type == PT_GNU_EH_FRAME)
+                            {
+                                eh = &ph;
+                            }
+                        }
+
+                        if (found && eh != nullptr)
+                        {
+                            l->eh_frame_hdr = reinterpret_cast<const void *>(info->dlpi_addr + eh->p_vaddr);
+                            return 1;
+                        }
+                        return 0;
+                    },
+                    &l);
+
+    return l.eh_frame_hdr;
+}
+
+const void *find_with_dl_find_object(const void *pc)
+{
+#ifdef DLFO_EH_SEGMENT_TYPE
+    dl_find_object result;
+    if (_dl_find_object(const_cast<void *>(pc), &result) == 0)
+    {
+        return result.dlfo_eh_frame;
+    }
+#endif
+    return nullptr;
+}
+
+void profile_lookups(int max_threads, int ms)
+{
+    // return addresses of a throw: this executable, libstdc++ (__cxa_throw), libgcc (_Unwind_RaiseException)
+    const void *pcs[] = {reinterpret_cast<const void *>(&throw_at),
+                         reinterpret_cast<const void *>(&__cxxabiv1::__cxa_throw),
+                         reinterpret_cast<const void *>(&_Unwind_RaiseException)};
+
+    std::cout << "\nPart 2. frame lookups\n"
+              << std::setw(9) << "threads" << std::setw(24) << "dl_iterate_phdr/s" << std::setw(24) << "_dl_find_object/s" << '\n';
+
+#ifndef DLFO_EH_SEGMENT_TYPE
+    std::cout << "(_dl_find_object() needs glibc 2.35)\n";
+#endif
+
+    for (auto threads = 1; threads <= max_threads; threads *= 2)
+    {
+        std::cout << std::setw(9) << threads;
+        for (auto find : {&find_with_dl_iterate_phdr, &find_with_dl_find_object})
+        {
+            auto samples = run_threads(threads, ms, [&](const std::atomic<bool> &stop, sample &out)
+                                       {
+                                           while (!stop.load(std::memory_order_relaxed))
+                                           {
+                                               for (auto pc : pcs)
+                                               {
+                                                   bench::do_not_optimize(find(pc));
+                                               }
+                                               out.count += std::size(pcs);
+                                           }
+                                       });
+
+            std::uint64_t lookups = 0;
+            for (auto &s : samples)
+            {
+                lookups += s.count;
+            }
+            std::cout << std::setw(24) << std::fixed << std::setprecision(0) << static_cast<double>(lookups) * 1000.0 / ms;
+        }
+        std::cout << '\n';
+    }
+}
+
+// ---------------------------------------
+// Part 3. unwind tables on disk
+// ---------------------------------------
+void print_sections(const std::string &path)
+{
+    auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        auto error = errno;
+        close(fd);
+        throw std::runtime_error(path + ": fstat: " + strerror(error));
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    if (size < sizeof(Elf64_Ehdr))
+    {
+        close(fd);
+        throw std::runtime_error(path + ": not a 64-bit ELF file");
+    }
+    auto map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        throw std::runtime_error(path + ": mmap: " + strerror(errno));
+    }
+
+    // every offset of the file is checked against its size: a truncated or corrupt file must not crash us
+    auto fail = [&](const char *what)
+    {
+        munmap(map, size);
+        throw std::runtime_error(path + ": " + what);
+    };
+
+    auto base = static_cast<const char *>(map);
+    auto ehdr = reinterpret_cast<const Elf64_Ehdr *>(base);
+    if (std::memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_ident[EI_CLASS] != ELFCLASS64)
+    {
+        fail("not a 64-bit ELF file");
+    }
+
+    // more than SHN_LORESERVE sections, or none, keep the real numbers in section 0: not handled here
+    if (ehdr->e_shnum == 0 || ehdr->e_shentsize != sizeof(Elf64_Shdr) ||
+        ehdr->e_shstrndx == SHN_UNDEF || ehdr->e_shstrndx == SHN_XINDEX || ehdr->e_shstrndx >= ehdr->e_shnum)
+    {
+        fail("no usable section header table");
+    }
+    if (ehdr->e_shoff > size || (size - ehdr->e_shoff) / sizeof(Elf64_Shdr) < ehdr->e_shnum ||
+        ehdr->e_shoff % alignof(Elf64_Shdr) != 0)
+    {
+        fail("section header table outside of the file");
+    }
+
+    auto shdr = reinterpret_cast<const Elf64_Shdr *>(base + ehdr->e_shoff);
+    const auto &strtab = shdr[ehdr->e_shstrndx];
+    if (strtab.sh_type != SHT_STRTAB || strtab.sh_offset > size || strtab.sh_size > size - strtab.sh_offset ||
+        strtab.sh_size == 0 || base[strtab.sh_offset + strtab.sh_size - 1] != '\0')
+    {
+        fail("section name table outside of the file");
+    }
+    auto names = base + strtab.sh_offset;
+
+    std::cout << path << " (" << size << " bytes)\n";
+    std::uint64_t text = 0, unwind = 0;
+    for (auto i = 0; i < ehdr->e_shnum; i++)
+    {
+        if (shdr[i].sh_name >= strtab.sh_size)
+        {
+            fail("section name outside of the name table");
+        }
+
+        // the table ends with '\0', checked above
+        std::string name{names + shdr[i].sh_name};
+        if (name == ".text")
+        {
+            text = shdr[i].sh_size;
+        }
+        else if (name == ".eh_frame" || name == ".eh_frame_hdr" || name == ".gcc_except_table")
+        {
+            unwind += shdr[i].sh_size;
+        }
+        else
+        {
+            continue;
+        }
+
+        std::cout << "  " << std::left << std::setw(20) << name << std::right << std::setw(10) << shdr[i].sh_size << '\n';
+    }
+
+    if (text != 0)
+    {
+        std::cout << "  unwind tables are " << std::fixed << std::setprecision(1)
+                  << 100.0 * static_cast<double>(unwind) / static_cast<double>(text) << "% of .text\n";
+    }
+
+    munmap(map, size);
+}
+
+int protected_main(int argc, char **argv)
+{
+    auto max_threads = 64;
+    auto ms = 200;
+    std::vector<std::string> binaries;
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg.starts_with("--max-threads="))
+        {
+            max_threads = std::stoi(arg.substr(14));
+        }
+        else if (arg.starts_with("--ms="))
+        {
+            ms = std::stoi(arg.substr(5));
+        }
+        else if (arg.starts_with("--binary="))
+        {
+            binaries.push_back(arg.substr(9));
+        }
+        else
+        {
+            std::cerr << "unknown argument: " << arg << '\n';
+            std::cerr << "usage: exception_profiler [--max-threads=N] [--ms=N] [--binary=FILE]...\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Step 1. throws
+    profile_throws(max_threads, ms);
+
+    // Step 2. the lookup the unwinder does for every frame
+    profile_lookups(max_threads, ms);
+
+    // Step 3. what the tables cost
+    std::cout << "\nPart 3. unwind tables\n";
+    if (binaries.empty())
+    {
+        binaries.push_back("/proc/self/exe");
+    }
+    for (auto &b : binaries)
+    {
+        print_sections(b);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}
@@ -32,6 +32,8 @@
 #include <cstring>
 #include <iostream>
 
+#include "error.hpp"
+
 int myfunc(int val)
 {
     if (val == 42)
@@ -131,6 +133,25 @@ int myfuncRAII(int val)
     return 0;
 }
 
+// the same errors, with their context: err::error (include/error.hpp) keeps the errno, where it was set
+// and where it passed on the way up, instead of the errno that the next call overwrites
+err::result<int, err::error> myfunc6(int val)
+{
+    if (val == 42)
+    {
+        return err::failure{err::error{err::posix_category, EINVAL}};
+    }
+
+    return 42;
+}
+
+err::result<int, err::error> nested6(int val)
+{
+    auto handle = ERROR_TRY(myfunc6(val), "opening handle", val);
+    std::cout << "nested6 success\n";
+
+    return handle;
+}
 
 int main(int argc, char **argv)
 {
@@ -257,5 +278,19 @@ int main(int argc, char **argv)
         std::cout << "failure: " << strerror(errno) << '\n';
     }
 
+    // ----context
+    std::cout << "--------------- 6 ---------------------\n";
+    for (auto val : {1, 42})
+    {
+        if (auto handle = nested6(val); handle)
+        {
+            std::cout << "success: " << *handle << '\n';
+        }
+        else
+        {
+            std::cout << "failure: " << handle.error() << '\n';
+        }
+    }
+
     return 0;
 }
\ No newline at end of file
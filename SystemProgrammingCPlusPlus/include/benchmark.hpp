@@ -0,0 +1,577 @@
+/**
+ * @File    : benchmark.hpp
+ * @Brief   : Statistical micro-benchmark harness shared by the chapter examples
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * @Command : ./a.out --format=json > before.json
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** A statistical benchmark harness
+ * The single-shot 'benchmark(FUNC)' template used throughout the earlier chapters
+ * runs the function once and returns the raw tick count of the clock.
+ * One measurement says very little: the first call pays for page faults and cold caches,
+ * the clock resolution may be larger than the work itself,
+ * and any interruption by the scheduler lands directly in the result.
+ *
+ * bench::run() replaces it with the following procedure:
+ * 1. warm-up: call the function until 'warmup_time' has elapsed (caches, branch predictors, page faults),
+ * 2. calibration: double the iteration count until one batch takes at least 'min_sample_time',
+ * 3. sampling: time 'samples' batches and convert each one to nanoseconds per iteration,
+ * 4. outlier rejection: drop samples further than 'outlier_k' scaled MADs from the median,
+ * 5. statistics: report median, MAD, min, p99 and mean of the remaining samples.
+ *
+ * bench::do_not_optimize() and bench::clobber_memory() are compiler barriers
+ * that keep the optimizer from deleting the work being measured.
+ *
+ * Results are collected in a bench::reporter which prints a text table (default),
+ * JSON or CSV so that the output of two builds can be diffed.
+ *
+ * With '--perf' every sample is also wrapped in the hardware performance counters
+ * of include/perf_counters.hpp, and the median of each counter per iteration
+ * is reported next to the wall time. Counters that cannot be opened are reported as n/a.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_BENCHMARK_HPP
+#define SYSTEM_PROGRAMMING_BENCHMARK_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "perf_counters.hpp"
+
+namespace bench
+{
+    using clock = std::chrono::steady_clock;
+
+    // ---------------------------------------
+    // Compiler barriers
+    // ---------------------------------------
+
+    // Forces 'value' to be materialized, so the computation producing it cannot be removed.
+    template <typename T>
+    inline void do_not_optimize(T const &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    template <typename T>
+    inline void do_not_optimize(T &value)
+    {
+        asm volatile("" : "+m,r"(value) : : "memory");
+    }
+
+    // Forces all pending writes to memory to be treated as observable.
+    inline void clobber_memory()
+    {
+        asm volatile("" : : : "memory");
+    }
+
+    // ---------------------------------------
+    // Options and results
+    // ---------------------------------------
+    enum class format
+    {
+        text,
+        json,
+        csv
+    };
+
+    struct options
+    {
+        std::chrono::nanoseconds warmup_time{std::chrono::milliseconds(100)};
+        std::chrono::nanoseconds min_sample_time{std::chrono::milliseconds(10)};
+        std::size_t samples{30};
+        std::uint64_t max_iterations{std::uint64_t{1} << 30};
+        double outlier_k{3.0};
+        bench::format format{format::text};
+        bool perf_counters{false};
+    };
+
+    struct result
+    {
+        std::string name;
+        std::uint64_t iterations{};
+        std::size_t samples{};
+        std::size_t outliers{};
+        double median_ns{};
+        double mad_ns{};
+        double min_ns{};
+        double p99_ns{};
+        double mean_ns{};
+        perf::sample counters{};
+    };
+
+    // ---------------------------------------
+    // Statistics helpers
+    // ---------------------------------------
+    namespace detail
+    {
+        inline double percentile(std::vector<double> sorted, double p)
+        {
+            if (sorted.empty())
+            {
+                return 0.0;
+            }
+
+            std::sort(sorted.begin(), sorted.end());
+
+            auto rank = p * static_cast<double>(sorted.size() - 1);
+            auto lo = static_cast<std::size_t>(std::floor(rank));
+            auto hi = static_cast<std::size_t>(std::ceil(rank));
+
+            return sorted[lo] + (sorted[hi] - sorted[lo]) * (rank - static_cast<double>(lo));
+        }
+
+        inline double median(const std::vector<double> &v)
+        {
+            return percentile(v, 0.5);
+        }
+
+        // median absolute deviation, scaled to be comparable with a standard deviation
+        inline double mad(const std::vector<double> &v, double med)
+        {
+            std::vector<double> dev;
+            dev.reserve(v.size());
+
+            for (auto x : v)
+            {
+                dev.push_back(std::fabs(x - med));
+            }
+
+            return 1.4826 * median(dev);
+        }
+
+        // a benchmark name as a JSON string: quotes, backslashes and control characters escaped
+        inline void write_json_string(std::ostream &os, std::string_view str)
+        {
+            os << '"';
+            for (auto c : str)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    os << '\\' << c;
+                }
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    constexpr const char *hex = "0123456789abcdef";
+                    os << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+                }
+                else
+                {
+                    os << c;
+                }
+            }
+            os << '"';
+        }
+
+        // median of every counter, divided by the number of iterations per sample
+        inline perf::sample counters_per_iteration(const std::vector<perf::sample> &samples,
+                                                   std::uint64_t iterations)
+        {
+            perf::sample r{};
+            for (std::size_t idx = 0; idx < perf::num_events; idx++)
+            {
+                std::vector<double> values;
+                for (const auto &s : samples)
+                {
+                    if (s.valid[idx])
+                    {
+                        values.push_back(s.values[idx] / static_cast<double>(iterations));
+                    }
+                }
+
+                if (!values.empty())
+                {
+                    r.values[idx] = median(values);
+                    r.valid[idx] = true;
+                }
+            }
+
+            return r;
+        }
+
+        template <typename FUNC>
+        clock::duration time_batch(FUNC &func, std::uint64_t iterations)
+        {
+            auto stime = clock::now();
+            for (std::uint64_t i = 0; i < iterations; i++)
+            {
+                func();
+                clobber_memory();
+            }
+            auto etime = clock::now();
+
+            return etime - stime;
+        }
+    }
+
+    // Computes the summary statistics of 'samples' (nanoseconds per iteration).
+    inline result summarize(std::string_view name, std::uint64_t iterations,
+                            std::vector<double> samples, double outlier_k)
+    {
+        result r{};
+        r.name = name;
+        r.iterations = iterations;
+
+        auto med = detail::median(samples);
+        auto mad = detail::mad(samples, med);
+
+        if (mad > 0.0)
+        {
+            auto keep = std::remove_if(samples.begin(), samples.end(), [&](double x)
+                                       { return std::fabs(x - med) > outlier_k * mad; });
+
+            r.outliers = static_cast<std::size_t>(samples.end() - keep);
+            samples.erase(keep, samples.end());
+        }
+
+        r.samples = samples.size();
+        r.median_ns = detail::median(samples);
+        r.mad_ns = detail::mad(samples, r.median_ns);
+        r.min_ns = *std::min_element(samples.begin(), samples.end());
+        r.p99_ns = detail::percentile(samples, 0.99);
+
+        double total = 0.0;
+        for (auto x : samples)
+        {
+            total += x;
+        }
+        r.mean_ns = total / static_cast<double>(samples.size());
+
+        return r;
+    }
+
+    // ---------------------------------------
+    // Runner
+    // ---------------------------------------
+    template <typename FUNC>
+    result run(std::string_view name, FUNC &&func, const options &opts = {})
+    {
+        // Step 1. warm-up
+        auto warmup_end = clock::now() + opts.warmup_time;
+        do
+        {
+            func();
+            clobber_memory();
+        } while (clock::now() < warmup_end);
+
+        // Step 2. calibrate the number of iterations per sample
+        std::uint64_t iterations = 1;
+        while (iterations < opts.max_iterations)
+        {
+            if (detail::time_batch(func, iterations) >= opts.min_sample_time)
+            {
+                break;
+            }
+
+            iterations *= 2;
+        }
+
+        // Step 3. repeated samples, in nanoseconds per iteration
+        std::vector<double> samples;
+        samples.reserve(opts.samples);
+
+        auto *pmu = opts.perf_counters ? &perf::thread_counters() : nullptr;
+        std::vector<perf::sample> counter_samples;
+
+        for (std::size_t i = 0; i < std::max<std::size_t>(opts.samples, 1); i++)
+        {
+            if (pmu)
+            {
+                pmu->start();
+            }
+
+            auto d = detail::time_batch(func, iterations);
+
+            if (pmu)
+            {
+                counter_samples.push_back(pmu->stop());
+            }
+
+            auto ns = std::chrono::duration<double, std::nano>(d).count();
+            samples.push_back(ns / static_cast<double>(iterations));
+        }
+
+        // Step 4. outlier rejection and statistics
+        auto r = summarize(name, iterations, std::move(samples), opts.outlier_k);
+        r.counters = detail::counters_per_iteration(counter_samples, iterations);
+
+        return r;
+    }
+
+    // ---------------------------------------
+    // Command line
+    // ---------------------------------------
+
+    /** Recognised arguments (all optional):
+     *  --format=text|json|csv
+     *  --samples=N
+     *  --min-time-ms=N
+     *  --warmup-ms=N
+     *  --perf            collect hardware performance counters
+     * Unknown arguments are left to the example itself.
+     */
+    inline options parse_args(int argc, char **argv, options opts = {})
+    {
+        for (auto i = 1; i < argc; i++)
+        {
+            std::string_view arg{argv[i]};
+
+            auto value = [&arg](std::string_view key) -> const char *
+            {
+                if (arg.substr(0, key.size()) == key)
+                {
+                    return arg.data() + key.size();
+                }
+
+                return nullptr;
+            };
+
+            if (auto v = value("--format="))
+            {
+                if (std::strcmp(v, "json") == 0)
+                {
+                    opts.format = format::json;
+                }
+                else if (std::strcmp(v, "csv") == 0)
+                {
+                    opts.format = format::csv;
+                }
+                else
+                {
+                    opts.format = format::text;
+                }
+            }
+            else if (auto v = value("--samples="))
+            {
+                opts.samples = std::stoul(v);
+            }
+            else if (auto v = value("--min-time-ms="))
+            {
+                opts.min_sample_time = std::chrono::milliseconds(std::stoul(v));
+            }
+            else if (auto v = value("--warmup-ms="))
+            {
+                opts.warmup_time = std::chrono::milliseconds(std::stoul(v));
+            }
+            else if (arg == "--perf")
+            {
+                opts.perf_counters = true;
+            }
+        }
+
+        return opts;
+    }
+
+    // ---------------------------------------
+    // Reporter
+    // ---------------------------------------
+    class reporter
+    {
+    public:
+        explicit reporter(const options &opts = {}) : m_opts{opts}
+        {
+            if (m_opts.perf_counters)
+            {
+                // counters are opened per thread, report what this one can count
+                if (auto msg = perf::unavailable(perf::thread_counters()); !msg.empty())
+                {
+                    std::clog << "perf counters not available:\n"
+                              << msg;
+                }
+            }
+        }
+
+        template <typename FUNC>
+        const result &run(std::string_view name, FUNC &&func)
+        {
+            m_results.push_back(bench::run(name, std::forward<FUNC>(func), m_opts));
+            return m_results.back();
+        }
+
+        void add(result r)
+        {
+            m_results.push_back(std::move(r));
+        }
+
+        const std::vector<result> &results() const
+        {
+            return m_results;
+        }
+
+        const options &opts() const
+        {
+            return m_opts;
+        }
+
+        void print(std::ostream &os = std::cout) const
+        {
+            switch (m_opts.format)
+            {
+            case format::json:
+                print_json(os);
+                break;
+            case format::csv:
+                print_csv(os);
+                break;
+            default:
+                print_text(os);
+                break;
+            }
+        }
+
+    private:
+        void print_text(std::ostream &os) const
+        {
+            auto flags = os.flags();
+
+            os << std::left << std::setw(32) << "benchmark" << std::right
+               << std::setw(14) << "median(ns)" << std::setw(12) << "mad(ns)"
+               << std::setw(14) << "min(ns)" << std::setw(14) << "p99(ns)"
+               << std::setw(12) << "iters" << std::setw(10) << "samples" << '\n';
+
+            os << std::fixed << std::setprecision(2);
+            for (const auto &r : m_results)
+            {
+                os << std::left << std::setw(32) << r.name << std::right
+                   << std::setw(14) << r.median_ns << std::setw(12) << r.mad_ns
+                   << std::setw(14) << r.min_ns << std::setw(14) << r.p99_ns
+                   << std::setw(12) << r.iterations << std::setw(6) << r.samples
+                   << " (-" << r.outliers << ")\n";
+            }
+
+            if (m_opts.perf_counters)
+            {
+                os << '\n'
+                   << std::left << std::setw(32) << "counters per iteration" << std::right;
+                for (auto name : perf::event_names)
+                {
+                    os << std::setw(15) << name;
+                }
+                os << '\n';
+
+                for (const auto &r : m_results)
+                {
+                    os << std::left << std::setw(32) << r.name << std::right;
+                    for (std::size_t idx = 0; idx < perf::num_events; idx++)
+                    {
+                        if (r.counters.valid[idx])
+                        {
+                            os << std::setw(15) << r.counters.values[idx];
+                        }
+                        else
+                        {
+                            os << std::setw(15) << "n/a";
+                        }
+                    }
+                    os << '\n';
+                }
+            }
+
+            os.flags(flags);
+        }
+
+        void print_json(std::ostream &os) const
+        {
+            auto flags = os.flags();
+            os << std::setprecision(6) << std::fixed;
+
+            os << "{\n  \"benchmarks\": [\n";
+            for (std::size_t i = 0; i < m_results.size(); i++)
+            {
+                const auto &r = m_results[i];
+
+                os << "    {\"name\": ";
+                detail::write_json_string(os, r.name);
+                os << ", \"iterations\": " << r.iterations
+                   << ", \"samples\": " << r.samples
+                   << ", \"outliers\": " << r.outliers
+                   << ", \"median_ns\": " << r.median_ns
+                   << ", \"mad_ns\": " << r.mad_ns
+                   << ", \"min_ns\": " << r.min_ns
+                   << ", \"p99_ns\": " << r.p99_ns
+                   << ", \"mean_ns\": " << r.mean_ns;
+
+                if (m_opts.perf_counters)
+                {
+                    os << ", \"counters\": {";
+                    for (std::size_t idx = 0; idx < perf::num_events; idx++)
+                    {
+                        os << (idx == 0 ? "" : ", ") << '"' << perf::event_names[idx] << "\": ";
+                        if (r.counters.valid[idx])
+                        {
+                            os << r.counters.values[idx];
+                        }
+                        else
+                        {
+                            os << "null";
+                        }
+                    }
+                    os << '}';
+                }
+
+                os << "}"
+                   << (i + 1 < m_results.size() ? "," : "") << '\n';
+            }
+            os << "  ]\n}\n";
+
+            os.flags(flags);
+        }
+
+        void print_csv(std::ostream &os) const
+        {
+            auto flags = os.flags();
+            os << std::setprecision(6) << std::fixed;
+
+            os << "name,iterations,samples,outliers,median_ns,mad_ns,min_ns,p99_ns,mean_ns";
+            if (m_opts.perf_counters)
+            {
+                for (auto name : perf::event_names)
+                {
+                    os << ',' << name;
+                }
+            }
+            os << '\n';
+
+            for (const auto &r : m_results)
+            {
+                os << r.name << ',' << r.iterations << ',' << r.samples << ','
+                   << r.outliers << ',' << r.median_ns << ',' << r.mad_ns << ','
+                   << r.min_ns << ',' << r.p99_ns << ',' << r.mean_ns;
+
+                if (m_opts.perf_counters)
+                {
+                    for (std::size_t idx = 0; idx < perf::num_events; idx++)
+                    {
+                        // an empty field marks a counter that was not available
+                        os << ',';
+                        if (r.counters.valid[idx])
+                        {
+                            os << r.counters.values[idx];
+                        }
+                    }
+                }
+                os << '\n';
+            }
+
+            os.flags(flags);
+        }
+
+    private:
+        options m_opts;
+        std::vector<result> m_results{};
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_BENCHMARK_HPP
@@ -0,0 +1,241 @@
+/**
+ * @File    : crc32c.hpp
+ * @Brief   : CRC32C (Castagnoli): slicing-by-8 tables, SSE4.2 crc32 instruction, 3-way interleaving with PCLMUL recombination
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** CRC32C
+ * CRC32C (polynomial 0x1EDC6F41, reflected 0x82F63B78) is the checksum of iSCSI, ext4 metadata,
+ * Btrfs and many storage formats. x86-64 computes it in hardware: the SSE4.2 crc32 instruction
+ * consumes 8 bytes per instruction, with a latency of 3 cycles and a throughput of 1 per cycle.
+ * A single dependency chain therefore runs at a third of the possible speed.
+ *
+ * The fast kernel (Intel, "Fast CRC Computation for iSCSI Polynomial Using CRC32 Instruction")
+ * splits a block into three parts and runs three independent crc32 chains, one per part.
+ * The three partial CRCs are then combined: a CRC is linear, so the CRC of A|B|C is
+ *   shift(crc(A), |B| + |C|) ^ shift(crc(B), |C|) ^ crc(C)
+ * where shift(c, n) appends n zero bytes. shift() is one carry-less multiplication (PCLMULQDQ)
+ * of c with the constant x^(8n - 33) mod P, reduced to 32 bits by one more crc32 instruction.
+ * The constants are computed at compile time for the two block sizes used.
+ *
+ * The slicing-by-8 table version (8 lookups per 8 bytes) is the portable fallback,
+ * crc32c::update() selects the kernel at run time (__builtin_cpu_supports).
+ * update() chains like zlib's crc32(): pass the previous result, 0 to start.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_CRC32C_HPP
+#define SYSTEM_PROGRAMMING_CRC32C_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace crc32c
+{
+    namespace detail
+    {
+        constexpr std::uint32_t polynomial = 0x82F63B78;
+
+        constexpr std::array<std::array<std::uint32_t, 256>, 8> make_tables()
+        {
+            std::array<std::array<std::uint32_t, 256>, 8> tables{};
+            for (std::uint32_t i = 0; i < 256; i++)
+            {
+                auto crc = i;
+                for (auto bit = 0; bit < 8; bit++)
+                {
+                    crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+                }
+                tables[0][i] = crc;
+            }
+
+            for (std::uint32_t i = 0; i < 256; i++)
+            {
+                for (std::size_t t = 1; t < 8; t++)
+                {
+                    tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+                }
+            }
+
+            return tables;
+        }
+
+        inline constexpr auto tables = make_tables();
+
+        // x^n mod P, bit-reflected (bit 31 is x^0)
+        constexpr std::uint32_t x_pow(std::uint64_t n)
+        {
+            std::uint32_t v = 0x80000000;
+            for (std::uint64_t i = 0; i < n; i++)
+            {
+                v = (v >> 1) ^ ((v & 1) ? polynomial : 0);
+            }
+
+            return v;
+        }
+
+        // the CRC register without the initial and final inversion
+        inline std::uint32_t update_table(std::uint32_t crc, const std::uint8_t *data, std::size_t size)
+        {
+            while (size >= 8)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, data, 8);
+                word ^= crc;
+
+                crc = tables[7][word & 0xFF] ^ tables[6][(word >> 8) & 0xFF] ^
+                      tables[5][(word >> 16) & 0xFF] ^ tables[4][(word >> 24) & 0xFF] ^
+                      tables[3][(word >> 32) & 0xFF] ^ tables[2][(word >> 40) & 0xFF] ^
+                      tables[1][(word >> 48) & 0xFF] ^ tables[0][word >> 56];
+
+                data += 8;
+                size -= 8;
+            }
+
+            while (size-- != 0)
+            {
+                crc = (crc >> 8) ^ tables[0][(crc ^ *data++) & 0xFF];
+            }
+
+            return crc;
+        }
+
+#if defined(__x86_64__)
+        __attribute__((target("sse4.2"))) inline std::uint32_t update_sse42(std::uint32_t crc, const std::uint8_t *data, std::size_t size)
+        {
+            std::uint64_t c = crc;
+            while (size >= 8)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, data, 8);
+                c = _mm_crc32_u64(c, word);
+                data += 8;
+                size -= 8;
+            }
+
+            auto c32 = static_cast<std::uint32_t>(c);
+            while (size-- != 0)
+            {
+                c32 = _mm_crc32_u8(c32, *data++);
+            }
+
+            return c32;
+        }
+
+        // shift(crc, n): crc * x^(8n) mod P as one carry-less multiplication and one crc32 reduction
+        __attribute__((target("sse4.2,pclmul"))) inline std::uint32_t shift(std::uint32_t crc, std::uint32_t constant)
+        {
+            auto product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)), _mm_cvtsi32_si128(static_cast<int>(constant)), 0);
+            return static_cast<std::uint32_t>(_mm_crc32_u64(0, static_cast<std::uint64_t>(_mm_cvtsi128_si64(product))));
+        }
+
+        template <std::size_t BLOCK>
+        __attribute__((target("sse4.2,pclmul"))) inline std::uint32_t three_way(std::uint32_t crc, const std::uint8_t *&data, std::size_t &size)
+        {
+            static constexpr std::uint32_t shift1 = x_pow(8 * BLOCK - 33);
+            static constexpr std::uint32_t shift2 = x_pow(16 * BLOCK - 33);
+
+            while (size >= 3 * BLOCK)
+            {
+                std::uint64_t c0 = crc;
+                std::uint64_t c1 = 0;
+                std::uint64_t c2 = 0;
+
+                for (std::size_t i = 0; i < BLOCK; i += 8)
+                {
+                    std::uint64_t w0, w1, w2;
+                    std::memcpy(&w0, data + i, 8);
+                    std::memcpy(&w1, data + BLOCK + i, 8);
+                    std::memcpy(&w2, data + 2 * BLOCK + i, 8);
+
+                    c0 = _mm_crc32_u64(c0, w0);
+                    c1 = _mm_crc32_u64(c1, w1);
+                    c2 = _mm_crc32_u64(c2, w2);
+                }
+
+                crc = shift(static_cast<std::uint32_t>(c0), shift2) ^ shift(static_cast<std::uint32_t>(c1), shift1) ^ static_cast<std::uint32_t>(c2);
+                data += 3 * BLOCK;
+                size -= 3 * BLOCK;
+            }
+
+            return crc;
+        }
+
+        __attribute__((target("sse4.2,pclmul"))) inline std::uint32_t update_pclmul(std::uint32_t crc, const std::uint8_t *data, std::size_t size)
+        {
+            // long blocks for the bulk, short ones for the rest, the crc32 chain for the tail
+            crc = three_way<8192>(crc, data, size);
+            crc = three_way<256>(crc, data, size);
+            return update_sse42(crc, data, size);
+        }
+
+        inline bool has_sse42()
+        {
+            static const bool sse42 = __builtin_cpu_supports("sse4.2");
+            return sse42;
+        }
+
+        inline bool has_pclmul()
+        {
+            static const bool pclmul = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul");
+            return pclmul;
+        }
+#endif
+    }
+
+    enum class isa
+    {
+        table,
+        sse42,
+        pclmul
+    };
+
+    inline isa best_isa()
+    {
+#if defined(__x86_64__)
+        return detail::has_pclmul() ? isa::pclmul : detail::has_sse42() ? isa::sse42 : isa::table;
+#else
+        return isa::table;
+#endif
+    }
+
+    // CRC32C of [data, data + size) continuing 'crc' (0 for the first piece)
+    inline std::uint32_t update(std::uint32_t crc, const void *data, std::size_t size, isa use = best_isa())
+    {
+        auto input = static_cast<const std::uint8_t *>(data);
+        crc = ~crc;
+
+        switch (use)
+        {
+#if defined(__x86_64__)
+        case isa::pclmul:
+            crc = detail::update_pclmul(crc, input, size);
+            break;
+        case isa::sse42:
+            crc = detail::update_sse42(crc, input, size);
+            break;
+#endif
+        default:
+            crc = detail::update_table(crc, input, size);
+            break;
+        }
+
+        return ~crc;
+    }
+
+    inline std::uint32_t compute(const void *data, std::size_t size, isa use = best_isa())
+    {
+        return update(0, data, size, use);
+    }
+}
+
+#endif // SYSTEM_PROGRAMMING_CRC32C_HPP
@@ -0,0 +1,466 @@
+/**
+ * @File    : dir_walker.hpp
+ * @Brief   : Parallel directory tree walker: work-stealing over directories, getdents64(), d_type, optional statx()
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp -lpthread
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Walking a directory tree
+ * std::filesystem::recursive_directory_iterator walks a tree from one thread, one entry at a time:
+ * readdir() hands out the entries of a small buffer (32KB in glibc), every entry becomes
+ * a std::filesystem::path, and the next directory is only opened when the previous one is done.
+ * For a tree with millions of files the walk waits on one directory read after the other.
+ *
+ * walk::walker reads the directories in parallel:
+ * 1. every worker thread owns a queue of directories. It takes the newest directory of its own queue
+ *    (depth-first, the parent path is still in the cache), an idle worker steals the oldest directory
+ *    of another queue (near the top of the tree, so probably a large subtree),
+ * 2. a directory is read with the raw getdents64() system call into a large buffer (256KB by default),
+ *    one system call returns thousands of entries,
+ * 3. the type of an entry comes from d_type, no stat() is needed to find the subdirectories.
+ *    Only file systems that do not fill d_type (DT_UNKNOWN) cost an fstatat() per entry,
+ * 4. optionally every entry is described by statx() with only the requested fields (statx_mask),
+ *    relative to the open directory, so the kernel does not resolve the whole path again.
+ *
+ * The entries are streamed to a callback, nothing is collected. The callback runs on the worker threads
+ * concurrently, entry::worker tells which one, for per-thread accumulators without locking.
+ * The views of an entry are only valid during the call. An exception thrown by the callback
+ * (or by options::descend) stops the walk, the workers finish and run() rethrows the first one.
+ *
+ * Symbolic links are reported and not followed, and a directory that cannot be opened
+ * (permission denied, removed during the walk) is counted in stats::errors and skipped.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_DIR_WALKER_HPP
+#define SYSTEM_PROGRAMMING_DIR_WALKER_HPP
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace walk
+{
+    struct entry
+    {
+        // the path of the entry, starting with the root given to run()
+        std::string_view path;
+        std::string_view name;
+
+        std::filesystem::file_type type;
+        std::uint64_t inode;
+
+        // 1 for the entries of the root directory
+        unsigned depth;
+
+        // the worker thread that runs the callback, from 0 to options::threads - 1
+        unsigned worker;
+
+        // only the fields of options::statx_mask, nullptr when statx_mask is 0 or statx() failed
+        const struct statx *stat;
+    };
+
+    using callback = std::function<void(const entry &e)>;
+
+    struct options
+    {
+        // number of worker threads, 0 for std::thread::hardware_concurrency()
+        unsigned threads{0};
+
+        // the getdents64() buffer of each worker
+        std::size_t buffer_size{256 << 10};
+
+        // STATX_SIZE, STATX_MTIME, ... 0 for no statx() call at all
+        unsigned statx_mask{0};
+
+        // directories deeper than this are reported but not read
+        unsigned max_depth{~0u};
+
+        // decides whether a directory is read, all of them when empty
+        std::function<bool(const entry &dir)> descend;
+    };
+
+    struct stats
+    {
+        std::uint64_t directories{};
+        std::uint64_t entries{};
+        std::uint64_t errors{};
+        std::uint64_t steals{};
+    };
+
+    inline std::filesystem::file_type to_file_type(unsigned char d_type)
+    {
+        using std::filesystem::file_type;
+
+        switch (d_type)
+        {
+        case DT_REG:
+            return file_type::regular;
+        case DT_DIR:
+            return file_type::directory;
+        case DT_LNK:
+            return file_type::symlink;
+        case DT_BLK:
+            return file_type::block;
+        case DT_CHR:
+            return file_type::character;
+        case DT_FIFO:
+            return file_type::fifo;
+        case DT_SOCK:
+            return file_type::socket;
+        default:
+            return file_type::unknown;
+        }
+    }
+
+    inline std::filesystem::file_type to_file_type_from_mode(mode_t mode)
+    {
+        return to_file_type(static_cast<unsigned char>(IFTODT(mode)));
+    }
+
+    class walker
+    {
+    public:
+        explicit walker(options opts = {}) : m_opts{std::move(opts)}
+        {
+            if (m_opts.threads == 0)
+            {
+                m_opts.threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            m_opts.buffer_size = std::max<std::size_t>(m_opts.buffer_size, 4096);
+        }
+
+        // walks the tree below 'root' (the root itself is not reported)
+        stats run(const std::string &root, const callback &func)
+        {
+            auto fd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd == -1)
+            {
+                throw std::runtime_error(root + ": " + strerror(errno));
+            }
+            close(fd);
+
+            m_workers.clear();
+            for (unsigned i = 0; i < m_opts.threads; i++)
+            {
+                m_workers.push_back(std::make_unique<worker>());
+            }
+
+            m_stop = false;
+            m_error = nullptr;
+            m_pending = 1;
+            m_queued = 1;
+            m_workers[0]->queue.push_back(directory{root, 0});
+
+            std::vector<std::thread> threads;
+            for (unsigned i = 1; i < m_opts.threads; i++)
+            {
+                threads.emplace_back([this, i, &func]
+                                     { work(i, func); });
+            }
+
+            work(0, func);
+            for (auto &t : threads)
+            {
+                t.join();
+            }
+
+            if (m_error)
+            {
+                std::rethrow_exception(std::exchange(m_error, nullptr));
+            }
+
+            stats total{};
+            for (const auto &w : m_workers)
+            {
+                total.directories += w->counters.directories;
+                total.entries += w->counters.entries;
+                total.errors += w->counters.errors;
+                total.steals += w->counters.steals;
+            }
+
+            return total;
+        }
+
+        // ends a walk early, may be called from the callback
+        void stop()
+        {
+            m_stop = true;
+        }
+
+    private:
+        struct directory
+        {
+            std::string path;
+            unsigned depth;
+        };
+
+        struct alignas(64) worker
+        {
+            std::mutex mutex;
+            std::deque<directory> queue;
+            stats counters{};
+        };
+
+        // the record layout of getdents64(), glibc only declares it with _GNU_SOURCE and 2.30+
+        struct linux_dirent64
+        {
+            std::uint64_t d_ino;
+            std::int64_t d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[];
+        };
+
+        void push(unsigned self, directory dir)
+        {
+            m_pending.fetch_add(1, std::memory_order_relaxed);
+            {
+                std::unique_lock lock{m_workers[self]->mutex};
+                m_workers[self]->queue.push_back(std::move(dir));
+            }
+
+            m_queued.fetch_add(1, std::memory_order_release);
+            if (m_sleeping.load(std::memory_order_acquire) != 0)
+            {
+                m_idle_cond.notify_one();
+            }
+        }
+
+        // the newest directory of the own queue, or the oldest one of another worker
+        bool pop(unsigned self, directory &dir)
+        {
+            {
+                auto &own = *m_workers[self];
+                std::unique_lock lock{own.mutex};
+                if (!own.queue.empty())
+                {
+                    dir = std::move(own.queue.back());
+                    own.queue.pop_back();
+                    m_queued.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            for (unsigned i = 1; i < m_workers.size(); i++)
+            {
+                auto &victim = *m_workers[(self + i) % m_workers.size()];
+                std::unique_lock lock{victim.mutex};
+                if (!victim.queue.empty())
+                {
+                    dir = std::move(victim.queue.front());
+                    victim.queue.pop_front();
+                    m_queued.fetch_sub(1, std::memory_order_relaxed);
+                    m_workers[self]->counters.steals++;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void work(unsigned self, const callback &func)
+        {
+            std::vector<char> buffer(m_opts.buffer_size);
+            std::string path;
+
+            while (true)
+            {
+                directory dir;
+                if (pop(self, dir))
+                {
+                    if (!m_stop)
+                    {
+                        // the directory still counts as done below, so that every worker sees m_pending reach 0
+                        try
+                        {
+                            read_directory(self, dir, buffer, path, func);
+                        }
+                        catch (...)
+                        {
+                            fail(std::current_exception());
+                        }
+                    }
+
+                    // the last directory of the tree wakes up everybody to finish
+                    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    {
+                        std::unique_lock lock{m_idle_mutex};
+                        m_idle_cond.notify_all();
+                    }
+
+                    continue;
+                }
+
+                std::unique_lock lock{m_idle_mutex};
+                m_sleeping++;
+                m_idle_cond.wait_for(lock, std::chrono::milliseconds(1), [this]
+                                     { return m_queued.load(std::memory_order_acquire) != 0 || m_pending.load() == 0; });
+                m_sleeping--;
+
+                if (m_pending.load() == 0)
+                {
+                    return;
+                }
+            }
+        }
+
+        // keeps the first exception for run() and stops the walk
+        void fail(std::exception_ptr error)
+        {
+            {
+                std::unique_lock lock{m_error_mutex};
+                if (!m_error)
+                {
+                    m_error = std::move(error);
+                }
+            }
+            m_stop = true;
+        }
+
+        void read_directory(unsigned self, const directory &dir, std::vector<char> &buffer, std::string &path, const callback &func)
+        {
+            auto &counters = m_workers[self]->counters;
+
+            // the root may be a symbolic link, as run() accepted it; below it links are never followed
+            auto flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | (dir.depth != 0 ? O_NOFOLLOW : 0);
+            auto fd = open(dir.path.c_str(), flags);
+            if (fd == -1)
+            {
+                counters.errors++;
+                return;
+            }
+
+            counters.directories++;
+
+            path.assign(dir.path);
+            if (path.empty() || path.back() != '/')
+            {
+                path.push_back('/');
+            }
+            auto base = path.size();
+
+            try
+            {
+                read_entries(self, fd, dir, buffer, path, base, func);
+            }
+            catch (...)
+            {
+                close(fd);
+                throw;
+            }
+
+            close(fd);
+        }
+
+        void read_entries(unsigned self, int fd, const directory &dir, std::vector<char> &buffer, std::string &path, std::size_t base,
+                          const callback &func)
+        {
+            auto &counters = m_workers[self]->counters;
+
+            struct statx stx{};
+            while (!m_stop)
+            {
+                auto len = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+                if (len <= 0)
+                {
+                    if (len == -1)
+                    {
+                        counters.errors++;
+                    }
+                    break;
+                }
+
+                for (long pos = 0; pos < len && !m_stop;)
+                {
+                    auto d = reinterpret_cast<const linux_dirent64 *>(buffer.data() + pos);
+                    pos += d->d_reclen;
+
+                    std::string_view name{d->d_name};
+                    if (name == "." || name == "..")
+                    {
+                        continue;
+                    }
+
+                    path.resize(base);
+                    path.append(name);
+
+                    entry e{path, std::string_view{path}.substr(base), to_file_type(d->d_type), d->d_ino, dir.depth + 1, self, nullptr};
+
+                    if (m_opts.statx_mask != 0)
+                    {
+                        auto mask = m_opts.statx_mask | (e.type == std::filesystem::file_type::unknown ? STATX_TYPE : 0);
+                        if (statx(fd, d->d_name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, mask, &stx) == 0)
+                        {
+                            e.stat = &stx;
+                            if (e.type == std::filesystem::file_type::unknown)
+                            {
+                                e.type = to_file_type_from_mode(stx.stx_mode);
+                            }
+                        }
+                    }
+                    else if (e.type == std::filesystem::file_type::unknown)
+                    {
+                        // d_type is not filled by every file system
+                        struct stat st{};
+                        if (fstatat(fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+                        {
+                            e.type = to_file_type_from_mode(st.st_mode);
+                        }
+                    }
+
+                    counters.entries++;
+                    func(e);
+
+                    if (e.type == std::filesystem::file_type::directory && e.depth < m_opts.max_depth &&
+                        (!m_opts.descend || m_opts.descend(e)))
+                    {
+                        push(self, directory{path, e.depth});
+                    }
+                }
+            }
+        }
+
+        options m_opts;
+        std::vector<std::unique_ptr<worker>> m_workers;
+
+        // directories queued or being read, the walk is over when it drops to 0
+        std::atomic<std::uint64_t> m_pending{};
+        std::atomic<std::uint64_t> m_queued{};
+        std::atomic<bool> m_stop{};
+
+        // the first exception of a callback, rethrown by run()
+        std::mutex m_error_mutex;
+        std::exception_ptr m_error;
+
+        std::mutex m_idle_mutex;
+        std::condition_variable m_idle_cond;
+        std::atomic<unsigned> m_sleeping{};
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_DIR_WALKER_HPP
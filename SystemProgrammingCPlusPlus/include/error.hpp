@@ -0,0 +1,304 @@
+/**
+ * @File    : error.hpp
+ * @Brief   : err::error: category, code, source location and a context stack, without allocation, formatted when printed
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Errors with context, for free until printed
+ * chapter13/cpp_style_error.cpp builds the message of std::runtime_error on every throw:
+ * "error: " + std::to_string(42) allocates, formats, and is thrown away when the caller retries.
+ * POSIX-style code keeps nothing but errno, which the next system call overwrites: by the time the
+ * error reaches main() nobody knows which file, which call, which line.
+ *
+ * err::error records what is known where it is known, and formats nothing:
+ *
+ * 1. a static category (name and message function, constant-initialized) and an integer code,
+ * 2. the std::source_location where the error was created,
+ * 3. up to 'max_context' context entries added on the way up, each a string literal, an optional
+ *    integer and the source_location of the caller that added it; more entries are counted, not stored,
+ * 4. everything is trivially copyable and lives inline, creating and propagating an error never allocates,
+ * 5. the text is produced by operator<< or format() into a caller buffer (snprintf, no allocation),
+ *    only when somebody prints the error.
+ *
+ *      err::result<int, err::error> open_config(const char *path)
+ *      {
+ *          auto fd = ::open(path, O_RDONLY);
+ *          if (fd == -1)
+ *          {
+ *              return err::failure{err::error::from_errno()};
+ *          }
+ *          return fd;
+ *      }
+ *
+ *      auto fd = ERROR_TRY(open_config(path), "opening the configuration");
+ *
+ * ERROR_TRY is RESULT_TRY (include/result.hpp) adding a context entry on the way out.
+ * err::exception carries an error through a throw, raise() throws one, and result<T, error>::value() too;
+ * what() is the static message of the code.
+ * An error is 160 bytes: the hot paths keep result<T> with a plain std::errc and switch to
+ * err::error where the context is worth it.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_ERROR_HPP
+#define SYSTEM_PROGRAMMING_ERROR_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <ostream>
+#include <source_location>
+#include <type_traits>
+
+#include "result.hpp"
+
+namespace err
+{
+    // ---------------------------------------
+    // Categories
+    // ---------------------------------------
+    struct category
+    {
+        const char *name;
+        const char *(*message)(int code) noexcept; // a static string
+    };
+
+    namespace detail
+    {
+        inline const char *posix_message(int code) noexcept
+        {
+            // unlike strerror(), never formats "Unknown error N" into a shared buffer
+            auto text = strerrordesc_np(code);
+            return text != nullptr ? text : "unknown error";
+        }
+    }
+
+    inline constexpr category posix_category{"posix", &detail::posix_message};
+
+    // ---------------------------------------
+    // error
+    // ---------------------------------------
+    class error
+    {
+    public:
+        static constexpr std::size_t max_context = 4;
+
+        struct context_entry
+        {
+            const char *what;
+            std::int64_t value;
+            bool has_value;
+            std::source_location where;
+        };
+
+        constexpr error(const category &cat, int code, std::source_location where = std::source_location::current()) noexcept
+            : m_category{&cat}, m_code{code}, m_where{where}
+        {
+        }
+
+        // the errno of the last failed system call, at the caller
+        static error from_errno(std::source_location where = std::source_location::current()) noexcept
+        {
+            return error{posix_category, errno, where};
+        }
+
+        // 'what' must be a string literal or otherwise outlive the error
+        error &context(const char *what, std::source_location where = std::source_location::current()) & noexcept
+        {
+            push({what, 0, false, where});
+            return *this;
+        }
+
+        error &context(const char *what, std::int64_t value, std::source_location where = std::source_location::current()) & noexcept
+        {
+            push({what, value, true, where});
+            return *this;
+        }
+
+        error &&context(const char *what, std::source_location where = std::source_location::current()) && noexcept
+        {
+            push({what, 0, false, where});
+            return std::move(*this);
+        }
+
+        error &&context(const char *what, std::int64_t value, std::source_location where = std::source_location::current()) && noexcept
+        {
+            push({what, value, true, where});
+            return std::move(*this);
+        }
+
+        const category &cat() const noexcept
+        {
+            return *m_category;
+        }
+
+        int code() const noexcept
+        {
+            return m_code;
+        }
+
+        const char *message() const noexcept
+        {
+            return m_category->message(m_code);
+        }
+
+        const std::source_location &where() const noexcept
+        {
+            return m_where;
+        }
+
+        std::size_t context_size() const noexcept
+        {
+            return m_depth;
+        }
+
+        const context_entry &context_at(std::size_t i) const noexcept
+        {
+            return m_context[i];
+        }
+
+        // context entries that did not fit
+        std::uint32_t dropped() const noexcept
+        {
+            return m_dropped;
+        }
+
+        bool is(const category &cat, int code) const noexcept
+        {
+            return m_category == &cat && m_code == code;
+        }
+
+        // the text into 'buf' (always terminated), returns the length it needed, like snprintf()
+        std::size_t format(char *buf, std::size_t size) const noexcept
+        {
+            std::size_t len = 0;
+            auto append = [&](int n)
+            {
+                if (n > 0)
+                {
+                    len += static_cast<std::size_t>(n);
+                }
+            };
+            auto rest = [&]
+            {
+                return len < size ? size - len : 0;
+            };
+            auto at = [&]
+            {
+                return len < size ? buf + len : nullptr;
+            };
+
+            append(std::snprintf(at(), rest(), "%s error %d (%s) at %s:%u in %s", m_category->name, m_code, message(),
+                                 file_name(m_where), m_where.line(), m_where.function_name()));
+            for (std::size_t i = 0; i < m_depth; i++)
+            {
+                auto &c = m_context[i];
+                if (c.has_value)
+                {
+                    append(std::snprintf(at(), rest(), "\n  while %s %lld at %s:%u", c.what, static_cast<long long>(c.value),
+                                         file_name(c.where), c.where.line()));
+                }
+                else
+                {
+                    append(std::snprintf(at(), rest(), "\n  while %s at %s:%u", c.what, file_name(c.where), c.where.line()));
+                }
+            }
+            if (m_dropped != 0)
+            {
+                append(std::snprintf(at(), rest(), "\n  (%u more)", m_dropped));
+            }
+
+            return len;
+        }
+
+        friend std::ostream &operator<<(std::ostream &os, const error &e)
+        {
+            char buf[1024];
+            e.format(buf, sizeof(buf));
+            return os << buf;
+        }
+
+    private:
+        void push(const context_entry &entry) noexcept
+        {
+            if (m_depth < max_context)
+            {
+                m_context[m_depth++] = entry;
+            }
+            else
+            {
+                m_dropped++;
+            }
+        }
+
+        static const char *file_name(const std::source_location &where) noexcept
+        {
+            auto path = where.file_name();
+            auto slash = std::strrchr(path, '/');
+            return slash != nullptr ? slash + 1 : path;
+        }
+
+        const category *m_category;
+        int m_code;
+        std::uint8_t m_depth{0};
+        std::uint32_t m_dropped{0};
+        std::source_location m_where;
+        context_entry m_context[max_context]{};
+    };
+
+    static_assert(std::is_trivially_copyable_v<error>);
+
+    // ---------------------------------------
+    // exception carrying an error
+    // ---------------------------------------
+    class exception : public std::exception
+    {
+    public:
+        explicit exception(const error &e) noexcept : m_error{e}
+        {
+        }
+
+        // the static message of the code, the full text is operator<< of error()
+        const char *what() const noexcept override
+        {
+            return m_error.message();
+        }
+
+        const err::error &error() const noexcept
+        {
+            return m_error;
+        }
+
+        err::error &error() noexcept
+        {
+            return m_error;
+        }
+
+    private:
+        err::error m_error;
+    };
+
+    // what result<T, error>::value() throws
+    [[noreturn]] inline void raise(const error &e)
+    {
+        throw exception{e};
+    }
+}
+
+// the value of 'expr' (unchecked, as in RESULT_TRY), or return its error with the context 'what' (and this line) added
+#define ERROR_TRY(expr, ...)                                                           \
+    ({                                                                                 \
+        auto &&error_try_ = (expr);                                                    \
+        if (!error_try_) [[unlikely]]                                                  \
+        {                                                                              \
+            return ::err::failure{std::move(error_try_).error().context(__VA_ARGS__)}; \
+        }                                                                              \
+        *std::move(error_try_);                                                        \
+    })
+
+#endif // SYSTEM_PROGRAMMING_ERROR_HPP
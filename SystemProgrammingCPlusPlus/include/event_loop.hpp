@@ -0,0 +1,260 @@
+/**
+ * @File    : event_loop.hpp
+ * @Brief   : epoll event loop with signals delivered through a signalfd: graceful drain, SIGHUP, SIGUSR1 without handlers
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Signals as events
+ * A signal handler interrupts the program anywhere: in the middle of a write(), while malloc() holds its lock.
+ * It may only call async-signal-safe functions, in practice it sets a flag that the program checks "soon".
+ * Meanwhile every blocking system call of every thread can fail with EINTR and has to be restarted.
+ *
+ * events::signals blocks a set of signals and reads them from a signalfd instead: a signal becomes a
+ * readable descriptor, handled by ordinary code at a well-defined point of the event loop, which can lock,
+ * allocate, write to the log. Blocked signals interrupt no system call, there is no EINTR on the hot path.
+ * The signal mask is inherited by the threads created afterwards, so the signals object must exist before
+ * any thread (a global defined before the other globals that start threads, or the first thing in main()):
+ * a thread that does not block the signals would receive them with their default action, which terminates.
+ *
+ * events::loop is a small epoll loop: descriptors with a callback each, stop() ends run().
+ * loop::add(signals) registers the signalfd like a socket.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_EVENT_LOOP_HPP
+#define SYSTEM_PROGRAMMING_EVENT_LOOP_HPP
+
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace events
+{
+    // ---------------------------------------
+    // Signals through a signalfd
+    // ---------------------------------------
+    class signals
+    {
+    public:
+        // blocks 'list' in the calling thread and in the threads it creates from now on
+        explicit signals(std::initializer_list<int> list)
+        {
+            sigemptyset(&m_set);
+            for (auto sig : list)
+            {
+                sigaddset(&m_set, sig);
+            }
+            pthread_sigmask(SIG_BLOCK, &m_set, &m_previous);
+
+            m_fd = signalfd(-1, &m_set, SFD_NONBLOCK | SFD_CLOEXEC);
+            if (m_fd < 0)
+            {
+                auto error = errno;
+                pthread_sigmask(SIG_SETMASK, &m_previous, nullptr);
+                throw std::runtime_error(std::string{"signalfd: "} + strerror(error));
+            }
+        }
+
+        signals(const signals &) = delete;
+        signals &operator=(const signals &) = delete;
+
+        ~signals()
+        {
+            ::close(m_fd);
+            pthread_sigmask(SIG_SETMASK, &m_previous, nullptr);
+        }
+
+        // 'handler' runs from dispatch(), in the thread of the loop
+        void on(int sig, std::function<void(const signalfd_siginfo &)> handler)
+        {
+            m_handlers[sig] = std::move(handler);
+        }
+
+        // handles every pending signal, returns how many
+        int dispatch()
+        {
+            auto count = 0;
+            signalfd_siginfo info;
+            while (::read(m_fd, &info, sizeof(info)) == sizeof(info))
+            {
+                count++;
+                if (auto it = m_handlers.find(static_cast<int>(info.ssi_signo)); it != m_handlers.end())
+                {
+                    it->second(info);
+                }
+            }
+
+            return count;
+        }
+
+        int fd() const
+        {
+            return m_fd;
+        }
+
+        // the mask before the signals were blocked, for the children started with exec()
+        const sigset_t &previous_mask() const
+        {
+            return m_previous;
+        }
+
+    private:
+        int m_fd{-1};
+        sigset_t m_set;
+        sigset_t m_previous;
+        std::unordered_map<int, std::function<void(const signalfd_siginfo &)>> m_handlers;
+    };
+
+    // ---------------------------------------
+    // epoll loop
+    // ---------------------------------------
+    class loop
+    {
+    public:
+        using callback = std::function<void(std::uint32_t events)>;
+
+        loop()
+        {
+            m_epoll = epoll_create1(EPOLL_CLOEXEC);
+            if (m_epoll < 0)
+            {
+                throw std::runtime_error(std::string{"epoll_create1: "} + strerror(errno));
+            }
+        }
+
+        loop(const loop &) = delete;
+        loop &operator=(const loop &) = delete;
+
+        ~loop()
+        {
+            ::close(m_epoll);
+        }
+
+        void add(int fd, std::uint32_t events, callback cb)
+        {
+            // the callback lives on the heap: its address is the epoll cookie and survives rehashing
+            auto entry = std::make_unique<callback>(std::move(cb));
+
+            epoll_event event{};
+            event.events = events;
+            event.data.ptr = entry.get();
+            if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) < 0)
+            {
+                throw std::runtime_error(std::string{"epoll_ctl: "} + strerror(errno));
+            }
+
+            m_callbacks[fd] = std::move(entry);
+        }
+
+        void add(signals &sigs)
+        {
+            add(sigs.fd(), EPOLLIN, [&sigs](std::uint32_t)
+                { sigs.dispatch(); });
+        }
+
+        void modify(int fd, std::uint32_t events)
+        {
+            epoll_event event{};
+            event.events = events;
+            event.data.ptr = m_callbacks.at(fd).get();
+            if (epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &event) < 0)
+            {
+                throw std::runtime_error(std::string{"epoll_ctl: "} + strerror(errno));
+            }
+        }
+
+        // before the descriptor is closed; safe from inside a callback, also the running one
+        void remove(int fd)
+        {
+            epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+            if (auto it = m_callbacks.find(fd); it != m_callbacks.end())
+            {
+                m_retired.push_back(std::move(it->second));
+                m_callbacks.erase(it);
+            }
+        }
+
+        std::size_t size() const
+        {
+            return m_callbacks.size();
+        }
+
+        // one epoll_wait(), returns the number of events handled
+        int run_once(int timeout_ms = -1)
+        {
+            epoll_event events[64];
+            auto count = epoll_wait(m_epoll, events, 64, timeout_ms);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    return 0;
+                }
+                throw std::runtime_error(std::string{"epoll_wait: "} + strerror(errno));
+            }
+
+            for (auto i = 0; i < count; i++)
+            {
+                // an earlier callback of this round may have removed this one
+                auto cb = static_cast<callback *>(events[i].data.ptr);
+                if (!is_retired(cb))
+                {
+                    (*cb)(events[i].events);
+                }
+            }
+            m_retired.clear();
+
+            return count;
+        }
+
+        void run()
+        {
+            m_stopped = false;
+            while (!m_stopped)
+            {
+                run_once();
+            }
+        }
+
+        // run() returns after the current round
+        void stop()
+        {
+            m_stopped = true;
+        }
+
+    private:
+        bool is_retired(const callback *cb) const
+        {
+            for (auto &retired : m_retired)
+            {
+                if (retired.get() == cb)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        int m_epoll{-1};
+        bool m_stopped{false};
+        std::unordered_map<int, std::unique_ptr<callback>> m_callbacks;
+        std::vector<std::unique_ptr<callback>> m_retired;
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_EVENT_LOOP_HPP
@@ -0,0 +1,378 @@
+/**
+ * @File    : fast_clock.hpp
+ * @Brief   : Timestamps for hot paths: selectable clock sources, a cached clock read with one load, cached wall-clock prefixes
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp -lpthread
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** What a timestamp costs
+ * std::chrono::system_clock::now() is clock_gettime(CLOCK_REALTIME), which does not enter the kernel:
+ * the kernel maps the vDSO, a small shared object, into every process, with a page of clock data it
+ * updates on every tick, and clock_gettime() reads the TSC and scales it in user space (20ns to 40ns).
+ * That only holds while the kernel clocksource can be read from user space (tsc, kvm-clock): on a
+ * machine with 'hpet' or 'acpi_pm' every call is a real system call again, ten times slower.
+ * Printing the time costs more: localtime() takes a lock and may stat /etc/localtime,
+ * strftime() parses its format, together hundreds of nanoseconds per log line.
+ *
+ * clk::clock reads one of the sources, always as nanoseconds since the UNIX epoch:
+ *
+ * 1. syscall:          clock_gettime(CLOCK_REALTIME) through syscall(2), the cost without the vDSO,
+ * 2. vdso:             clock_gettime(CLOCK_REALTIME), what std::chrono::system_clock uses,
+ * 3. realtime_coarse:  CLOCK_REALTIME_COARSE, the time of the last tick (1ms to 4ms resolution), a few ns,
+ * 4. monotonic_coarse: CLOCK_MONOTONIC_COARSE plus the offset to the wall clock taken at construction,
+ * 5. tsc:              rdtsc scaled by a multiplication and a shift, calibrated against CLOCK_MONOTONIC_RAW,
+ *                      only stable with an invariant TSC (constant_tsc, nonstop_tsc in /proc/cpuinfo),
+ * 6. cached:           the value clk::cached_clock stores, below.
+ *
+ * clk::cached_clock runs one thread that stores the time of a source every 'interval' (1ms) into an
+ * atomic: now() is one load. The timestamps are as old as the interval, which is fine for log lines.
+ *
+ * clk::prefix_formatter turns a timestamp into "2026-10-19 12:34:56.123456" and keeps the text of the
+ * current second: localtime_r() and the formatting of the date run once per second, the other calls
+ * only write the six digits of the microseconds. One formatter per thread, it is not synchronized.
+ *
+ * clk::environment() tells whether the vDSO is mapped, which clocksource the kernel uses and whether
+ * the TSC is invariant.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_FAST_CLOCK_HPP
+#define SYSTEM_PROGRAMMING_FAST_CLOCK_HPP
+
+#include <sys/auxv.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+    #include <x86intrin.h>
+#endif
+
+namespace clk
+{
+    enum class source
+    {
+        syscall,
+        vdso,
+        realtime_coarse,
+        monotonic_coarse,
+        tsc,
+        cached
+    };
+
+    inline const char *name(source s)
+    {
+        switch (s)
+        {
+        case source::syscall:
+            return "syscall";
+        case source::vdso:
+            return "vdso";
+        case source::realtime_coarse:
+            return "realtime_coarse";
+        case source::monotonic_coarse:
+            return "monotonic_coarse";
+        case source::tsc:
+            return "tsc";
+        case source::cached:
+            return "cached";
+        }
+        return "unknown";
+    }
+
+    // ---------------------------------------
+    // What the machine offers
+    // ---------------------------------------
+    struct clock_environment
+    {
+        bool vdso;                    // the kernel mapped a vDSO
+        std::string clocksource;      // tsc, kvm-clock, hpet, ... the vDSO needs tsc or a paravirtual clock
+        bool invariant_tsc;           // the TSC ticks at a constant rate in every P-state and C-state
+        std::int64_t coarse_resolution_ns;
+    };
+
+    inline bool tsc_invariant()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned eax, ebx, ecx, edx;
+        if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) != 0)
+        {
+            return (edx & (1u << 8)) != 0;
+        }
+#endif
+        return false;
+    }
+
+    inline clock_environment environment()
+    {
+        clock_environment env{};
+        env.vdso = getauxval(AT_SYSINFO_EHDR) != 0;
+
+        std::ifstream file{"/sys/devices/system/clocksource/clocksource0/current_clocksource"};
+        if (!std::getline(file, env.clocksource))
+        {
+            env.clocksource = "unknown";
+        }
+
+        env.invariant_tsc = tsc_invariant();
+
+        timespec res{};
+        clock_getres(CLOCK_REALTIME_COARSE, &res);
+        env.coarse_resolution_ns = res.tv_sec * 1000000000 + res.tv_nsec;
+        return env;
+    }
+
+    // ---------------------------------------
+    // Reading the sources
+    // ---------------------------------------
+    namespace detail
+    {
+        inline std::int64_t to_ns(const timespec &ts)
+        {
+            return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+
+        inline std::int64_t read(clockid_t id)
+        {
+            timespec ts;
+            ::clock_gettime(id, &ts);
+            return to_ns(ts);
+        }
+
+        inline std::int64_t read_syscall(clockid_t id)
+        {
+            timespec ts;
+            ::syscall(SYS_clock_gettime, id, &ts);
+            return to_ns(ts);
+        }
+
+        inline std::uint64_t ticks()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return static_cast<std::uint64_t>(read(CLOCK_MONOTONIC));
+#endif
+        }
+    }
+
+    // rdtsc to nanoseconds: ns = base + (ticks - ticks0) * mult >> 32, like the kernel's clocksource
+    class tsc_clock
+    {
+    public:
+        explicit tsc_clock(std::chrono::milliseconds calibration = std::chrono::milliseconds(20))
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            auto ns0 = detail::read(CLOCK_MONOTONIC_RAW);
+            auto ticks0 = detail::ticks();
+            std::this_thread::sleep_for(calibration);
+            auto ns1 = detail::read(CLOCK_MONOTONIC_RAW);
+            auto ticks1 = detail::ticks();
+
+            auto ns_per_tick = static_cast<double>(ns1 - ns0) / static_cast<double>(ticks1 - ticks0);
+            m_mult = static_cast<std::uint64_t>(ns_per_tick * 4294967296.0);
+#else
+            m_mult = std::uint64_t{1} << 32;
+#endif
+            // the epoch as close to the ticks as possible
+            m_ticks0 = detail::ticks();
+            m_base_ns = detail::read(CLOCK_REALTIME);
+        }
+
+        std::int64_t now() const
+        {
+            auto delta = static_cast<unsigned __int128>(detail::ticks() - m_ticks0) * m_mult;
+            return m_base_ns + static_cast<std::int64_t>(delta >> 32);
+        }
+
+        // ticks per microsecond, for the record
+        double mhz() const
+        {
+            return 4294967296.0 / static_cast<double>(m_mult) * 1000.0;
+        }
+
+    private:
+        std::uint64_t m_ticks0{};
+        std::uint64_t m_mult{};
+        std::int64_t m_base_ns{};
+    };
+
+    // ---------------------------------------
+    // Cached clock: one thread writes, everybody loads
+    // ---------------------------------------
+    class cached_clock
+    {
+    public:
+        explicit cached_clock(std::chrono::microseconds interval = std::chrono::milliseconds(1), source from = source::realtime_coarse)
+            : m_from{from == source::cached ? source::vdso : from}, m_interval{interval}
+        {
+            if (m_from == source::monotonic_coarse)
+            {
+                m_offset = detail::read(CLOCK_REALTIME) - detail::read(CLOCK_MONOTONIC);
+            }
+            m_now.store(read(), std::memory_order_relaxed);
+            m_thread = std::thread{[this]
+                                   { update(); }};
+        }
+
+        cached_clock(const cached_clock &) = delete;
+        cached_clock &operator=(const cached_clock &) = delete;
+
+        ~cached_clock()
+        {
+            m_stop.store(true, std::memory_order_relaxed);
+            m_thread.join();
+        }
+
+        // nanoseconds since the epoch, at most 'interval' old
+        std::int64_t now() const
+        {
+            return m_now.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::int64_t read()
+        {
+            switch (m_from)
+            {
+            case source::syscall:
+                return detail::read_syscall(CLOCK_REALTIME);
+            case source::realtime_coarse:
+                return detail::read(CLOCK_REALTIME_COARSE);
+            case source::monotonic_coarse:
+                return detail::read(CLOCK_MONOTONIC_COARSE) + m_offset;
+            default:
+                return detail::read(CLOCK_REALTIME);
+            }
+        }
+
+        void update()
+        {
+            while (!m_stop.load(std::memory_order_relaxed))
+            {
+                m_now.store(read(), std::memory_order_relaxed);
+                std::this_thread::sleep_for(m_interval);
+            }
+        }
+
+        source m_from;
+        std::chrono::microseconds m_interval;
+        std::int64_t m_offset{0};
+        // alone on its cache line: the readers share it, the writer touches it once per interval
+        alignas(64) std::atomic<std::int64_t> m_now{0};
+        std::atomic<bool> m_stop{false};
+        std::thread m_thread;
+    };
+
+    // ---------------------------------------
+    // One clock, any source
+    // ---------------------------------------
+    class clock
+    {
+    public:
+        // 'cached' needs the cached_clock to read
+        explicit clock(source s, const cached_clock *cache = nullptr) : m_source{s}, m_cache{cache}
+        {
+            if (s == source::monotonic_coarse)
+            {
+                m_offset = detail::read(CLOCK_REALTIME) - detail::read(CLOCK_MONOTONIC);
+            }
+            else if (s == source::tsc)
+            {
+                m_tsc.emplace();
+            }
+            else if (s == source::cached && cache == nullptr)
+            {
+                m_source = source::vdso;
+            }
+        }
+
+        // nanoseconds since the UNIX epoch
+        std::int64_t now() const
+        {
+            switch (m_source)
+            {
+            case source::syscall:
+                return detail::read_syscall(CLOCK_REALTIME);
+            case source::vdso:
+                return detail::read(CLOCK_REALTIME);
+            case source::realtime_coarse:
+                return detail::read(CLOCK_REALTIME_COARSE);
+            case source::monotonic_coarse:
+                return detail::read(CLOCK_MONOTONIC_COARSE) + m_offset;
+            case source::tsc:
+                return m_tsc->now();
+            case source::cached:
+                return m_cache->now();
+            }
+            return 0;
+        }
+
+        source from() const
+        {
+            return m_source;
+        }
+
+    private:
+        source m_source;
+        const cached_clock *m_cache;
+        std::int64_t m_offset{0};
+        std::optional<tsc_clock> m_tsc;
+    };
+
+    // ---------------------------------------
+    // "YYYY-MM-DD HH:MM:SS.uuuuuu", the date of the current second cached
+    // ---------------------------------------
+    class prefix_formatter
+    {
+    public:
+        static constexpr std::size_t size = 26;
+
+        // writes 'size' characters (not terminated) to 'out', local time
+        void format(std::int64_t ns, char *out)
+        {
+            auto seconds = ns / 1000000000;
+            auto us = static_cast<unsigned>((ns % 1000000000) / 1000);
+            if (seconds != m_second)
+            {
+                // once per second: the time zone rules, the calendar, the text
+                auto t = static_cast<time_t>(seconds);
+                tm local;
+                localtime_r(&t, &local);
+                std::strftime(m_text, sizeof(m_text), "%Y-%m-%d %H:%M:%S.", &local);
+                m_second = seconds;
+            }
+
+            std::memcpy(out, m_text, 20);
+            for (auto i = 25; i >= 20; i--)
+            {
+                out[i] = static_cast<char>('0' + us % 10);
+                us /= 10;
+            }
+        }
+
+        std::string format(std::int64_t ns)
+        {
+            std::string text(size, '\0');
+            format(ns, text.data());
+            return text;
+        }
+
+    private:
+        std::int64_t m_second{-1};
+        char m_text[24]{};
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_FAST_CLOCK_HPP
@@ -0,0 +1,844 @@
+/**
+ * @File    : fast_format.hpp
+ * @Brief   : Locale-free number formatting and parsing into caller buffers, with compile-time format strings
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Formatting without iostreams
+ * Every operator<< of a std::ostream goes through a sentry, the locale's num_put facet and
+ * the formatting flags of the stream, and manipulators such as std::hex or std::setfill
+ * change that state until they are reset (hence cout_transaction() in performance_stream.cpp).
+ * printf() parses its format string at run time, on every call.
+ *
+ * fastfmt writes into a buffer owned by the caller and returns std::to_chars_result,
+ * like std::to_chars(): the end of the output, or std::errc::value_too_large when it does not fit.
+ * - integers: the number of digits is known first (bit width * 1233 >> 12), so the padding, the sign
+ *   and the digits are written in place, the digits two at a time from a 200-byte table of the pairs "00".."99",
+ * - hexadecimal: two digits per lookup in a table of the 256 byte values, octal and binary one per digit,
+ * - floating point: std::to_chars(), the shortest representation that reads back to the same value,
+ *   or a fixed/scientific/general precision,
+ * - pointers as 0x..., strings, characters and bools.
+ *
+ * A fastfmt::spec holds what the manipulators set, and it is passed per value instead of stored in a stream:
+ *   fill and alignment ('<' left, '>' right, '^' center, '=' after the sign and the base prefix, i.e. std::internal),
+ *   sign ('+', ' '), '#' for the base prefix, width, precision and type (d x X o b c e f g p s);
+ *   inf and nan are never zero-padded, '=' pads them on the left like '>'.
+ * fastfmt::hex is the spec of usr::hex: 0x and 16 zero-padded digits.
+ *
+ * The format strings use the syntax of std::format: "{}", "{:#018x}", "{1:>8.3f}", "{{" and "}}".
+ * fastfmt::format_to<"...">() takes the format string as a template argument: it is parsed
+ * once at compile time, a malformed string or a wrong number of arguments is a compile error,
+ * and what remains at run time is one call per value with a constant spec.
+ *
+ * fastfmt::parse() and try_parse() read numbers with std::from_chars(), which ignores the locale,
+ * does not skip white space and reports where it stopped.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_FAST_FORMAT_HPP
+#define SYSTEM_PROGRAMMING_FAST_FORMAT_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace fastfmt
+{
+    // ---------------------------------------
+    // Format specification
+    // ---------------------------------------
+    struct spec
+    {
+        char fill{' '};
+        char align{};     // '<', '>', '^', '=' or 0 for the default of the type
+        char sign{'-'};   // '-' negative numbers only, '+' always, ' ' a space for positive numbers
+        bool alt{};       // '#': 0x, 0X, 0b or 0 in front of the digits
+        int width{};
+        int precision{-1};
+        char type{};      // 0 for the default of the type
+
+        constexpr bool operator==(const spec &) const = default;
+    };
+
+    // the equivalent of usr::hex: std::hex << std::showbase << std::internal << std::setfill('0') << std::setw(18)
+    inline constexpr spec hex{'0', '=', '-', true, 18, -1, 'x'};
+
+    namespace detail
+    {
+        constexpr auto make_digit_pairs()
+        {
+            std::array<char, 200> pairs{};
+            for (auto i = 0; i < 100; i++)
+            {
+                pairs[2 * i] = static_cast<char>('0' + i / 10);
+                pairs[2 * i + 1] = static_cast<char>('0' + i % 10);
+            }
+
+            return pairs;
+        }
+
+        constexpr auto make_powers_of_10()
+        {
+            std::array<std::uint64_t, 20> powers{};
+            powers[0] = 1;
+            for (std::size_t i = 1; i < powers.size(); i++)
+            {
+                powers[i] = powers[i - 1] * 10;
+            }
+
+            return powers;
+        }
+
+        inline constexpr auto digit_pairs = make_digit_pairs();
+        inline constexpr auto powers_of_10 = make_powers_of_10();
+        inline constexpr char lower_digits[] = "0123456789abcdef";
+        inline constexpr char upper_digits[] = "0123456789ABCDEF";
+
+        // log10 from log2: bit_width * 1233 / 4096 is at most one too small
+        inline int count_digits(std::uint64_t value)
+        {
+            auto guess = (static_cast<int>(std::bit_width(value | 1)) * 1233) >> 12;
+            return guess + ((value | 1) >= powers_of_10[guess]);
+        }
+
+        constexpr auto make_hex_pairs(const char *digits)
+        {
+            std::array<char, 512> pairs{};
+            for (auto i = 0; i < 256; i++)
+            {
+                pairs[2 * i] = digits[i >> 4];
+                pairs[2 * i + 1] = digits[i & 15];
+            }
+
+            return pairs;
+        }
+
+        inline constexpr auto lower_hex_pairs = make_hex_pairs(lower_digits);
+        inline constexpr auto upper_hex_pairs = make_hex_pairs(upper_digits);
+
+        // the digits end at 'end' and are written backwards, two per step
+        inline void write_decimal(char *end, std::uint64_t value)
+        {
+            while (value >= 100)
+            {
+                auto pair = value % 100;
+                value /= 100;
+                end -= 2;
+                std::memcpy(end, &digit_pairs[2 * pair], 2);
+            }
+
+            if (value >= 10)
+            {
+                std::memcpy(end - 2, &digit_pairs[2 * value], 2);
+            }
+            else
+            {
+                end[-1] = static_cast<char>('0' + value);
+            }
+        }
+
+        inline void write_hex(char *end, std::uint64_t value, int count, const std::array<char, 512> &pairs)
+        {
+            for (; count >= 2; count -= 2)
+            {
+                end -= 2;
+                std::memcpy(end, &pairs[2 * (value & 0xFF)], 2);
+                value >>= 8;
+            }
+
+            if (count != 0)
+            {
+                end[-1] = pairs[2 * (value & 0xF) + 1];
+            }
+        }
+
+        // bases 2 and 8: 'bits' bits per digit
+        inline void write_power_of_2(char *end, std::uint64_t value, int count, int bits)
+        {
+            auto mask = (1U << bits) - 1;
+            while (count-- != 0)
+            {
+                *--end = lower_digits[value & mask];
+                value >>= bits;
+            }
+        }
+
+        inline int count_power_of_2_digits(std::uint64_t value, int bits)
+        {
+            return (static_cast<int>(std::bit_width(value | 1)) + bits - 1) / bits;
+        }
+
+        inline std::to_chars_result too_large(char *last)
+        {
+            return {last, std::errc::value_too_large};
+        }
+
+        // writes 'body' (of which the first 'prefix' bytes are the sign and base prefix) padded to the width of the spec
+        inline std::to_chars_result pad(char *first, char *last, const char *body, std::size_t size, std::size_t prefix,
+                                        const spec &s, char default_align)
+        {
+            auto width = static_cast<std::size_t>(std::max(s.width, 0));
+            auto total = std::max(width, size);
+            if (static_cast<std::size_t>(last - first) < total)
+            {
+                return too_large(last);
+            }
+
+            auto fill = total - size;
+            auto align = s.align != 0 ? s.align : default_align;
+            std::size_t before = align == '<' ? 0 : align == '^' ? fill / 2 : fill;
+
+            if (align == '=')
+            {
+                std::memcpy(first, body, prefix);
+                std::memset(first + prefix, s.fill, fill);
+                std::memcpy(first + prefix + fill, body + prefix, size - prefix);
+            }
+            else
+            {
+                std::memset(first, s.fill, before);
+                std::memcpy(first + before, body, size);
+                std::memset(first + before + size, s.fill, fill - before);
+            }
+
+            return {first + total, std::errc{}};
+        }
+
+        // ---------------------------------------
+        // Integers
+        // ---------------------------------------
+
+        // the length is known before the first digit is written, so everything is written in place:
+        // [fill] sign prefix [zero fill for '='] digits [fill]
+        template <typename T>
+        std::to_chars_result write_integer(char *first, char *last, T value, const spec &s)
+        {
+            using U = std::make_unsigned_t<T>;
+
+            if (s.type == 'c')
+            {
+                auto c = static_cast<char>(value);
+                return pad(first, last, &c, 1, 0, s, '<');
+            }
+
+            auto magnitude = static_cast<std::uint64_t>(static_cast<U>(value));
+            char prefix[3];
+            std::size_t prefix_size = 0;
+            if constexpr (std::is_signed_v<T>)
+            {
+                if (value < 0)
+                {
+                    prefix[prefix_size++] = '-';
+                    magnitude = static_cast<std::uint64_t>(static_cast<U>(U{0} - static_cast<U>(value)));
+                }
+            }
+
+            if (prefix_size == 0 && s.sign != '-')
+            {
+                prefix[prefix_size++] = s.sign;
+            }
+
+            int digits;
+            switch (s.type)
+            {
+            case 'x':
+            case 'X':
+            case 'b':
+            case 'B':
+                if (s.alt)
+                {
+                    prefix[prefix_size++] = '0';
+                    prefix[prefix_size++] = s.type;
+                }
+                digits = count_power_of_2_digits(magnitude, s.type == 'x' || s.type == 'X' ? 4 : 1);
+                break;
+            case 'o':
+                if (s.alt && magnitude != 0)
+                {
+                    prefix[prefix_size++] = '0';
+                }
+                digits = count_power_of_2_digits(magnitude, 3);
+                break;
+            default:
+                digits = count_digits(magnitude);
+                break;
+            }
+
+            auto size = prefix_size + static_cast<std::size_t>(digits);
+            auto total = std::max(static_cast<std::size_t>(std::max(s.width, 0)), size);
+            if (static_cast<std::size_t>(last - first) < total)
+            {
+                return too_large(last);
+            }
+
+            auto fill = total - size;
+            auto align = s.align != 0 ? s.align : '>';
+            std::size_t before = align == '=' || align == '<' ? 0 : align == '^' ? fill / 2 : fill;
+            std::size_t inside = align == '=' ? fill : 0;
+
+            // short, mostly empty runs: plain loops instead of calls to memset() and memcpy()
+            auto ptr = first;
+            for (std::size_t i = 0; i < before; i++)
+            {
+                *ptr++ = s.fill;
+            }
+            for (std::size_t i = 0; i < prefix_size; i++)
+            {
+                *ptr++ = prefix[i];
+            }
+            for (std::size_t i = 0; i < inside; i++)
+            {
+                *ptr++ = s.fill;
+            }
+            ptr += digits;
+
+            switch (s.type)
+            {
+            case 'x':
+                write_hex(ptr, magnitude, digits, lower_hex_pairs);
+                break;
+            case 'X':
+                write_hex(ptr, magnitude, digits, upper_hex_pairs);
+                break;
+            case 'o':
+                write_power_of_2(ptr, magnitude, digits, 3);
+                break;
+            case 'b':
+            case 'B':
+                write_power_of_2(ptr, magnitude, digits, 1);
+                break;
+            default:
+                write_decimal(ptr, magnitude);
+                break;
+            }
+
+            for (std::size_t i = before + inside; i < fill; i++)
+            {
+                *ptr++ = s.fill;
+            }
+
+            return {first + total, std::errc{}};
+        }
+
+        // ---------------------------------------
+        // Floating point
+        // ---------------------------------------
+        template <typename T>
+        std::size_t float_room(const spec &s)
+        {
+            // shortest: at most 24 characters for a double; fixed notation may need all the digits of the exponent
+            auto precision = static_cast<std::size_t>(std::max(s.precision, 0));
+            auto fixed = s.type == 'f' || s.type == 'F';
+            return 8 + precision + (fixed ? std::numeric_limits<T>::max_exponent10 + 2 : 32);
+        }
+
+        template <typename T>
+        char *float_body(char *out, char *end, T value, const spec &s, std::size_t &prefix)
+        {
+            auto ptr = out;
+            if (!std::signbit(value) && s.sign != '-')
+            {
+                *ptr++ = s.sign;
+            }
+
+            std::to_chars_result result;
+            switch (s.type)
+            {
+            case 'e':
+            case 'E':
+                result = std::to_chars(ptr, end, value, std::chars_format::scientific, s.precision < 0 ? 6 : s.precision);
+                break;
+            case 'f':
+            case 'F':
+                result = std::to_chars(ptr, end, value, std::chars_format::fixed, s.precision < 0 ? 6 : s.precision);
+                break;
+            case 'g':
+            case 'G':
+                result = std::to_chars(ptr, end, value, std::chars_format::general, s.precision < 0 ? 6 : s.precision);
+                break;
+            default:
+                result = s.precision < 0 ? std::to_chars(ptr, end, value)
+                                         : std::to_chars(ptr, end, value, std::chars_format::general, s.precision);
+                break;
+            }
+
+            if (s.type == 'E' || s.type == 'F' || s.type == 'G')
+            {
+                std::transform(ptr, result.ptr, ptr, [](char c)
+                               { return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c; });
+            }
+
+            prefix = (out[0] == '-' || out[0] == '+' || out[0] == ' ') ? 1 : 0;
+            return result.ptr;
+        }
+
+        template <typename T>
+        std::to_chars_result write_float(char *first, char *last, T value, const spec &s)
+        {
+            // the default spec is std::to_chars() itself
+            if (s.type == 0 && s.precision < 0 && s.width == 0 && s.sign == '-')
+            {
+                return std::to_chars(first, last, value);
+            }
+
+            std::size_t prefix;
+            auto room = float_room<T>(s);
+            if (s.width == 0 && static_cast<std::size_t>(last - first) >= room)
+            {
+                return {float_body(first, last, value, s, prefix), std::errc{}};
+            }
+
+            // a long fixed-point number into a short buffer: the rare case that allocates
+            char stack[512];
+            std::vector<char> heap(room > sizeof(stack) ? room : 0);
+            auto body = heap.empty() ? stack : heap.data();
+
+            auto end = float_body(body, body + room, value, s, prefix);
+            if (!std::isfinite(value) && s.align == '=')
+            {
+                // like std::format: no zero padding for inf and nan, "    -inf" instead of "-0000inf"
+                auto plain = s;
+                plain.align = '>';
+                plain.fill = s.fill == '0' ? ' ' : s.fill;
+                return pad(first, last, body, static_cast<std::size_t>(end - body), prefix, plain, '>');
+            }
+            return pad(first, last, body, static_cast<std::size_t>(end - body), prefix, s, '>');
+        }
+
+        // ---------------------------------------
+        // Strings and pointers
+        // ---------------------------------------
+        inline std::to_chars_result write_string(char *first, char *last, std::string_view str, const spec &s)
+        {
+            if (s.precision >= 0)
+            {
+                str = str.substr(0, static_cast<std::size_t>(s.precision));
+            }
+
+            return pad(first, last, str.data(), str.size(), 0, s, '<');
+        }
+
+        inline std::to_chars_result write_pointer(char *first, char *last, const void *ptr, spec s)
+        {
+            if (s.type == 0 || s.type == 'p')
+            {
+                s.type = 'x';
+                s.alt = true;
+            }
+
+            return write_integer(first, last, reinterpret_cast<std::uintptr_t>(ptr), s);
+        }
+    }
+
+    // formats one value into [first, last)
+    template <typename T>
+    std::to_chars_result write(char *first, char *last, const T &value, const spec &s = {})
+    {
+        using V = std::decay_t<T>;
+
+        if constexpr (std::is_same_v<V, char *> || std::is_same_v<V, const char *>)
+        {
+            return detail::write_string(first, last, std::string_view{value}, s);
+        }
+        else if constexpr (std::is_convertible_v<const T &, std::string_view>)
+        {
+            return detail::write_string(first, last, std::string_view{value}, s);
+        }
+        else if constexpr (std::is_same_v<V, bool>)
+        {
+            if (s.type != 0 && s.type != 's')
+            {
+                return detail::write_integer(first, last, static_cast<unsigned>(value), s);
+            }
+            return detail::write_string(first, last, value ? "true" : "false", s);
+        }
+        else if constexpr (std::is_same_v<V, char>)
+        {
+            if (s.type != 0 && s.type != 'c')
+            {
+                return detail::write_integer(first, last, static_cast<int>(value), s);
+            }
+            return detail::write_string(first, last, std::string_view{&value, 1}, s);
+        }
+        else if constexpr (std::is_integral_v<V>)
+        {
+            return detail::write_integer(first, last, value, s);
+        }
+        else if constexpr (std::is_enum_v<V>)
+        {
+            return detail::write_integer(first, last, static_cast<std::underlying_type_t<V>>(value), s);
+        }
+        else if constexpr (std::is_floating_point_v<V>)
+        {
+            return detail::write_float(first, last, value, s);
+        }
+        else if constexpr (std::is_pointer_v<V> || std::is_null_pointer_v<V>)
+        {
+            return detail::write_pointer(first, last, static_cast<const void *>(value), s);
+        }
+        else
+        {
+            static_assert(std::is_void_v<T>, "fastfmt: no formatter for this type");
+        }
+    }
+
+    // ---------------------------------------
+    // Compile-time format strings
+    // ---------------------------------------
+    template <std::size_t N>
+    struct fixed_string
+    {
+        char data[N]{};
+
+        constexpr fixed_string(const char (&str)[N])
+        {
+            std::copy_n(str, N, data);
+        }
+
+        constexpr std::size_t size() const
+        {
+            return N - 1;
+        }
+    };
+
+    namespace detail
+    {
+        // not constexpr: reaching it while a format string is compiled stops the compilation with this message
+        inline void invalid_format_string(const char *)
+        {
+        }
+
+        struct piece
+        {
+            bool literal{};
+            std::size_t offset{};
+            std::size_t length{};
+            std::size_t arg{};
+            spec fmt{};
+        };
+
+        template <std::size_t N>
+        struct compiled_format
+        {
+            std::array<piece, N> pieces{};
+            std::size_t count{};
+            std::size_t args{};
+        };
+
+        constexpr bool is_digit(char c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        constexpr int parse_number(const char *str, std::size_t &pos, std::size_t size)
+        {
+            int value = 0;
+            while (pos < size && is_digit(str[pos]))
+            {
+                value = value * 10 + (str[pos++] - '0');
+                if (value > 100000)
+                {
+                    invalid_format_string("number too large in format spec");
+                }
+            }
+
+            return value;
+        }
+
+        constexpr bool is_align(char c)
+        {
+            return c == '<' || c == '>' || c == '^' || c == '=';
+        }
+
+        // [[fill]align][sign][#][0][width][.precision][type], up to the closing '}'
+        constexpr spec parse_spec(const char *str, std::size_t &pos, std::size_t size)
+        {
+            spec s;
+            if (pos + 1 < size && str[pos] != '}' && is_align(str[pos + 1]))
+            {
+                s.fill = str[pos];
+                s.align = str[pos + 1];
+                pos += 2;
+            }
+            else if (pos < size && is_align(str[pos]))
+            {
+                s.align = str[pos++];
+            }
+
+            if (pos < size && (str[pos] == '+' || str[pos] == '-' || str[pos] == ' '))
+            {
+                s.sign = str[pos++];
+            }
+
+            if (pos < size && str[pos] == '#')
+            {
+                s.alt = true;
+                pos++;
+            }
+
+            if (pos < size && str[pos] == '0')
+            {
+                if (s.align == 0)
+                {
+                    s.fill = '0';
+                    s.align = '=';
+                }
+                pos++;
+            }
+
+            s.width = parse_number(str, pos, size);
+
+            if (pos < size && str[pos] == '.')
+            {
+                pos++;
+                if (pos == size || !is_digit(str[pos]))
+                {
+                    invalid_format_string("missing precision after '.'");
+                }
+                s.precision = parse_number(str, pos, size);
+            }
+
+            if (pos < size && str[pos] != '}')
+            {
+                constexpr std::string_view types = "bBcdeEfFgGopsxX";
+                if (types.find(str[pos]) == std::string_view::npos)
+                {
+                    invalid_format_string("unknown format type");
+                }
+                s.type = str[pos++];
+            }
+
+            return s;
+        }
+
+        template <fixed_string S>
+        consteval auto compile()
+        {
+            compiled_format<S.size() + 1> c;
+            const char *str = S.data;
+            constexpr auto size = S.size();
+
+            std::size_t pos = 0;
+            std::size_t literal_start = 0;
+            std::size_t next_arg = 0;
+            bool automatic = false;
+            bool manual = false;
+
+            auto add_literal = [&](std::size_t end)
+            {
+                if (end > literal_start)
+                {
+                    c.pieces[c.count++] = piece{true, literal_start, end - literal_start, 0, spec{}};
+                }
+            };
+
+            while (pos < size)
+            {
+                if (str[pos] == '{' && pos + 1 < size && str[pos + 1] == '{')
+                {
+                    // "{{" is a literal '{': the first one ends the literal, the second one is skipped
+                    add_literal(pos + 1);
+                    pos += 2;
+                    literal_start = pos;
+                }
+                else if (str[pos] == '}' && pos + 1 < size && str[pos + 1] == '}')
+                {
+                    add_literal(pos + 1);
+                    pos += 2;
+                    literal_start = pos;
+                }
+                else if (str[pos] == '}')
+                {
+                    invalid_format_string("unmatched '}' in format string");
+                }
+                else if (str[pos] == '{')
+                {
+                    add_literal(pos);
+                    pos++;
+
+                    piece p;
+                    if (pos < size && is_digit(str[pos]))
+                    {
+                        p.arg = static_cast<std::size_t>(parse_number(str, pos, size));
+                        manual = true;
+                    }
+                    else
+                    {
+                        p.arg = next_arg++;
+                        automatic = true;
+                    }
+
+                    if (pos < size && str[pos] == ':')
+                    {
+                        pos++;
+                        p.fmt = parse_spec(str, pos, size);
+                    }
+
+                    if (pos == size || str[pos] != '}')
+                    {
+                        invalid_format_string("expected '}' in format string");
+                    }
+
+                    pos++;
+                    c.pieces[c.count++] = p;
+                    c.args = std::max(c.args, p.arg + 1);
+                    literal_start = pos;
+                }
+                else
+                {
+                    pos++;
+                }
+            }
+
+            add_literal(size);
+
+            if (automatic && manual)
+            {
+                invalid_format_string("cannot mix automatic and manual argument indexing");
+            }
+
+            return c;
+        }
+
+        template <fixed_string S>
+        inline constexpr auto compiled = compile<S>();
+
+        template <fixed_string S, std::size_t I, typename TUPLE>
+        std::to_chars_result write_pieces(char *first, char *last, const TUPLE &args)
+        {
+            constexpr auto &c = compiled<S>;
+            if constexpr (I == c.count)
+            {
+                return {first, std::errc{}};
+            }
+            else
+            {
+                constexpr piece p = c.pieces[I];
+                if constexpr (p.literal)
+                {
+                    if (static_cast<std::size_t>(last - first) < p.length)
+                    {
+                        return too_large(last);
+                    }
+
+                    std::memcpy(first, S.data + p.offset, p.length);
+                    first += p.length;
+                }
+                else
+                {
+                    auto result = write(first, last, std::get<p.arg>(args), p.fmt);
+                    if (result.ec != std::errc{})
+                    {
+                        return result;
+                    }
+                    first = result.ptr;
+                }
+
+                return write_pieces<S, I + 1>(first, last, args);
+            }
+        }
+    }
+
+    // formats the arguments into [first, last) following the format string S
+    template <fixed_string S, typename... ARGS>
+    std::to_chars_result format_to(char *first, char *last, const ARGS &...args)
+    {
+        static_assert(detail::compiled<S>.args == sizeof...(ARGS), "fastfmt: the number of arguments does not match the format string");
+
+        return detail::write_pieces<S, 0>(first, last, std::forward_as_tuple(args...));
+    }
+
+    template <fixed_string S, typename... ARGS>
+    std::string format(const ARGS &...args)
+    {
+        char stack[256];
+        auto result = format_to<S>(stack, stack + sizeof(stack), args...);
+        if (result.ec == std::errc{})
+        {
+            return std::string(stack, result.ptr);
+        }
+
+        // long output: grow until it fits
+        std::string out(4 * sizeof(stack), '\0');
+        while ((result = format_to<S>(out.data(), out.data() + out.size(), args...)).ec != std::errc{})
+        {
+            out.resize(out.size() * 2);
+        }
+        out.resize(static_cast<std::size_t>(result.ptr - out.data()));
+
+        return out;
+    }
+
+    template <fixed_string S, typename... ARGS>
+    void print(std::FILE *file, const ARGS &...args)
+    {
+        char stack[1024];
+        auto result = format_to<S>(stack, stack + sizeof(stack), args...);
+        if (result.ec == std::errc{})
+        {
+            std::fwrite(stack, 1, static_cast<std::size_t>(result.ptr - stack), file);
+            return;
+        }
+
+        auto out = format<S>(args...);
+        std::fwrite(out.data(), 1, out.size(), file);
+    }
+
+    // ---------------------------------------
+    // Parsing
+    // ---------------------------------------
+
+    // the whole text must be the number; base 16 accepts a 0x prefix
+    template <typename T>
+    bool try_parse(std::string_view text, T &value, int base = 10)
+    {
+        auto first = text.data();
+        auto last = text.data() + text.size();
+
+        std::from_chars_result result;
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            result = std::from_chars(first, last, value);
+        }
+        else
+        {
+            if (base == 16 && text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
+            {
+                first += 2;
+            }
+            result = std::from_chars(first, last, value, base);
+        }
+
+        return result.ec == std::errc{} && result.ptr == last;
+    }
+
+    template <typename T>
+    T parse(std::string_view text, int base = 10)
+    {
+        T value{};
+        if (!try_parse(text, value, base))
+        {
+            throw std::runtime_error("fastfmt: not a number: '" + std::string{text} + "'");
+        }
+
+        return value;
+    }
+}
+
+#endif // SYSTEM_PROGRAMMING_FAST_FORMAT_HPP
@@ -0,0 +1,858 @@
+/**
+ * @File    : file_copier.hpp
+ * @Brief   : Bulk tree copy: FICLONE reflinks, copy_file_range(), sparse files, parallel extents, XXH3 deduplication
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp -lpthread
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Copying large trees
+ * std::filesystem::copy() copies one file after the other, and every file is copied in full,
+ * even when the same content already was copied under another name.
+ *
+ * copier::bulk copies a tree in phases, every phase runs on a pool of threads:
+ * 1. the source tree is walked with walk::walker (dir_walker.hpp), directories and symbolic links
+ *    are created first,
+ * 2. deduplication: only files of the same size can be identical, so only the groups of files
+ *    with equal sizes are hashed (XXH3, xxh3.hpp): the first 64KB first, which separates most
+ *    files that only happen to have the same size, then the whole mapped file, then the bytes are compared.
+ *    A file with the content of another one becomes a duplicate of it,
+ * 3. every other file is first cloned with the FICLONE ioctl: on Btrfs, XFS and other file systems
+ *    with reflinks the copy shares the extents of the source and costs no data transfer at all.
+ *    Otherwise the data is copied with copy_file_range(), inside the kernel without a user-space buffer
+ *    (and offloaded to the server on NFS 4.2 and SMB). Files larger than 'extent_size' are split
+ *    into extents that are copied in parallel,
+ * 4. a sparse file (fewer allocated blocks than its size) is copied extent by extent with
+ *    lseek(SEEK_DATA) and lseek(SEEK_HOLE), the holes stay holes in the copy,
+ * 5. duplicates are cloned from the copy of their original (FICLONE), hard linked to it
+ *    (options::hardlink_duplicates), or copied from it when neither is possible.
+ *    Only the first two save the data transfer: without reflinks, and without hardlink_duplicates,
+ *    a duplicate is still copied in full (from the copy of its original, which is in the page cache),
+ *    deduplication then only saves reading the source twice.
+ *
+ * Copies get the permission bits and (with preserve_times) the modification time of their source.
+ * When copy_file_range() is not supported between the two file systems, a pread()/pwrite() loop is used.
+ * An error aborts the copy with a std::runtime_error naming the file, including the errors of the walk:
+ * a directory that cannot be read or a file that cannot be examined, never a partial copy.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_FILE_COPIER_HPP
+#define SYSTEM_PROGRAMMING_FILE_COPIER_HPP
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "dir_walker.hpp"
+#include "xxh3.hpp"
+
+namespace copier
+{
+    struct options
+    {
+        // number of threads of every phase, 0 for std::thread::hardware_concurrency()
+        unsigned threads{0};
+
+        // files larger than this are copied in extents of this size, in parallel
+        std::uint64_t extent_size{64 << 20};
+
+        // try the FICLONE reflink before copying data
+        bool reflink{true};
+
+        // copy the content of identical files only once: with reflinks or hardlink_duplicates,
+        // otherwise the duplicates are copied from the first copy
+        bool dedup{true};
+
+        // files smaller than this are not worth hashing
+        std::uint64_t dedup_min_size{4096};
+
+        // compare the bytes of files with equal hashes before treating them as duplicates
+        bool verify{true};
+
+        // a duplicate that cannot be cloned becomes a hard link of the first copy instead of a copy
+        bool hardlink_duplicates{false};
+
+        bool preserve_times{true};
+    };
+
+    struct stats
+    {
+        std::uint64_t files{};
+        std::uint64_t directories{};
+        std::uint64_t symlinks{};
+
+        // the size of all the files copied
+        std::uint64_t bytes{};
+
+        // data actually transferred with copy_file_range() or pread()/pwrite()
+        std::uint64_t copied_bytes{};
+
+        std::uint64_t cloned_files{};
+        std::uint64_t duplicate_files{};
+        std::uint64_t duplicate_bytes{};
+        std::uint64_t hashed_bytes{};
+        std::uint64_t hole_bytes{};
+        std::uint64_t extents{};
+    };
+
+    namespace detail
+    {
+        inline std::runtime_error error(const std::string &path)
+        {
+            return std::runtime_error(path + ": " + strerror(errno));
+        }
+
+        // closes the descriptor at the end of the scope
+        class fd_guard
+        {
+        public:
+            explicit fd_guard(int fd) : m_fd{fd}
+            {
+            }
+
+            ~fd_guard()
+            {
+                if (m_fd != -1)
+                {
+                    close(m_fd);
+                }
+            }
+
+            fd_guard(const fd_guard &) = delete;
+            fd_guard &operator=(const fd_guard &) = delete;
+
+            int get() const
+            {
+                return m_fd;
+            }
+
+        private:
+            int m_fd;
+        };
+
+        // runs func(i) for i in [0, count) on 'threads' threads, rethrows the first exception
+        template <typename FUNC>
+        void parallel_for(std::size_t count, unsigned threads, FUNC func)
+        {
+            std::atomic<std::size_t> next{0};
+            std::exception_ptr first_error;
+            std::mutex error_mutex;
+
+            auto work = [&]
+            {
+                for (auto i = next++; i < count; i = next++)
+                {
+                    try
+                    {
+                        func(i);
+                    }
+                    catch (...)
+                    {
+                        std::unique_lock lock{error_mutex};
+                        if (!first_error)
+                        {
+                            first_error = std::current_exception();
+                        }
+                        next = count;
+                    }
+                }
+            };
+
+            std::vector<std::thread> pool;
+            for (unsigned t = 1; t < std::min<std::size_t>(threads, count); t++)
+            {
+                pool.emplace_back(work);
+            }
+
+            work();
+            for (auto &t : pool)
+            {
+                t.join();
+            }
+
+            if (first_error)
+            {
+                std::rethrow_exception(first_error);
+            }
+        }
+
+        // [offset, offset + len) with copy_file_range(), pread()/pwrite() where it is not supported
+        inline std::uint64_t copy_data(int in, int out, std::uint64_t offset, std::uint64_t len, const std::string &path)
+        {
+            auto in_off = static_cast<loff_t>(offset);
+            auto out_off = static_cast<loff_t>(offset);
+            std::uint64_t done = 0;
+
+            while (done < len)
+            {
+                auto ret = copy_file_range(in, &in_off, out, &out_off, len - done, 0);
+                if (ret == 0)
+                {
+                    // the source got shorter while it was copied
+                    return done;
+                }
+
+                if (ret > 0)
+                {
+                    done += static_cast<std::uint64_t>(ret);
+                    continue;
+                }
+
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP)
+                {
+                    throw error(path);
+                }
+
+                break;
+            }
+
+            thread_local std::vector<char> buffer(1 << 20);
+            while (done < len)
+            {
+                auto n = pread(in, buffer.data(), std::min<std::uint64_t>(buffer.size(), len - done), static_cast<off_t>(offset + done));
+                if (n <= 0)
+                {
+                    if (n == -1 && errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (n == -1)
+                    {
+                        throw error(path);
+                    }
+                    return done;
+                }
+
+                for (ssize_t written = 0; written < n;)
+                {
+                    auto w = pwrite(out, buffer.data() + written, static_cast<std::size_t>(n - written),
+                                    static_cast<off_t>(offset + done + static_cast<std::uint64_t>(written)));
+                    if (w == -1)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        throw error(path);
+                    }
+                    written += w;
+                }
+
+                done += static_cast<std::uint64_t>(n);
+            }
+
+            return done;
+        }
+
+        // the data extents of [offset, offset + len), skipping the holes. The copy must already have its final size
+        inline void copy_range(int in, int out, std::uint64_t offset, std::uint64_t len, bool sparse, const std::string &path,
+                               std::atomic<std::uint64_t> &copied, std::atomic<std::uint64_t> &holes)
+        {
+            auto end = offset + len;
+            if (!sparse)
+            {
+                copied += copy_data(in, out, offset, len, path);
+                return;
+            }
+
+            auto pos = offset;
+            while (pos < end)
+            {
+                auto data = lseek(in, static_cast<off_t>(pos), SEEK_DATA);
+                if (data == -1)
+                {
+                    if (errno == ENXIO)
+                    {
+                        // only a hole is left
+                        break;
+                    }
+
+                    // SEEK_DATA is not supported, copy everything
+                    copied += copy_data(in, out, pos, end - pos, path);
+                    return;
+                }
+
+                auto data_start = static_cast<std::uint64_t>(data);
+                if (data_start >= end)
+                {
+                    break;
+                }
+
+                auto hole = lseek(in, data, SEEK_HOLE);
+                auto data_end = hole == -1 ? end : std::min(end, static_cast<std::uint64_t>(hole));
+
+                holes += data_start - pos;
+                copied += copy_data(in, out, data_start, data_end - data_start, path);
+                pos = data_end;
+            }
+
+            holes += end > pos ? end - pos : 0;
+        }
+
+        // XXH3 of the whole file, through a read-only mapping
+        inline std::uint64_t hash_file(const std::string &path, std::uint64_t size)
+        {
+            fd_guard fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+            if (fd.get() == -1)
+            {
+                throw error(path);
+            }
+
+            auto data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+            if (data == MAP_FAILED)
+            {
+                throw error(path);
+            }
+
+            madvise(data, size, MADV_SEQUENTIAL);
+            auto hash = xxh3::hash64(data, size);
+            munmap(data, size);
+
+            return hash;
+        }
+
+        // XXH3 of the first 'len' bytes of the file
+        inline std::uint64_t hash_head(const std::string &path, std::uint64_t len)
+        {
+            fd_guard fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+            if (fd.get() == -1)
+            {
+                throw error(path);
+            }
+
+            std::vector<char> buffer(len);
+            std::uint64_t done = 0;
+            while (done < len)
+            {
+                auto n = pread(fd.get(), buffer.data() + done, len - done, static_cast<off_t>(done));
+                if (n <= 0)
+                {
+                    if (n == -1 && errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (n == -1)
+                    {
+                        throw error(path);
+                    }
+                    break;
+                }
+                done += static_cast<std::uint64_t>(n);
+            }
+
+            return xxh3::hash64(buffer.data(), done);
+        }
+
+        inline bool same_content(const std::string &lhs, const std::string &rhs, std::uint64_t size)
+        {
+            fd_guard a{open(lhs.c_str(), O_RDONLY | O_CLOEXEC)};
+            fd_guard b{open(rhs.c_str(), O_RDONLY | O_CLOEXEC)};
+            if (a.get() == -1 || b.get() == -1)
+            {
+                throw error(a.get() == -1 ? lhs : rhs);
+            }
+
+            auto pa = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, a.get(), 0);
+            auto pb = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, b.get(), 0);
+            auto same = pa != MAP_FAILED && pb != MAP_FAILED && std::memcmp(pa, pb, size) == 0;
+
+            if (pa != MAP_FAILED)
+            {
+                munmap(pa, size);
+            }
+            if (pb != MAP_FAILED)
+            {
+                munmap(pb, size);
+            }
+
+            return same;
+        }
+    }
+
+    class bulk
+    {
+    public:
+        explicit bulk(options opts = {}) : m_opts{opts}
+        {
+            if (m_opts.threads == 0)
+            {
+                m_opts.threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            m_opts.extent_size = std::max<std::uint64_t>(m_opts.extent_size, 1 << 20);
+            m_opts.dedup_min_size = std::max<std::uint64_t>(m_opts.dedup_min_size, 1);
+        }
+
+        // copies the tree below 'from' into 'to' (created when missing), existing files are overwritten
+        stats run(const std::string &from, const std::string &to)
+        {
+            m_from = from;
+            m_to = to;
+            m_files.clear();
+            m_extents.clear();
+            m_counters.reset();
+
+            // Step 1. the source tree, and the directories and symbolic links of the copy
+            scan();
+            create_directories();
+
+            // Step 2. files with the same size and hash
+            if (m_opts.dedup)
+            {
+                find_duplicates();
+            }
+
+            // Step 3. originals: clone, or copy small files whole and split large ones into extents
+            std::vector<std::size_t> originals;
+            std::vector<std::size_t> duplicates;
+            for (std::size_t i = 0; i < m_files.size(); i++)
+            {
+                (m_files[i].original == none ? originals : duplicates).push_back(i);
+            }
+
+            detail::parallel_for(originals.size(), m_opts.threads, [this, &originals](std::size_t i)
+                                 { copy_file(m_files[originals[i]]); });
+
+            detail::parallel_for(m_extents.size(), m_opts.threads, [this](std::size_t i)
+                                 { copy_extent(m_extents[i]); });
+
+            // Step 4. duplicates from the copies of their originals
+            detail::parallel_for(duplicates.size(), m_opts.threads, [this, &duplicates](std::size_t i)
+                                 { copy_duplicate(m_files[duplicates[i]]); });
+
+            // Step 5. modification times, after the last write of every file
+            if (m_opts.preserve_times)
+            {
+                detail::parallel_for(m_files.size(), m_opts.threads, [this](std::size_t i)
+                                     {
+                                         const auto &f = m_files[i];
+                                         if (!f.linked)
+                                         {
+                                             timespec times[2] = {{0, UTIME_OMIT}, f.mtime};
+                                             utimensat(AT_FDCWD, target(f).c_str(), times, 0);
+                                         }
+                                     });
+            }
+
+            stats result{};
+            result.files = m_files.size();
+            result.directories = m_directories.size();
+            result.symlinks = m_symlinks.size();
+            result.bytes = m_counters.bytes;
+            result.copied_bytes = m_counters.copied_bytes;
+            result.cloned_files = m_counters.cloned_files;
+            result.duplicate_files = m_counters.duplicate_files;
+            result.duplicate_bytes = m_counters.duplicate_bytes;
+            result.hashed_bytes = m_counters.hashed_bytes;
+            result.hole_bytes = m_counters.hole_bytes;
+            result.extents = m_extents.size();
+
+            return result;
+        }
+
+    private:
+        static constexpr std::size_t none = ~std::size_t{0};
+
+        // the prefix hashed before the whole file
+        static constexpr std::uint64_t head_size = 64 << 10;
+
+        struct file
+        {
+            // relative to the roots
+            std::string path;
+            std::uint64_t size;
+            std::uint64_t blocks;
+            mode_t mode;
+            timespec mtime;
+
+            // the index of the file with the same content, none for an original
+            std::size_t original{none};
+
+            // a hard link of the copy of the original, which has the time already
+            bool linked{false};
+        };
+
+        struct extent
+        {
+            std::size_t file;
+            std::uint64_t offset;
+            std::uint64_t len;
+        };
+
+        struct counters
+        {
+            std::atomic<std::uint64_t> bytes;
+            std::atomic<std::uint64_t> copied_bytes;
+            std::atomic<std::uint64_t> cloned_files;
+            std::atomic<std::uint64_t> duplicate_files;
+            std::atomic<std::uint64_t> duplicate_bytes;
+            std::atomic<std::uint64_t> hashed_bytes;
+            std::atomic<std::uint64_t> hole_bytes;
+
+            void reset()
+            {
+                bytes = copied_bytes = cloned_files = duplicate_files = duplicate_bytes = hashed_bytes = hole_bytes = 0;
+            }
+        };
+
+        std::string source(const file &f) const
+        {
+            return m_from + "/" + f.path;
+        }
+
+        std::string target(const file &f) const
+        {
+            return m_to + "/" + f.path;
+        }
+
+        void scan()
+        {
+            m_directories.clear();
+            m_symlinks.clear();
+
+            std::mutex mutex;
+            auto prefix = m_from.size() + (m_from.ends_with('/') ? 0 : 1);
+
+            walk::options walk_opts;
+            walk_opts.threads = m_opts.threads;
+            walk_opts.statx_mask = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_BLOCKS | STATX_MTIME;
+
+            // the first entry that could not be examined, reported after the walk
+            std::string failed;
+
+            walk::walker walker{walk_opts};
+            auto walked = walker.run(m_from, [&](const walk::entry &e)
+                                     {
+                                         std::string path{e.path.substr(prefix)};
+
+                                         std::unique_lock lock{mutex};
+                                         if (e.stat == nullptr && (e.type == std::filesystem::file_type::regular ||
+                                                                   e.type == std::filesystem::file_type::unknown))
+                                         {
+                                             if (failed.empty())
+                                             {
+                                                 failed = e.path;
+                                             }
+                                         }
+                                         else if (e.type == std::filesystem::file_type::directory)
+                                         {
+                                             m_directories.emplace_back(std::move(path), e.stat != nullptr ? e.stat->stx_mode & 07777 : 0755);
+                                         }
+                                         else if (e.type == std::filesystem::file_type::symlink)
+                                         {
+                                             m_symlinks.push_back(std::move(path));
+                                         }
+                                         else if (e.type == std::filesystem::file_type::regular && e.stat != nullptr)
+                                         {
+                                             const auto &st = *e.stat;
+                                             m_files.push_back(file{std::move(path), st.stx_size, st.stx_blocks, static_cast<mode_t>(st.stx_mode & 07777),
+                                                                    timespec{st.stx_mtime.tv_sec, st.stx_mtime.tv_nsec}});
+                                         }
+                                     });
+
+            if (!failed.empty())
+            {
+                throw std::runtime_error(failed + ": statx failed, not copied");
+            }
+            if (walked.errors != 0)
+            {
+                throw std::runtime_error(m_from + ": " + std::to_string(walked.errors) + " director" +
+                                         (walked.errors == 1 ? "y" : "ies") + " could not be read, not copied");
+            }
+        }
+
+        void create_directories()
+        {
+            if (mkdir(m_to.c_str(), 0755) == -1 && errno != EEXIST)
+            {
+                throw detail::error(m_to);
+            }
+
+            // parents before their children
+            std::sort(m_directories.begin(), m_directories.end(), [](const auto &lhs, const auto &rhs)
+                      { return std::count(lhs.first.begin(), lhs.first.end(), '/') < std::count(rhs.first.begin(), rhs.first.end(), '/'); });
+
+            for (const auto &[path, mode] : m_directories)
+            {
+                auto dir = m_to + "/" + path;
+                if (mkdir(dir.c_str(), mode | S_IRWXU) == -1 && errno != EEXIST)
+                {
+                    throw detail::error(dir);
+                }
+            }
+
+            detail::parallel_for(m_symlinks.size(), m_opts.threads, [this](std::size_t i)
+                                 {
+                                     auto src = m_from + "/" + m_symlinks[i];
+                                     auto dst = m_to + "/" + m_symlinks[i];
+
+                                     // readlink() truncates silently: a target that fills the buffer may be longer
+                                     std::vector<char> link(PATH_MAX);
+                                     ssize_t len;
+                                     while ((len = readlink(src.c_str(), link.data(), link.size())) == static_cast<ssize_t>(link.size()))
+                                     {
+                                         link.resize(link.size() * 2);
+                                     }
+                                     if (len == -1)
+                                     {
+                                         throw detail::error(src);
+                                     }
+
+                                     unlink(dst.c_str());
+                                     if (symlink(std::string(link.data(), static_cast<std::size_t>(len)).c_str(), dst.c_str()) == -1)
+                                     {
+                                         throw detail::error(dst);
+                                     }
+                                 });
+        }
+
+        void find_duplicates()
+        {
+            // Step 2.1 groups of equal sizes, only they can hold identical files.
+            // Sparse files are left out, their copy already skips the holes
+            std::vector<std::uint64_t> hashes(m_files.size());
+            std::vector<std::size_t> all;
+            for (std::size_t i = 0; i < m_files.size(); i++)
+            {
+                if (m_files[i].size >= m_opts.dedup_min_size && !sparse(m_files[i]))
+                {
+                    all.push_back(i);
+                }
+            }
+
+            auto candidates = same_keys(all, hashes);
+
+            // Step 2.2 the first 64KB, files of the same size (images, archives) usually differ at the start
+            detail::parallel_for(candidates.size(), m_opts.threads, [this, &candidates, &hashes](std::size_t i)
+                                 {
+                                     const auto &f = m_files[candidates[i]];
+                                     hashes[candidates[i]] = detail::hash_head(source(f), std::min(f.size, head_size));
+                                     m_counters.hashed_bytes += std::min(f.size, head_size);
+                                 });
+
+            candidates = same_keys(candidates, hashes);
+
+            // Step 2.3 the whole content of the files that are still candidates
+            detail::parallel_for(candidates.size(), m_opts.threads, [this, &candidates, &hashes](std::size_t i)
+                                 {
+                                     const auto &f = m_files[candidates[i]];
+                                     if (f.size > head_size)
+                                     {
+                                         hashes[candidates[i]] = detail::hash_file(source(f), f.size);
+                                         m_counters.hashed_bytes += f.size;
+                                     }
+                                 });
+
+            // Step 2.4 the first file of every (size, hash) is the original of the others
+            std::map<std::pair<std::uint64_t, std::uint64_t>, std::size_t> originals;
+            for (auto i : candidates)
+            {
+                auto [it, inserted] = originals.try_emplace({m_files[i].size, hashes[i]}, i);
+                if (!inserted)
+                {
+                    m_files[i].original = it->second;
+                }
+            }
+
+            if (m_opts.verify)
+            {
+                detail::parallel_for(candidates.size(), m_opts.threads, [this, &candidates](std::size_t i)
+                                     {
+                                         auto &f = m_files[candidates[i]];
+                                         if (f.original != none && !detail::same_content(source(m_files[f.original]), source(f), f.size))
+                                         {
+                                             // a hash collision, copy the file on its own
+                                             f.original = none;
+                                         }
+                                     });
+            }
+        }
+
+        // the files of 'files' that share their (size, hash) with another one
+        std::vector<std::size_t> same_keys(const std::vector<std::size_t> &files, const std::vector<std::uint64_t> &hashes) const
+        {
+            std::map<std::pair<std::uint64_t, std::uint64_t>, std::size_t> count;
+            for (auto i : files)
+            {
+                count[{m_files[i].size, hashes[i]}]++;
+            }
+
+            std::vector<std::size_t> result;
+            for (auto i : files)
+            {
+                if (count[{m_files[i].size, hashes[i]}] > 1)
+                {
+                    result.push_back(i);
+                }
+            }
+
+            return result;
+        }
+
+        // opens (creates or truncates) the copy with the permissions of the source
+        int create_target(const file &f) const
+        {
+            auto dst = target(f);
+            auto fd = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+            if (fd == -1)
+            {
+                throw detail::error(dst);
+            }
+
+            fchmod(fd, f.mode);
+            return fd;
+        }
+
+        void copy_file(const file &f)
+        {
+            auto src = source(f);
+            detail::fd_guard in{open(src.c_str(), O_RDONLY | O_CLOEXEC)};
+            if (in.get() == -1)
+            {
+                throw detail::error(src);
+            }
+
+            detail::fd_guard out{create_target(f)};
+            m_counters.bytes += f.size;
+
+            if (m_opts.reflink && f.size != 0 && ioctl(out.get(), FICLONE, in.get()) == 0)
+            {
+                m_counters.cloned_files++;
+                return;
+            }
+
+            // the final size first: the holes of a sparse source stay holes, and the extents can be written in any order
+            if (ftruncate(out.get(), static_cast<off_t>(f.size)) == -1)
+            {
+                throw detail::error(target(f));
+            }
+
+            if (f.size > m_opts.extent_size)
+            {
+                std::unique_lock lock{m_extents_mutex};
+                auto index = static_cast<std::size_t>(&f - m_files.data());
+                for (std::uint64_t offset = 0; offset < f.size; offset += m_opts.extent_size)
+                {
+                    m_extents.push_back(extent{index, offset, std::min(m_opts.extent_size, f.size - offset)});
+                }
+
+                return;
+            }
+
+            detail::copy_range(in.get(), out.get(), 0, f.size, sparse(f), src, m_counters.copied_bytes, m_counters.hole_bytes);
+        }
+
+        void copy_extent(const extent &e)
+        {
+            const auto &f = m_files[e.file];
+            auto src = source(f);
+            auto dst = target(f);
+
+            detail::fd_guard in{open(src.c_str(), O_RDONLY | O_CLOEXEC)};
+            detail::fd_guard out{open(dst.c_str(), O_WRONLY | O_CLOEXEC)};
+            if (in.get() == -1 || out.get() == -1)
+            {
+                throw detail::error(in.get() == -1 ? src : dst);
+            }
+
+            detail::copy_range(in.get(), out.get(), e.offset, e.len, sparse(f), src, m_counters.copied_bytes, m_counters.hole_bytes);
+        }
+
+        void copy_duplicate(file &f)
+        {
+            auto first = target(m_files[f.original]);
+            auto dst = target(f);
+
+            m_counters.bytes += f.size;
+            m_counters.duplicate_files++;
+            m_counters.duplicate_bytes += f.size;
+
+            detail::fd_guard in{open(first.c_str(), O_RDONLY | O_CLOEXEC)};
+            if (in.get() == -1)
+            {
+                throw detail::error(first);
+            }
+
+            if (m_opts.hardlink_duplicates)
+            {
+                // a reflink keeps two independent files, try it before sharing the inode
+                if (m_opts.reflink)
+                {
+                    detail::fd_guard out{create_target(f)};
+                    if (ioctl(out.get(), FICLONE, in.get()) == 0)
+                    {
+                        m_counters.cloned_files++;
+                        return;
+                    }
+                }
+
+                unlink(dst.c_str());
+                if (link(first.c_str(), dst.c_str()) == -1)
+                {
+                    throw detail::error(dst);
+                }
+                f.linked = true;
+                return;
+            }
+
+            detail::fd_guard out{create_target(f)};
+            if (m_opts.reflink && ioctl(out.get(), FICLONE, in.get()) == 0)
+            {
+                m_counters.cloned_files++;
+                return;
+            }
+
+            if (ftruncate(out.get(), static_cast<off_t>(f.size)) == -1)
+            {
+                throw detail::error(dst);
+            }
+
+            detail::copy_range(in.get(), out.get(), 0, f.size, sparse(f), first, m_counters.copied_bytes, m_counters.hole_bytes);
+        }
+
+        static bool sparse(const file &f)
+        {
+            return f.blocks * 512 < f.size;
+        }
+
+        options m_opts;
+        std::string m_from;
+        std::string m_to;
+
+        std::vector<file> m_files;
+        std::vector<std::pair<std::string, mode_t>> m_directories;
+        std::vector<std::string> m_symlinks;
+
+        std::mutex m_extents_mutex;
+        std::vector<extent> m_extents;
+
+        counters m_counters;
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_FILE_COPIER_HPP
@@ -0,0 +1,460 @@
+/**
+ * @File    : file_follower.hpp
+ * @Brief   : Event-driven 'tail -F' for many files from one thread, with inotify and pread()
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Following files with inotify
+ * Polling a file (sleep, clear the stream, read again) adds up to one polling interval of latency
+ * to every line and wakes the process even when nothing was written.
+ * inotify lets the kernel tell us which file changed, so the follower sleeps in poll()
+ * until there is something to read, and one thread can follow thousands of files
+ * (up to /proc/sys/fs/inotify/max_user_watches, and every followed file keeps one descriptor open,
+ * so thousands of files also need a larger 'ulimit -n').
+ *
+ * For every followed file the follower watches:
+ * - the file itself (through /proc/self/fd/N, so the watch is on the inode that was opened):
+ *   IN_MODIFY for appended data, IN_MOVE_SELF when the file is renamed by a log rotation,
+ *   IN_ATTRIB because unlinking changes the link count (IN_DELETE_SELF only arrives after we close it),
+ * - its parent directory: IN_CREATE and IN_MOVED_TO, to pick up the new file after a rotation
+ *   or a file that does not exist yet.
+ *
+ * New data is read with pread() in large chunks into one buffer shared by all files,
+ * and split into lines by the SIMD scanner of line_scanner.hpp. Lines are passed to the callback
+ * as std::string_view into that buffer, only a line that spans two reads is copied.
+ * A file whose size drops below the read offset was truncated (copytruncate, '>' in a shell),
+ * the follower continues at offset 0.
+ *
+ * fanotify could report modifications for a whole mount, but it needs CAP_SYS_ADMIN,
+ * inotify works for every user.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_FILE_FOLLOWER_HPP
+#define SYSTEM_PROGRAMMING_FILE_FOLLOWER_HPP
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "line_scanner.hpp"
+
+namespace follow
+{
+    // called with every complete line of a followed file, without the '\n'
+    using line_callback = std::function<void(std::string_view line)>;
+
+    // called with "truncated", "replaced" or "removed"
+    using notice_callback = std::function<void(const std::string &path, const char *what)>;
+
+    struct options
+    {
+        // size of a single pread()
+        std::size_t chunk_size{1 << 20};
+
+        // start at the beginning of the files that exist when they are added (tail -n +1),
+        // instead of at their end (tail -n 0)
+        bool from_start{false};
+
+        notice_callback notice{};
+    };
+
+    class follower
+    {
+    public:
+        explicit follower(options opts = {}) : m_opts{std::move(opts)}, m_buffer(m_opts.chunk_size)
+        {
+            m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (m_inotify == -1)
+            {
+                throw std::runtime_error(strerror(errno));
+            }
+        }
+
+        ~follower()
+        {
+            for (auto &f : m_files)
+            {
+                if (f->fd != -1)
+                {
+                    close(f->fd);
+                }
+            }
+
+            close(m_inotify);
+        }
+
+        follower(const follower &) = delete;
+        follower &operator=(const follower &) = delete;
+
+        // follows 'path', which does not need to exist yet
+        void add(const std::string &path, line_callback func)
+        {
+            auto f = std::make_unique<file>();
+            f->path = path;
+            f->func = std::move(func);
+
+            auto p = std::filesystem::path(path);
+            auto dir = p.parent_path().empty() ? std::filesystem::path(".") : p.parent_path();
+            f->name = p.filename().string();
+
+            auto wd = inotify_add_watch(m_inotify, dir.c_str(), IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+            if (wd == -1)
+            {
+                throw std::runtime_error(dir.string() + ": " + strerror(errno));
+            }
+
+            m_dirs[wd].push_back(f.get());
+
+            open_file(*f, !m_opts.from_start);
+            if (f->fd != -1 && m_opts.from_start)
+            {
+                mark(*f, false);
+            }
+
+            m_files.push_back(std::move(f));
+        }
+
+        // waits up to 'timeout' milliseconds (-1 forever) for changes,
+        // reads them and returns the number of lines passed to the callbacks
+        std::size_t poll(int timeout = -1)
+        {
+            if (m_pending.empty())
+            {
+                pollfd pfd{m_inotify, POLLIN, 0};
+                if (::poll(&pfd, 1, timeout) == -1 && errno != EINTR)
+                {
+                    throw std::runtime_error(strerror(errno));
+                }
+            }
+
+            read_events();
+
+            std::size_t lines = 0;
+            for (auto f : m_pending)
+            {
+                lines += update(*f);
+            }
+
+            m_pending.clear();
+            return lines;
+        }
+
+        [[noreturn]] void run()
+        {
+            while (true)
+            {
+                poll();
+            }
+        }
+
+        // the inotify descriptor, to wait on it in an existing epoll loop
+        int fd() const
+        {
+            return m_inotify;
+        }
+
+        std::size_t size() const
+        {
+            return m_files.size();
+        }
+
+    private:
+        static constexpr std::uint32_t file_mask = IN_MODIFY | IN_MOVE_SELF | IN_ATTRIB | IN_DELETE_SELF;
+
+        struct file
+        {
+            std::string path;
+            std::string name;
+            line_callback func;
+
+            int fd{-1};
+            int wd{-1};
+            ino_t inode{};
+            off_t offset{};
+
+            // a line that did not end in the last read
+            std::string partial;
+
+            bool pending{};
+            bool check{};
+        };
+
+        void mark(file &f, bool check)
+        {
+            f.check = f.check || check;
+            if (!f.pending)
+            {
+                f.pending = true;
+                m_pending.push_back(&f);
+            }
+        }
+
+        void notice(const file &f, const char *what)
+        {
+            if (m_opts.notice)
+            {
+                m_opts.notice(f.path, what);
+            }
+        }
+
+        void open_file(file &f, bool at_end)
+        {
+            auto fd = open(f.path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1)
+            {
+                if (errno == ENOENT)
+                {
+                    // picked up later by the directory watch
+                    return;
+                }
+
+                throw std::runtime_error(f.path + ": " + strerror(errno));
+            }
+
+            struct stat st{};
+            fstat(fd, &st);
+
+            // watch the inode we opened, not whatever the path refers to by now
+            auto proc = "/proc/self/fd/" + std::to_string(fd);
+            auto wd = inotify_add_watch(m_inotify, proc.c_str(), file_mask);
+            if (wd == -1)
+            {
+                auto err = errno;
+                close(fd);
+                throw std::runtime_error(f.path + ": " + strerror(err));
+            }
+
+            f.fd = fd;
+            f.wd = wd;
+            f.inode = st.st_ino;
+            f.offset = at_end ? st.st_size : 0;
+            f.partial.clear();
+
+            m_watches[wd].push_back(&f);
+        }
+
+        void close_file(file &f)
+        {
+            auto &files = m_watches[f.wd];
+            std::erase(files, &f);
+            if (files.empty())
+            {
+                inotify_rm_watch(m_inotify, f.wd);
+                m_watches.erase(f.wd);
+            }
+
+            close(f.fd);
+            f.fd = -1;
+            f.wd = -1;
+
+            if (!f.partial.empty())
+            {
+                // the last line of a file without a final '\n'
+                f.func(f.partial);
+                f.partial.clear();
+            }
+        }
+
+        void read_events()
+        {
+            alignas(inotify_event) char buf[64 * 1024];
+
+            while (true)
+            {
+                auto len = read(m_inotify, buf, sizeof(buf));
+                if (len == -1)
+                {
+                    if (errno == EAGAIN || errno == EINTR)
+                    {
+                        return;
+                    }
+
+                    throw std::runtime_error(strerror(errno));
+                }
+
+                for (auto ptr = buf; ptr < buf + len;)
+                {
+                    auto ev = reinterpret_cast<const inotify_event *>(ptr);
+                    ptr += sizeof(inotify_event) + ev->len;
+
+                    if (ev->mask & IN_Q_OVERFLOW)
+                    {
+                        // events were lost, look at every file
+                        for (auto &f : m_files)
+                        {
+                            mark(*f, true);
+                        }
+                        continue;
+                    }
+
+                    if (auto it = m_watches.find(ev->wd); it != m_watches.end())
+                    {
+                        for (auto f : it->second)
+                        {
+                            mark(*f, (ev->mask & (IN_MOVE_SELF | IN_ATTRIB | IN_DELETE_SELF | IN_IGNORED)) != 0);
+                        }
+                    }
+
+                    if (auto it = m_dirs.find(ev->wd); it != m_dirs.end() && ev->len != 0)
+                    {
+                        for (auto f : it->second)
+                        {
+                            if (f->name == ev->name)
+                            {
+                                mark(*f, true);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // reads everything between the offset and the end of the file
+        std::size_t read_new(file &f)
+        {
+            struct stat st{};
+            if (fstat(f.fd, &st) == -1)
+            {
+                throw std::runtime_error(f.path + ": " + strerror(errno));
+            }
+
+            if (st.st_size < f.offset)
+            {
+                f.offset = 0;
+                f.partial.clear();
+                notice(f, "truncated");
+            }
+
+            std::size_t lines = 0;
+            auto data = m_buffer.data();
+
+            while (true)
+            {
+                auto len = pread(f.fd, data, m_buffer.size(), f.offset);
+                if (len == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    throw std::runtime_error(f.path + ": " + strerror(errno));
+                }
+
+                if (len == 0)
+                {
+                    break;
+                }
+
+                f.offset += len;
+
+                auto used = lines::for_each_line(data, static_cast<std::size_t>(len), [&](std::string_view line)
+                                                 {
+                                                     if (!f.partial.empty())
+                                                     {
+                                                         f.partial.append(line);
+                                                         f.func(f.partial);
+                                                         f.partial.clear();
+                                                     }
+                                                     else
+                                                     {
+                                                         f.func(line);
+                                                     }
+
+                                                     lines++;
+                                                 });
+
+                f.partial.append(data + used, static_cast<std::size_t>(len) - used);
+
+                if (static_cast<std::size_t>(len) < m_buffer.size())
+                {
+                    break;
+                }
+            }
+
+            return lines;
+        }
+
+        std::size_t update(file &f)
+        {
+            std::size_t lines = 0;
+            auto check = f.check;
+
+            f.pending = false;
+            f.check = false;
+
+            if (f.fd != -1)
+            {
+                lines += read_new(f);
+            }
+
+            if (!check)
+            {
+                return lines;
+            }
+
+            // the followed file was unlinked, or renamed and the path now names another file
+            struct stat st{};
+            auto exists = stat(f.path.c_str(), &st) == 0;
+
+            if (f.fd != -1)
+            {
+                struct stat fst{};
+                fstat(f.fd, &fst);
+
+                if (fst.st_nlink == 0)
+                {
+                    close_file(f);
+                    notice(f, "removed");
+                }
+                else if (exists && st.st_ino != f.inode)
+                {
+                    close_file(f);
+                    notice(f, "replaced");
+                }
+            }
+
+            if (f.fd == -1 && exists)
+            {
+                open_file(f, false);
+                if (f.fd != -1)
+                {
+                    lines += read_new(f);
+                }
+            }
+
+            return lines;
+        }
+
+        options m_opts;
+        int m_inotify{-1};
+
+        // read buffer shared by all files, the lines passed to the callbacks point into it
+        std::vector<char> m_buffer;
+
+        std::vector<std::unique_ptr<file>> m_files;
+        std::vector<file *> m_pending;
+
+        // inotify watch descriptor of an opened file, or of a parent directory, to the followed files
+        std::unordered_map<int, std::vector<file *>> m_watches;
+        std::unordered_map<int, std::vector<file *>> m_dirs;
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_FILE_FOLLOWER_HPP
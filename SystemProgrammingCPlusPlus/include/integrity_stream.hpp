@@ -0,0 +1,380 @@
+/**
+ * @File    : integrity_stream.hpp
+ * @Brief   : Stream buffers that checksum (CRC32C + XXH3) and optionally LZ4-compress the data passing through
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Checksums without a second pass
+ * Verifying a file after writing it (or before using what was read) means reading all of it again.
+ * The data already passes through memory once, in the buffer of the stream: integrity::output_buf and
+ * integrity::input_buf are std::streambuf stages between a std::ostream/std::istream and the std::filebuf
+ * (or any other stream buffer), and checksum every block while it is still in the cache:
+ *
+ *   std::ostream <<  --> integrity::output_buf (CRC32C, XXH3, [LZ4]) --> std::filebuf --> file
+ *   std::istream >>  <-- integrity::input_buf  (CRC32C, XXH3, [LZ4]) <-- std::filebuf <-- file
+ *
+ * integrity::digest runs both checksums over the same 32KB slices one after the other,
+ * the second one reads the slice from L1/L2 instead of memory:
+ * - CRC32C with the 3-way SSE4.2 kernel and PCLMUL recombination (crc32c.hpp),
+ * - XXH3-64 with AVX2 (xxh3.hpp), streamed over the blocks.
+ *
+ * With compression::lz4 every block (64KB by default) is stored as
+ *   uncompressed size (4 bytes) | stored size (4 bytes) | LZ4 block, or the raw bytes when they do not shrink
+ * and the checksums are those of the uncompressed data, so they do not depend on the storage format.
+ *
+ * integrity::ofstream and integrity::ifstream bundle a std::filebuf with the stage,
+ * they are used like std::ofstream and std::ifstream and report the digest at the end.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_INTEGRITY_STREAM_HPP
+#define SYSTEM_PROGRAMMING_INTEGRITY_STREAM_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "crc32c.hpp"
+#include "lz4_block.hpp"
+#include "xxh3.hpp"
+
+namespace integrity
+{
+    struct digest_value
+    {
+        std::uint32_t crc32c{};
+        std::uint64_t xxh3{};
+        std::uint64_t bytes{};
+
+        bool operator==(const digest_value &) const = default;
+    };
+
+    inline std::ostream &operator<<(std::ostream &os, const digest_value &d)
+    {
+        auto flags = os.flags();
+        os << "crc32c=" << std::hex << d.crc32c << " xxh3=" << d.xxh3 << std::dec << " bytes=" << d.bytes;
+        os.flags(flags);
+
+        return os;
+    }
+
+    class digest
+    {
+    public:
+        void update(const void *data, std::size_t size)
+        {
+            // one slice at a time through both kernels, the second one finds it in the cache
+            constexpr std::size_t slice = 32 << 10;
+
+            auto ptr = static_cast<const char *>(data);
+            for (std::size_t done = 0; done < size; done += slice)
+            {
+                auto len = std::min(slice, size - done);
+                m_crc = crc32c::update(m_crc, ptr + done, len);
+                m_xxh3.update(ptr + done, len);
+            }
+
+            m_bytes += size;
+        }
+
+        digest_value value() const
+        {
+            return digest_value{m_crc, m_xxh3.digest(), m_bytes};
+        }
+
+        void reset()
+        {
+            m_crc = 0;
+            m_xxh3.reset();
+            m_bytes = 0;
+        }
+
+    private:
+        std::uint32_t m_crc{};
+        xxh3::state m_xxh3;
+        std::uint64_t m_bytes{};
+    };
+
+    enum class compression
+    {
+        none,
+        lz4
+    };
+
+    namespace detail
+    {
+        struct block_header
+        {
+            std::uint32_t size;
+            std::uint32_t stored;
+        };
+    }
+
+    // ---------------------------------------
+    // Writing
+    // ---------------------------------------
+    class output_buf : public std::streambuf
+    {
+    public:
+        explicit output_buf(std::streambuf *sink, compression mode = compression::none, std::size_t block_size = 64 << 10)
+            : m_sink{sink}, m_mode{mode}, m_buffer(std::max<std::size_t>(block_size, 4096))
+        {
+            if (m_mode == compression::lz4)
+            {
+                m_packed.resize(lz4::compress_bound(m_buffer.size()));
+            }
+
+            setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+        }
+
+        ~output_buf() override
+        {
+            write_block();
+        }
+
+        output_buf(const output_buf &) = delete;
+        output_buf &operator=(const output_buf &) = delete;
+
+        // the checksums of everything written so far, including the buffered bytes
+        digest_value value()
+        {
+            write_block();
+            return m_digest.value();
+        }
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if (!write_block())
+            {
+                return traits_type::eof();
+            }
+
+            if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+
+            return traits_type::not_eof(ch);
+        }
+
+        int sync() override
+        {
+            return write_block() && m_sink->pubsync() == 0 ? 0 : -1;
+        }
+
+    private:
+        bool write_block()
+        {
+            auto size = static_cast<std::size_t>(pptr() - pbase());
+            if (size == 0)
+            {
+                return true;
+            }
+
+            m_digest.update(pbase(), size);
+            setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+
+            if (m_mode == compression::none)
+            {
+                return put(m_buffer.data(), size);
+            }
+
+            auto packed = lz4::compress(m_buffer.data(), size, m_packed.data());
+            auto stored = packed < size ? packed : size;
+
+            detail::block_header header{static_cast<std::uint32_t>(size), static_cast<std::uint32_t>(stored)};
+            return put(reinterpret_cast<const char *>(&header), sizeof(header)) &&
+                   put(packed < size ? m_packed.data() : m_buffer.data(), stored);
+        }
+
+        bool put(const char *data, std::size_t size)
+        {
+            return m_sink->sputn(data, static_cast<std::streamsize>(size)) == static_cast<std::streamsize>(size);
+        }
+
+        std::streambuf *m_sink;
+        compression m_mode;
+        std::vector<char> m_buffer;
+        std::vector<char> m_packed;
+        digest m_digest;
+    };
+
+    // ---------------------------------------
+    // Reading
+    // ---------------------------------------
+    class input_buf : public std::streambuf
+    {
+    public:
+        explicit input_buf(std::streambuf *source, compression mode = compression::none, std::size_t block_size = 64 << 10)
+            : m_source{source}, m_mode{mode}, m_buffer(std::max<std::size_t>(block_size, 4096))
+        {
+            setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+        }
+
+        input_buf(const input_buf &) = delete;
+        input_buf &operator=(const input_buf &) = delete;
+
+        // the checksums of the data read from the source so far (whole blocks, read ahead of the stream)
+        digest_value value() const
+        {
+            return m_digest.value();
+        }
+
+    protected:
+        int_type underflow() override
+        {
+            if (gptr() < egptr())
+            {
+                return traits_type::to_int_type(*gptr());
+            }
+
+            auto size = m_mode == compression::none ? read_raw() : read_block();
+            if (size == 0)
+            {
+                return traits_type::eof();
+            }
+
+            m_digest.update(m_buffer.data(), size);
+            setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + size);
+
+            return traits_type::to_int_type(*gptr());
+        }
+
+    private:
+        std::size_t read_raw()
+        {
+            auto n = m_source->sgetn(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+            return n > 0 ? static_cast<std::size_t>(n) : 0;
+        }
+
+        std::size_t read_block()
+        {
+            detail::block_header header{};
+            auto n = m_source->sgetn(reinterpret_cast<char *>(&header), sizeof(header));
+            if (n == 0)
+            {
+                return 0;
+            }
+
+            if (n != sizeof(header) || header.stored > header.size || header.size > (1U << 30))
+            {
+                throw std::runtime_error("integrity: corrupt block header");
+            }
+
+            if (m_buffer.size() < header.size)
+            {
+                m_buffer.resize(header.size);
+            }
+
+            auto raw = header.stored == header.size;
+            auto target = raw ? m_buffer.data() : packed_buffer(header.stored);
+
+            if (m_source->sgetn(target, header.stored) != static_cast<std::streamsize>(header.stored))
+            {
+                throw std::runtime_error("integrity: truncated block");
+            }
+
+            if (!raw && lz4::decompress(target, header.stored, m_buffer.data(), header.size) != header.size)
+            {
+                throw std::runtime_error("integrity: corrupt block");
+            }
+
+            return header.size;
+        }
+
+        char *packed_buffer(std::size_t size)
+        {
+            if (m_packed.size() < size)
+            {
+                m_packed.resize(size);
+            }
+
+            return m_packed.data();
+        }
+
+        std::streambuf *m_source;
+        compression m_mode;
+        std::vector<char> m_buffer;
+        std::vector<char> m_packed;
+        digest m_digest;
+    };
+
+    // ---------------------------------------
+    // File streams
+    // ---------------------------------------
+    class ofstream : public std::ostream
+    {
+    public:
+        explicit ofstream(const std::string &filename, compression mode = compression::none)
+            : std::ostream{nullptr}, m_stage{&m_file, mode}
+        {
+            // rdbuf() clears the state, the failure to open is set after it
+            rdbuf(&m_stage);
+            if (m_file.open(filename, std::ios::out | std::ios::trunc | std::ios::binary) == nullptr)
+            {
+                setstate(std::ios::failbit);
+            }
+        }
+
+        ~ofstream() override
+        {
+            close();
+        }
+
+        // flushes the stage and closes the file, returns the checksums of everything written
+        digest_value close()
+        {
+            if (m_file.is_open())
+            {
+                m_value = m_stage.value();
+                m_file.close();
+            }
+
+            return m_value;
+        }
+
+    private:
+        std::filebuf m_file;
+        output_buf m_stage;
+        digest_value m_value{};
+    };
+
+    class ifstream : public std::istream
+    {
+    public:
+        explicit ifstream(const std::string &filename, compression mode = compression::none)
+            : std::istream{nullptr}, m_stage{&m_file, mode}
+        {
+            // rdbuf() clears the state, the failure to open is set after it
+            rdbuf(&m_stage);
+            if (m_file.open(filename, std::ios::in | std::ios::binary) == nullptr)
+            {
+                setstate(std::ios::failbit);
+            }
+        }
+
+        // the checksums of the data read so far, of the whole file once the stream reached its end
+        digest_value value() const
+        {
+            return m_stage.value();
+        }
+
+    private:
+        std::filebuf m_file;
+        input_buf m_stage;
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_INTEGRITY_STREAM_HPP
@@ -0,0 +1,748 @@
+/**
+ * @File    : launcher.hpp
+ * @Brief   : Starting programs without fork(): posix_spawn, clone(CLONE_VM | CLONE_VFORK), redirections, environment, pidfd
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Why not fork() + exec()
+ * fork() duplicates the address space of the parent: no data is copied (copy-on-write), but every page table
+ * entry is, and every writable page is marked read-only in the parent as well. For a parent of several GB
+ * that is milliseconds per fork(), spent only to be thrown away by exec() in the child a moment later.
+ * Meanwhile the parent faults on every page it writes to.
+ *
+ * clone(CLONE_VM | CLONE_VFORK) starts the child in the address space of the parent, on a small stack of its own,
+ * and suspends the parent until the child called exec() or exited: the cost does not depend on the size
+ * of the parent. The child runs on borrowed memory, so it must only make system calls (no malloc, no locks),
+ * everything it needs is prepared by the parent beforehand. posix_spawn() does exactly this in glibc.
+ *
+ * proc::command describes the program: arguments, environment (inherited, cleared, changed),
+ * file descriptors (dup2, open, close, in order), working directory, process group.
+ * proc::spawn() starts it with one of three backends:
+ * - backend::posix_spawn: posix_spawnp() and its file actions,
+ * - backend::clone_vfork: clone(CLONE_VM | CLONE_VFORK | CLONE_PIDFD), the pidfd comes with the child,
+ * - backend::fork_exec: the classic way, kept for comparison.
+ *
+ * proc::child owns the process through a pidfd (pidfd_open(), or CLONE_PIDFD): kill() and wait() cannot hit
+ * another process that reused the pid, and the pidfd can be polled (it becomes readable when the child exits).
+ * A child that was not waited for is waited for by the destructor, there are no zombies.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_LAUNCHER_HPP
+#define SYSTEM_PROGRAMMING_LAUNCHER_HPP
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+extern char **environ;
+
+namespace proc
+{
+    enum class backend
+    {
+        posix_spawn,
+        clone_vfork,
+        fork_exec,
+    };
+
+    // ---------------------------------------
+    // What to start
+    // ---------------------------------------
+    class command
+    {
+    public:
+        struct fd_action
+        {
+            enum kind
+            {
+                dup2,
+                open,
+                close,
+            } type;
+            int fd;       // in the child
+            int source;   // dup2: the descriptor of the parent
+            std::string path;
+            int flags;
+            mode_t mode;
+        };
+
+        explicit command(std::string program) : m_args{std::move(program)}
+        {
+        }
+
+        command &arg(std::string value)
+        {
+            m_args.push_back(std::move(value));
+            return *this;
+        }
+
+        command &args(std::initializer_list<std::string_view> values)
+        {
+            for (auto value : values)
+            {
+                m_args.emplace_back(value);
+            }
+            return *this;
+        }
+
+        // the child starts with an empty environment, env() adds to it
+        command &env_clear()
+        {
+            m_env_cleared = true;
+            m_env.clear();
+            return *this;
+        }
+
+        command &env(std::string_view name, std::string_view value)
+        {
+            m_env.push_back({std::string{name}, std::string{value}});
+            return *this;
+        }
+
+        command &env_unset(std::string_view name)
+        {
+            m_env.push_back({std::string{name}, std::nullopt});
+            return *this;
+        }
+
+        // descriptor 'fd' of the child is 'source' of the parent (dup2)
+        command &redirect(int fd, int source)
+        {
+            m_actions.push_back({fd_action::dup2, fd, source, {}, 0, 0});
+            return *this;
+        }
+
+        // descriptor 'fd' of the child is the file 'path', opened in the child
+        command &redirect(int fd, std::string path, int flags, mode_t mode = 0644)
+        {
+            m_actions.push_back({fd_action::open, fd, -1, std::move(path), flags, mode});
+            return *this;
+        }
+
+        command &close_fd(int fd)
+        {
+            m_actions.push_back({fd_action::close, fd, -1, {}, 0, 0});
+            return *this;
+        }
+
+        command &directory(std::string path)
+        {
+            m_directory = std::move(path);
+            return *this;
+        }
+
+        // a process group of its own (setpgid(0, 0)), a terminal signal to the parent's group does not reach it
+        command &new_process_group()
+        {
+            m_new_process_group = true;
+            return *this;
+        }
+
+        // the signal mask of the child, the mask of the calling thread by default
+        // (a parent that blocks signals to read them from a signalfd must not pass them on)
+        command &signal_mask(const sigset_t &mask)
+        {
+            m_signal_mask = mask;
+            return *this;
+        }
+
+        const std::vector<std::string> &arguments() const
+        {
+            return m_args;
+        }
+
+        const std::vector<fd_action> &actions() const
+        {
+            return m_actions;
+        }
+
+        const std::string &working_directory() const
+        {
+            return m_directory;
+        }
+
+        bool process_group() const
+        {
+            return m_new_process_group;
+        }
+
+        const std::optional<sigset_t> &child_signal_mask() const
+        {
+            return m_signal_mask;
+        }
+
+        // "NAME=value" strings: the environment of the parent (unless cleared) with the changes applied
+        std::vector<std::string> environment() const
+        {
+            std::vector<std::string> result;
+            if (!m_env_cleared)
+            {
+                for (auto var = environ; var != nullptr && *var != nullptr; var++)
+                {
+                    result.emplace_back(*var);
+                }
+            }
+
+            for (auto &[name, value] : m_env)
+            {
+                std::erase_if(result, [&name](const std::string &var)
+                              { return var.size() > name.size() && var.starts_with(name) && var[name.size()] == '='; });
+                if (value)
+                {
+                    result.push_back(name + '=' + *value);
+                }
+            }
+
+            return result;
+        }
+
+        bool inherits_environment() const
+        {
+            return !m_env_cleared && m_env.empty();
+        }
+
+    private:
+        std::vector<std::string> m_args;
+        std::vector<std::pair<std::string, std::optional<std::string>>> m_env;
+        bool m_env_cleared{false};
+        std::vector<fd_action> m_actions;
+        std::string m_directory;
+        bool m_new_process_group{false};
+        std::optional<sigset_t> m_signal_mask;
+    };
+
+    // ---------------------------------------
+    // A running child
+    // ---------------------------------------
+    struct exit_status
+    {
+        int code{-1};  // exit() code, -1 when killed
+        int signal{0}; // the signal that killed it
+
+        bool success() const
+        {
+            return code == 0;
+        }
+    };
+
+    namespace detail
+    {
+        [[noreturn]] inline void throw_errno(const std::string &what, int error = errno)
+        {
+            throw std::runtime_error(what + ": " + strerror(error));
+        }
+
+        inline int pidfd_open(pid_t pid)
+        {
+            return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+        }
+
+        inline int pidfd_send_signal(int pidfd, int sig)
+        {
+            return static_cast<int>(syscall(SYS_pidfd_send_signal, pidfd, sig, nullptr, 0));
+        }
+
+        // waitid(P_PIDFD) (Linux 5.4), spelled as a number for C libraries without P_PIDFD
+        constexpr auto p_pidfd = static_cast<idtype_t>(3);
+    }
+
+    class child
+    {
+    public:
+        child() = default;
+
+        child(pid_t pid, int pidfd) : m_pid{pid}, m_pidfd{pidfd}
+        {
+        }
+
+        child(child &&other) noexcept
+            : m_pid{std::exchange(other.m_pid, -1)}, m_pidfd{std::exchange(other.m_pidfd, -1)}
+        {
+        }
+
+        child &operator=(child &&other) noexcept
+        {
+            std::swap(m_pid, other.m_pid);
+            std::swap(m_pidfd, other.m_pidfd);
+            return *this;
+        }
+
+        ~child()
+        {
+            if (m_pid > 0)
+            {
+                try
+                {
+                    wait();
+                }
+                catch (...)
+                {
+                }
+            }
+            if (m_pidfd >= 0)
+            {
+                ::close(m_pidfd);
+            }
+        }
+
+        pid_t pid() const
+        {
+            return m_pid;
+        }
+
+        // readable (poll, epoll) once the child exited
+        int pidfd() const
+        {
+            return m_pidfd;
+        }
+
+        bool running() const
+        {
+            return m_pid > 0;
+        }
+
+        void kill(int sig = SIGTERM) const
+        {
+            if (m_pid > 0 && detail::pidfd_send_signal(m_pidfd, sig) < 0 && errno != ESRCH)
+            {
+                detail::throw_errno("pidfd_send_signal");
+            }
+        }
+
+        // collects the child if it exited, with its resource usage: wait4() on the pid, which
+        // cannot have been reused while the child is not reaped; call it once the pidfd is readable
+        std::optional<exit_status> try_wait(rusage *usage = nullptr)
+        {
+            if (m_pid <= 0)
+            {
+                throw std::logic_error("proc::child: nothing to wait for");
+            }
+
+            int status;
+            pid_t pid;
+            while ((pid = wait4(m_pid, &status, WNOHANG, usage)) < 0 && errno == EINTR)
+            {
+            }
+            if (pid < 0)
+            {
+                detail::throw_errno("wait4");
+            }
+            if (pid == 0)
+            {
+                return std::nullopt;
+            }
+
+            m_pid = -1;
+            if (WIFEXITED(status))
+            {
+                return exit_status{WEXITSTATUS(status), 0};
+            }
+
+            return exit_status{-1, WTERMSIG(status)};
+        }
+
+        exit_status wait()
+        {
+            return *wait_for(-1);
+        }
+
+        // nullopt if the child still runs after 'timeout_ms' (-1 waits forever, 0 only checks)
+        std::optional<exit_status> wait_for(int timeout_ms)
+        {
+            if (m_pid <= 0)
+            {
+                throw std::logic_error("proc::child: nothing to wait for");
+            }
+
+            if (timeout_ms >= 0)
+            {
+                pollfd pfd{m_pidfd, POLLIN, 0};
+                int ready;
+                while ((ready = poll(&pfd, 1, timeout_ms)) < 0 && errno == EINTR)
+                {
+                }
+                if (ready == 0)
+                {
+                    return std::nullopt;
+                }
+            }
+
+            siginfo_t info{};
+            while (waitid(detail::p_pidfd, static_cast<id_t>(m_pidfd), &info, WEXITED) < 0)
+            {
+                if (errno != EINTR)
+                {
+                    detail::throw_errno("waitid");
+                }
+            }
+
+            m_pid = -1;
+            if (info.si_code == CLD_EXITED)
+            {
+                return exit_status{info.si_status, 0};
+            }
+
+            return exit_status{-1, info.si_status};
+        }
+
+    private:
+        pid_t m_pid{-1};
+        int m_pidfd{-1};
+    };
+
+    // ---------------------------------------
+    // Starting it
+    // ---------------------------------------
+    namespace detail
+    {
+        // everything the child needs, built by the parent: the child only reads it and makes system calls
+        struct plan
+        {
+            std::string path;
+            std::vector<char *> argv;
+            std::vector<std::string> env_storage;
+            std::vector<char *> envp;
+            const command *cmd;
+            sigset_t parent_mask;
+            sigset_t child_mask;
+            sigset_t reset_signals; // reset to SIG_DFL in the child, by every method
+            int error{0}; // written by a clone_vfork child that failed (shared memory)
+        };
+
+        // the program in $PATH, like execvp()
+        inline std::string find_program(const std::string &program)
+        {
+            if (program.find('/') != std::string::npos)
+            {
+                return program;
+            }
+
+            auto path = getenv("PATH");
+            std::string_view dirs = path != nullptr ? path : "/bin:/usr/bin";
+            while (true)
+            {
+                auto end = dirs.find(':');
+                auto dir = dirs.substr(0, end);
+                auto candidate = (dir.empty() ? std::string{"."} : std::string{dir}) + '/' + program;
+                if (access(candidate.c_str(), X_OK) == 0)
+                {
+                    return candidate;
+                }
+                if (end == std::string_view::npos)
+                {
+                    break;
+                }
+                dirs.remove_prefix(end + 1);
+            }
+
+            throw std::runtime_error("proc::spawn: " + program + ": " + strerror(ENOENT));
+        }
+
+        // the signals with a handler: exec() would reset them, the child must before it.
+        // Ignored signals stay ignored across exec(), as with fork() + exec()
+        inline sigset_t caught_signals()
+        {
+            sigset_t set;
+            sigemptyset(&set);
+            for (int sig = 1; sig < NSIG; sig++)
+            {
+                struct sigaction old;
+                if (sigaction(sig, nullptr, &old) == 0 && old.sa_handler != SIG_IGN && old.sa_handler != SIG_DFL)
+                {
+                    sigaddset(&set, sig);
+                }
+            }
+            return set;
+        }
+
+        inline plan make_plan(const command &cmd, bool resolve)
+        {
+            plan p;
+            p.cmd = &cmd;
+            p.path = resolve ? find_program(cmd.arguments().front()) : cmd.arguments().front();
+
+            for (auto &arg : cmd.arguments())
+            {
+                p.argv.push_back(const_cast<char *>(arg.c_str()));
+            }
+            p.argv.push_back(nullptr);
+
+            if (cmd.inherits_environment())
+            {
+                for (auto var = environ; var != nullptr && *var != nullptr; var++)
+                {
+                    p.envp.push_back(*var);
+                }
+            }
+            else
+            {
+                p.env_storage = cmd.environment();
+                for (auto &var : p.env_storage)
+                {
+                    p.envp.push_back(var.data());
+                }
+            }
+            p.envp.push_back(nullptr);
+
+            p.reset_signals = caught_signals();
+            return p;
+        }
+
+        // the child side for clone_vfork and fork_exec: system calls only, returns errno if exec failed
+        inline int child_main(const plan &p)
+        {
+            // handlers of the parent must not run here (a clone_vfork child shares its memory)
+            struct sigaction dfl{};
+            dfl.sa_handler = SIG_DFL;
+            for (int sig = 1; sig < NSIG; sig++)
+            {
+                if (sigismember(&p.reset_signals, sig) == 1)
+                {
+                    sigaction(sig, &dfl, nullptr);
+                }
+            }
+
+            for (auto &action : p.cmd->actions())
+            {
+                int result = 0;
+                switch (action.type)
+                {
+                case command::fd_action::dup2:
+                    // dup2() onto itself keeps FD_CLOEXEC, clear it instead
+                    result = action.source == action.fd ? fcntl(action.fd, F_SETFD, 0) : dup2(action.source, action.fd);
+                    break;
+                case command::fd_action::open:
+                    if (auto fd = ::open(action.path.c_str(), action.flags, action.mode); fd < 0)
+                    {
+                        result = -1;
+                    }
+                    else if (fd != action.fd)
+                    {
+                        result = dup2(fd, action.fd);
+                        ::close(fd);
+                    }
+                    break;
+                case command::fd_action::close:
+                    result = ::close(action.fd);
+                    break;
+                }
+                if (result < 0)
+                {
+                    return errno;
+                }
+            }
+
+            if (!p.cmd->working_directory().empty() && chdir(p.cmd->working_directory().c_str()) < 0)
+            {
+                return errno;
+            }
+            if (p.cmd->process_group() && setpgid(0, 0) < 0)
+            {
+                return errno;
+            }
+
+            sigprocmask(SIG_SETMASK, &p.child_mask, nullptr);
+            execve(p.path.c_str(), p.argv.data(), p.envp.data());
+            return errno;
+        }
+
+        inline child spawn_posix(const command &cmd)
+        {
+            auto p = make_plan(cmd, false);
+
+            posix_spawn_file_actions_t actions;
+            posix_spawn_file_actions_init(&actions);
+            for (auto &action : cmd.actions())
+            {
+                switch (action.type)
+                {
+                case command::fd_action::dup2:
+                    posix_spawn_file_actions_adddup2(&actions, action.source, action.fd);
+                    break;
+                case command::fd_action::open:
+                    posix_spawn_file_actions_addopen(&actions, action.fd, action.path.c_str(), action.flags, action.mode);
+                    break;
+                case command::fd_action::close:
+                    posix_spawn_file_actions_addclose(&actions, action.fd);
+                    break;
+                }
+            }
+            if (!cmd.working_directory().empty())
+            {
+                posix_spawn_file_actions_addchdir_np(&actions, cmd.working_directory().c_str());
+            }
+
+            // the signal mask and the default dispositions, as child_main() does
+            posix_spawnattr_t attr;
+            posix_spawnattr_init(&attr);
+            short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+            sigset_t mask;
+            pthread_sigmask(SIG_SETMASK, nullptr, &mask);
+            if (cmd.child_signal_mask())
+            {
+                mask = *cmd.child_signal_mask();
+            }
+            posix_spawnattr_setsigmask(&attr, &mask);
+            posix_spawnattr_setsigdefault(&attr, &p.reset_signals);
+            if (cmd.process_group())
+            {
+                flags |= POSIX_SPAWN_SETPGROUP;
+                posix_spawnattr_setpgroup(&attr, 0);
+            }
+            posix_spawnattr_setflags(&attr, flags);
+
+            pid_t pid;
+            auto error = posix_spawnp(&pid, p.path.c_str(), &actions, &attr, p.argv.data(), p.envp.data());
+            posix_spawn_file_actions_destroy(&actions);
+            posix_spawnattr_destroy(&attr);
+            if (error != 0)
+            {
+                throw_errno("posix_spawn " + p.path, error);
+            }
+
+            // the child is not reaped before we wait for it: the pid cannot have been reused yet
+            auto pidfd = pidfd_open(pid);
+            if (pidfd < 0)
+            {
+                auto open_error = errno;
+                waitpid(pid, nullptr, 0);
+                throw_errno("pidfd_open", open_error);
+            }
+
+            return {pid, pidfd};
+        }
+
+        inline int clone_entry(void *arg)
+        {
+            auto p = static_cast<plan *>(arg);
+            p->error = child_main(*p);
+            _exit(127);
+        }
+
+        inline child spawn_clone(const command &cmd)
+        {
+            auto p = make_plan(cmd, true);
+
+            // the parent is suspended until exec(), one stack per thread is enough
+            constexpr std::size_t stack_size = 64 << 10;
+            alignas(64) static thread_local char stack[stack_size];
+
+            // no signal handler may run in the child before child_main() reset them
+            sigset_t all;
+            sigfillset(&all);
+            pthread_sigmask(SIG_SETMASK, &all, &p.parent_mask);
+            p.child_mask = cmd.child_signal_mask().value_or(p.parent_mask);
+
+            int pidfd = -1;
+            auto pid = clone(clone_entry, stack + stack_size, CLONE_VM | CLONE_VFORK | CLONE_PIDFD | SIGCHLD, &p, &pidfd);
+            auto error = errno;
+            pthread_sigmask(SIG_SETMASK, &p.parent_mask, nullptr);
+
+            if (pid < 0)
+            {
+                throw_errno("clone", error);
+            }
+
+            // back here after the child called exec() or exited
+            if (p.error != 0)
+            {
+                waitpid(pid, nullptr, 0);
+                ::close(pidfd);
+                throw_errno("proc::spawn " + p.path, p.error);
+            }
+
+            return {pid, pidfd};
+        }
+
+        inline child spawn_fork(const command &cmd)
+        {
+            auto p = make_plan(cmd, true);
+            pthread_sigmask(SIG_SETMASK, nullptr, &p.parent_mask);
+            p.child_mask = cmd.child_signal_mask().value_or(p.parent_mask);
+
+            // the child reports a failed exec() through a pipe that exec() closes
+            int report[2];
+            if (pipe2(report, O_CLOEXEC) < 0)
+            {
+                throw_errno("pipe2");
+            }
+
+            auto pid = fork();
+            if (pid == 0)
+            {
+                ::close(report[0]);
+                auto error = child_main(p);
+                static_cast<void>(::write(report[1], &error, sizeof(error)));
+                _exit(127);
+            }
+
+            auto fork_error = errno;
+            ::close(report[1]);
+            if (pid < 0)
+            {
+                ::close(report[0]);
+                throw_errno("fork", fork_error);
+            }
+
+            int error = 0;
+            auto bytes = ::read(report[0], &error, sizeof(error));
+            ::close(report[0]);
+            if (bytes == sizeof(error))
+            {
+                waitpid(pid, nullptr, 0);
+                throw_errno("proc::spawn " + p.path, error);
+            }
+
+            auto pidfd = pidfd_open(pid);
+            if (pidfd < 0)
+            {
+                auto open_error = errno;
+                waitpid(pid, nullptr, 0);
+                throw_errno("pidfd_open", open_error);
+            }
+
+            return {pid, pidfd};
+        }
+    }
+
+    inline child spawn(const command &cmd, backend how = backend::posix_spawn)
+    {
+        switch (how)
+        {
+        case backend::clone_vfork:
+            return detail::spawn_clone(cmd);
+        case backend::fork_exec:
+            return detail::spawn_fork(cmd);
+        default:
+            return detail::spawn_posix(cmd);
+        }
+    }
+
+    // system() without the shell
+    inline exit_status run(const command &cmd, backend how = backend::posix_spawn)
+    {
+        return spawn(cmd, how).wait();
+    }
+}
+
+#endif // SYSTEM_PROGRAMMING_LAUNCHER_HPP
@@ -0,0 +1,497 @@
+/**
+ * @File    : line_pipeline.hpp
+ * @Brief   : Parallel multi-file line pipeline: readers, SIMD line splitting, filters, ordered output
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp -lpthread
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** A grep pipeline
+ * Reading a log file with std::getline() handles one file and one line at a time:
+ * every line is copied into a std::string, and a single core does all the work.
+ * The pipeline splits the work into stages connected by queues:
+ *
+ *   readers (one stage per file) --> workers (shared pool) --> output (one thread)
+ *
+ * 1. a reader reads its file with pread() into large chunks (1MB by default) and cuts every chunk
+ *    after its last '\n', the incomplete last line is carried over to the next chunk of that file,
+ * 2. the workers split a chunk into lines with the AVX2 scanner of line_scanner.hpp
+ *    and run the filter stages (substring, regex, any predicate), all filters must match.
+ *    With a required literal the workers search it with lines::find() over the whole chunk
+ *    and only look at the lines around the hits,
+ * 3. the output stage receives the chunks in any order, puts them back into the order of each file
+ *    (a reorder buffer keyed by the chunk sequence number), and passes the matching lines to the sink.
+ *
+ * The lines stay std::string_view into the read buffers until the sink has seen them,
+ * then the chunk goes back to a fixed pool. The pool bounds the memory used,
+ * and makes the readers wait when the workers or the output cannot keep up (back pressure).
+ */
+
+#ifndef SYSTEM_PROGRAMMING_LINE_PIPELINE_HPP
+#define SYSTEM_PROGRAMMING_LINE_PIPELINE_HPP
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <regex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <thread>
+#include <vector>
+
+#include "line_scanner.hpp"
+
+namespace pipeline
+{
+    using filter = std::function<bool(std::string_view line)>;
+
+    // lines that contain 'pattern'
+    inline filter contains(std::string pattern)
+    {
+        return [pattern = std::move(pattern)](std::string_view line)
+        {
+            return line.find(pattern) != std::string_view::npos;
+        };
+    }
+
+    // lines in which 'pattern' (ECMAScript) matches anywhere
+    inline filter matches(const std::string &pattern)
+    {
+        auto re = std::make_shared<std::regex>(pattern, std::regex::optimize);
+        return [re](std::string_view line)
+        {
+            return std::regex_search(line.begin(), line.end(), *re);
+        };
+    }
+
+    struct options
+    {
+        std::size_t chunk_size{1 << 20};
+
+        // number of worker threads, 0 for std::thread::hardware_concurrency()
+        std::size_t workers{0};
+
+        // number of files read at the same time (at most one reader per file), 0 for one per worker
+        std::size_t readers{0};
+
+        // number of chunks in flight, 0 for 2 per worker and reader.
+        // More chunks do not help: the chunks that are read but not yet scanned fall out of the cache
+        std::size_t chunks{0};
+
+        // keep the views of the matching lines, false only counts them (grep -c)
+        bool collect{true};
+    };
+
+    struct stats
+    {
+        std::uint64_t bytes{};
+        std::uint64_t lines{};
+        std::uint64_t matches{};
+        std::uint64_t chunks{};
+    };
+
+    // receives the matching lines of one chunk, chunks of a file arrive in file order.
+    // The views are only valid during the call, and the sink must not throw.
+    using sink = std::function<void(std::size_t file, std::span<const std::string_view> lines)>;
+
+    template <typename T>
+    class blocking_queue
+    {
+    public:
+        void push(T value)
+        {
+            {
+                std::unique_lock lock{m_mutex};
+                m_queue.push_back(std::move(value));
+            }
+
+            m_cond.notify_one();
+        }
+
+        // returns an empty optional once the queue is closed and drained
+        std::optional<T> pop()
+        {
+            std::unique_lock lock{m_mutex};
+            m_cond.wait(lock, [this]
+                        { return !m_queue.empty() || m_closed; });
+
+            if (m_queue.empty())
+            {
+                return {};
+            }
+
+            auto value = std::move(m_queue.front());
+            m_queue.pop_front();
+
+            return value;
+        }
+
+        void close()
+        {
+            {
+                std::unique_lock lock{m_mutex};
+                m_closed = true;
+            }
+
+            m_cond.notify_all();
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::deque<T> m_queue;
+        bool m_closed{};
+    };
+
+    class grep
+    {
+    public:
+        explicit grep(options opts = {}) : m_opts{opts}
+        {
+            if (m_opts.workers == 0)
+            {
+                m_opts.workers = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            if (m_opts.readers == 0)
+            {
+                m_opts.readers = m_opts.workers;
+            }
+        }
+
+        // adds a filter stage, a line is passed to the sink when every filter accepts it
+        void add(filter f)
+        {
+            m_filters.push_back(std::move(f));
+        }
+
+        // only lines that contain 'literal', found with lines::find() over the whole chunk
+        // before the filter stages run. The literal must not contain a '\n'.
+        // This is the fast path of grep: the rare matching lines are the only ones looked at.
+        void require(std::string literal)
+        {
+            m_literal = std::move(literal);
+        }
+
+        stats run(const std::vector<std::string> &files, const sink &output)
+        {
+            stats total{};
+            if (files.empty())
+            {
+                return total;
+            }
+
+            auto readers = std::min(m_opts.readers, files.size());
+            auto num_chunks = m_opts.chunks != 0 ? m_opts.chunks : 2 * (m_opts.workers + readers);
+
+            queues q;
+            std::vector<std::unique_ptr<chunk>> chunks;
+            for (std::size_t i = 0; i < num_chunks; i++)
+            {
+                chunks.push_back(std::make_unique<chunk>());
+                q.free.push(chunks.back().get());
+            }
+
+            std::atomic<std::size_t> next_file{0};
+            std::atomic<std::size_t> running_readers{readers};
+            std::atomic<std::size_t> running_workers{m_opts.workers};
+            std::atomic<std::uint64_t> bytes{0};
+
+            // readers and workers close the next queue when the last of them is done
+            std::vector<std::jthread> threads;
+            for (std::size_t i = 0; i < readers; i++)
+            {
+                threads.emplace_back([&]
+                                     {
+                                         for (auto f = next_file++; f < files.size(); f = next_file++)
+                                         {
+                                             bytes += read_file(q, f, files[f]);
+                                         }
+
+                                         if (--running_readers == 0)
+                                         {
+                                             q.work.close();
+                                         }
+                                     });
+            }
+
+            for (std::size_t i = 0; i < m_opts.workers; i++)
+            {
+                threads.emplace_back([&]
+                                     {
+                                         while (auto c = q.work.pop())
+                                         {
+                                             process(**c);
+                                             q.done.push(*c);
+                                         }
+
+                                         if (--running_workers == 0)
+                                         {
+                                             q.done.close();
+                                         }
+                                     });
+            }
+
+            // output stage on the calling thread: per file reorder buffers
+            std::vector<std::uint64_t> next_seq(files.size());
+            std::vector<std::map<std::uint64_t, chunk *>> reorder(files.size());
+
+            auto emit = [&](chunk *c)
+            {
+                total.lines += c->num_lines;
+                total.matches += c->num_matches;
+                total.chunks++;
+
+                if (m_opts.collect && !c->lines.empty())
+                {
+                    output(c->file, c->lines);
+                }
+
+                next_seq[c->file]++;
+                q.free.push(c);
+            };
+
+            while (auto done = q.done.pop())
+            {
+                auto c = *done;
+                if (c->seq != next_seq[c->file])
+                {
+                    reorder[c->file].emplace(c->seq, c);
+                    continue;
+                }
+
+                emit(c);
+
+                auto &pending = reorder[c->file];
+                for (auto it = pending.begin(); it != pending.end() && it->first == next_seq[c->file];)
+                {
+                    emit(it->second);
+                    it = pending.erase(it);
+                }
+            }
+
+            threads.clear();
+
+            if (m_error)
+            {
+                std::rethrow_exception(std::exchange(m_error, nullptr));
+            }
+
+            total.bytes = bytes;
+            return total;
+        }
+
+    private:
+        struct chunk
+        {
+            std::size_t file{};
+            std::uint64_t seq{};
+
+            std::vector<char> data;
+            std::size_t size{};
+
+            std::vector<std::string_view> lines;
+            std::uint64_t num_lines{};
+            std::uint64_t num_matches{};
+        };
+
+        struct queues
+        {
+            blocking_queue<chunk *> free;
+            blocking_queue<chunk *> work;
+            blocking_queue<chunk *> done;
+        };
+
+        // reads one file into chunks that end after a '\n', returns the number of bytes read
+        std::uint64_t read_file(queues &q, std::size_t index, const std::string &filename)
+        {
+            auto fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1)
+            {
+                set_error(std::make_exception_ptr(std::runtime_error(filename + ": " + strerror(errno))));
+                return 0;
+            }
+
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+            std::uint64_t total = 0;
+            std::uint64_t seq = 0;
+            off_t offset = 0;
+
+            // the incomplete last line of the previous chunk
+            std::vector<char> carry;
+
+            while (true)
+            {
+                auto c = *q.free.pop();
+                if (c->data.size() < m_opts.chunk_size + carry.size())
+                {
+                    c->data.resize(m_opts.chunk_size + carry.size());
+                }
+
+                std::copy(carry.begin(), carry.end(), c->data.begin());
+                auto size = carry.size();
+                carry.clear();
+
+                auto eof = false;
+                while (size < c->data.size())
+                {
+                    auto len = pread(fd, c->data.data() + size, c->data.size() - size, offset);
+                    if (len == -1 && errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    if (len == -1)
+                    {
+                        set_error(std::make_exception_ptr(std::runtime_error(filename + ": " + strerror(errno))));
+                        eof = true;
+                        break;
+                    }
+
+                    if (len == 0)
+                    {
+                        eof = true;
+                        break;
+                    }
+
+                    offset += len;
+                    total += static_cast<std::uint64_t>(len);
+                    size += static_cast<std::size_t>(len);
+                }
+
+                if (!eof)
+                {
+                    // cut after the last '\n', a chunk without any '\n' grows on the next round
+                    auto nl = static_cast<const char *>(memrchr(c->data.data(), '\n', size));
+                    auto cut = nl == nullptr ? 0 : static_cast<std::size_t>(nl - c->data.data()) + 1;
+
+                    carry.assign(c->data.begin() + static_cast<std::ptrdiff_t>(cut), c->data.begin() + static_cast<std::ptrdiff_t>(size));
+                    size = cut;
+                }
+                else if (size != 0 && c->data[size - 1] != '\n')
+                {
+                    // the last line of a file without a final '\n'
+                    if (c->data.size() == size)
+                    {
+                        c->data.push_back('\n');
+                    }
+                    else
+                    {
+                        c->data[size] = '\n';
+                    }
+                    size++;
+                }
+
+                if (size == 0 && !eof)
+                {
+                    q.free.push(c);
+                    continue;
+                }
+
+                c->file = index;
+                c->seq = seq++;
+                c->size = size;
+                q.work.push(c);
+
+                if (eof)
+                {
+                    break;
+                }
+            }
+
+            close(fd);
+            return total;
+        }
+
+        void process(chunk &c)
+        {
+            c.lines.clear();
+            c.num_matches = 0;
+
+            auto accept = [&](std::string_view line)
+            {
+                for (const auto &f : m_filters)
+                {
+                    if (!f(line))
+                    {
+                        return;
+                    }
+                }
+
+                c.num_matches++;
+                if (m_opts.collect)
+                {
+                    c.lines.push_back(line);
+                }
+            };
+
+            if (m_literal.empty())
+            {
+                c.num_lines = 0;
+                lines::for_each_line(c.data.data(), c.size, [&](std::string_view line)
+                                     {
+                                         c.num_lines++;
+                                         accept(line);
+                                     });
+                return;
+            }
+
+            // search the literal in the whole chunk, only the lines around a hit are looked at
+            c.num_lines = lines::count(c.data.data(), c.size);
+
+            const char *data = c.data.data();
+            auto end = data + c.size;
+            for (auto pos = data; pos < end;)
+            {
+                auto hit = lines::find(pos, static_cast<std::size_t>(end - pos), m_literal);
+                if (hit == nullptr)
+                {
+                    break;
+                }
+
+                auto begin = static_cast<const char *>(memrchr(pos, '\n', static_cast<std::size_t>(hit - pos)));
+                begin = begin == nullptr ? pos : begin + 1;
+
+                // every chunk ends with a '\n'
+                auto nl = static_cast<const char *>(std::memchr(hit, '\n', static_cast<std::size_t>(end - hit)));
+
+                accept(std::string_view{begin, static_cast<std::size_t>(nl - begin)});
+                pos = nl + 1;
+            }
+        }
+
+        void set_error(std::exception_ptr e)
+        {
+            std::unique_lock lock{m_error_mutex};
+            if (!m_error)
+            {
+                m_error = e;
+            }
+        }
+
+        options m_opts;
+        std::vector<filter> m_filters;
+        std::string m_literal;
+
+        std::mutex m_error_mutex;
+        std::exception_ptr m_error;
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_LINE_PIPELINE_HPP
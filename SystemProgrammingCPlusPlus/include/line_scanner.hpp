@@ -0,0 +1,253 @@
+/**
+ * @File    : line_scanner.hpp
+ * @Brief   : SIMD newline scanning that splits a buffer into std::string_view lines
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Splitting lines without std::getline
+ * std::getline() copies every line into a std::string, character by character through the stream buffer.
+ * When the data is already in memory (read with pread() or mmap()), a line is just a std::string_view
+ * between two '\n' characters, and the only work left is finding the '\n' characters.
+ *
+ * The scanner compares 32 bytes at a time with AVX2 (16 bytes with SSE2, always available on x86-64):
+ * _mm256_cmpeq_epi8 marks the '\n' bytes, _mm256_movemask_epi8 turns them into a 32-bit mask,
+ * and every set bit is one line end. One compare finds all the line ends of a block,
+ * so short lines cost no more than long ones, unlike calling memchr() once per line.
+ *
+ * lines::find() searches a substring in the same way, with the first and the last byte of the pattern.
+ *
+ * AVX2 is selected at run time (__builtin_cpu_supports), the binary does not need -mavx2.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_LINE_SCANNER_HPP
+#define SYSTEM_PROGRAMMING_LINE_SCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace lines
+{
+    namespace detail
+    {
+        // calls func(offset) for every '\n' of [data, data + size), returns the number of newlines
+        template <typename FUNC>
+        inline std::size_t scan_generic(const char *data, std::size_t size, FUNC &func)
+        {
+            std::size_t count = 0;
+
+            auto pos = data;
+            auto end = data + size;
+            while (auto nl = static_cast<const char *>(std::memchr(pos, '\n', static_cast<std::size_t>(end - pos))))
+            {
+                func(static_cast<std::size_t>(nl - data));
+                count++;
+                pos = nl + 1;
+            }
+
+            return count;
+        }
+
+#if defined(__x86_64__)
+        template <typename FUNC>
+        inline std::size_t scan_tail(const char *data, std::size_t i, std::size_t size, FUNC &func)
+        {
+            std::size_t count = 0;
+            for (; i < size; i++)
+            {
+                if (data[i] == '\n')
+                {
+                    func(i);
+                    count++;
+                }
+            }
+
+            return count;
+        }
+
+        template <typename FUNC>
+        inline std::size_t scan_sse2(const char *data, std::size_t size, FUNC &func)
+        {
+            std::size_t count = 0;
+            const auto nl = _mm_set1_epi8('\n');
+
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl)));
+
+                while (mask != 0)
+                {
+                    func(i + static_cast<std::size_t>(__builtin_ctz(mask)));
+                    count++;
+                    mask &= mask - 1;
+                }
+            }
+
+            return count + scan_tail(data, i, size, func);
+        }
+
+        template <typename FUNC>
+        __attribute__((target("avx2"))) std::size_t scan_avx2(const char *data, std::size_t size, FUNC &func)
+        {
+            std::size_t count = 0;
+            const auto nl = _mm256_set1_epi8('\n');
+
+            // two vectors per iteration, the common case of no newline in 64 bytes is a single branch
+            std::size_t i = 0;
+            for (; i + 64 <= size; i += 64)
+            {
+                auto lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                auto hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 32));
+
+                auto mask = static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nl)))) |
+                            static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nl)))) << 32;
+
+                while (mask != 0)
+                {
+                    func(i + static_cast<std::size_t>(__builtin_ctzll(mask)));
+                    count++;
+                    mask &= mask - 1;
+                }
+            }
+
+            for (; i + 32 <= size; i += 32)
+            {
+                auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl)));
+
+                while (mask != 0)
+                {
+                    func(i + static_cast<std::size_t>(__builtin_ctz(mask)));
+                    count++;
+                    mask &= mask - 1;
+                }
+            }
+
+            return count + scan_tail(data, i, size, func);
+        }
+
+        // compares the first and the last byte of the needle at 32 positions at once,
+        // and memcmp() only where both match (W. Mula, "SIMD-friendly algorithms for substring searching")
+        __attribute__((target("avx2"))) inline const char *find_avx2(const char *data, std::size_t size, std::string_view needle)
+        {
+            auto n = needle.size();
+            const auto first = _mm256_set1_epi8(needle.front());
+            const auto last = _mm256_set1_epi8(needle.back());
+
+            std::size_t i = 0;
+            for (; i + n + 31 <= size; i += 32)
+            {
+                auto block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                auto block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + n - 1));
+
+                auto eq = _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last));
+                auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(eq));
+
+                while (mask != 0)
+                {
+                    auto pos = i + static_cast<std::size_t>(__builtin_ctz(mask));
+                    if (std::memcmp(data + pos + 1, needle.data() + 1, n - 2) == 0)
+                    {
+                        return data + pos;
+                    }
+
+                    mask &= mask - 1;
+                }
+            }
+
+            auto rest = static_cast<const char *>(memmem(data + i, size - i, needle.data(), n));
+            return rest;
+        }
+
+        inline bool has_avx2()
+        {
+            static const bool avx2 = __builtin_cpu_supports("avx2");
+            return avx2;
+        }
+#endif
+    }
+
+    enum class isa
+    {
+        generic,
+        sse2,
+        avx2
+    };
+
+    inline isa best_isa()
+    {
+#if defined(__x86_64__)
+        return detail::has_avx2() ? isa::avx2 : isa::sse2;
+#else
+        return isa::generic;
+#endif
+    }
+
+    // calls func(offset) for the offset of every '\n' in [data, data + size),
+    // returns the number of newlines
+    template <typename FUNC>
+    std::size_t scan(const char *data, std::size_t size, FUNC &&func, isa use = best_isa())
+    {
+#if defined(__x86_64__)
+        switch (use)
+        {
+        case isa::avx2:
+            return detail::scan_avx2(data, size, func);
+        case isa::sse2:
+            return detail::scan_sse2(data, size, func);
+        default:
+            break;
+        }
+#endif
+        return detail::scan_generic(data, size, func);
+    }
+
+    // calls func(std::string_view line) for every complete line of [data, data + size),
+    // the views point into the buffer and do not include the '\n'.
+    // Returns the number of bytes consumed, the bytes after the last '\n' are an incomplete line.
+    template <typename FUNC>
+    std::size_t for_each_line(const char *data, std::size_t size, FUNC &&func, isa use = best_isa())
+    {
+        std::size_t begin = 0;
+        scan(
+            data, size, [&](std::size_t nl)
+            {
+                func(std::string_view{data + begin, nl - begin});
+                begin = nl + 1;
+            },
+            use);
+
+        return begin;
+    }
+
+    // the first occurrence of 'needle' in [data, data + size), or nullptr
+    inline const char *find(const char *data, std::size_t size, std::string_view needle, isa use = best_isa())
+    {
+#if defined(__x86_64__)
+        if (use == isa::avx2 && needle.size() >= 2)
+        {
+            return detail::find_avx2(data, size, needle);
+        }
+#endif
+        return static_cast<const char *>(memmem(data, size, needle.data(), needle.size()));
+    }
+
+    inline std::size_t count(const char *data, std::size_t size, isa use = best_isa())
+    {
+        return scan(
+            data, size, [](std::size_t) {}, use);
+    }
+}
+
+#endif // SYSTEM_PROGRAMMING_LINE_SCANNER_HPP
@@ -0,0 +1,567 @@
+/**
+ * @File    : log_sink.hpp
+ * @Brief   : Rotating, preallocated log file writer with optional O_DIRECT and background compression
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp -lpthread
+ * @Command : ls -l log.txt.*
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** A log sink for the servers
+ * The servers of chapter10 and chapter12 append to an unbounded std::fstream,
+ * some of them flush it after every message. Each flush is a write() system call,
+ * the file grows by a few bytes at a time (the filesystem allocates blocks piecemeal),
+ * and the dirty pages pile up in the page cache until the kernel writes them back all at once,
+ * which shows up as latency spikes on the threads that happen to write at that moment.
+ *
+ * log_sink::rotating_file writes in a different way:
+ * 1. callers copy their message into an in-memory block under a short lock, no system call,
+ * 2. full blocks (1MB by default) are handed to a writer thread, while the callers continue
+ *    with the next free block (double buffering, 'buffers' blocks in total),
+ * 3. the writer thread issues one large, aligned pwrite() per block, and starts the write-back
+ *    of the written range with sync_file_range() so dirty pages never accumulate,
+ * 4. optionally the file is opened with O_DIRECT (bypassing the page cache entirely),
+ *    partial blocks are then padded to the 4KB alignment and rewritten when they grow,
+ * 5. every segment file is preallocated with fallocate(FALLOC_FL_KEEP_SIZE),
+ *    so the filesystem reserves contiguous extents once instead of on every append,
+ * 6. segments rotate by size or by age; closed segments are compressed by 'gzip'
+ *    on a background thread, the writers never wait for it.
+ *
+ * A message passed to write() is never split across two segments.
+ * Callers only block when all blocks are waiting for the disk (back pressure).
+ */
+
+#ifndef SYSTEM_PROGRAMMING_LOG_SINK_HPP
+#define SYSTEM_PROGRAMMING_LOG_SINK_HPP
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+extern char **environ;
+
+namespace log_sink
+{
+    constexpr const std::size_t alignment = 4096;
+
+    struct options
+    {
+        std::string path{"log.txt"};                // segments are named <path>.000000, <path>.000001, ...
+        std::size_t segment_size{64 << 20};         // rotate when the next message would not fit
+        std::chrono::seconds max_age{0};            // rotate by age as well, 0 disables
+        std::size_t block_size{1 << 20};            // one pwrite() per block, multiple of 4KB
+        std::size_t buffers{4};                     // blocks in flight, at least 2
+        std::chrono::milliseconds flush_interval{1000}; // partial blocks are written after this long
+        bool direct_io{false};                      // O_DIRECT, falls back to buffered I/O when unsupported
+        bool compress{false};                       // gzip closed segments in the background
+    };
+
+    class rotating_file
+    {
+    public:
+        explicit rotating_file(options opts) : m_opts{std::move(opts)}
+        {
+            if (m_opts.block_size % alignment != 0 || m_opts.block_size == 0)
+            {
+                throw std::invalid_argument("block_size must be a multiple of 4096");
+            }
+
+            if (m_opts.segment_size < m_opts.block_size)
+            {
+                throw std::invalid_argument("segment_size must be at least one block");
+            }
+
+            for (std::size_t i = 0; i < std::max<std::size_t>(m_opts.buffers, 2); i++)
+            {
+                auto data = static_cast<char *>(std::aligned_alloc(alignment, m_opts.block_size));
+                if (data == nullptr)
+                {
+                    throw std::bad_alloc();
+                }
+
+                m_blocks.push_back(block{data});
+                m_free.push_back(&m_blocks.back());
+            }
+
+            m_segment = next_segment_index();
+            m_segment_start = std::chrono::steady_clock::now();
+            m_next_check = m_segment_start + m_opts.flush_interval;
+            m_active = take_free_block();
+            m_active->segment = m_segment;
+
+            m_writer = std::thread([this]
+                                   { this->write_loop(); });
+
+            if (m_opts.compress)
+            {
+                m_compressor = std::thread([this]
+                                           { this->compress_loop(); });
+            }
+        }
+
+        ~rotating_file()
+        {
+            {
+                std::unique_lock lock{m_mutex};
+                wait_active(lock);
+                submit(true);
+                m_stop = true;
+            }
+            m_cond.notify_all();
+            m_writer.join();
+
+            if (m_compressor.joinable())
+            {
+                {
+                    std::lock_guard lock{m_compress_mutex};
+                    m_compress_stop = true;
+                }
+                m_compress_cond.notify_all();
+                m_compressor.join();
+            }
+
+            for (auto &b : m_blocks)
+            {
+                std::free(b.data);
+            }
+        }
+
+        rotating_file(const rotating_file &) = delete;
+        rotating_file &operator=(const rotating_file &) = delete;
+
+        // Appends one message; thread-safe, never splits the message across segments.
+        void write(const char *data, std::size_t len)
+        {
+            std::unique_lock lock{m_mutex};
+            wait_active(lock);
+
+            if ((m_rotate_due || m_segment_used + len > m_opts.segment_size) && m_segment_used != 0)
+            {
+                rotate(lock);
+            }
+
+            m_segment_used += len;
+            m_dirty = true;
+            while (len != 0)
+            {
+                auto n = std::min(len, m_opts.block_size - m_active->len);
+                std::memcpy(m_active->data + m_active->len, data, n);
+
+                m_active->len += n;
+                data += n;
+                len -= n;
+
+                if (m_active->len == m_opts.block_size)
+                {
+                    submit(false);
+                    next_block(lock, m_active_offset + m_opts.block_size);
+                }
+            }
+        }
+
+        void write(std::string_view str)
+        {
+            write(str.data(), str.size());
+        }
+
+        // Writes the partial block now instead of after 'flush_interval'.
+        void flush()
+        {
+            std::unique_lock lock{m_mutex};
+            wait_active(lock);
+            flush_partial(lock);
+        }
+
+        // Closes the current segment and starts the next one.
+        void rotate()
+        {
+            std::unique_lock lock{m_mutex};
+            wait_active(lock);
+            rotate(lock);
+        }
+
+        const options &opts() const
+        {
+            return m_opts;
+        }
+
+    private:
+        struct block
+        {
+            char *data;
+            std::size_t len{0};
+            std::uint64_t offset{0};  // file offset of data[0] inside the segment
+            std::uint64_t segment{0};
+            bool last{false};         // close the segment after this block
+        };
+
+        std::string segment_name(std::uint64_t index) const
+        {
+            auto name = std::to_string(index);
+            return m_opts.path + '.' + std::string(6 - std::min<std::size_t>(name.size(), 6), '0') + name;
+        }
+
+        // continue after the highest existing segment, compressed or not
+        std::uint64_t next_segment_index() const
+        {
+            namespace fs = std::filesystem;
+
+            auto path = fs::absolute(m_opts.path);
+            auto prefix = path.filename().string() + '.';
+
+            std::uint64_t next = 0;
+            if (fs::is_directory(path.parent_path()))
+            {
+                for (const auto &entry : fs::directory_iterator(path.parent_path()))
+                {
+                    auto name = entry.path().filename().string();
+                    if (name.compare(0, prefix.size(), prefix) == 0)
+                    {
+                        auto index = std::strtoull(name.c_str() + prefix.size(), nullptr, 10);
+                        next = std::max<std::uint64_t>(next, index + 1);
+                    }
+                }
+            }
+
+            return next;
+        }
+
+        block *take_free_block()
+        {
+            auto b = m_free.front();
+            m_free.pop_front();
+
+            b->len = 0;
+            b->last = false;
+            return b;
+        }
+
+        // while one thread waits for a free block, there is no active block,
+        // the other callers wait here until it is back (so a message is never interleaved)
+        void wait_active(std::unique_lock<std::mutex> &lock)
+        {
+            m_free_cond.wait(lock, [this]
+                             { return m_active != nullptr; });
+        }
+
+        // waits for a free block (back pressure) and makes it the active block at 'offset'
+        void next_block(std::unique_lock<std::mutex> &lock, std::uint64_t offset)
+        {
+            m_free_cond.wait(lock, [this]
+                             { return !m_free.empty(); });
+
+            m_active = take_free_block();
+            m_active->offset = offset;
+            m_active->segment = m_segment;
+            m_active_offset = offset;
+
+            m_free_cond.notify_all();
+        }
+
+        // hands the active block to the writer thread
+        void submit(bool last)
+        {
+            m_active->last = last;
+            m_queue.push_back(m_active);
+            m_active = nullptr;
+
+            m_cond.notify_all();
+        }
+
+        void rotate(std::unique_lock<std::mutex> &lock)
+        {
+            submit(true);
+
+            m_segment++;
+            m_segment_used = 0;
+            m_rotate_due = false;
+            m_segment_start = std::chrono::steady_clock::now();
+
+            next_block(lock, 0);
+        }
+
+        // writes the partial active block, its unaligned tail moves to the next block
+        void flush_partial(std::unique_lock<std::mutex> &lock)
+        {
+            if (!m_dirty || m_active == nullptr || m_active->len == 0)
+            {
+                return;
+            }
+
+            m_dirty = false;
+
+            auto full = m_active;
+            auto aligned = full->len & ~(alignment - 1);
+            auto tail = full->len - aligned;
+
+            submit(false);
+            next_block(lock, full->offset + aligned);
+
+            // the data of 'full' stays intact even when the writer already returned it,
+            // it may even be the new active block, hence memmove()
+            std::memmove(m_active->data, full->data + aligned, tail);
+            m_active->len = tail;
+        }
+
+        int open_segment(std::uint64_t index)
+        {
+            auto name = segment_name(index);
+            auto flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+            int fd = -1;
+            if (m_opts.direct_io)
+            {
+                fd = ::open(name.c_str(), flags | O_DIRECT, 0644);
+                if (fd == -1 && errno == EINVAL)
+                {
+                    std::cerr << "log_sink: O_DIRECT not supported for " << name << ", using buffered I/O\n";
+                    m_opts.direct_io = false;
+                }
+            }
+
+            if (fd == -1)
+            {
+                fd = ::open(name.c_str(), flags, 0644);
+            }
+
+            if (fd == -1)
+            {
+                throw std::runtime_error("log_sink: failed to open " + name + ": " + std::strerror(errno));
+            }
+
+            // reserve the extents of the whole segment without changing the file size,
+            // filesystems without fallocate() support simply allocate on write
+            ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(m_opts.segment_size));
+
+            return fd;
+        }
+
+        void write_block(int fd, const block &b)
+        {
+            auto len = b.len;
+            if (m_opts.direct_io)
+            {
+                // O_DIRECT needs aligned lengths, the padding is removed by ftruncate() on close
+                len = (len + alignment - 1) & ~(alignment - 1);
+                std::memset(b.data + b.len, 0, len - b.len);
+            }
+
+            std::size_t done = 0;
+            while (done < len)
+            {
+                auto n = ::pwrite(fd, b.data + done, len - done, static_cast<off_t>(b.offset + done));
+                if (n == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    std::cerr << "log_sink: pwrite failed: " << std::strerror(errno) << '\n';
+                    return;
+                }
+
+                done += static_cast<std::size_t>(n);
+            }
+
+            if (!m_opts.direct_io)
+            {
+                // start the write-back now, so dirty pages never pile up in the page cache
+                ::sync_file_range(fd, static_cast<off_t>(b.offset), static_cast<off_t>(b.len), SYNC_FILE_RANGE_WRITE);
+            }
+        }
+
+        void close_segment(int fd, std::uint64_t index, std::uint64_t size)
+        {
+            ::ftruncate(fd, static_cast<off_t>(size));
+            ::close(fd);
+
+            if (m_opts.compress)
+            {
+                std::lock_guard lock{m_compress_mutex};
+                m_compress_queue.push_back(segment_name(index));
+                m_compress_cond.notify_one();
+            }
+        }
+
+        void write_loop()
+        {
+            int fd = -1;
+            std::uint64_t fd_segment = 0;
+            std::uint64_t fd_size = 0;
+
+            std::unique_lock lock{m_mutex};
+            while (true)
+            {
+                m_cond.wait_for(lock, m_opts.flush_interval, [this]
+                                { return m_stop || !m_queue.empty(); });
+
+                // on every pass, busy or idle: rotate by age, or write the partial block once it is due.
+                // The writer does it itself only with an active block and a free one to follow it, which
+                // next_block() then takes without waiting: it must never wait for a block only it can free.
+                // Otherwise the writers are busy anyway: the next write() rotates
+                auto now = std::chrono::steady_clock::now();
+                if (!m_stop && now >= m_next_check)
+                {
+                    m_next_check = now + m_opts.flush_interval;
+                    auto age = now - m_segment_start;
+                    auto expired = m_opts.max_age.count() != 0 && age >= m_opts.max_age && m_segment_used != 0;
+                    if (m_active != nullptr && !m_free.empty())
+                    {
+                        if (expired)
+                        {
+                            rotate(lock);
+                        }
+                        else
+                        {
+                            flush_partial(lock);
+                        }
+                    }
+                    else if (expired)
+                    {
+                        m_rotate_due = true;
+                    }
+                }
+
+                if (m_queue.empty())
+                {
+                    if (m_stop)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+
+                auto b = m_queue.front();
+                m_queue.pop_front();
+                lock.unlock();
+
+                if (b->len == 0 && (fd == -1 || fd_segment != b->segment))
+                {
+                    // nothing was written to this segment, do not create an empty file
+                }
+                else if (fd == -1 || fd_segment != b->segment)
+                {
+                    if (fd != -1)
+                    {
+                        close_segment(fd, fd_segment, fd_size);
+                    }
+
+                    fd = open_segment(b->segment);
+                    fd_segment = b->segment;
+                    fd_size = 0;
+                }
+
+                if (fd != -1 && fd_segment == b->segment)
+                {
+                    write_block(fd, *b);
+                    fd_size = std::max<std::uint64_t>(fd_size, b->offset + b->len);
+                }
+
+                if (b->last && fd != -1 && fd_segment == b->segment)
+                {
+                    close_segment(fd, fd_segment, fd_size);
+                    fd = -1;
+                }
+
+                lock.lock();
+                m_free.push_back(b);
+                m_free_cond.notify_all();
+            }
+
+            if (fd != -1)
+            {
+                close_segment(fd, fd_segment, fd_size);
+            }
+        }
+
+        void compress_loop()
+        {
+            std::unique_lock lock{m_compress_mutex};
+            while (true)
+            {
+                m_compress_cond.wait(lock, [this]
+                                     { return m_compress_stop || !m_compress_queue.empty(); });
+
+                if (m_compress_queue.empty())
+                {
+                    break;
+                }
+
+                auto name = m_compress_queue.front();
+                m_compress_queue.pop_front();
+                lock.unlock();
+
+                // gzip replaces <name> with <name>.gz
+                const char *argv[] = {"gzip", "-f", name.c_str(), nullptr};
+
+                // this thread may run with signals blocked (a server reading them from a signalfd),
+                // gzip must not inherit that mask
+                posix_spawnattr_t attr;
+                ::posix_spawnattr_init(&attr);
+                sigset_t mask;
+                sigemptyset(&mask);
+                ::posix_spawnattr_setsigmask(&attr, &mask);
+                ::posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+                pid_t pid;
+                if (::posix_spawnp(&pid, "gzip", nullptr, &attr, const_cast<char **>(argv), environ) == 0)
+                {
+                    ::waitpid(pid, nullptr, 0);
+                }
+                ::posix_spawnattr_destroy(&attr);
+
+                lock.lock();
+            }
+        }
+
+    private:
+        options m_opts;
+
+        std::mutex m_mutex{};
+        std::condition_variable m_cond{};
+        std::condition_variable m_free_cond{};
+
+        std::deque<block> m_blocks{};
+        std::deque<block *> m_free{};
+        std::deque<block *> m_queue{};
+        block *m_active{nullptr};
+        std::uint64_t m_active_offset{0};
+
+        std::uint64_t m_segment{0};
+        std::uint64_t m_segment_used{0};
+        bool m_dirty{false}; // the active block holds data that has not been flushed
+        std::chrono::steady_clock::time_point m_segment_start{};
+        std::chrono::steady_clock::time_point m_next_check{}; // of the age and the partial block, by the writer
+        bool m_rotate_due{false};                             // max_age passed while the writer could not rotate
+        bool m_stop{false};
+
+        std::thread m_writer{};
+
+        std::mutex m_compress_mutex{};
+        std::condition_variable m_compress_cond{};
+        std::deque<std::string> m_compress_queue{};
+        bool m_compress_stop{false};
+        std::thread m_compressor{};
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_LOG_SINK_HPP
@@ -0,0 +1,265 @@
+/**
+ * @File    : lz4_block.hpp
+ * @Brief   : LZ4 block format compressor (greedy, single hash table) and bounds-checked decompressor
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** LZ4 blocks
+ * LZ4 trades compression ratio for speed: a block is a sequence of
+ *
+ *   token | [literal length bytes] | literals | offset (2 bytes) | [match length bytes]
+ *
+ * the 4 high bits of the token are the number of literals, the 4 low bits the match length minus 4,
+ * a value of 15 continues in extra bytes of 255. A match copies 'length' bytes from 'offset' bytes back
+ * in the output, so decompression is a loop of memcpy() and runs at several GB/s.
+ *
+ * The compressor looks up the next 4 bytes in a hash table of the last position they were seen at (4096 entries),
+ * a hit is extended as far as it matches. Without a hit it skips ahead faster and faster
+ * through incompressible data (1 byte, then 1 + misses / 64).
+ * The format rules of the reference implementation are kept: the last 5 bytes are literals
+ * and no match starts in the last 12 bytes, so lz4 -d and the lz4 libraries read these blocks.
+ *
+ * A block carries no size: the caller stores the uncompressed size next to it.
+ * decompress() checks every length and offset against both buffers and throws on a corrupt block.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_LZ4_BLOCK_HPP
+#define SYSTEM_PROGRAMMING_LZ4_BLOCK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace lz4
+{
+    namespace detail
+    {
+        constexpr std::size_t min_match = 4;
+        constexpr std::size_t last_literals = 5;
+        constexpr std::size_t match_limit = 12;
+        constexpr std::size_t max_offset = 65535;
+        constexpr unsigned hash_bits = 12;
+
+        inline std::uint32_t read32(const std::uint8_t *p)
+        {
+            std::uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline std::uint32_t hash(std::uint32_t sequence)
+        {
+            return (sequence * 2654435761U) >> (32 - hash_bits);
+        }
+
+        inline std::uint8_t *write_length(std::uint8_t *out, std::size_t len)
+        {
+            for (; len >= 255; len -= 255)
+            {
+                *out++ = 255;
+            }
+            *out++ = static_cast<std::uint8_t>(len);
+
+            return out;
+        }
+
+        inline std::uint8_t *write_sequence(std::uint8_t *out, const std::uint8_t *literals, std::size_t num_literals,
+                                            std::size_t offset, std::size_t match_len)
+        {
+            auto token = out++;
+            *token = static_cast<std::uint8_t>((num_literals >= 15 ? 15 : num_literals) << 4);
+            if (num_literals >= 15)
+            {
+                out = write_length(out, num_literals - 15);
+            }
+
+            if (num_literals != 0)
+            {
+                std::memcpy(out, literals, num_literals);
+                out += num_literals;
+            }
+
+            // the last sequence has literals only
+            if (match_len == 0)
+            {
+                return out;
+            }
+
+            *out++ = static_cast<std::uint8_t>(offset);
+            *out++ = static_cast<std::uint8_t>(offset >> 8);
+
+            auto len = match_len - min_match;
+            *token |= static_cast<std::uint8_t>(len >= 15 ? 15 : len);
+            if (len >= 15)
+            {
+                out = write_length(out, len - 15);
+            }
+
+            return out;
+        }
+    }
+
+    // the largest compressed size of 'size' bytes (incompressible data grows a little)
+    constexpr std::size_t compress_bound(std::size_t size)
+    {
+        return size + size / 255 + 16;
+    }
+
+    // compresses [src, src + size) into dst, which holds at least compress_bound(size) bytes.
+    // Returns the compressed size
+    inline std::size_t compress(const void *src, std::size_t size, void *dst)
+    {
+        using namespace detail;
+
+        auto in = static_cast<const std::uint8_t *>(src);
+        auto out = static_cast<std::uint8_t *>(dst);
+        auto start = out;
+
+        std::uint32_t table[1 << hash_bits] = {};
+
+        std::size_t anchor = 0;
+        if (size > match_limit)
+        {
+            auto limit = size - match_limit;
+            auto match_end = size - last_literals;
+
+            std::size_t pos = 1;
+            table[hash(read32(in))] = 0;
+            unsigned misses = 0;
+
+            while (pos < limit)
+            {
+                auto h = hash(read32(in + pos));
+                std::size_t ref = table[h];
+                table[h] = static_cast<std::uint32_t>(pos);
+
+                if (ref >= pos || pos - ref > max_offset || read32(in + ref) != read32(in + pos))
+                {
+                    pos += 1 + (misses++ >> 6);
+                    continue;
+                }
+
+                misses = 0;
+
+                // extend the match backwards over the pending literals, then forwards
+                while (pos > anchor && ref > 0 && in[pos - 1] == in[ref - 1])
+                {
+                    pos--;
+                    ref--;
+                }
+
+                auto len = min_match;
+                while (pos + len < match_end && in[ref + len] == in[pos + len])
+                {
+                    len++;
+                }
+
+                out = write_sequence(out, in + anchor, pos - anchor, pos - ref, len);
+                pos += len;
+                anchor = pos;
+
+                // the position just before the next one, to find repetitions right away
+                if (pos < limit)
+                {
+                    table[hash(read32(in + pos - 2))] = static_cast<std::uint32_t>(pos - 2);
+                }
+            }
+        }
+
+        out = write_sequence(out, in + anchor, size - anchor, 0, 0);
+        return static_cast<std::size_t>(out - start);
+    }
+
+    // decompresses a block into dst (capacity 'capacity'), returns the decompressed size
+    inline std::size_t decompress(const void *src, std::size_t size, void *dst, std::size_t capacity)
+    {
+        auto in = static_cast<const std::uint8_t *>(src);
+        auto in_end = in + size;
+        auto out = static_cast<std::uint8_t *>(dst);
+        auto out_start = out;
+        auto out_end = out + capacity;
+
+        auto corrupt = []
+        {
+            return std::runtime_error("lz4: corrupt block");
+        };
+
+        auto read_length = [&](std::size_t len)
+        {
+            if (len == 15)
+            {
+                std::uint8_t extra;
+                do
+                {
+                    if (in == in_end)
+                    {
+                        throw corrupt();
+                    }
+                    extra = *in++;
+                    len += extra;
+                } while (extra == 255);
+            }
+
+            return len;
+        };
+
+        while (in < in_end)
+        {
+            auto token = *in++;
+
+            auto literals = read_length(token >> 4);
+            if (literals > static_cast<std::size_t>(in_end - in) || literals > static_cast<std::size_t>(out_end - out))
+            {
+                throw corrupt();
+            }
+
+            std::memcpy(out, in, literals);
+            in += literals;
+            out += literals;
+
+            // the last sequence ends after its literals
+            if (in == in_end)
+            {
+                break;
+            }
+
+            if (in_end - in < 2)
+            {
+                throw corrupt();
+            }
+
+            std::size_t offset = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+            in += 2;
+
+            auto len = read_length(token & 15) + detail::min_match;
+            if (offset == 0 || offset > static_cast<std::size_t>(out - out_start) || len > static_cast<std::size_t>(out_end - out))
+            {
+                throw corrupt();
+            }
+
+            // overlapping copies repeat the last 'offset' bytes
+            auto match = out - offset;
+            if (offset >= len)
+            {
+                std::memcpy(out, match, len);
+                out += len;
+            }
+            else
+            {
+                for (std::size_t i = 0; i < len; i++)
+                {
+                    *out++ = *match++;
+                }
+            }
+        }
+
+        return static_cast<std::size_t>(out - out_start);
+    }
+}
+
+#endif // SYSTEM_PROGRAMMING_LZ4_BLOCK_HPP
@@ -0,0 +1,318 @@
+/**
+ * @File    : perf_counters.hpp
+ * @Brief   : Hardware performance counters through perf_event_open()
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * @Command : ./a.out --perf
+ * @Command : cat /proc/sys/kernel/perf_event_paranoid
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Hardware performance counters
+ * Timing tells how long something took, the performance monitoring unit (PMU) of the CPU tells why.
+ * Linux exposes the PMU through the perf_event_open() system call, which returns one file descriptor per event.
+ * Events opened with the same 'group_fd' form a group: they are scheduled onto the PMU together
+ * and a single read() returns all of their values, so the ratios between them are consistent.
+ *
+ * perf::counters opens the following events for the calling thread (pid = 0, cpu = -1):
+ * - cycles, instructions, cache misses, branch misses and dTLB read misses (hardware group),
+ * - page faults (software group, available even when the PMU is not).
+ *
+ * Counting is restricted to user space (exclude_kernel, exclude_hv),
+ * which is allowed for unprivileged users as long as perf_event_paranoid <= 2.
+ * Events that cannot be opened (no PMU in a virtual machine, seccomp, paranoid level 3, ...)
+ * are marked unavailable and simply not reported, the rest keeps working.
+ * When the PMU has fewer counters than requested, the kernel multiplexes the group,
+ * and the values are scaled by time_enabled / time_running.
+ *
+ * The counters belong to the thread that constructed the object,
+ * use perf::thread_counters() to get one instance per thread.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_PERF_COUNTERS_HPP
+#define SYSTEM_PROGRAMMING_PERF_COUNTERS_HPP
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace perf
+{
+    enum class event : std::size_t
+    {
+        cycles,
+        instructions,
+        cache_misses,
+        branch_misses,
+        dtlb_misses,
+        page_faults,
+    };
+
+    constexpr const std::size_t num_events = 6;
+
+    constexpr const char *event_names[num_events] = {
+        "cycles",
+        "instructions",
+        "cache_misses",
+        "branch_misses",
+        "dtlb_misses",
+        "page_faults",
+    };
+
+    // One reading of every event; 'valid' is false for events that could not be counted.
+    struct sample
+    {
+        std::array<double, num_events> values{};
+        std::array<bool, num_events> valid{};
+
+        double operator[](event e) const
+        {
+            return values[static_cast<std::size_t>(e)];
+        }
+    };
+
+    class counters
+    {
+    public:
+        counters()
+        {
+            // the hardware events share one group, page faults get their own
+            int hw_leader = -1;
+            for (auto e : {event::cycles, event::instructions, event::cache_misses,
+                           event::branch_misses, event::dtlb_misses})
+            {
+                hw_leader = add(e, hw_leader);
+            }
+
+            add(event::page_faults, -1);
+        }
+
+        ~counters()
+        {
+            for (auto fd : m_fds)
+            {
+                if (fd != -1)
+                {
+                    ::close(fd);
+                }
+            }
+        }
+
+        counters(const counters &) = delete;
+        counters &operator=(const counters &) = delete;
+
+        bool available(event e) const
+        {
+            return m_fds[static_cast<std::size_t>(e)] != -1;
+        }
+
+        bool any_available() const
+        {
+            return !m_leaders.empty();
+        }
+
+        // errno of the failed perf_event_open() call, 0 if the event is available
+        int error(event e) const
+        {
+            return m_errors[static_cast<std::size_t>(e)];
+        }
+
+        void start()
+        {
+            for (auto fd : m_leaders)
+            {
+                ::ioctl(fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ::ioctl(fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+        }
+
+        sample stop()
+        {
+            for (auto fd : m_leaders)
+            {
+                ::ioctl(fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            }
+
+            sample s{};
+            for (auto fd : m_leaders)
+            {
+                read_group(fd, s);
+            }
+
+            return s;
+        }
+
+    private:
+        // layout of read() with PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING | ID
+        struct read_format
+        {
+            std::uint64_t nr;
+            std::uint64_t time_enabled;
+            std::uint64_t time_running;
+            struct
+            {
+                std::uint64_t value;
+                std::uint64_t id;
+            } values[num_events];
+        };
+
+        static void configure(event e, perf_event_attr &attr)
+        {
+            attr.type = PERF_TYPE_HARDWARE;
+
+            switch (e)
+            {
+            case event::cycles:
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case event::instructions:
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case event::cache_misses:
+                attr.config = PERF_COUNT_HW_CACHE_MISSES;
+                break;
+            case event::branch_misses:
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case event::dtlb_misses:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_DTLB
+                              | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                              | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                break;
+            case event::page_faults:
+                attr.type = PERF_TYPE_SOFTWARE;
+                attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+                break;
+            }
+        }
+
+        static int open_event(event e, int group_fd)
+        {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            configure(e, attr);
+
+            attr.disabled = group_fd == -1 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID
+                               | PERF_FORMAT_TOTAL_TIME_ENABLED
+                               | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+        }
+
+        // Opens 'e' inside the group of 'leader' (or as a new leader), returns the leader to use next.
+        int add(event e, int leader)
+        {
+            auto idx = static_cast<std::size_t>(e);
+
+            auto fd = open_event(e, leader);
+            if (fd == -1 && leader != -1)
+            {
+                // the group may not fit on this PMU, count the event on its own instead
+                fd = open_event(e, -1);
+                if (fd != -1)
+                {
+                    register_event(idx, fd, true);
+                    return leader;
+                }
+            }
+
+            if (fd == -1)
+            {
+                m_errors[idx] = errno;
+                return leader;
+            }
+
+            register_event(idx, fd, leader == -1);
+            return leader == -1 ? fd : leader;
+        }
+
+        void register_event(std::size_t idx, int fd, bool is_leader)
+        {
+            m_fds[idx] = fd;
+
+            std::uint64_t id{};
+            if (::ioctl(fd, PERF_EVENT_IOC_ID, &id) == 0)
+            {
+                m_ids[idx] = id;
+            }
+
+            if (is_leader)
+            {
+                m_leaders.push_back(fd);
+            }
+        }
+
+        void read_group(int fd, sample &s) const
+        {
+            read_format data{};
+            if (::read(fd, &data, sizeof(data)) < static_cast<ssize_t>(3 * sizeof(std::uint64_t)))
+            {
+                return;
+            }
+
+            if (data.time_running == 0)
+            {
+                // never scheduled onto the PMU, nothing meaningful to report
+                return;
+            }
+
+            auto scale = static_cast<double>(data.time_enabled) / static_cast<double>(data.time_running);
+
+            for (std::uint64_t i = 0; i < data.nr && i < num_events; i++)
+            {
+                for (std::size_t idx = 0; idx < num_events; idx++)
+                {
+                    if (m_fds[idx] != -1 && m_ids[idx] == data.values[i].id)
+                    {
+                        s.values[idx] = static_cast<double>(data.values[i].value) * scale;
+                        s.valid[idx] = true;
+                    }
+                }
+            }
+        }
+
+    private:
+        std::array<int, num_events> m_fds{-1, -1, -1, -1, -1, -1};
+        std::array<std::uint64_t, num_events> m_ids{};
+        std::array<int, num_events> m_errors{};
+        std::vector<int> m_leaders{};
+    };
+
+    // The counters of the calling thread, opened on first use.
+    inline counters &thread_counters()
+    {
+        thread_local counters c;
+        return c;
+    }
+
+    // Human readable list of the events that are not available and why.
+    inline std::string unavailable(const counters &c)
+    {
+        std::string msg;
+        for (std::size_t idx = 0; idx < num_events; idx++)
+        {
+            auto e = static_cast<event>(idx);
+            if (!c.available(e))
+            {
+                msg += std::string{event_names[idx]} + ": " + std::strerror(c.error(e)) + '\n';
+            }
+        }
+
+        return msg;
+    }
+}
+
+#endif // SYSTEM_PROGRAMMING_PERF_COUNTERS_HPP
@@ -0,0 +1,657 @@
+/**
+ * @File    : prefork.hpp
+ * @Brief   : Pre-forked multi-process server: SO_REUSEPORT or shared listening socket, CPU pinning, shared counters, socket handover
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp -lpthread
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** One process per core
+ * A server in one process uses one core, and one crash takes every connection with it.
+ * prefork::master creates the listening sockets, then fork()s N workers that accept and serve on them:
+ * - SO_REUSEPORT (default): one listening socket per worker, all bound to the same port. The kernel spreads
+ *   the incoming connections over them by hash, every worker has an accept queue of its own, no lock is shared.
+ * - shared socket: a single listening socket inherited by every worker, registered with EPOLLEXCLUSIVE
+ *   so that a new connection wakes one worker, not all of them.
+ * The sockets belong to the master: a worker that crashes is restarted on the same socket, the connections
+ * that arrived meanwhile wait in its accept queue. A worker that keeps crashing is restarted after a delay
+ * that doubles with every short run (a timerfd in the loop), reset once a run lasted 'stable_after',
+ * as in include/supervisor.hpp. Workers can be pinned to a CPU each (sched_setaffinity).
+ *
+ * The counters of every worker live in a shared page (shm::segment, include/shm_segment.hpp), one cache line
+ * per worker: a worker only writes its own line, the master adds them up (SIGUSR1 prints them).
+ *
+ * Zero-downtime upgrade: the master listens on a UNIX socket ('control_path'). A new master started with the
+ * same options connects to it and receives the listening sockets and the counter page (SCM_RIGHTS).
+ * It starts its workers on them, the old master tells its workers to stop accepting and to finish their
+ * connections, then exits. The listening sockets are never closed: no connection is refused or lost.
+ * Whoever connects gets the sockets, so the control socket lives in a directory only the user can enter
+ * ($XDG_RUNTIME_DIR, or a 0700 directory in /tmp owned by the user), and both sides check the user
+ * of the other one (SO_PEERCRED).
+ *
+ * Signals are read from a signalfd (include/event_loop.hpp), in the master and in every worker:
+ * SIGTERM / SIGINT drain and exit, SIGUSR1 prints the counters.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_PREFORK_HPP
+#define SYSTEM_PROGRAMMING_PREFORK_HPP
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "event_loop.hpp"
+#include "shm_segment.hpp"
+
+namespace prefork
+{
+    constexpr unsigned max_workers = 256;
+
+    struct options
+    {
+        std::uint16_t port{22000};
+        unsigned workers{0};        // 0: one per online CPU
+        bool reuseport{true};       // false: one listening socket shared by every worker
+        bool pin{false};            // worker i runs on CPU i % CPUs
+        std::string control_path{}; // empty: $XDG_RUNTIME_DIR/prefork_<port>.sock or /tmp/prefork-<uid>/prefork_<port>.sock
+
+        // a worker that exits before 'stable_after' is restarted after a delay that doubles every time
+        std::chrono::milliseconds initial_backoff{100};
+        std::chrono::milliseconds max_backoff{30000};
+        std::chrono::milliseconds stable_after{10000};
+    };
+
+    // ---------------------------------------
+    // Shared counters
+    // ---------------------------------------
+    // one cache line per worker, only written by that worker
+    struct alignas(64) worker_stats
+    {
+        std::atomic<std::uint64_t> connections;
+        std::atomic<std::uint64_t> requests;
+        std::atomic<std::uint64_t> bytes;
+        std::atomic<std::int32_t> pid;
+        std::atomic<std::int32_t> cpu;
+    };
+
+    struct stats_page
+    {
+        alignas(64) std::atomic<std::uint64_t> upgrades;
+        std::atomic<std::uint64_t> restarts;
+        std::atomic<std::uint32_t> workers;
+        worker_stats worker[max_workers];
+    };
+
+    // given to the worker function, in the worker process
+    struct worker_context
+    {
+        unsigned index;
+        int listen_fd;
+        bool shared_socket; // register listen_fd with EPOLLEXCLUSIVE
+        worker_stats &stats;
+        events::signals &signals;
+    };
+
+    namespace detail
+    {
+        [[noreturn]] inline void throw_errno(const std::string &what, int error = errno)
+        {
+            throw std::runtime_error(what + ": " + strerror(error));
+        }
+
+        inline int pidfd_open(pid_t pid)
+        {
+            return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+        }
+
+        inline sockaddr_un unix_address(const std::string &path)
+        {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(addr.sun_path))
+            {
+                throw std::runtime_error("prefork: control path too long: " + path);
+            }
+            std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+            return addr;
+        }
+
+        // a directory nobody else can enter: the predictable name in /tmp may have been created by another user
+        inline std::string private_directory()
+        {
+            if (auto runtime = getenv("XDG_RUNTIME_DIR"); runtime != nullptr && runtime[0] == '/')
+            {
+                return runtime;
+            }
+
+            auto dir = "/tmp/prefork-" + std::to_string(getuid());
+            if (mkdir(dir.c_str(), 0700) == -1 && errno != EEXIST)
+            {
+                throw_errno("mkdir " + dir);
+            }
+
+            struct stat st{};
+            if (lstat(dir.c_str(), &st) == -1)
+            {
+                throw_errno("lstat " + dir);
+            }
+            if (!S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 077) != 0)
+            {
+                throw std::runtime_error("prefork: " + dir + " is not a private directory of this user");
+            }
+
+            return dir;
+        }
+
+        // the peer of a control connection must run as the same user
+        inline bool same_user(int fd)
+        {
+            ucred cred{};
+            socklen_t len = sizeof(cred);
+            return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && cred.uid == getuid();
+        }
+    }
+
+    // a non-blocking listening TCP socket on 'port', with SO_REUSEPORT if asked
+    inline int listen_socket(std::uint16_t port, bool reuseport)
+    {
+        auto fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1)
+        {
+            detail::throw_errno("socket");
+        }
+
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1)
+        {
+            auto error = errno;
+            close(fd);
+            detail::throw_errno("setsockopt SO_REUSEPORT", error);
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == -1 || ::listen(fd, SOMAXCONN) == -1)
+        {
+            auto error = errno;
+            close(fd);
+            detail::throw_errno("bind/listen port " + std::to_string(port), error);
+        }
+
+        return fd;
+    }
+
+    // ---------------------------------------
+    // The master
+    // ---------------------------------------
+    class master
+    {
+    public:
+        using worker_function = std::function<void(worker_context &)>;
+
+        master(options opts, worker_function worker_main)
+            : m_opts{std::move(opts)}, m_worker_main{std::move(worker_main)},
+              m_signals{SIGINT, SIGTERM, SIGUSR1}
+        {
+            if (m_opts.control_path.empty())
+            {
+                m_opts.control_path = detail::private_directory() + "/prefork_" + std::to_string(m_opts.port) + ".sock";
+            }
+        }
+
+        ~master()
+        {
+            for (auto fd : m_sockets)
+            {
+                close(fd);
+            }
+            if (m_control != -1)
+            {
+                close(m_control);
+            }
+        }
+
+        // until SIGTERM / SIGINT, or until a newer master took over the sockets
+        void run()
+        {
+            // Step 1. the sockets and the counters: from the running master, or new ones
+            if (!take_over())
+            {
+                auto count = m_opts.workers != 0 ? m_opts.workers : static_cast<unsigned>(sysconf(_SC_NPROCESSORS_ONLN));
+                count = std::min(count, max_workers);
+
+                shm::options page;
+                page.size = sizeof(stats_page);
+                m_page = shm::segment::create(page);
+                new (m_page->data()) stats_page{};
+
+                for (unsigned i = 0; i < (m_opts.reuseport ? count : 1); i++)
+                {
+                    m_sockets.push_back(listen_socket(m_opts.port, m_opts.reuseport));
+                }
+                m_workers.resize(count);
+            }
+            stats().workers.store(static_cast<std::uint32_t>(m_workers.size()), std::memory_order_relaxed);
+
+            // Step 2. the workers
+            for (unsigned i = 0; i < m_workers.size(); i++)
+            {
+                start(i);
+            }
+
+            // Step 3. control socket, signals and worker exits in one loop
+            open_control();
+            m_signals.on(SIGINT, [this](const signalfd_siginfo &)
+                         { shutdown(); });
+            m_signals.on(SIGTERM, [this](const signalfd_siginfo &)
+                         { shutdown(); });
+            m_signals.on(SIGUSR1, [this](const signalfd_siginfo &)
+                         { print(std::cerr); });
+            m_loop.add(m_signals);
+            m_loop.run();
+        }
+
+        stats_page &stats() const
+        {
+            return *m_page->as<stats_page>();
+        }
+
+        void print(std::ostream &os) const
+        {
+            auto &page = stats();
+            os << "upgrades " << page.upgrades << ", restarts " << page.restarts << '\n'
+               << std::setw(8) << "worker" << std::setw(10) << "pid" << std::setw(6) << "cpu" << std::setw(14)
+               << "connections" << std::setw(14) << "requests" << std::setw(16) << "bytes" << '\n';
+            for (unsigned i = 0; i < m_workers.size(); i++)
+            {
+                auto &w = page.worker[i];
+                os << std::setw(8) << i << std::setw(10) << w.pid << std::setw(6) << w.cpu << std::setw(14) << w.connections
+                   << std::setw(14) << w.requests << std::setw(16) << w.bytes << '\n';
+            }
+        }
+
+    private:
+        struct worker_process
+        {
+            pid_t pid{-1};
+            int pidfd{-1};
+            int timer{-1}; // armed while the restart waits out its backoff
+            std::chrono::steady_clock::time_point started{};
+            unsigned failures{}; // consecutive short runs
+        };
+
+        int socket_for(unsigned index) const
+        {
+            return m_sockets[m_sockets.size() == 1 ? 0 : index];
+        }
+
+        // the worker process: its own loop and signalfd, never returns
+        [[noreturn]] void worker_main(unsigned index)
+        {
+            auto code = 0;
+            try
+            {
+                if (m_opts.pin)
+                {
+                    cpu_set_t set;
+                    CPU_ZERO(&set);
+                    CPU_SET(index % static_cast<unsigned>(sysconf(_SC_NPROCESSORS_ONLN)), &set);
+                    sched_setaffinity(0, sizeof(set), &set);
+                }
+
+                auto &w = stats().worker[index];
+                w.pid.store(getpid(), std::memory_order_relaxed);
+                w.cpu.store(sched_getcpu(), std::memory_order_relaxed);
+
+                // only the worker's own socket stays open: a control socket held by a worker would
+                // accept the connection of a new master after this one died
+                for (auto fd : m_sockets)
+                {
+                    if (fd != socket_for(index))
+                    {
+                        close(fd);
+                    }
+                }
+                for (auto &other : m_workers)
+                {
+                    if (other.pidfd != -1)
+                    {
+                        close(other.pidfd);
+                    }
+                    if (other.timer != -1)
+                    {
+                        close(other.timer);
+                    }
+                }
+                if (m_control != -1)
+                {
+                    close(m_control);
+                }
+
+                // the signals are still blocked (inherited mask), the worker reads its own
+                events::signals signals{SIGINT, SIGTERM};
+                worker_context context{index, socket_for(index), m_sockets.size() == 1, w, signals};
+                m_worker_main(context);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "worker " << index << ": " << e.what() << '\n';
+                code = 1;
+            }
+
+            // no destructor of the master's objects runs in the worker
+            std::cout.flush();
+            _exit(code);
+        }
+
+        void start(unsigned index)
+        {
+            auto pid = fork();
+            if (pid == -1)
+            {
+                detail::throw_errno("fork");
+            }
+            if (pid == 0)
+            {
+                worker_main(index);
+            }
+
+            auto pidfd = detail::pidfd_open(pid);
+            if (pidfd == -1)
+            {
+                // a worker the loop cannot watch would never be restarted
+                auto error = errno;
+                kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+                detail::throw_errno("pidfd_open", error);
+            }
+
+            auto &w = m_workers[index];
+            w.pid = pid;
+            w.pidfd = pidfd;
+            w.started = std::chrono::steady_clock::now();
+            m_loop.add(pidfd, EPOLLIN, [this, index](std::uint32_t)
+                       {
+                           guarded(index, [this, index]
+                                   { exited(index); });
+                       });
+        }
+
+        // an exception thrown from a loop callback would end the master and leave the workers unsupervised
+        template <typename FUNC>
+        void guarded(unsigned index, FUNC func)
+        {
+            try
+            {
+                func();
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "worker " << index << ": " << e.what() << std::endl;
+            }
+        }
+
+        // a worker exited: restarted on the same socket, unless the master is stopping
+        void exited(unsigned index)
+        {
+            auto &w = m_workers[index];
+            int status;
+            waitpid(w.pid, &status, 0);
+            m_loop.remove(w.pidfd);
+            close(w.pidfd);
+            w.pid = -1;
+            w.pidfd = -1;
+
+            if (m_stopping)
+            {
+                if (--m_running == 0)
+                {
+                    m_loop.stop();
+                }
+                return;
+            }
+
+            // a long run forgives the earlier crashes, a short one doubles the delay
+            if (std::chrono::steady_clock::now() - w.started >= m_opts.stable_after)
+            {
+                w.failures = 0;
+                restart(index);
+                return;
+            }
+
+            schedule_restart(index);
+        }
+
+        void schedule_restart(unsigned index)
+        {
+            auto &w = m_workers[index];
+            auto delay = m_opts.initial_backoff;
+            for (unsigned i = 0; i < w.failures && delay < m_opts.max_backoff; i++)
+            {
+                delay *= 2;
+            }
+            delay = std::min(delay, m_opts.max_backoff);
+            w.failures++;
+
+            w.timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (w.timer == -1)
+            {
+                detail::throw_errno("timerfd_create");
+            }
+            itimerspec due{};
+            due.it_value.tv_sec = static_cast<time_t>(delay.count() / 1000);
+            due.it_value.tv_nsec = static_cast<long>(delay.count() % 1000) * 1000000;
+            timerfd_settime(w.timer, 0, &due, nullptr);
+            m_loop.add(w.timer, EPOLLIN, [this, index](std::uint32_t)
+                       {
+                           guarded(index, [this, index]
+                                   {
+                                       cancel_restart(m_workers[index]);
+                                       restart(index);
+                                   });
+                       });
+        }
+
+        // a failed fork() counts as a crash at once: tried again after the next delay
+        void restart(unsigned index)
+        {
+            stats().restarts.fetch_add(1, std::memory_order_relaxed);
+            try
+            {
+                start(index);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "worker " << index << ": restart failed: " << e.what() << std::endl;
+                m_workers[index].started = std::chrono::steady_clock::now();
+                schedule_restart(index);
+            }
+        }
+
+        void cancel_restart(worker_process &w)
+        {
+            if (w.timer != -1)
+            {
+                m_loop.remove(w.timer);
+                close(w.timer);
+                w.timer = -1;
+            }
+        }
+
+        void shutdown()
+        {
+            if (m_stopping)
+            {
+                return;
+            }
+
+            close_control();
+            unlink(m_opts.control_path.c_str());
+            stop_workers();
+        }
+
+        // SIGTERM to every worker, the loop ends when the last one exited
+        void stop_workers()
+        {
+            m_stopping = true;
+            m_running = 0;
+            for (auto &w : m_workers)
+            {
+                cancel_restart(w);
+                if (w.pid != -1)
+                {
+                    kill(w.pid, SIGTERM);
+                    m_running++;
+                }
+            }
+            if (m_running == 0)
+            {
+                m_loop.stop();
+            }
+        }
+
+        // ---------------------------------------
+        // Handover
+        // ---------------------------------------
+        // protocol: the old master sends the number of sockets, the counter page, then every listening socket
+        bool take_over()
+        {
+            auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            auto addr = detail::unix_address(m_opts.control_path);
+            if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == -1)
+            {
+                close(fd);
+                return false;
+            }
+            if (!detail::same_user(fd))
+            {
+                close(fd);
+                throw std::runtime_error("prefork: " + m_opts.control_path + " belongs to another user");
+            }
+
+            std::uint32_t header[2];
+            if (::recv(fd, header, sizeof(header), MSG_WAITALL) != sizeof(header))
+            {
+                close(fd);
+                throw std::runtime_error("prefork: handover failed");
+            }
+
+            m_page = shm::segment::receive(fd);
+            for (std::uint32_t i = 0; i < header[0]; i++)
+            {
+                m_sockets.push_back(shm::receive_fd(fd));
+            }
+            m_workers.resize(header[1]);
+            close(fd);
+
+            stats().upgrades.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "took over " << header[0] << " socket(s) for " << header[1] << " worker(s)" << std::endl;
+            return true;
+        }
+
+        void open_control()
+        {
+            // the path of the old master, if any, was left to us
+            unlink(m_opts.control_path.c_str());
+
+            m_control = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            auto addr = detail::unix_address(m_opts.control_path);
+            if (::bind(m_control, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == -1 || ::listen(m_control, 1) == -1)
+            {
+                detail::throw_errno("bind " + m_opts.control_path);
+            }
+
+            m_loop.add(m_control, EPOLLIN, [this](std::uint32_t)
+                       { hand_over(); });
+        }
+
+        void hand_over()
+        {
+            auto fd = ::accept4(m_control, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd == -1)
+            {
+                return;
+            }
+            if (!detail::same_user(fd))
+            {
+                std::cerr << "handover refused: the new master runs as another user" << std::endl;
+                close(fd);
+                return;
+            }
+
+            std::uint32_t header[2] = {static_cast<std::uint32_t>(m_sockets.size()), static_cast<std::uint32_t>(m_workers.size())};
+            try
+            {
+                if (::send(fd, header, sizeof(header), MSG_NOSIGNAL) != sizeof(header))
+                {
+                    detail::throw_errno("send");
+                }
+                m_page->send(fd);
+                for (auto s : m_sockets)
+                {
+                    shm::send_fd(fd, s);
+                }
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "handover failed: " << e.what() << std::endl;
+                close(fd);
+                return;
+            }
+            close(fd);
+
+            // the path belongs to the new master now: closed, not removed
+            close_control();
+            std::cerr << "handed over, draining the old workers" << std::endl;
+            stop_workers();
+        }
+
+        void close_control()
+        {
+            if (m_control != -1)
+            {
+                m_loop.remove(m_control);
+                close(m_control);
+                m_control = -1;
+            }
+        }
+
+        options m_opts;
+        worker_function m_worker_main;
+        events::signals m_signals;
+        events::loop m_loop;
+
+        std::optional<shm::segment> m_page;
+        std::vector<int> m_sockets;
+        std::vector<worker_process> m_workers;
+        int m_control{-1};
+        bool m_stopping{false};
+        unsigned m_running{0};
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_PREFORK_HPP
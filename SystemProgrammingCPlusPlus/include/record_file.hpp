@@ -0,0 +1,413 @@
+/**
+ * @File    : record_file.hpp
+ * @Brief   : Binary record files: versioned header, fixed-width little-endian records, mmap reader, batch writer
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Record files
+ * Reading objects field by field with operator>> parses text: every number is converted
+ * from characters, every string is copied, and the whole file has to be parsed before
+ * the last record can be used.
+ *
+ * A record file stores fixed-width binary records, in the in-memory layout of the record type:
+ *
+ *   +--------------------------+ offset 0
+ *   | header (64 bytes)        | magic "RECF", format version, header size,
+ *   |                          | record type id, record version, record size, record count
+ *   +--------------------------+ offset 64
+ *   | record 0                 |
+ *   | record 1                 |
+ *   | ...                      |
+ *   +--------------------------+
+ *
+ * records::reader maps the file with mmap() and checks the header, after that the records
+ * are a std::span<const RECORD> directly over the mapped pages: no parsing, no copy,
+ * random access in O(1), and opening a file of any size costs the same few system calls.
+ *
+ * The records are stored little-endian, which is the native byte order of x86-64 and AArch64,
+ * so the reader can use them in place (the header enforces it with a static_assert).
+ * A record type must be trivially copyable and must not have padding bytes
+ * (std::has_unique_object_representations), so that the bytes in the file are well defined.
+ * It also declares a type id and a version, a reader refuses a file of another type or version:
+ *
+ *   struct trade
+ *   {
+ *       static constexpr std::uint32_t type_id = 1;
+ *       static constexpr std::uint32_t version = 1;
+ *
+ *       std::uint64_t timestamp;
+ *       std::int64_t price;
+ *   };
+ *
+ * records::writer collects the records in a large buffer (1MB by default) and appends it
+ * with one write() per buffer. The record count in the header is updated by flush() and close(),
+ * a reader of a file that is still being written sees the records of the last flush.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_RECORD_FILE_HPP
+#define SYSTEM_PROGRAMMING_RECORD_FILE_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace records
+{
+    static_assert(std::endian::native == std::endian::little, "record files are read in place, little-endian only");
+
+    constexpr std::uint32_t file_magic = 0x46434552; // "RECF"
+    constexpr std::uint16_t file_version = 1;
+
+    struct header
+    {
+        std::uint32_t magic;
+        std::uint16_t format_version;
+        std::uint16_t header_size;
+        std::uint32_t record_type;
+        std::uint32_t record_version;
+        std::uint32_t record_size;
+        std::uint32_t reserved0;
+        std::uint64_t count;
+        std::uint8_t reserved[32];
+    };
+
+    static_assert(sizeof(header) == 64);
+
+    template <typename RECORD>
+    concept record = std::is_trivially_copyable_v<RECORD> &&
+                     std::has_unique_object_representations_v<RECORD> &&
+                     alignof(RECORD) <= sizeof(header) &&
+                     requires {
+                         { RECORD::type_id } -> std::convertible_to<std::uint32_t>;
+                         { RECORD::version } -> std::convertible_to<std::uint32_t>;
+                     };
+
+    class file_error : public std::runtime_error
+    {
+    public:
+        file_error(const std::string &filename, const std::string &what) : std::runtime_error(filename + ": " + what)
+        {
+        }
+    };
+
+    template <record RECORD>
+    constexpr header make_header(std::uint64_t count)
+    {
+        header h{};
+        h.magic = file_magic;
+        h.format_version = file_version;
+        h.header_size = sizeof(header);
+        h.record_type = RECORD::type_id;
+        h.record_version = RECORD::version;
+        h.record_size = sizeof(RECORD);
+        h.count = count;
+
+        return h;
+    }
+
+    template <record RECORD>
+    void check_header(const std::string &filename, const header &h)
+    {
+        if (h.magic != file_magic)
+        {
+            throw file_error(filename, "not a record file");
+        }
+
+        if (h.format_version != file_version || h.header_size != sizeof(header))
+        {
+            throw file_error(filename, "unsupported record file version " + std::to_string(h.format_version));
+        }
+
+        if (h.record_type != RECORD::type_id || h.record_size != sizeof(RECORD))
+        {
+            throw file_error(filename, "records of type " + std::to_string(h.record_type) + " and size " +
+                                           std::to_string(h.record_size) + " expected type " + std::to_string(RECORD::type_id));
+        }
+
+        if (h.record_version != RECORD::version)
+        {
+            throw file_error(filename, "record version " + std::to_string(h.record_version) + " expected " + std::to_string(RECORD::version));
+        }
+    }
+
+    enum class access
+    {
+        normal,
+        sequential,
+        random
+    };
+
+    // ---------------------------------------
+    // Reader
+    // ---------------------------------------
+    template <record RECORD>
+    class reader
+    {
+    public:
+        explicit reader(const std::string &filename, access hint = access::normal)
+        {
+            auto fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1)
+            {
+                throw file_error(filename, strerror(errno));
+            }
+
+            struct stat st{};
+            if (fstat(fd, &st) == -1 || static_cast<std::size_t>(st.st_size) < sizeof(header))
+            {
+                close(fd);
+                throw file_error(filename, "truncated record file");
+            }
+
+            m_size = static_cast<std::size_t>(st.st_size);
+            m_data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+
+            if (m_data == MAP_FAILED)
+            {
+                throw file_error(filename, strerror(errno));
+            }
+
+            try
+            {
+                check_header<RECORD>(filename, *static_cast<const header *>(m_data));
+            }
+            catch (...)
+            {
+                munmap(m_data, m_size);
+                throw;
+            }
+
+            // the header counts the flushed records, a shorter file (a writer crashed) only exposes its complete records
+            auto count = static_cast<const header *>(m_data)->count;
+            auto available = (m_size - sizeof(header)) / sizeof(RECORD);
+
+            auto first = reinterpret_cast<const RECORD *>(static_cast<const char *>(m_data) + sizeof(header));
+            m_records = std::span<const RECORD>{first, std::min<std::uint64_t>(count, available)};
+
+            if (hint != access::normal)
+            {
+                madvise(m_data, m_size, hint == access::sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+            }
+        }
+
+        ~reader()
+        {
+            if (m_data != nullptr)
+            {
+                munmap(m_data, m_size);
+            }
+        }
+
+        reader(reader &&other) noexcept : m_data{std::exchange(other.m_data, nullptr)}, m_size{other.m_size}, m_records{other.m_records}
+        {
+        }
+
+        reader &operator=(reader &&) = delete;
+        reader(const reader &) = delete;
+
+        std::span<const RECORD> records() const
+        {
+            return m_records;
+        }
+
+        const RECORD &operator[](std::size_t index) const
+        {
+            return m_records[index];
+        }
+
+        std::size_t size() const
+        {
+            return m_records.size();
+        }
+
+        auto begin() const
+        {
+            return m_records.begin();
+        }
+
+        auto end() const
+        {
+            return m_records.end();
+        }
+
+    private:
+        void *m_data{};
+        std::size_t m_size{};
+        std::span<const RECORD> m_records;
+    };
+
+    // ---------------------------------------
+    // Writer
+    // ---------------------------------------
+    enum class mode
+    {
+        truncate,
+        append
+    };
+
+    template <record RECORD>
+    class writer
+    {
+    public:
+        explicit writer(const std::string &filename, mode m = mode::truncate, std::size_t buffer_size = 1 << 20)
+            : m_filename{filename}
+        {
+            m_buffer.reserve(std::max<std::size_t>(1, buffer_size / sizeof(RECORD)));
+
+            auto flags = O_RDWR | O_CREAT | O_CLOEXEC | (m == mode::truncate ? O_TRUNC : 0);
+            m_fd = open(filename.c_str(), flags, 0644);
+            if (m_fd == -1)
+            {
+                throw file_error(filename, strerror(errno));
+            }
+
+            header h{};
+            auto len = pread(m_fd, &h, sizeof(h), 0);
+
+            if (len == 0)
+            {
+                write_header();
+                return;
+            }
+
+            if (len != sizeof(h))
+            {
+                ::close(m_fd);
+                throw file_error(filename, "truncated record file");
+            }
+
+            try
+            {
+                check_header<RECORD>(filename, h);
+            }
+            catch (...)
+            {
+                ::close(m_fd);
+                throw;
+            }
+
+            // append after the last counted record, a partial record of a crashed writer is overwritten
+            m_count = h.count;
+        }
+
+        ~writer()
+        {
+            try
+            {
+                close();
+            }
+            catch (...)
+            {
+            }
+        }
+
+        writer(const writer &) = delete;
+        writer &operator=(const writer &) = delete;
+
+        void append(const RECORD &r)
+        {
+            m_buffer.push_back(r);
+            if (m_buffer.size() == m_buffer.capacity())
+            {
+                write_buffer();
+            }
+        }
+
+        void append(std::span<const RECORD> rs)
+        {
+            for (const auto &r : rs)
+            {
+                append(r);
+            }
+        }
+
+        // writes the buffered records and updates the record count in the header
+        void flush()
+        {
+            write_buffer();
+            write_header();
+        }
+
+        void close()
+        {
+            if (m_fd == -1)
+            {
+                return;
+            }
+
+            flush();
+            ::close(std::exchange(m_fd, -1));
+        }
+
+        // records written, including the buffered ones
+        std::uint64_t size() const
+        {
+            return m_count + m_buffer.size();
+        }
+
+    private:
+        void write_all(const void *data, std::size_t len, std::uint64_t offset)
+        {
+            auto ptr = static_cast<const char *>(data);
+            while (len != 0)
+            {
+                auto ret = pwrite(m_fd, ptr, len, static_cast<off_t>(offset));
+                if (ret == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    throw file_error(m_filename, strerror(errno));
+                }
+
+                ptr += ret;
+                len -= static_cast<std::size_t>(ret);
+                offset += static_cast<std::uint64_t>(ret);
+            }
+        }
+
+        void write_buffer()
+        {
+            if (m_buffer.empty())
+            {
+                return;
+            }
+
+            write_all(m_buffer.data(), m_buffer.size() * sizeof(RECORD), sizeof(header) + m_count * sizeof(RECORD));
+            m_count += m_buffer.size();
+            m_buffer.clear();
+        }
+
+        void write_header()
+        {
+            auto h = make_header<RECORD>(m_count);
+            write_all(&h, sizeof(h), 0);
+        }
+
+        std::string m_filename;
+        int m_fd{-1};
+        std::uint64_t m_count{};
+        std::vector<RECORD> m_buffer;
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_RECORD_FILE_HPP
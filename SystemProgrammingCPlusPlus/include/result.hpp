@@ -0,0 +1,424 @@
+/**
+ * @File    : result.hpp
+ * @Brief   : result<T, E>: a value or an error, returned in registers, propagated with RESULT_TRY
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Errors as values
+ * POSIX return codes (chapter13/posix_style_error.cpp) are cheap but easy to ignore, and the value
+ * travels separately from the error (an out-parameter, or -1 and errno). C++ exceptions cost nothing
+ * while nothing is thrown, but a throw allocates, looks up the unwind tables of every frame and takes
+ * the unwinder's locks: microseconds per throw, too much for an error as ordinary as EAGAIN.
+ *
+ * err::result<T, E> holds either a T or an E (std::errc by default), like std::expected of C++23:
+ *
+ * 1. it is [[nodiscard]], an ignored result is a warning,
+ * 2. when T and E are trivially copyable, so is result<T, E>: up to 16 bytes it is returned in registers
+ *    (rax:rdx on x86-64), result<int> is 8 bytes, result<std::size_t> 16,
+ * 3. E is meant to be small: a code, an enum, or a pointer to a static description, the payload of a
+ *    rich error lives out of line, behind that pointer, instead of widening every successful return,
+ * 4. RESULT_TRY(expr) evaluates to the value of 'expr', or returns its error from the enclosing function,
+ *    the error branch is [[unlikely]] so the compiler moves it out of the fall-through path:
+ *
+ *      err::result<std::size_t> read_header(int fd, header &h)
+ *      {
+ *          auto len = RESULT_TRY(err::read(fd, &h, sizeof(h)));
+ *          if (len != sizeof(h))
+ *          {
+ *              return err::failure{std::errc::message_size};
+ *          }
+ *          return len;
+ *      }
+ *
+ * RESULT_TRY is a GNU statement expression, supported by g++ and clang++.
+ * err::read() and err::write() are read(2) and write(2) with the errno folded into the result.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_RESULT_HPP
+#define SYSTEM_PROGRAMMING_RESULT_HPP
+
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace err
+{
+    // ---------------------------------------
+    // The error side
+    // ---------------------------------------
+    template <typename E>
+    class failure
+    {
+    public:
+        constexpr explicit failure(E error) noexcept(std::is_nothrow_move_constructible_v<E>) : m_error{std::move(error)}
+        {
+        }
+
+        constexpr const E &error() const &
+        {
+            return m_error;
+        }
+
+        constexpr E &&error() &&
+        {
+            return std::move(m_error);
+        }
+
+    private:
+        E m_error;
+    };
+
+    template <typename E>
+    failure(E) -> failure<E>;
+
+    // the error of the last failed system call
+    inline failure<std::errc> last_error() noexcept
+    {
+        return failure{static_cast<std::errc>(errno)};
+    }
+
+    namespace detail
+    {
+        // the value of a result<void>
+        struct none
+        {
+        };
+
+        [[noreturn, gnu::cold]] inline void bad_access()
+        {
+            throw std::logic_error("result: value() of an error");
+        }
+
+        template <typename E>
+        [[noreturn, gnu::cold]] void throw_error(const E &error)
+        {
+            if constexpr (requires { raise(error); })
+            {
+                // an error type with its own exception, found by argument-dependent lookup
+                raise(error);
+            }
+            else if constexpr (std::is_error_code_enum_v<E> || std::is_error_condition_enum_v<E>)
+            {
+                throw std::system_error(std::make_error_code(error));
+            }
+            else
+            {
+                bad_access();
+            }
+        }
+    }
+
+    // ---------------------------------------
+    // result<T, E>
+    // ---------------------------------------
+    template <typename T, typename E = std::errc>
+    class [[nodiscard]] result
+    {
+        static_assert(!std::is_reference_v<T> && !std::is_reference_v<E>, "result: no references");
+
+        static constexpr bool trivial_copy = std::is_trivially_copy_constructible_v<T> && std::is_trivially_copy_constructible_v<E>;
+        static constexpr bool trivial_move = std::is_trivially_move_constructible_v<T> && std::is_trivially_move_constructible_v<E>;
+        static constexpr bool trivial_destroy = std::is_trivially_destructible_v<T> && std::is_trivially_destructible_v<E>;
+        static constexpr bool nothrow_move = std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_constructible_v<E>;
+
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        constexpr result() requires std::is_default_constructible_v<T> : m_value{}, m_ok{true}
+        {
+        }
+
+        constexpr result(const T &value) : m_value(value), m_ok{true}
+        {
+        }
+
+        constexpr result(T &&value) : m_value(std::move(value)), m_ok{true}
+        {
+        }
+
+        template <typename G>
+        requires std::is_constructible_v<E, const G &>
+        constexpr result(const failure<G> &f) : m_error(f.error()), m_ok{false}
+        {
+        }
+
+        template <typename G>
+        requires std::is_constructible_v<E, G &&>
+        constexpr result(failure<G> &&f) : m_error(std::move(f).error()), m_ok{false}
+        {
+        }
+
+        // the special members are trivial when those of T and E are: that is what keeps result in registers
+        constexpr result(const result &) requires trivial_copy = default;
+        constexpr result(const result &other) : m_ok{other.m_ok}
+        {
+            if (m_ok)
+            {
+                std::construct_at(&m_value, other.m_value);
+            }
+            else
+            {
+                std::construct_at(&m_error, other.m_error);
+            }
+        }
+
+        constexpr result(result &&) requires trivial_move = default;
+        constexpr result(result &&other) noexcept(std::is_nothrow_move_constructible_v<T> &&std::is_nothrow_move_constructible_v<E>)
+            : m_ok{other.m_ok}
+        {
+            if (m_ok)
+            {
+                std::construct_at(&m_value, std::move(other.m_value));
+            }
+            else
+            {
+                std::construct_at(&m_error, std::move(other.m_error));
+            }
+        }
+
+        // the old state is destroyed only when the new one can be put in its place without throwing:
+        // a copy is made first and moved in, and assignment needs T and E nothrow move constructible
+        constexpr result &operator=(const result &) requires trivial_copy && trivial_destroy = default;
+        constexpr result &operator=(const result &other) requires(!(trivial_copy && trivial_destroy) && nothrow_move)
+        {
+            if (this != &other)
+            {
+                result copy{other};
+                destroy();
+                std::construct_at(this, std::move(copy));
+            }
+            return *this;
+        }
+
+        constexpr result &operator=(result &&) requires trivial_move && trivial_destroy = default;
+        constexpr result &operator=(result &&other) noexcept requires(!(trivial_move && trivial_destroy) && nothrow_move)
+        {
+            if (this != &other)
+            {
+                destroy();
+                std::construct_at(this, std::move(other));
+            }
+            return *this;
+        }
+
+        constexpr ~result() requires trivial_destroy = default;
+        constexpr ~result()
+        {
+            destroy();
+        }
+
+        constexpr bool has_value() const noexcept
+        {
+            return m_ok;
+        }
+
+        constexpr explicit operator bool() const noexcept
+        {
+            return m_ok;
+        }
+
+        // throws raise(error()) when the error type has one, std::system_error for an error code, std::logic_error otherwise
+        constexpr T &value() &
+        {
+            check();
+            return m_value;
+        }
+
+        constexpr const T &value() const &
+        {
+            check();
+            return m_value;
+        }
+
+        constexpr T &&value() &&
+        {
+            check();
+            return std::move(m_value);
+        }
+
+        // unchecked
+        constexpr T &operator*() & noexcept
+        {
+            return m_value;
+        }
+
+        constexpr const T &operator*() const & noexcept
+        {
+            return m_value;
+        }
+
+        constexpr T &&operator*() && noexcept
+        {
+            return std::move(m_value);
+        }
+
+        constexpr T *operator->() noexcept
+        {
+            return &m_value;
+        }
+
+        constexpr const T *operator->() const noexcept
+        {
+            return &m_value;
+        }
+
+        constexpr const E &error() const & noexcept
+        {
+            return m_error;
+        }
+
+        constexpr E &&error() && noexcept
+        {
+            return std::move(m_error);
+        }
+
+        template <typename U>
+        constexpr T value_or(U &&fallback) const &
+        {
+            return m_ok ? m_value : static_cast<T>(std::forward<U>(fallback));
+        }
+
+    private:
+        constexpr void check() const
+        {
+            if (!m_ok) [[unlikely]]
+            {
+                detail::throw_error(m_error);
+            }
+        }
+
+        constexpr void destroy()
+        {
+            if (m_ok)
+            {
+                std::destroy_at(&m_value);
+            }
+            else
+            {
+                std::destroy_at(&m_error);
+            }
+        }
+
+        union
+        {
+            T m_value;
+            E m_error;
+        };
+        bool m_ok;
+    };
+
+    // ---------------------------------------
+    // result<void, E>: success or an error
+    // ---------------------------------------
+    template <typename E>
+    class [[nodiscard]] result<void, E>
+    {
+    public:
+        using value_type = void;
+        using error_type = E;
+
+        constexpr result() noexcept : m_result{detail::none{}}
+        {
+        }
+
+        template <typename G>
+        requires std::is_constructible_v<E, const G &>
+        constexpr result(const failure<G> &f) : m_result{f}
+        {
+        }
+
+        template <typename G>
+        requires std::is_constructible_v<E, G &&>
+        constexpr result(failure<G> &&f) : m_result{std::move(f)}
+        {
+        }
+
+        constexpr bool has_value() const noexcept
+        {
+            return m_result.has_value();
+        }
+
+        constexpr explicit operator bool() const noexcept
+        {
+            return m_result.has_value();
+        }
+
+        constexpr void value() const
+        {
+            if (!m_result) [[unlikely]]
+            {
+                detail::throw_error(m_result.error());
+            }
+        }
+
+        // unchecked, nothing to return: what RESULT_TRY expands to for result<void>
+        constexpr void operator*() const noexcept
+        {
+        }
+
+        constexpr const E &error() const & noexcept
+        {
+            return m_result.error();
+        }
+
+        constexpr E &&error() && noexcept
+        {
+            return std::move(m_result).error();
+        }
+
+    private:
+        // the same storage as a value, an empty one
+        result<detail::none, E> m_result;
+    };
+
+    static_assert(sizeof(result<int>) == 8 && std::is_trivially_copyable_v<result<int>>);
+    static_assert(sizeof(result<std::size_t>) == 16 && std::is_trivially_copyable_v<result<std::size_t>>);
+
+    // ---------------------------------------
+    // System calls returning results
+    // ---------------------------------------
+    inline result<std::size_t> read(int fd, void *buf, std::size_t count) noexcept
+    {
+        auto len = ::read(fd, buf, count);
+        if (len < 0) [[unlikely]]
+        {
+            return last_error();
+        }
+        return static_cast<std::size_t>(len);
+    }
+
+    inline result<std::size_t> write(int fd, const void *buf, std::size_t count) noexcept
+    {
+        auto len = ::write(fd, buf, count);
+        if (len < 0) [[unlikely]]
+        {
+            return last_error();
+        }
+        return static_cast<std::size_t>(len);
+    }
+}
+
+// the value of 'expr', or return its error from the enclosing function (which returns a result).
+// The value is taken unchecked: it was just tested, value() would test again and pull in the cold throw
+#define RESULT_TRY(...)                                                 \
+    ({                                                                  \
+        auto &&result_try_ = (__VA_ARGS__);                             \
+        if (!result_try_) [[unlikely]]                                  \
+        {                                                               \
+            return ::err::failure{std::move(result_try_).error()};      \
+        }                                                               \
+        *std::move(result_try_);                                        \
+    })
+
+#endif // SYSTEM_PROGRAMMING_RESULT_HPP
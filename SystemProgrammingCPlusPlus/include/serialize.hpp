@@ -0,0 +1,758 @@
+/**
+ * @File    : serialize.hpp
+ * @Brief   : Binary, text and JSON serializers generated at compile time from one constexpr field list per struct
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Field lists
+ * A hand-written operator<< and operator>> per struct repeats the list of its members once per format,
+ * and formats every field through the locale-aware machinery of iostreams.
+ * Here a struct declares its fields once, as a constexpr tuple of (name, pointer to member):
+ *
+ *   struct sample
+ *   {
+ *       std::uint64_t id;
+ *       double value;
+ *       std::string tag;
+ *   };
+ *
+ *   template <>
+ *   inline constexpr auto serial::fields<sample> = std::tuple{
+ *       serial::field("id", &sample::id),
+ *       serial::field("value", &sample::value),
+ *       serial::field("tag", &sample::tag)};
+ *
+ * and every serializer walks that tuple with a fold expression, so the loop over the fields,
+ * the choice of the code per member type and the field names are resolved by the compiler:
+ * - serial::binary: trivially copyable members are copied with memcpy(). A struct whose listed fields
+ *   are all memcpy-able and cover all of its bytes (no padding) is copied with one memcpy(),
+ *   and a std::vector of such structs with one memcpy() for the whole array.
+ *   Strings and vectors are stored as a 32-bit length followed by the elements (little-endian host order).
+ * - serial::text: the fields separated by spaces, numbers with std::to_chars()/std::from_chars()
+ *   (shortest round-trip form for floating point, no locale). Strings must not contain whitespace,
+ *   the same rule as operator>> for std::string.
+ * - serial::json: an object with the field names as keys (writing only).
+ *
+ * The serializers write into a serial::output buffer and read from a serial::input view,
+ * both throw std::runtime_error on truncated or malformed input.
+ * serial::operators provides operator<< and operator>> for std::ostream/std::istream
+ * in the text format, for every described struct.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_SERIALIZE_HPP
+#define SYSTEM_PROGRAMMING_SERIALIZE_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace serial
+{
+    static_assert(std::endian::native == std::endian::little, "the binary format is little-endian");
+
+    // ---------------------------------------
+    // Field lists
+    // ---------------------------------------
+    template <typename Class, typename T>
+    struct field_t
+    {
+        using type = T;
+
+        std::string_view name;
+        T Class::*member;
+    };
+
+    template <typename Class, typename T>
+    constexpr field_t<Class, T> field(std::string_view name, T Class::*member)
+    {
+        return {name, member};
+    }
+
+    struct undescribed
+    {
+    };
+
+    // specialized once per struct with a std::tuple of serial::field()
+    template <typename T>
+    inline constexpr auto fields = undescribed{};
+
+    template <typename T>
+    concept described = !std::is_same_v<std::remove_cvref_t<decltype(fields<T>)>, undescribed>;
+
+    template <described T, typename F>
+    constexpr void for_each_field(F &&func)
+    {
+        std::apply([&](const auto &...f)
+                   { (func(f), ...); },
+                   fields<T>);
+    }
+
+    namespace detail
+    {
+        template <typename T>
+        inline constexpr bool always_false = false;
+
+        template <typename T>
+        struct is_vector : std::false_type
+        {
+        };
+
+        template <typename T, typename A>
+        struct is_vector<std::vector<T, A>> : std::true_type
+        {
+        };
+
+        template <typename T>
+        struct is_array : std::false_type
+        {
+        };
+
+        template <typename T, std::size_t N>
+        struct is_array<std::array<T, N>> : std::true_type
+        {
+        };
+
+        template <typename F>
+        using member_type = typename std::remove_cvref_t<F>::type;
+    }
+
+    // the bytes of T can be stored as they are: no pointers, no padding, no owned memory
+    template <typename T>
+    constexpr bool memcpy_able()
+    {
+        if constexpr (!std::is_trivially_copyable_v<T> || std::is_pointer_v<T> || std::is_member_pointer_v<T>)
+        {
+            return false;
+        }
+        else if constexpr (described<T>)
+        {
+            bool all = true;
+            std::size_t bytes = 0;
+            for_each_field<T>([&](const auto &f)
+                              {
+                                  using M = detail::member_type<decltype(f)>;
+                                  all = all && memcpy_able<M>();
+                                  bytes += sizeof(M);
+                              });
+            return all && bytes == sizeof(T);
+        }
+        else
+        {
+            return std::is_arithmetic_v<T> || std::is_enum_v<T> || std::has_unique_object_representations_v<T>;
+        }
+    }
+
+    // ---------------------------------------
+    // Buffers
+    // ---------------------------------------
+    class output
+    {
+    public:
+        // room for 'size' bytes at the end, made part of the output by commit()
+        char *reserve(std::size_t size)
+        {
+            if (m_size + size > m_capacity)
+            {
+                auto capacity = std::max({m_capacity * 2, m_size + size, std::size_t{256}});
+                auto data = std::make_unique_for_overwrite<char[]>(capacity);
+                if (m_size != 0)
+                {
+                    std::memcpy(data.get(), m_data.get(), m_size);
+                }
+
+                m_data = std::move(data);
+                m_capacity = capacity;
+            }
+
+            return m_data.get() + m_size;
+        }
+
+        void commit(std::size_t size)
+        {
+            m_size += size;
+        }
+
+        void write(const void *data, std::size_t size)
+        {
+            if (size != 0)
+            {
+                std::memcpy(reserve(size), data, size);
+                m_size += size;
+            }
+        }
+
+        void put(char c)
+        {
+            *reserve(1) = c;
+            m_size++;
+        }
+
+        const char *data() const
+        {
+            return m_data.get();
+        }
+
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+        std::string_view view() const
+        {
+            return {m_data.get(), m_size};
+        }
+
+        void clear()
+        {
+            m_size = 0;
+        }
+
+    private:
+        std::unique_ptr<char[]> m_data;
+        std::size_t m_size{};
+        std::size_t m_capacity{};
+    };
+
+    class input
+    {
+    public:
+        explicit input(std::string_view data) : m_data{data}
+        {
+        }
+
+        const char *take(std::size_t size)
+        {
+            if (size > remaining())
+            {
+                throw std::runtime_error("serial: truncated input");
+            }
+
+            auto ptr = m_data.data() + m_pos;
+            m_pos += size;
+            return ptr;
+        }
+
+        void read(void *data, std::size_t size)
+        {
+            if (size != 0)
+            {
+                std::memcpy(data, take(size), size);
+            }
+        }
+
+        // the next whitespace-delimited token (text format)
+        std::string_view token()
+        {
+            auto is_space = [](char c)
+            {
+                return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+            };
+
+            while (m_pos < m_data.size() && is_space(m_data[m_pos]))
+            {
+                m_pos++;
+            }
+
+            auto start = m_pos;
+            while (m_pos < m_data.size() && !is_space(m_data[m_pos]))
+            {
+                m_pos++;
+            }
+
+            if (start == m_pos)
+            {
+                throw std::runtime_error("serial: unexpected end of input");
+            }
+
+            return m_data.substr(start, m_pos - start);
+        }
+
+        std::size_t remaining() const
+        {
+            return m_data.size() - m_pos;
+        }
+
+        bool empty() const
+        {
+            return m_pos == m_data.size();
+        }
+
+    private:
+        std::string_view m_data;
+        std::size_t m_pos{};
+    };
+
+    // ---------------------------------------
+    // Binary
+    // ---------------------------------------
+    namespace binary
+    {
+        inline void write_size(output &out, std::size_t size)
+        {
+            if (size > UINT32_MAX)
+            {
+                throw std::length_error("serial: sequence too long");
+            }
+
+            auto n = static_cast<std::uint32_t>(size);
+            out.write(&n, sizeof(n));
+        }
+
+        inline std::size_t read_size(input &in, std::size_t element_size)
+        {
+            std::uint32_t n;
+            in.read(&n, sizeof(n));
+
+            // every element takes at least one byte, a corrupt size must not allocate gigabytes
+            if (n > in.remaining() / std::max<std::size_t>(element_size, 1))
+            {
+                throw std::runtime_error("serial: truncated input");
+            }
+
+            return n;
+        }
+
+        template <typename T>
+        void write(output &out, const T &value)
+        {
+            if constexpr (memcpy_able<T>())
+            {
+                out.write(&value, sizeof(T));
+            }
+            else if constexpr (std::is_same_v<T, std::string>)
+            {
+                write_size(out, value.size());
+                out.write(value.data(), value.size());
+            }
+            else if constexpr (detail::is_vector<T>::value || detail::is_array<T>::value)
+            {
+                using E = typename T::value_type;
+                if constexpr (detail::is_vector<T>::value)
+                {
+                    write_size(out, value.size());
+                }
+
+                if constexpr (memcpy_able<E>())
+                {
+                    out.write(value.data(), value.size() * sizeof(E));
+                }
+                else
+                {
+                    for (const auto &element : value)
+                    {
+                        write(out, element);
+                    }
+                }
+            }
+            else if constexpr (described<T>)
+            {
+                for_each_field<T>([&](const auto &f)
+                                  { write(out, value.*f.member); });
+            }
+            else
+            {
+                static_assert(detail::always_false<T>, "serial: no binary form for this type");
+            }
+        }
+
+        template <typename T>
+        void read(input &in, T &value)
+        {
+            if constexpr (memcpy_able<T>())
+            {
+                in.read(&value, sizeof(T));
+            }
+            else if constexpr (std::is_same_v<T, std::string>)
+            {
+                auto size = read_size(in, 1);
+                value.assign(in.take(size), size);
+            }
+            else if constexpr (detail::is_vector<T>::value || detail::is_array<T>::value)
+            {
+                using E = typename T::value_type;
+                if constexpr (detail::is_vector<T>::value)
+                {
+                    value.resize(read_size(in, memcpy_able<E>() ? sizeof(E) : 1));
+                }
+
+                if constexpr (memcpy_able<E>())
+                {
+                    in.read(value.data(), value.size() * sizeof(E));
+                }
+                else
+                {
+                    for (auto &element : value)
+                    {
+                        read(in, element);
+                    }
+                }
+            }
+            else if constexpr (described<T>)
+            {
+                for_each_field<T>([&](const auto &f)
+                                  { read(in, value.*f.member); });
+            }
+            else
+            {
+                static_assert(detail::always_false<T>, "serial: no binary form for this type");
+            }
+        }
+    }
+
+    // ---------------------------------------
+    // Text
+    // ---------------------------------------
+    namespace text
+    {
+        template <typename T>
+        void write(output &out, const T &value)
+        {
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                out.put(value ? '1' : '0');
+            }
+            else if constexpr (std::is_arithmetic_v<T>)
+            {
+                constexpr std::size_t room = 64;
+                auto ptr = out.reserve(room);
+                auto result = std::to_chars(ptr, ptr + room, value);
+                out.commit(static_cast<std::size_t>(result.ptr - ptr));
+            }
+            else if constexpr (std::is_enum_v<T>)
+            {
+                write(out, static_cast<std::underlying_type_t<T>>(value));
+            }
+            else if constexpr (std::is_same_v<T, std::string>)
+            {
+                out.write(value.data(), value.size());
+            }
+            else if constexpr (detail::is_vector<T>::value || detail::is_array<T>::value)
+            {
+                if constexpr (detail::is_vector<T>::value)
+                {
+                    write(out, value.size());
+                    out.put(' ');
+                }
+
+                auto first = true;
+                for (const auto &element : value)
+                {
+                    if (!first)
+                    {
+                        out.put(' ');
+                    }
+                    first = false;
+                    write(out, element);
+                }
+            }
+            else if constexpr (described<T>)
+            {
+                auto first = true;
+                for_each_field<T>([&](const auto &f)
+                                  {
+                                      if (!first)
+                                      {
+                                          out.put(' ');
+                                      }
+                                      first = false;
+                                      write(out, value.*f.member);
+                                  });
+            }
+            else
+            {
+                static_assert(detail::always_false<T>, "serial: no text form for this type");
+            }
+        }
+
+        // SOURCE has token(): serial::input, or the std::istream adapter of serial::operators
+        template <typename SOURCE, typename T>
+        void read(SOURCE &in, T &value)
+        {
+            if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+            {
+                auto token = in.token();
+                auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+                if (result.ec != std::errc{} || result.ptr != token.data() + token.size())
+                {
+                    throw std::runtime_error("serial: not a number: " + std::string{token});
+                }
+            }
+            else if constexpr (std::is_same_v<T, bool>)
+            {
+                auto token = in.token();
+                if (token != "0" && token != "1")
+                {
+                    throw std::runtime_error("serial: not a bool: " + std::string{token});
+                }
+                value = token == "1";
+            }
+            else if constexpr (std::is_enum_v<T>)
+            {
+                std::underlying_type_t<T> raw;
+                read(in, raw);
+                value = static_cast<T>(raw);
+            }
+            else if constexpr (std::is_same_v<T, std::string>)
+            {
+                value = in.token();
+            }
+            else if constexpr (detail::is_vector<T>::value || detail::is_array<T>::value)
+            {
+                if constexpr (detail::is_vector<T>::value)
+                {
+                    std::size_t size;
+                    read(in, size);
+                    value.clear();
+                    value.resize(size);
+                }
+
+                for (auto &element : value)
+                {
+                    read(in, element);
+                }
+            }
+            else if constexpr (described<T>)
+            {
+                for_each_field<T>([&](const auto &f)
+                                  { read(in, value.*f.member); });
+            }
+            else
+            {
+                static_assert(detail::always_false<T>, "serial: no text form for this type");
+            }
+        }
+    }
+
+    // ---------------------------------------
+    // JSON
+    // ---------------------------------------
+    namespace json
+    {
+        // the index of the first byte at or after 'pos' that must be escaped: a control character, '"' or '\\'
+        inline std::size_t find_escape(std::string_view str, std::size_t pos)
+        {
+            // 8 bytes per step, the bytes of a word are tested at once (SWAR)
+            constexpr std::uint64_t ones = 0x0101010101010101;
+            constexpr std::uint64_t highs = 0x8080808080808080;
+
+            for (; pos + 8 <= str.size(); pos += 8)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, str.data() + pos, 8);
+
+                auto below_space = (word - ones * 0x20) & ~word;
+                auto quote = ((word ^ (ones * '"')) - ones) & ~(word ^ (ones * '"'));
+                auto backslash = ((word ^ (ones * '\\')) - ones) & ~(word ^ (ones * '\\'));
+                if (((below_space | quote | backslash) & highs) != 0)
+                {
+                    break;
+                }
+            }
+
+            for (; pos < str.size(); pos++)
+            {
+                auto c = static_cast<unsigned char>(str[pos]);
+                if (c < 0x20 || c == '"' || c == '\\')
+                {
+                    break;
+                }
+            }
+
+            return pos;
+        }
+
+        inline void write_string(output &out, std::string_view str)
+        {
+            constexpr char hex[] = "0123456789abcdef";
+
+            out.put('"');
+
+            // copy the runs that need no escaping in one piece
+            for (std::size_t pos = 0;;)
+            {
+                auto next = find_escape(str, pos);
+                out.write(str.data() + pos, next - pos);
+                if (next == str.size())
+                {
+                    break;
+                }
+
+                auto c = static_cast<unsigned char>(str[next]);
+                char escaped[6] = {'\\', static_cast<char>(c), 0, 0, 0, 0};
+                std::size_t len = 2;
+                switch (c)
+                {
+                case '\n':
+                    escaped[1] = 'n';
+                    break;
+                case '\t':
+                    escaped[1] = 't';
+                    break;
+                case '\r':
+                    escaped[1] = 'r';
+                    break;
+                case '"':
+                case '\\':
+                    break;
+                default:
+                    std::memcpy(escaped, "\\u00", 4);
+                    escaped[4] = hex[c >> 4];
+                    escaped[5] = hex[c & 15];
+                    len = 6;
+                    break;
+                }
+                out.write(escaped, len);
+                pos = next + 1;
+            }
+
+            out.put('"');
+        }
+
+        template <typename T>
+        void write(output &out, const T &value)
+        {
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                value ? out.write("true", 4) : out.write("false", 5);
+            }
+            else if constexpr (std::is_floating_point_v<T>)
+            {
+                // JSON has no representation for NaN and infinity
+                if (value != value || value - value != 0)
+                {
+                    out.write("null", 4);
+                }
+                else
+                {
+                    text::write(out, value);
+                }
+            }
+            else if constexpr (std::is_arithmetic_v<T>)
+            {
+                text::write(out, value);
+            }
+            else if constexpr (std::is_enum_v<T>)
+            {
+                text::write(out, static_cast<std::underlying_type_t<T>>(value));
+            }
+            else if constexpr (std::is_same_v<T, std::string>)
+            {
+                write_string(out, value);
+            }
+            else if constexpr (detail::is_vector<T>::value || detail::is_array<T>::value)
+            {
+                out.put('[');
+                auto first = true;
+                for (const auto &element : value)
+                {
+                    if (!first)
+                    {
+                        out.put(',');
+                    }
+                    first = false;
+                    write(out, element);
+                }
+                out.put(']');
+            }
+            else if constexpr (described<T>)
+            {
+                out.put('{');
+                auto first = true;
+                for_each_field<T>([&](const auto &f)
+                                  {
+                                      if (!first)
+                                      {
+                                          out.put(',');
+                                      }
+                                      first = false;
+                                      // field names are identifiers, they need no escaping
+                                      out.put('"');
+                                      out.write(f.name.data(), f.name.size());
+                                      out.write("\":", 2);
+                                      write(out, value.*f.member);
+                                  });
+                out.put('}');
+            }
+            else
+            {
+                static_assert(detail::always_false<T>, "serial: no JSON form for this type");
+            }
+        }
+    }
+
+    // ---------------------------------------
+    // std::ostream / std::istream in the text format
+    // ---------------------------------------
+    namespace operators
+    {
+        namespace detail
+        {
+            class stream_source
+            {
+            public:
+                explicit stream_source(std::istream &is) : m_is{is}
+                {
+                }
+
+                std::string_view token()
+                {
+                    if (!(m_is >> m_token))
+                    {
+                        throw std::runtime_error("serial: unexpected end of input");
+                    }
+
+                    return m_token;
+                }
+
+            private:
+                std::istream &m_is;
+                std::string m_token;
+            };
+        }
+
+        template <described T>
+        std::ostream &operator<<(std::ostream &os, const T &value)
+        {
+            thread_local output buffer;
+            buffer.clear();
+            text::write(buffer, value);
+
+            return os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        }
+
+        // like operator>> of the fields: a malformed or missing field sets failbit
+        template <described T>
+        std::istream &operator>>(std::istream &is, T &value)
+        {
+            try
+            {
+                detail::stream_source source{is};
+                text::read(source, value);
+            }
+            catch (const std::runtime_error &)
+            {
+                is.setstate(std::ios::failbit);
+            }
+
+            return is;
+        }
+    }
+}
+
+#endif // SYSTEM_PROGRAMMING_SERIALIZE_HPP
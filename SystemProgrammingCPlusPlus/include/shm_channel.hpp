@@ -0,0 +1,639 @@
+/**
+ * @File    : shm_channel.hpp
+ * @Brief   : Process-shared single-producer/single-consumer message ring in a memfd, futex blocking
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** A pipe without the kernel in the data path
+ * Every write() into a pipe copies the message into the kernel, every read() copies it out again,
+ * and both are system calls. Two processes that share memory can exchange messages with
+ * loads and stores only, and enter the kernel only to sleep when there is nothing to do.
+ *
+ * ipc::channel is a memfd (memfd_create) holding one page of control words followed by the ring:
+ *
+ *   | magic, capacity | head (producer) | tail (consumer) | closed, pids |  ring (capacity bytes)  |
+ *                      own cache line    own cache line
+ *
+ * The ring is mapped twice, back to back, so a message that wraps around the end of the ring
+ * is still contiguous in memory: it can be written and read in place, there is no copy and no split.
+ * A message is a 8-byte header (its length) and the payload, padded to 8 bytes.
+ * The memfd is inherited by fork(), or passed to another process as a file descriptor (ipc::channel::attach()).
+ *
+ * ipc::producer::claim() returns the space for the next message directly in the ring and
+ * commit() appends it. The head is published to the consumer in batches ('batch_bytes' of messages,
+ * or flush()), one store per batch instead of one per message.
+ * ipc::consumer::receive() returns a view of the next message in the ring, valid until the next call;
+ * the space is handed back to the producer in batches as well.
+ * Each side caches the last index it read from the other one and only reloads it (a cache miss
+ * on the other side's line) when the ring looks empty or full.
+ *
+ * An empty (or full) ring is first polled 'spin' times, then the waiting side sleeps with futex(FUTEX_WAIT)
+ * on a 32-bit word in the shared page. The other side checks a 'sleeping' flag after publishing and
+ * calls FUTEX_WAKE only when it is set, so the common case has no system call at all.
+ * (std::atomic<T>::wait() is not used: libstdc++ waits with private futexes, which do not work across processes.)
+ *
+ * Either side may go away: the producer close()s the channel, the consumer is closed when it is destroyed,
+ * and a process can die without doing either. Each side stores its pid in the shared page, and a sleeping
+ * side wakes up every 'peer_check' to see whether the other process still exists (kill(pid, 0)).
+ * A producer whose consumer is gone and a consumer whose producer died without close() throw,
+ * instead of waiting forever.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_SHM_CHANNEL_HPP
+#define SYSTEM_PROGRAMMING_SHM_CHANNEL_HPP
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+namespace ipc
+{
+    namespace detail
+    {
+        constexpr std::uint64_t magic = 0x4C4E414843504953; // "SPSCHANL"
+        constexpr std::size_t control_size = 4096;
+        constexpr std::size_t header_size = 8;
+
+        struct control
+        {
+            std::uint64_t magic;
+            std::uint64_t capacity;
+
+            // written by the producer
+            alignas(64) std::atomic<std::uint64_t> head;
+            std::atomic<std::uint32_t> data_signal;
+            std::atomic<std::uint32_t> consumer_sleeping;
+
+            // written by the consumer
+            alignas(64) std::atomic<std::uint64_t> tail;
+            std::atomic<std::uint32_t> space_signal;
+            std::atomic<std::uint32_t> producer_sleeping;
+
+            alignas(64) std::atomic<std::uint32_t> closed; // by the producer
+            std::atomic<std::uint32_t> consumer_closed;
+
+            // the processes of both sides, 0 until they attached
+            std::atomic<std::int32_t> producer_pid;
+            std::atomic<std::int32_t> consumer_pid;
+        };
+
+        static_assert(sizeof(control) <= control_size);
+        static_assert(std::atomic<std::uint32_t>::is_always_lock_free && sizeof(std::atomic<std::uint32_t>) == 4);
+
+        // shared (not FUTEX_PRIVATE_FLAG) futexes: the word lives in memory mapped by several processes.
+        // false when nobody woke us up within 'timeout'
+        inline bool futex_wait(std::atomic<std::uint32_t> &word, std::uint32_t expected, std::chrono::milliseconds timeout)
+        {
+            timespec ts{static_cast<time_t>(timeout.count() / 1000), static_cast<long>(timeout.count() % 1000) * 1000000};
+            return syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0) == 0 ||
+                   errno != ETIMEDOUT;
+        }
+
+        inline void futex_wake(std::atomic<std::uint32_t> &word)
+        {
+            syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+
+        inline void cpu_relax()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+        }
+
+        constexpr std::size_t align8(std::size_t size)
+        {
+            return (size + 7) & ~std::size_t{7};
+        }
+
+        // publishes 'value' and wakes the other side if it went to sleep (see wait())
+        inline void publish(std::atomic<std::uint64_t> &index, std::uint64_t value,
+                            std::atomic<std::uint32_t> &sleeping, std::atomic<std::uint32_t> &signal)
+        {
+            // seq_cst store and load: either the sleeper sees the new index, or we see its flag
+            index.store(value, std::memory_order_seq_cst);
+            if (sleeping.load(std::memory_order_seq_cst) != 0)
+            {
+                signal.fetch_add(1, std::memory_order_seq_cst);
+                futex_wake(signal);
+            }
+        }
+
+        // false once the process of the other side is gone; a side that did not attach yet (0) counts as alive.
+        // A child that exited stays a zombie until its parent waits for it, kill(pid, 0) still succeeds then:
+        // the state in /proc tells. A recycled pid makes a dead peer look alive, which only delays the error.
+        inline bool alive(const std::atomic<std::int32_t> &pid)
+        {
+            auto value = pid.load(std::memory_order_acquire);
+            if (value == 0)
+            {
+                return true;
+            }
+            if (kill(value, 0) == -1 && errno == ESRCH)
+            {
+                return false;
+            }
+
+            // "pid (comm) S ...", the command may contain spaces and parentheses: the state follows the last ')'
+            char stat[512];
+            auto fd = open(("/proc/" + std::to_string(value) + "/stat").c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                return errno != ENOENT;
+            }
+            auto len = read(fd, stat, sizeof(stat));
+            ::close(fd);
+
+            std::string_view line{stat, len > 0 ? static_cast<std::size_t>(len) : 0};
+            auto end = line.rfind(')');
+            return end == std::string_view::npos || end + 2 >= line.size() || (line[end + 2] != 'Z' && line[end + 2] != 'X');
+        }
+
+        // spins, then sleeps until ready() or closed, or until the 'peer' process is gone
+        template <typename READY>
+        void wait(READY ready, unsigned spin, std::chrono::milliseconds peer_check, const std::atomic<std::uint32_t> &closed,
+                  const std::atomic<std::int32_t> &peer, std::atomic<std::uint32_t> &sleeping, std::atomic<std::uint32_t> &signal)
+        {
+            // with one CPU the other side cannot make progress while we poll
+            static const bool single_cpu = sysconf(_SC_NPROCESSORS_ONLN) == 1;
+
+            for (unsigned i = 0; !single_cpu && i < spin; i++)
+            {
+                if (ready() || closed.load(std::memory_order_acquire) != 0)
+                {
+                    return;
+                }
+                cpu_relax();
+            }
+
+            while (true)
+            {
+                sleeping.store(1, std::memory_order_seq_cst);
+                auto value = signal.load(std::memory_order_seq_cst);
+                if (ready() || closed.load(std::memory_order_seq_cst) != 0)
+                {
+                    sleeping.store(0, std::memory_order_relaxed);
+                    return;
+                }
+
+                // returns at once if 'signal' changed since it was read, after 'peer_check' at the latest.
+                // Only a quiet peer is checked, the check reads /proc
+                auto woken = futex_wait(signal, value, peer_check);
+                sleeping.store(0, std::memory_order_relaxed);
+
+                if (!woken && !alive(peer))
+                {
+                    return;
+                }
+            }
+        }
+    }
+
+    // ---------------------------------------
+    // The shared segment
+    // ---------------------------------------
+    class channel
+    {
+    public:
+        // a new channel, 'capacity' is rounded up to a power of two and at least one page
+        static channel create(std::size_t capacity = 1 << 20)
+        {
+            std::size_t size = 4096;
+            while (size < capacity)
+            {
+                size *= 2;
+            }
+
+            auto fd = memfd_create("ipc_channel", MFD_CLOEXEC);
+            if (fd < 0)
+            {
+                throw std::runtime_error(std::string{"memfd_create: "} + strerror(errno));
+            }
+
+            if (ftruncate(fd, static_cast<off_t>(detail::control_size + size)) < 0)
+            {
+                auto error = errno;
+                ::close(fd);
+                throw std::runtime_error(std::string{"ftruncate: "} + strerror(error));
+            }
+
+            channel ch{fd};
+            ch.m_control->magic = detail::magic;
+            ch.m_control->capacity = size;
+            ch.map_ring();
+
+            return ch;
+        }
+
+        // a channel created by another process, 'fd' is duplicated.
+        // The header comes from the other process: the capacity is checked against the size of the memfd
+        static channel attach(int fd)
+        {
+            struct stat st{};
+            if (fstat(fd, &st) < 0)
+            {
+                throw std::runtime_error(std::string{"fstat: "} + strerror(errno));
+            }
+            auto size = static_cast<std::uint64_t>(st.st_size);
+            if (size < detail::control_size)
+            {
+                throw std::runtime_error("ipc::channel: not a channel");
+            }
+
+            auto dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+            if (dup_fd < 0)
+            {
+                throw std::runtime_error(std::string{"fcntl: "} + strerror(errno));
+            }
+
+            channel ch{dup_fd};
+            if (ch.m_control->magic != detail::magic)
+            {
+                throw std::runtime_error("ipc::channel: not a channel");
+            }
+
+            auto capacity = ch.m_control->capacity;
+            if (capacity < 4096 || (capacity & (capacity - 1)) != 0 || capacity > size - detail::control_size)
+            {
+                throw std::runtime_error("ipc::channel: invalid capacity " + std::to_string(capacity));
+            }
+            ch.map_ring();
+
+            return ch;
+        }
+
+        channel(channel &&other) noexcept
+            : m_fd{std::exchange(other.m_fd, -1)},
+              m_control{std::exchange(other.m_control, nullptr)},
+              m_ring{std::exchange(other.m_ring, nullptr)},
+              m_capacity{other.m_capacity}
+        {
+        }
+
+        channel &operator=(channel &&other) noexcept
+        {
+            std::swap(m_fd, other.m_fd);
+            std::swap(m_control, other.m_control);
+            std::swap(m_ring, other.m_ring);
+            std::swap(m_capacity, other.m_capacity);
+            return *this;
+        }
+
+        ~channel()
+        {
+            if (m_ring != nullptr)
+            {
+                munmap(m_ring, 2 * m_capacity);
+            }
+            if (m_control != nullptr)
+            {
+                munmap(m_control, detail::control_size);
+            }
+            if (m_fd >= 0)
+            {
+                ::close(m_fd);
+            }
+        }
+
+        int fd() const
+        {
+            return m_fd;
+        }
+
+        std::size_t capacity() const
+        {
+            return m_capacity;
+        }
+
+        detail::control &control() const
+        {
+            return *m_control;
+        }
+
+        char *ring() const
+        {
+            return m_ring;
+        }
+
+    private:
+        explicit channel(int fd) : m_fd{fd}
+        {
+            auto ptr = mmap(nullptr, detail::control_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (ptr == MAP_FAILED)
+            {
+                auto error = errno;
+                ::close(fd);
+                m_fd = -1;
+                throw std::runtime_error(std::string{"mmap: "} + strerror(error));
+            }
+
+            m_control = static_cast<detail::control *>(ptr);
+        }
+
+        // the ring twice, back to back: reserve the address range, then map the same pages into both halves
+        void map_ring()
+        {
+            m_capacity = m_control->capacity;
+
+            auto base = mmap(nullptr, 2 * m_capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base == MAP_FAILED)
+            {
+                throw std::runtime_error(std::string{"mmap: "} + strerror(errno));
+            }
+
+            m_ring = static_cast<char *>(base);
+            for (auto half : {m_ring, m_ring + m_capacity})
+            {
+                if (mmap(half, m_capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_fd, detail::control_size) == MAP_FAILED)
+                {
+                    throw std::runtime_error(std::string{"mmap: "} + strerror(errno));
+                }
+            }
+        }
+
+        int m_fd{-1};
+        detail::control *m_control{nullptr};
+        char *m_ring{nullptr};
+        std::size_t m_capacity{};
+    };
+
+    struct options
+    {
+        std::size_t batch_bytes{4096};                 // publish after this many bytes of messages, 0 publishes every message
+        unsigned spin{2000};                           // polls before sleeping on the futex (not on a single CPU)
+        std::chrono::milliseconds peer_check{100};     // a sleeping side checks this often that the other one still exists
+    };
+
+    // ---------------------------------------
+    // Writing side
+    // ---------------------------------------
+    class producer
+    {
+    public:
+        explicit producer(channel &ch, options opts = {})
+            : m_control{ch.control()}, m_ring{ch.ring()}, m_capacity{ch.capacity()}, m_opts{opts}
+        {
+            m_head = m_published = m_control.head.load(std::memory_order_relaxed);
+            m_tail_cache = m_control.tail.load(std::memory_order_acquire);
+            m_control.producer_pid.store(getpid(), std::memory_order_release);
+        }
+
+        producer(const producer &) = delete;
+        producer &operator=(const producer &) = delete;
+
+        ~producer()
+        {
+            flush();
+        }
+
+        // space for a message of 'size' bytes in the ring, waits while the ring is full
+        std::span<char> claim(std::size_t size)
+        {
+            auto need = detail::header_size + detail::align8(size);
+            if (need > m_capacity / 2)
+            {
+                throw std::length_error("ipc::producer: message larger than half the ring");
+            }
+
+            if (m_capacity - (m_head - m_tail_cache) < need)
+            {
+                wait_for_space(need);
+            }
+
+            return {m_ring + (m_head & (m_capacity - 1)) + detail::header_size, size};
+        }
+
+        // appends the claimed message, 'size' may be smaller than the claimed size
+        void commit(std::size_t size)
+        {
+            auto length = static_cast<std::uint64_t>(size);
+            std::memcpy(m_ring + (m_head & (m_capacity - 1)), &length, sizeof(length));
+            m_head += detail::header_size + detail::align8(size);
+
+            if (m_head - m_published >= m_opts.batch_bytes)
+            {
+                flush();
+            }
+        }
+
+        void send(const void *data, std::size_t size)
+        {
+            std::memcpy(claim(size).data(), data, size);
+            commit(size);
+        }
+
+        void send(std::string_view msg)
+        {
+            send(msg.data(), msg.size());
+        }
+
+        // makes every committed message visible to the consumer
+        void flush()
+        {
+            if (m_head != m_published)
+            {
+                m_published = m_head;
+                detail::publish(m_control.head, m_head, m_control.consumer_sleeping, m_control.data_signal);
+            }
+        }
+
+        // no more messages: the consumer receives the rest, then std::nullopt
+        void close()
+        {
+            flush();
+            m_control.closed.store(1, std::memory_order_seq_cst);
+            m_control.data_signal.fetch_add(1, std::memory_order_seq_cst);
+            detail::futex_wake(m_control.data_signal);
+        }
+
+    private:
+        void wait_for_space(std::size_t need)
+        {
+            auto has_space = [&]
+            {
+                m_tail_cache = m_control.tail.load(std::memory_order_acquire);
+                return m_capacity - (m_head - m_tail_cache) >= need;
+            };
+
+            if (has_space())
+            {
+                return;
+            }
+
+            // the consumer may be waiting for the messages of this batch
+            flush();
+            detail::wait(has_space, m_opts.spin, m_opts.peer_check, m_control.consumer_closed, m_control.consumer_pid,
+                         m_control.producer_sleeping, m_control.space_signal);
+
+            if (!has_space())
+            {
+                throw std::runtime_error(m_control.consumer_closed.load() != 0 ? "ipc::producer: the consumer closed the channel"
+                                                                               : "ipc::producer: the consumer exited");
+            }
+        }
+
+        detail::control &m_control;
+        char *m_ring;
+        std::size_t m_capacity;
+        options m_opts;
+
+        std::uint64_t m_head{};
+        std::uint64_t m_published{};
+        std::uint64_t m_tail_cache{};
+    };
+
+    // ---------------------------------------
+    // Reading side
+    // ---------------------------------------
+    class consumer
+    {
+    public:
+        explicit consumer(channel &ch, options opts = {})
+            : m_control{ch.control()}, m_ring{ch.ring()}, m_capacity{ch.capacity()}, m_opts{opts}
+        {
+            m_tail = m_released = m_control.tail.load(std::memory_order_relaxed);
+            m_head_cache = m_control.head.load(std::memory_order_acquire);
+            m_control.consumer_pid.store(getpid(), std::memory_order_release);
+        }
+
+        consumer(const consumer &) = delete;
+        consumer &operator=(const consumer &) = delete;
+
+        ~consumer()
+        {
+            close();
+        }
+
+        // no more messages are read: a producer waiting for space (now or later) throws instead of blocking
+        void close()
+        {
+            release();
+            m_control.consumer_closed.store(1, std::memory_order_seq_cst);
+            m_control.space_signal.fetch_add(1, std::memory_order_seq_cst);
+            detail::futex_wake(m_control.space_signal);
+        }
+
+        // the next message, in place in the ring and valid until the next call; waits while the ring is empty.
+        // std::nullopt once the producer closed the channel and every message was received
+        std::optional<std::string_view> receive()
+        {
+            consume_previous();
+
+            if (m_tail == m_head_cache)
+            {
+                auto has_data = [&]
+                {
+                    m_head_cache = m_control.head.load(std::memory_order_acquire);
+                    return m_head_cache != m_tail;
+                };
+
+                if (!has_data())
+                {
+                    // the producer may be waiting for the space of this batch
+                    release();
+                    detail::wait(has_data, m_opts.spin, m_opts.peer_check, m_control.closed, m_control.producer_pid,
+                                 m_control.consumer_sleeping, m_control.data_signal);
+
+                    if (!has_data())
+                    {
+                        if (m_control.closed.load(std::memory_order_acquire) == 0)
+                        {
+                            throw std::runtime_error("ipc::consumer: the producer exited without closing the channel");
+                        }
+                        return std::nullopt;
+                    }
+                }
+            }
+
+            return current();
+        }
+
+        // like receive(), but returns std::nullopt at once when no message is published
+        std::optional<std::string_view> try_receive()
+        {
+            consume_previous();
+
+            if (m_tail == m_head_cache)
+            {
+                m_head_cache = m_control.head.load(std::memory_order_acquire);
+                if (m_tail == m_head_cache)
+                {
+                    release();
+                    return std::nullopt;
+                }
+            }
+
+            return current();
+        }
+
+        // hands the space of the received messages back to the producer
+        void release()
+        {
+            consume_previous();
+            if (m_tail != m_released)
+            {
+                m_released = m_tail;
+                detail::publish(m_control.tail, m_tail, m_control.producer_sleeping, m_control.space_signal);
+            }
+        }
+
+    private:
+        std::string_view current()
+        {
+            std::uint64_t length;
+            auto ptr = m_ring + (m_tail & (m_capacity - 1));
+            std::memcpy(&length, ptr, sizeof(length));
+
+            m_pending = detail::header_size + detail::align8(length);
+            return {ptr + detail::header_size, static_cast<std::size_t>(length)};
+        }
+
+        void consume_previous()
+        {
+            m_tail += m_pending;
+            m_pending = 0;
+
+            if (m_tail - m_released >= m_opts.batch_bytes && m_tail != m_released)
+            {
+                m_released = m_tail;
+                detail::publish(m_control.tail, m_tail, m_control.producer_sleeping, m_control.space_signal);
+            }
+        }
+
+        detail::control &m_control;
+        char *m_ring;
+        std::size_t m_capacity;
+        options m_opts;
+
+        std::uint64_t m_tail{};
+        std::uint64_t m_released{};
+        std::uint64_t m_head_cache{};
+        std::uint64_t m_pending{};
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_SHM_CHANNEL_HPP
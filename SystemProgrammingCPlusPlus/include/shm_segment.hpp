@@ -0,0 +1,660 @@
+/**
+ * @File    : shm_segment.hpp
+ * @Brief   : Growable shared-memory segment (memfd or shm_open), robust process-shared mutex, seqlock, fd passing
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp -lpthread
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Shared memory that can be found, checked, grown and cleaned up
+ * A SysV segment (ftok() + shmget()) has a fixed size, a key that two unrelated programs can
+ * choose by accident, and it outlives every process that used it until someone runs ipcrm.
+ * shm::segment is a file in RAM instead:
+ * - create() makes an anonymous memfd (memfd_create), inherited by fork() and closed with the last descriptor,
+ *   create(name) a POSIX object /dev/shm/<name> (shm_open), removed by the destructor of the creator,
+ * - open(name) attaches to a named segment, attach(fd) to any segment descriptor and
+ *   receive(socket) to a descriptor sent by another process over a UNIX socket (SCM_RIGHTS, shm::send_fd()),
+ * - the first page is a header: a magic number, the version of the layout of the user data
+ *   (checked by every attach), the current size and a generation counter,
+ * - grow() enlarges the segment for every process. Each process reserves 'max_size' bytes of address
+ *   space when it attaches and maps the file into the start of it, growing maps the new pages right behind
+ *   the old ones (mmap MAP_FIXED): data() never moves, pointers into the segment stay valid.
+ *   The other processes see a new generation and map the new pages with refresh().
+ *
+ * Synchronization for data that many processes read and few write:
+ * - shm::robust_mutex: a pthread mutex with PTHREAD_PROCESS_SHARED and PTHREAD_MUTEX_ROBUST. If its owner dies,
+ *   the next lock() does not hang: it gets the mutex and is told that the data it protects may be half written,
+ * - shm::seqlock: readers never write to the shared cache line, they copy the data and retry if a writer
+ *   was active meanwhile (the sequence was odd, or changed). Writers must be serialized, by a robust_mutex for example.
+ *   The copy in the reader races with the writer by design, it must only copy bytes (shm::seqlocked<T> needs a
+ *   trivially copyable T) and use the copy once the read succeeded.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_SHM_SEGMENT_HPP
+#define SYSTEM_PROGRAMMING_SHM_SEGMENT_HPP
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+namespace shm
+{
+    namespace detail
+    {
+        inline void cpu_relax()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+        }
+
+        [[noreturn]] inline void throw_errno(const std::string &what, int error = errno)
+        {
+            throw std::runtime_error(what + ": " + strerror(error));
+        }
+    }
+
+    // ---------------------------------------
+    // Robust process-shared mutex
+    // ---------------------------------------
+    class robust_mutex
+    {
+    public:
+        // only in shared memory, constructed once by the creator of the segment
+        robust_mutex()
+        {
+            pthread_mutexattr_t attr;
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+            auto error = pthread_mutex_init(&m_mutex, &attr);
+            pthread_mutexattr_destroy(&attr);
+
+            if (error != 0)
+            {
+                detail::throw_errno("pthread_mutex_init", error);
+            }
+        }
+
+        robust_mutex(const robust_mutex &) = delete;
+        robust_mutex &operator=(const robust_mutex &) = delete;
+
+        // true when the previous owner died while holding the mutex: the protected data must be checked or repaired
+        [[nodiscard]] bool lock_or_recover()
+        {
+            auto error = pthread_mutex_lock(&m_mutex);
+            if (error == EOWNERDEAD)
+            {
+                pthread_mutex_consistent(&m_mutex);
+                return true;
+            }
+            if (error != 0)
+            {
+                detail::throw_errno("pthread_mutex_lock", error);
+            }
+
+            return false;
+        }
+
+        // Lockable, for std::lock_guard and std::unique_lock
+        void lock()
+        {
+            static_cast<void>(lock_or_recover());
+        }
+
+        bool try_lock()
+        {
+            auto error = pthread_mutex_trylock(&m_mutex);
+            if (error == EOWNERDEAD)
+            {
+                pthread_mutex_consistent(&m_mutex);
+                return true;
+            }
+
+            return error == 0;
+        }
+
+        void unlock()
+        {
+            pthread_mutex_unlock(&m_mutex);
+        }
+
+    private:
+        pthread_mutex_t m_mutex;
+    };
+
+    // ---------------------------------------
+    // Sequence lock
+    // ---------------------------------------
+    class seqlock
+    {
+    public:
+        // writers must be serialized
+        void write_lock()
+        {
+            m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        void write_unlock()
+        {
+            m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        template <typename WRITE>
+        void write(WRITE write_data)
+        {
+            write_lock();
+            write_data();
+            write_unlock();
+        }
+
+        // waits out an active writer, returns the sequence to check with read_retry()
+        std::uint64_t read_begin() const
+        {
+            while (true)
+            {
+                auto sequence = m_sequence.load(std::memory_order_acquire);
+                if ((sequence & 1) == 0)
+                {
+                    return sequence;
+                }
+                detail::cpu_relax();
+            }
+        }
+
+        bool read_retry(std::uint64_t sequence) const
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return m_sequence.load(std::memory_order_relaxed) != sequence;
+        }
+
+        // calls read_data() until it ran without a concurrent write, returns its last result
+        template <typename READ>
+        auto read(READ read_data) const
+        {
+            while (true)
+            {
+                auto sequence = read_begin();
+                auto result = read_data();
+                if (!read_retry(sequence))
+                {
+                    return result;
+                }
+            }
+        }
+
+        // after a writer died between write_lock() and write_unlock() (see robust_mutex::lock_or_recover())
+        void recover()
+        {
+            auto sequence = m_sequence.load(std::memory_order_relaxed);
+            if ((sequence & 1) != 0)
+            {
+                m_sequence.store(sequence + 1, std::memory_order_release);
+            }
+        }
+
+        std::uint64_t sequence() const
+        {
+            return m_sequence.load(std::memory_order_acquire);
+        }
+
+    private:
+        std::atomic<std::uint64_t> m_sequence{0};
+    };
+
+    // a value behind a seqlock, copied with memcpy on both sides
+    template <typename T>
+    class seqlocked
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "shm::seqlocked<T> copies T byte by byte");
+
+    public:
+        T load() const
+        {
+            return m_lock.read([this]
+                               {
+                                   T value;
+                                   std::memcpy(&value, m_bytes, sizeof(T));
+                                   return value;
+                               });
+        }
+
+        void store(const T &value)
+        {
+            m_lock.write([&]
+                         { std::memcpy(m_bytes, &value, sizeof(T)); });
+        }
+
+        seqlock &lock()
+        {
+            return m_lock;
+        }
+
+    private:
+        seqlock m_lock;
+        alignas(T) unsigned char m_bytes[sizeof(T)]{};
+    };
+
+    // ---------------------------------------
+    // Descriptor passing
+    // ---------------------------------------
+    // sends 'fd' over a connected UNIX socket, the receiver gets its own descriptor of the same open file
+    inline void send_fd(int socket, int fd)
+    {
+        char byte = 0;
+        iovec iov{&byte, 1};
+
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        auto cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+        if (sendmsg(socket, &msg, MSG_NOSIGNAL) < 0)
+        {
+            detail::throw_errno("sendmsg");
+        }
+    }
+
+    inline int receive_fd(int socket)
+    {
+        char byte;
+        iovec iov{&byte, 1};
+
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        auto bytes = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+        if (bytes < 0)
+        {
+            detail::throw_errno("recvmsg");
+        }
+
+        auto cmsg = CMSG_FIRSTHDR(&msg);
+        if (bytes == 0 || cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        {
+            throw std::runtime_error("receive_fd: no descriptor received");
+        }
+
+        int fd;
+        std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        return fd;
+    }
+
+    // ---------------------------------------
+    // The segment
+    // ---------------------------------------
+    namespace detail
+    {
+        constexpr std::uint64_t magic = 0x544E454D47455348; // "HSEGMENT"
+        constexpr std::uint32_t format = 1;                 // layout of struct header
+
+        struct header
+        {
+            std::uint64_t magic;
+            std::uint32_t format;
+            std::uint32_t version;   // of the user data, given to create()
+            std::uint64_t data_offset;
+            std::uint64_t max_size;
+
+            alignas(64) std::atomic<std::uint64_t> size; // of the user data
+            std::atomic<std::uint64_t> generation;       // incremented by every grow()
+            robust_mutex mutex;                          // serializes grow(), free for the user otherwise
+        };
+
+        inline std::size_t page_size()
+        {
+            static const auto size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        inline std::size_t round_to_page(std::size_t size)
+        {
+            return (size + page_size() - 1) / page_size() * page_size();
+        }
+    }
+
+    struct options
+    {
+        std::size_t size{1 << 20};                  // of the user data at creation
+        std::size_t max_size{std::size_t{1} << 34}; // growth limit, the address space every process reserves
+        std::uint32_t version{0};                   // layout version of the user data, checked when attaching
+    };
+
+    class segment
+    {
+    public:
+        // anonymous segment, shared with children (fork) or with send() / receive()
+        static segment create(const options &opts = {})
+        {
+            auto fd = memfd_create("shm_segment", MFD_CLOEXEC);
+            if (fd < 0)
+            {
+                detail::throw_errno("memfd_create");
+            }
+
+            return initialize(fd, opts, {});
+        }
+
+        // named segment /dev/shm/<name>, fails if it exists; the name is removed when this object is destroyed
+        static segment create(const std::string &name, const options &opts = {})
+        {
+            auto fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+            if (fd < 0)
+            {
+                detail::throw_errno("shm_open " + name);
+            }
+
+            return initialize(fd, opts, name);
+        }
+
+        static segment open(const std::string &name, std::uint32_t version = 0)
+        {
+            auto fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+            if (fd < 0)
+            {
+                detail::throw_errno("shm_open " + name);
+            }
+
+            return segment{fd, version};
+        }
+
+        // 'fd' is duplicated
+        static segment attach(int fd, std::uint32_t version = 0)
+        {
+            auto dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+            if (dup_fd < 0)
+            {
+                detail::throw_errno("fcntl");
+            }
+
+            return segment{dup_fd, version};
+        }
+
+        // a segment sent with send() by another process
+        static segment receive(int socket, std::uint32_t version = 0)
+        {
+            return segment{receive_fd(socket), version};
+        }
+
+        void send(int socket) const
+        {
+            send_fd(socket, m_fd);
+        }
+
+        segment(segment &&other) noexcept
+            : m_fd{std::exchange(other.m_fd, -1)},
+              m_base{std::exchange(other.m_base, nullptr)},
+              m_reserved{other.m_reserved},
+              m_mapped{other.m_mapped},
+              m_name{std::move(other.m_name)}
+        {
+            other.m_name.clear();
+        }
+
+        segment &operator=(segment &&other) noexcept
+        {
+            std::swap(m_fd, other.m_fd);
+            std::swap(m_base, other.m_base);
+            std::swap(m_reserved, other.m_reserved);
+            std::swap(m_mapped, other.m_mapped);
+            std::swap(m_name, other.m_name);
+            return *this;
+        }
+
+        ~segment()
+        {
+            if (m_base != nullptr)
+            {
+                munmap(m_base, m_reserved);
+            }
+            if (m_fd >= 0)
+            {
+                ::close(m_fd);
+            }
+            if (!m_name.empty())
+            {
+                shm_unlink(m_name.c_str());
+            }
+        }
+
+        // the user data, at the same address for the lifetime of this object
+        char *data() const
+        {
+            return m_base + header().data_offset;
+        }
+
+        template <typename T>
+        T *as(std::size_t offset = 0) const
+        {
+            return reinterpret_cast<T *>(data() + offset);
+        }
+
+        // bytes of data() mapped in this process, at least what was current at the last grow() or refresh()
+        std::size_t size() const
+        {
+            return m_mapped - header().data_offset;
+        }
+
+        std::uint64_t generation() const
+        {
+            return header().generation.load(std::memory_order_acquire);
+        }
+
+        std::uint32_t version() const
+        {
+            return header().version;
+        }
+
+        int fd() const
+        {
+            return m_fd;
+        }
+
+        // free for the user data: the same lock serializes grow()
+        robust_mutex &mutex() const
+        {
+            return header().mutex;
+        }
+
+        // enlarges the segment to at least 'size' bytes of data for every process, maps the new pages here
+        void grow(std::size_t size)
+        {
+            auto &h = header();
+            if (size > h.max_size)
+            {
+                throw std::length_error("shm::segment: " + std::to_string(size) + " bytes exceed max_size");
+            }
+
+            {
+                std::lock_guard lock{h.mutex};
+                if (size > h.size.load(std::memory_order_relaxed))
+                {
+                    size = detail::round_to_page(size);
+                    if (ftruncate(m_fd, static_cast<off_t>(h.data_offset + size)) < 0)
+                    {
+                        detail::throw_errno("ftruncate");
+                    }
+
+                    h.size.store(size, std::memory_order_release);
+                    h.generation.fetch_add(1, std::memory_order_release);
+                }
+            }
+
+            refresh();
+        }
+
+        // maps what another process added with grow(); true when something changed
+        bool refresh()
+        {
+            auto wanted = header().data_offset + header().size.load(std::memory_order_acquire);
+            if (wanted <= m_mapped)
+            {
+                return false;
+            }
+
+            map(m_mapped, wanted);
+            return true;
+        }
+
+        // removes the name, the segment lives on until the last process closes it
+        void unlink()
+        {
+            if (!m_name.empty())
+            {
+                shm_unlink(m_name.c_str());
+                m_name.clear();
+            }
+        }
+
+    private:
+        static segment initialize(int fd, const options &opts, const std::string &name)
+        {
+            // owns the descriptor and the name from here on: both are released if anything below throws
+            segment seg{fd};
+            seg.m_name = name;
+
+            auto data_offset = detail::round_to_page(sizeof(detail::header));
+            auto size = detail::round_to_page(opts.size);
+            auto max_size = std::max(opts.max_size, size);
+            if (ftruncate(fd, static_cast<off_t>(data_offset + size)) < 0)
+            {
+                detail::throw_errno("ftruncate");
+            }
+
+            seg.reserve(data_offset + max_size);
+
+            // the file is zero-filled, the magic number is written last: open() fails until the header is complete
+            auto h = new (seg.m_base) detail::header{};
+            h->format = detail::format;
+            h->version = opts.version;
+            h->data_offset = data_offset;
+            h->max_size = max_size;
+            h->size.store(size, std::memory_order_relaxed);
+            std::atomic_ref{h->magic}.store(detail::magic, std::memory_order_release);
+
+            seg.refresh();
+            return seg;
+        }
+
+        explicit segment(int fd) : m_fd{fd}
+        {
+        }
+
+        // attaches to an existing segment
+        segment(int fd, std::uint32_t version) : segment{fd}
+        {
+            struct stat st;
+            if (fstat(fd, &st) < 0)
+            {
+                detail::throw_errno("fstat");
+            }
+            if (static_cast<std::size_t>(st.st_size) < sizeof(detail::header))
+            {
+                throw std::runtime_error("shm::segment: not a segment");
+            }
+
+            // the header first, the reservation needs max_size
+            auto ptr = mmap(nullptr, sizeof(detail::header), PROT_READ, MAP_SHARED, fd, 0);
+            if (ptr == MAP_FAILED)
+            {
+                detail::throw_errno("mmap");
+            }
+
+            auto h = static_cast<detail::header *>(ptr);
+            auto magic = std::atomic_ref{h->magic}.load(std::memory_order_acquire);
+            auto format = h->format;
+            auto data_version = h->version;
+            auto reserved = h->data_offset + h->max_size;
+            munmap(ptr, sizeof(detail::header));
+
+            if (magic != detail::magic || format != detail::format)
+            {
+                throw std::runtime_error("shm::segment: not a segment, or not initialized yet");
+            }
+            if (data_version != version)
+            {
+                throw std::runtime_error("shm::segment: data version " + std::to_string(data_version) +
+                                         ", expected " + std::to_string(version));
+            }
+
+            reserve(reserved);
+            refresh();
+        }
+
+        // reserves the address space for the largest size, maps the header page at its start
+        void reserve(std::size_t bytes)
+        {
+            m_reserved = detail::round_to_page(bytes);
+            auto base = mmap(nullptr, m_reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (base == MAP_FAILED)
+            {
+                detail::throw_errno("mmap");
+            }
+
+            m_base = static_cast<char *>(base);
+            map(0, detail::round_to_page(sizeof(detail::header)));
+        }
+
+        // maps [from, to) of the file at the same offsets in the reservation
+        void map(std::size_t from, std::size_t to)
+        {
+            if (to > m_reserved)
+            {
+                throw std::length_error("shm::segment: the segment outgrew the reserved address space");
+            }
+
+            if (mmap(m_base + from, to - from, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_fd,
+                     static_cast<off_t>(from)) == MAP_FAILED)
+            {
+                detail::throw_errno("mmap");
+            }
+            m_mapped = to;
+        }
+
+        detail::header &header() const
+        {
+            return *reinterpret_cast<detail::header *>(m_base);
+        }
+
+        int m_fd{-1};
+        char *m_base{nullptr};
+        std::size_t m_reserved{};
+        std::size_t m_mapped{};
+        std::string m_name;
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_SHM_SEGMENT_HPP
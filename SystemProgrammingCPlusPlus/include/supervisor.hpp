@@ -0,0 +1,507 @@
+/**
+ * @File    : supervisor.hpp
+ * @Brief   : Process supervisor: pidfds, timers and signals in one epoll loop, restarts with backoff, rusage per worker
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Watching hundreds of children without blocking
+ * wait() blocks until some child exits, a SIGCHLD handler can only set a flag, and neither combines with
+ * the other things a supervisor waits for: timers, signals, sockets. Everything here is a file descriptor
+ * registered in one epoll instance, and the loop sleeps in a single epoll_wait():
+ * - every child is a pidfd (include/launcher.hpp), readable once the child exited. It is then collected with
+ *   wait4(), which also returns its resource usage (CPU time, peak RSS, page faults) added to the worker,
+ * - signals (SIGINT, SIGTERM, SIGHUP by default) are blocked and read from a signalfd: a signal is an event of
+ *   the loop like any other, no handler runs at a random point of the program. The workers start with the
+ *   signal mask the supervisor found, the blocked signals are not inherited,
+ * - a single timerfd is armed for the earliest deadline of a heap: restarts waiting out their backoff,
+ *   periodic user timers, the SIGKILL after the grace period of shutdown().
+ *
+ * A worker that exits is restarted according to its policy, after a backoff that doubles with every
+ * consecutive failure (up to a limit) and starts over once a run lasted 'stable_after'.
+ * Nothing in the loop blocks: starting a worker is a posix_spawn(), collecting it a wait4(WNOHANG).
+ */
+
+#ifndef SYSTEM_PROGRAMMING_SUPERVISOR_HPP
+#define SYSTEM_PROGRAMMING_SUPERVISOR_HPP
+
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "launcher.hpp"
+
+namespace proc
+{
+    using milliseconds = std::chrono::milliseconds;
+    using steady_time = std::chrono::steady_clock::time_point;
+
+    struct restart_policy
+    {
+        enum when
+        {
+            never,
+            on_failure, // exit code other than 0, or killed by a signal
+            always,
+        } restart{always};
+
+        milliseconds initial_backoff{100};
+        milliseconds max_backoff{30000};
+        milliseconds stable_after{10000}; // a run this long resets the backoff
+    };
+
+    // summed over all the runs of a worker
+    struct resource_usage
+    {
+        double user_seconds{};
+        double system_seconds{};
+        long max_rss_kb{};
+        long minor_faults{};
+        long major_faults{};
+        long context_switches{};
+
+        void add(const rusage &ru)
+        {
+            user_seconds += static_cast<double>(ru.ru_utime.tv_sec) + static_cast<double>(ru.ru_utime.tv_usec) / 1e6;
+            system_seconds += static_cast<double>(ru.ru_stime.tv_sec) + static_cast<double>(ru.ru_stime.tv_usec) / 1e6;
+            max_rss_kb = std::max(max_rss_kb, ru.ru_maxrss);
+            minor_faults += ru.ru_minflt;
+            major_faults += ru.ru_majflt;
+            context_switches += ru.ru_nvcsw + ru.ru_nivcsw;
+        }
+    };
+
+    struct worker
+    {
+        enum state
+        {
+            running,
+            backing_off,
+            stopped,
+        };
+
+        std::size_t id;
+        std::string name;
+        command cmd;
+        restart_policy policy;
+
+        child process;
+        state status{stopped};
+        steady_time started{};
+        unsigned runs{};
+        unsigned failures{};             // consecutive
+        exit_status last_exit{};
+        resource_usage usage;
+    };
+
+    class supervisor
+    {
+    public:
+        explicit supervisor(std::initializer_list<int> signals = {SIGINT, SIGTERM, SIGHUP})
+        {
+            m_epoll = epoll_create1(EPOLL_CLOEXEC);
+            if (m_epoll < 0)
+            {
+                detail::throw_errno("epoll_create1");
+            }
+
+            m_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (m_timer < 0)
+            {
+                auto error = errno;
+                ::close(m_epoll);
+                detail::throw_errno("timerfd_create", error);
+            }
+
+            // the signals are only delivered through the signalfd from now on
+            sigset_t blocked;
+            sigemptyset(&blocked);
+            for (auto sig : signals)
+            {
+                sigaddset(&blocked, sig);
+            }
+            pthread_sigmask(SIG_BLOCK, &blocked, &m_original_mask);
+
+            m_signals = signalfd(-1, &blocked, SFD_NONBLOCK | SFD_CLOEXEC);
+            if (m_signals < 0)
+            {
+                auto error = errno;
+                pthread_sigmask(SIG_SETMASK, &m_original_mask, nullptr);
+                ::close(m_timer);
+                ::close(m_epoll);
+                detail::throw_errno("signalfd", error);
+            }
+
+            watch(m_signals, signal_event);
+            watch(m_timer, timer_event);
+        }
+
+        supervisor(const supervisor &) = delete;
+        supervisor &operator=(const supervisor &) = delete;
+
+        // the workers still running are killed and collected
+        ~supervisor()
+        {
+            for (auto &w : m_workers)
+            {
+                if (w.process.running())
+                {
+                    w.process.kill(SIGKILL);
+                    w.process.wait();
+                }
+            }
+
+            ::close(m_signals);
+            ::close(m_timer);
+            ::close(m_epoll);
+            pthread_sigmask(SIG_SETMASK, &m_original_mask, nullptr);
+        }
+
+        // starts a worker at once, returns its id
+        std::size_t add(std::string name, command cmd, restart_policy policy = {})
+        {
+            cmd.signal_mask(m_original_mask);
+            m_workers.push_back({m_workers.size(), std::move(name), std::move(cmd), policy, {}, worker::stopped, {}, 0, 0, {}, {}});
+            start(m_workers.back());
+            return m_workers.back().id;
+        }
+
+        // 'callback' every 'interval', from the loop
+        void every(milliseconds interval, std::function<void()> callback)
+        {
+            m_periodic.push_back({interval, std::move(callback)});
+            schedule(std::chrono::steady_clock::now() + interval, deadline::periodic, m_periodic.size() - 1);
+        }
+
+        // after every exit of a worker, before the restart is scheduled
+        void on_exit(std::function<void(const worker &)> callback)
+        {
+            m_on_exit = std::move(callback);
+        }
+
+        // replaces the default: shutdown() on any of the signals
+        void on_signal(std::function<void(int)> callback)
+        {
+            m_on_signal = std::move(callback);
+        }
+
+        // no more restarts, SIGTERM to every worker, SIGKILL to those still there after 'grace'
+        void shutdown(milliseconds grace = milliseconds{5000})
+        {
+            if (m_shutting_down)
+            {
+                return;
+            }
+
+            m_shutting_down = true;
+            for (auto &w : m_workers)
+            {
+                if (w.status == worker::running)
+                {
+                    w.process.kill(SIGTERM);
+                }
+                else
+                {
+                    w.status = worker::stopped;
+                }
+            }
+            schedule(std::chrono::steady_clock::now() + grace, deadline::kill, 0);
+        }
+
+        // one round of the loop; false once shutdown() is complete (or there is nothing left to supervise)
+        bool run_once(int timeout_ms = -1)
+        {
+            if (finished())
+            {
+                return false;
+            }
+
+            epoll_event events[64];
+            auto count = epoll_wait(m_epoll, events, 64, timeout_ms);
+            if (count < 0 && errno != EINTR)
+            {
+                detail::throw_errno("epoll_wait");
+            }
+
+            for (auto i = 0; i < count; i++)
+            {
+                auto tag = events[i].data.u64;
+                if (tag == signal_event)
+                {
+                    read_signals();
+                }
+                else if (tag == timer_event)
+                {
+                    fire_timers();
+                }
+                else
+                {
+                    collect(m_workers[tag - worker_event]);
+                }
+            }
+
+            return !finished();
+        }
+
+        void run()
+        {
+            while (run_once())
+            {
+            }
+        }
+
+        const std::deque<worker> &workers() const
+        {
+            return m_workers;
+        }
+
+        std::size_t running() const
+        {
+            return static_cast<std::size_t>(std::count_if(m_workers.begin(), m_workers.end(), [](const worker &w)
+                                                          { return w.status == worker::running; }));
+        }
+
+        // to nest the supervisor into another epoll loop: readable when run_once(0) has something to do
+        int fd() const
+        {
+            return m_epoll;
+        }
+
+    private:
+        static constexpr std::uint64_t signal_event = 0;
+        static constexpr std::uint64_t timer_event = 1;
+        static constexpr std::uint64_t worker_event = 2; // + worker id
+
+        struct deadline
+        {
+            enum kind
+            {
+                restart,
+                periodic,
+                kill,
+            };
+
+            steady_time due;
+            kind type;
+            std::size_t index;
+
+            bool operator>(const deadline &other) const
+            {
+                return due > other.due;
+            }
+        };
+
+        struct periodic_timer
+        {
+            milliseconds interval;
+            std::function<void()> callback;
+        };
+
+        void watch(int fd, std::uint64_t tag)
+        {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = tag;
+            if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) < 0)
+            {
+                detail::throw_errno("epoll_ctl");
+            }
+        }
+
+        bool finished() const
+        {
+            auto idle = std::none_of(m_workers.begin(), m_workers.end(), [](const worker &w)
+                                     { return w.status != worker::stopped; });
+            return idle && (m_shutting_down || m_periodic.empty());
+        }
+
+        void start(worker &w)
+        {
+            try
+            {
+                w.process = spawn(w.cmd);
+            }
+            catch (const std::runtime_error &)
+            {
+                // a worker that cannot start fails like one that exits at once: a run of zero length,
+                // which must not count as a stable run and reset the backoff
+                auto now = std::chrono::steady_clock::now();
+                w.started = now;
+                w.last_exit = exit_status{127, 0};
+                w.runs++;
+                backoff(w, now);
+                return;
+            }
+
+            w.status = worker::running;
+            w.started = std::chrono::steady_clock::now();
+            w.runs++;
+            watch(w.process.pidfd(), worker_event + w.id);
+        }
+
+        void collect(worker &w)
+        {
+            rusage ru{};
+            auto status = w.process.try_wait(&ru);
+            if (!status)
+            {
+                return;
+            }
+
+            // removed before it is closed: a child being spawned may still hold a copy of the pidfd
+            // (vfork returns before exec() closed the O_CLOEXEC descriptors), which would keep it in the epoll set
+            epoll_ctl(m_epoll, EPOLL_CTL_DEL, w.process.pidfd(), nullptr);
+            w.process = child{};
+            w.last_exit = *status;
+            w.usage.add(ru);
+
+            auto now = std::chrono::steady_clock::now();
+            if (m_on_exit)
+            {
+                m_on_exit(w);
+            }
+
+            backoff(w, now);
+        }
+
+        void backoff(worker &w, steady_time now)
+        {
+            auto failed = !w.last_exit.success();
+            auto again = !m_shutting_down && (w.policy.restart == restart_policy::always ||
+                                              (w.policy.restart == restart_policy::on_failure && failed));
+            if (!again)
+            {
+                w.status = worker::stopped;
+                return;
+            }
+
+            // a clean exit or a long run forgives the earlier failures
+            if (!failed || now - w.started >= w.policy.stable_after)
+            {
+                w.failures = 0;
+            }
+
+            auto delay = w.policy.initial_backoff;
+            for (unsigned i = 0; i < w.failures && delay < w.policy.max_backoff; i++)
+            {
+                delay *= 2;
+            }
+            delay = std::min(delay, w.policy.max_backoff);
+            if (failed)
+            {
+                w.failures++;
+            }
+
+            w.status = worker::backing_off;
+            schedule(now + delay, deadline::restart, w.id);
+        }
+
+        void read_signals()
+        {
+            signalfd_siginfo info;
+            while (::read(m_signals, &info, sizeof(info)) == sizeof(info))
+            {
+                auto sig = static_cast<int>(info.ssi_signo);
+                if (m_on_signal)
+                {
+                    m_on_signal(sig);
+                }
+                else
+                {
+                    shutdown();
+                }
+            }
+        }
+
+        void schedule(steady_time due, deadline::kind type, std::size_t index)
+        {
+            m_deadlines.push({due, type, index});
+            arm();
+        }
+
+        // the timerfd for the earliest deadline, in absolute CLOCK_MONOTONIC time (the clock of steady_clock)
+        void arm()
+        {
+            itimerspec spec{};
+            if (!m_deadlines.empty())
+            {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(m_deadlines.top().due.time_since_epoch()).count();
+                spec.it_value.tv_sec = ns / 1000000000;
+                spec.it_value.tv_nsec = ns % 1000000000;
+                if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+                {
+                    spec.it_value.tv_nsec = 1;
+                }
+            }
+            timerfd_settime(m_timer, TFD_TIMER_ABSTIME, &spec, nullptr);
+        }
+
+        void fire_timers()
+        {
+            std::uint64_t expirations;
+            static_cast<void>(::read(m_timer, &expirations, sizeof(expirations)));
+
+            auto now = std::chrono::steady_clock::now();
+            while (!m_deadlines.empty() && m_deadlines.top().due <= now)
+            {
+                auto d = m_deadlines.top();
+                m_deadlines.pop();
+
+                switch (d.type)
+                {
+                case deadline::restart:
+                    if (m_workers[d.index].status == worker::backing_off)
+                    {
+                        start(m_workers[d.index]);
+                    }
+                    break;
+                case deadline::periodic:
+                    m_periodic[d.index].callback();
+                    m_deadlines.push({d.due + m_periodic[d.index].interval, deadline::periodic, d.index});
+                    break;
+                case deadline::kill:
+                    for (auto &w : m_workers)
+                    {
+                        if (w.status == worker::running)
+                        {
+                            w.process.kill(SIGKILL);
+                        }
+                    }
+                    break;
+                }
+            }
+
+            arm();
+        }
+
+        int m_epoll{-1};
+        int m_timer{-1};
+        int m_signals{-1};
+        sigset_t m_original_mask;
+
+        // deques: a callback may add() a worker or call every(), the references held by the loop stay valid
+        std::deque<worker> m_workers;
+        std::deque<periodic_timer> m_periodic;
+        std::priority_queue<deadline, std::vector<deadline>, std::greater<>> m_deadlines;
+        std::function<void(const worker &)> m_on_exit;
+        std::function<void(int)> m_on_signal;
+        bool m_shutting_down{false};
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_SUPERVISOR_HPP
@@ -0,0 +1,600 @@
+/**
+ * @File    : trace.hpp
+ * @Brief   : Low-overhead hot-path tracing with per-thread binary ring buffers
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp -lpthread
+ * @Command : ../tools/trace_decode trace.bin > trace.json
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Tracing instead of logging on the hot path
+ * The debug<LEVEL>() and log<LEVEL>() templates of chapter06 and chapter08 format text through iostreams
+ * at the call site, which costs microseconds per call and is therefore compiled out of release builds.
+ * A trace point does the minimum amount of work at the call site and defers everything else:
+ *
+ * 1. every call site owns a static 'descriptor' (name, category, file, line, argument names and types),
+ *    constant-initialized at compile time and registered through a pointer placed in the
+ *    'trace_descriptors' ELF section, so the full table is known at startup without any registration code,
+ * 2. an event is the TSC timestamp, the descriptor pointer and up to four raw 64-bit arguments,
+ * 3. events are written into a ring buffer owned by the calling thread (single producer, single consumer),
+ *    publishing an event is one relaxed load, a 48-byte store and one release store, there is no lock,
+ * 4. trace::session drains the rings into a binary file, either on demand (flush()) or from a background thread,
+ *    when a ring is full, new events are dropped and counted instead of blocking the hot path,
+ *    the ring of a thread that exited is retired and, once drained, handed to the next new thread:
+ *    a server starting a thread per connection keeps as many rings as threads ran between two flushes,
+ * 5. tools/trace_decode.cpp turns the binary file into Chrome trace / Perfetto JSON (chrome://tracing, ui.perfetto.dev).
+ *
+ * Usage:
+ *  TRACE_INSTANT("net", "recv", len);     // instant event with one argument
+ *  TRACE_SCOPE("net", "handle_client");   // complete event covering the enclosing scope
+ *
+ * Arguments must be integers, enums, floating point values or pointers.
+ * The argument names are taken from the macro arguments, so they should be simple expressions.
+ * Compile with -DTRACE_DISABLED to remove every trace point.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_TRACE_HPP
+#define SYSTEM_PROGRAMMING_TRACE_HPP
+
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+namespace trace
+{
+    constexpr const std::size_t max_args = 4;
+    constexpr const std::size_t ring_size = 1 << 14;
+    constexpr const std::uint32_t file_magic = 0x45435254; // "TRCE"
+    constexpr const std::uint32_t file_version = 1;
+
+    enum class phase : char
+    {
+        instant = 'i',
+        complete = 'X',
+    };
+
+    // Static, per call site description of an event, never written after initialization.
+    struct descriptor
+    {
+        const char *category;
+        const char *name;
+        const char *file;
+        std::uint32_t line;
+        trace::phase phase;
+        std::uint8_t num_args;
+        std::array<char, max_args> arg_types; // 'i' signed, 'u' unsigned, 'f' double, 'p' pointer
+        const char *arg_names;                // the stringified macro arguments, "a, b"
+    };
+
+    // One event as stored in the ring, 48 bytes.
+    struct event
+    {
+        std::uint64_t tsc;
+        const descriptor *desc;
+        std::array<std::uint64_t, max_args> args;
+    };
+
+    // ---------------------------------------
+    // Timestamps
+    // ---------------------------------------
+    inline std::uint64_t timestamp()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        timespec ts{};
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+    }
+
+    // ---------------------------------------
+    // Argument encoding
+    // ---------------------------------------
+    namespace detail
+    {
+        template <typename T>
+        constexpr char type_code()
+        {
+            using U = std::decay_t<T>;
+            static_assert(std::is_arithmetic_v<U> || std::is_enum_v<U> || std::is_pointer_v<U>,
+                          "trace arguments must be integers, enums, floating point values or pointers");
+
+            if constexpr (std::is_floating_point_v<U>)
+            {
+                return 'f';
+            }
+            else if constexpr (std::is_pointer_v<U>)
+            {
+                return 'p';
+            }
+            else if constexpr (std::is_enum_v<U>)
+            {
+                return std::is_signed_v<std::underlying_type_t<U>> ? 'i' : 'u';
+            }
+            else
+            {
+                return std::is_signed_v<U> ? 'i' : 'u';
+            }
+        }
+
+        template <typename... ARGS>
+        struct type_list
+        {
+        };
+
+        template <typename... ARGS>
+        type_list<ARGS...> types_of(const ARGS &...);
+
+        template <typename... ARGS>
+        constexpr std::array<char, max_args> type_codes(type_list<ARGS...>)
+        {
+            static_assert(sizeof...(ARGS) <= max_args, "too many trace arguments");
+            return {type_code<ARGS>()...};
+        }
+
+        template <typename... ARGS>
+        constexpr std::uint8_t count(type_list<ARGS...>)
+        {
+            return sizeof...(ARGS);
+        }
+
+        template <typename T>
+        inline std::uint64_t to_raw(T value)
+        {
+            using U = std::decay_t<T>;
+
+            if constexpr (std::is_floating_point_v<U>)
+            {
+                auto d = static_cast<double>(value);
+                std::uint64_t raw;
+                std::memcpy(&raw, &d, sizeof(raw));
+                return raw;
+            }
+            else if constexpr (std::is_pointer_v<U>)
+            {
+                return reinterpret_cast<std::uintptr_t>(value);
+            }
+            else if constexpr (std::is_enum_v<U>)
+            {
+                return static_cast<std::uint64_t>(static_cast<std::underlying_type_t<U>>(value));
+            }
+            else
+            {
+                return static_cast<std::uint64_t>(value);
+            }
+        }
+    }
+
+    // ---------------------------------------
+    // Per-thread ring buffer
+    // ---------------------------------------
+
+    /** Single producer (the owning thread), single consumer (the session flush).
+     * 'm_head' is only written by the producer, 'm_tail' only by the consumer,
+     * both live on their own cache line to avoid false sharing.
+     */
+    class ring
+    {
+    public:
+        explicit ring(std::uint32_t tid) : m_tid{tid}
+        {
+        }
+
+        // the owning thread exited: nothing is pushed any more
+        void retire()
+        {
+            m_retired.store(true, std::memory_order_release);
+        }
+
+        // retired and every event collected: the ring can be given to another thread
+        bool reusable() const
+        {
+            return m_retired.load(std::memory_order_acquire) &&
+                   m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+        }
+
+        // under the registry lock, for the new owner; the counters continue, the drops stay accounted
+        void reuse(std::uint32_t tid)
+        {
+            m_tid = tid;
+            m_retired.store(false, std::memory_order_relaxed);
+        }
+
+        void push(const descriptor *desc, std::uint64_t tsc,
+                  const std::array<std::uint64_t, max_args> &args)
+        {
+            auto head = m_head.load(std::memory_order_relaxed);
+            if (head - m_tail_cache == ring_size)
+            {
+                m_tail_cache = m_tail.load(std::memory_order_acquire);
+                if (head - m_tail_cache == ring_size)
+                {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            m_events[head & (ring_size - 1)] = event{tsc, desc, args};
+            m_head.store(head + 1, std::memory_order_release);
+        }
+
+        // Copies every published event to 'out', returns the number of events copied.
+        std::size_t drain(std::vector<event> &out)
+        {
+            auto tail = m_tail.load(std::memory_order_relaxed);
+            auto head = m_head.load(std::memory_order_acquire);
+
+            for (auto i = tail; i != head; i++)
+            {
+                out.push_back(m_events[i & (ring_size - 1)]);
+            }
+
+            m_tail.store(head, std::memory_order_release);
+            return head - tail;
+        }
+
+        std::uint64_t dropped() const
+        {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+        std::uint32_t tid() const
+        {
+            return m_tid;
+        }
+
+    private:
+        alignas(64) std::atomic<std::uint64_t> m_head{0};
+        std::uint64_t m_tail_cache{0};
+        std::atomic<std::uint64_t> m_dropped{0};
+
+        alignas(64) std::atomic<std::uint64_t> m_tail{0};
+        std::atomic<bool> m_retired{false};
+
+        alignas(64) std::array<event, ring_size> m_events{};
+        std::uint32_t m_tid;
+    };
+
+    // ---------------------------------------
+    // Registry of the rings of all threads
+    // ---------------------------------------
+    class registry
+    {
+    public:
+        static registry &instance()
+        {
+            static registry r;
+            return r;
+        }
+
+        ring *create()
+        {
+            auto tid = static_cast<std::uint32_t>(::syscall(SYS_gettid));
+
+            std::lock_guard lock{m_mutex};
+            for (auto &r : m_rings)
+            {
+                if (r->reusable())
+                {
+                    r->reuse(tid);
+                    return r.get();
+                }
+            }
+            m_rings.push_back(std::make_unique<ring>(tid));
+
+            return m_rings.back().get();
+        }
+
+        template <typename FUNC>
+        void for_each(FUNC func)
+        {
+            std::lock_guard lock{m_mutex};
+            for (auto &r : m_rings)
+            {
+                func(*r);
+            }
+        }
+
+    private:
+        std::mutex m_mutex{};
+        // rings outlive their threads so that the last events of a thread are not lost
+        std::vector<std::unique_ptr<ring>> m_rings{};
+    };
+
+    namespace detail
+    {
+        // retires the ring of the thread when the thread exits
+        struct ring_owner
+        {
+            ring *r = registry::instance().create();
+
+            ~ring_owner()
+            {
+                r->retire();
+            }
+        };
+    }
+
+    inline ring &thread_ring()
+    {
+        thread_local detail::ring_owner owner;
+        return *owner.r;
+    }
+
+    template <typename... ARGS>
+    inline void record(const descriptor *desc, std::uint64_t tsc, const ARGS &...args)
+    {
+        thread_ring().push(desc, tsc, {detail::to_raw(args)...});
+    }
+
+    // Records a complete event from construction to destruction.
+    class scope
+    {
+    public:
+        explicit scope(const descriptor *desc) : m_desc{desc}, m_start{timestamp()}
+        {
+        }
+
+        ~scope()
+        {
+            record(m_desc, m_start, timestamp());
+        }
+
+        scope(const scope &) = delete;
+        scope &operator=(const scope &) = delete;
+
+    private:
+        const descriptor *m_desc;
+        std::uint64_t m_start;
+    };
+
+    // ---------------------------------------
+    // Descriptor table from the ELF section
+    // ---------------------------------------
+    using descriptor_ptr = const descriptor *;
+}
+
+extern "C"
+{
+    extern const trace::descriptor_ptr __start_trace_descriptors[] __attribute__((weak));
+    extern const trace::descriptor_ptr __stop_trace_descriptors[] __attribute__((weak));
+}
+
+namespace trace
+{
+    // ---------------------------------------
+    // Session: drains the rings into a binary trace file
+    // ---------------------------------------
+
+    /** File layout (native endianness):
+     *  header      : magic u32, version u32, ticks_per_us f64, pid u32
+     *  descriptors : count u32, then per descriptor: id u32, line u32, phase u8, num_args u8, types[4],
+     *                and the length-prefixed (u32) category, name, file and argument names
+     *  chunks      : tid u32, dropped u64, count u32, then 'count' records of
+     *                tsc u64, descriptor id u32, args u64[4]
+     * For complete events 'tsc' is the start of the scope and args[0] the end.
+     */
+    class session
+    {
+    public:
+        explicit session(const std::string &filename)
+            : m_file{filename, std::ios::out | std::ios::binary | std::ios::trunc}
+        {
+            if (!m_file)
+            {
+                throw std::runtime_error("failed to open trace file " + filename);
+            }
+
+            write_header();
+            write_descriptors();
+        }
+
+        ~session()
+        {
+            stop();
+            flush();
+        }
+
+        session(const session &) = delete;
+        session &operator=(const session &) = delete;
+
+        // Drains the rings of every thread into the file.
+        void flush()
+        {
+            std::lock_guard lock{m_mutex};
+
+            registry::instance().for_each([this](ring &r)
+                                          {
+                                              m_events.clear();
+                                              r.drain(m_events);
+
+                                              // a descriptor missing from the table cannot be decoded: count it as dropped
+                                              auto unknown = std::erase_if(m_events, [this](const event &e)
+                                                                           { return m_ids.find(e.desc) == m_ids.end(); });
+
+                                              auto dropped = r.dropped();
+                                              // by ring, not by tid: the ring of an exited thread is reused, tids are too
+                                              auto &last = m_dropped[&r];
+                                              if (m_events.empty() && dropped == last && unknown == 0)
+                                              {
+                                                  return;
+                                              }
+
+                                              write_chunk(r.tid(), dropped - last + unknown);
+                                              last = dropped;
+                                          });
+
+            m_file.flush();
+        }
+
+        // Flushes from a background thread every 'interval'.
+        void start(std::chrono::milliseconds interval = std::chrono::milliseconds(100))
+        {
+            m_running = true;
+            m_thread = std::thread([this, interval]
+                                   {
+                                       while (m_running)
+                                       {
+                                           std::this_thread::sleep_for(interval);
+                                           flush();
+                                       }
+                                   });
+        }
+
+        void stop()
+        {
+            if (m_thread.joinable())
+            {
+                m_running = false;
+                m_thread.join();
+            }
+        }
+
+    private:
+        template <typename T>
+        void put(const T &value)
+        {
+            m_file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        void put_string(const char *str)
+        {
+            auto len = static_cast<std::uint32_t>(str ? std::strlen(str) : 0);
+            put(len);
+            m_file.write(str, len);
+        }
+
+        // ticks of timestamp() per microsecond, measured against the steady clock
+        static double calibrate()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            auto stime = std::chrono::steady_clock::now();
+            auto stsc = timestamp();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            auto etsc = timestamp();
+            auto etime = std::chrono::steady_clock::now();
+
+            auto us = std::chrono::duration<double, std::micro>(etime - stime).count();
+            return static_cast<double>(etsc - stsc) / us;
+#else
+            return 1000.0;
+#endif
+        }
+
+        void write_header()
+        {
+            put(file_magic);
+            put(file_version);
+            put(calibrate());
+            put(static_cast<std::uint32_t>(::getpid()));
+        }
+
+        void write_descriptors()
+        {
+            auto begin = __start_trace_descriptors;
+            auto end = __stop_trace_descriptors;
+            auto count = static_cast<std::uint32_t>(begin ? end - begin : 0);
+
+            put(count);
+            for (std::uint32_t id = 0; id < count; id++)
+            {
+                auto desc = begin[id];
+                m_ids[desc] = id;
+
+                put(id);
+                put(desc->line);
+                put(static_cast<std::uint8_t>(desc->phase));
+                put(desc->num_args);
+                put(desc->arg_types);
+                put_string(desc->category);
+                put_string(desc->name);
+                put_string(desc->file);
+                put_string(desc->arg_names);
+            }
+        }
+
+        void write_chunk(std::uint32_t tid, std::uint64_t dropped)
+        {
+            put(tid);
+            put(dropped);
+            put(static_cast<std::uint32_t>(m_events.size()));
+
+            for (const auto &e : m_events)
+            {
+                put(e.tsc);
+                put(m_ids.find(e.desc)->second);
+                put(e.args);
+            }
+        }
+
+    private:
+        std::mutex m_mutex{};
+        std::fstream m_file;
+        std::unordered_map<const descriptor *, std::uint32_t> m_ids{};
+        std::unordered_map<const ring *, std::uint64_t> m_dropped{};
+        std::vector<event> m_events{};
+
+        std::atomic<bool> m_running{false};
+        std::thread m_thread{};
+    };
+}
+
+// ---------------------------------------
+// Trace points
+// ---------------------------------------
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+// defines the static descriptor of a call site and registers it in the 'trace_descriptors' section
+#define TRACE_DESCRIPTOR(var, cat, nm, ph, ...)                                                        \
+    static const ::trace::descriptor var{                                                               \
+        cat, nm, __FILE__, __LINE__, ph,                                                                \
+        ::trace::detail::count(decltype(::trace::detail::types_of(__VA_ARGS__)){}),                     \
+        ::trace::detail::type_codes(decltype(::trace::detail::types_of(__VA_ARGS__)){}), #__VA_ARGS__}; \
+    [[gnu::section("trace_descriptors"), gnu::used]] static const ::trace::descriptor_ptr              \
+        TRACE_CONCAT(var, _ptr) = &var
+
+#ifndef TRACE_DISABLED
+    #define TRACE_INSTANT(cat, nm, ...)                                                                  \
+        do                                                                                               \
+        {                                                                                                \
+            TRACE_DESCRIPTOR(trace_desc_, cat, nm, ::trace::phase::instant, ##__VA_ARGS__);              \
+            ::trace::record(&trace_desc_, ::trace::timestamp(), ##__VA_ARGS__);                          \
+        } while (0)
+
+    #define TRACE_SCOPE(cat, nm)                                                                         \
+        TRACE_DESCRIPTOR(TRACE_CONCAT(trace_desc_, __LINE__), cat, nm, ::trace::phase::complete);        \
+        ::trace::scope TRACE_CONCAT(trace_scope_, __LINE__)                                              \
+        {                                                                                                \
+            &TRACE_CONCAT(trace_desc_, __LINE__)                                                         \
+        }
+#else
+    #define TRACE_INSTANT(cat, nm, ...) \
+        do                              \
+        {                               \
+        } while (0)
+
+    #define TRACE_SCOPE(cat, nm)
+#endif
+
+#endif // SYSTEM_PROGRAMMING_TRACE_HPP
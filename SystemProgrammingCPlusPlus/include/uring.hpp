@@ -0,0 +1,330 @@
+/**
+ * @File    : uring.hpp
+ * @Brief   : Minimal io_uring wrapper on the raw system calls, without liburing
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** io_uring
+ * read() and pread() cost one system call per request, and the calling thread waits for each one.
+ * io_uring shares two ring buffers between the process and the kernel:
+ * - the submission queue (SQ): the process fills submission queue entries (SQE), e.g. "read 4KB
+ *   from fd 3 at offset 8192 into this buffer", and publishes them by moving the SQ tail,
+ * - the completion queue (CQ): the kernel posts one completion queue entry (CQE) per request,
+ *   with the user_data of the request and the result (bytes or -errno).
+ *
+ * One io_uring_enter() system call submits any number of requests and can wait for completions,
+ * so many reads are in flight at the same time (queue depth) with a single thread.
+ *
+ * The head and tail indices are shared with the kernel: the tails we publish are stored with
+ * release semantics, the tails written by the kernel are loaded with acquire semantics.
+ * liburing wraps exactly this, it is not needed for the few operations used here.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_URING_HPP
+#define SYSTEM_PROGRAMMING_URING_HPP
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace uring
+{
+    inline int setup(unsigned entries, io_uring_params *params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    inline int enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    inline int register_(int fd, unsigned opcode, const void *arg, unsigned nr_args)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+    }
+
+    // true when the kernel supports io_uring and it is not disabled (kernel.io_uring_disabled, seccomp)
+    inline bool supported()
+    {
+        io_uring_params params{};
+        auto fd = setup(1, &params);
+        if (fd == -1)
+        {
+            return false;
+        }
+
+        close(fd);
+        return true;
+    }
+
+    class ring
+    {
+    public:
+        explicit ring(unsigned entries, unsigned flags = 0)
+        {
+            io_uring_params params{};
+            params.flags = flags;
+
+            m_fd = setup(entries, &params);
+            if (m_fd == -1)
+            {
+                throw std::runtime_error(std::string("io_uring_setup: ") + strerror(errno));
+            }
+
+            m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+            // with IORING_FEAT_SINGLE_MMAP both rings live in one mapping
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+            {
+                m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+            }
+
+            // the destructor does not run for a throwing constructor: undo what is mapped so far
+            try
+            {
+                m_sq_ptr = map(m_sq_size, IORING_OFF_SQ_RING);
+                m_cq_ptr = (params.features & IORING_FEAT_SINGLE_MMAP) ? m_sq_ptr : map(m_cq_size, IORING_OFF_CQ_RING);
+
+                m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+                m_sqes = static_cast<io_uring_sqe *>(map(m_sqes_size, IORING_OFF_SQES));
+            }
+            catch (...)
+            {
+                release();
+                throw;
+            }
+
+            auto sq = static_cast<char *>(m_sq_ptr);
+            m_sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+            m_sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            m_sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            m_sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+            m_sq_entries = params.sq_entries;
+
+            auto cq = static_cast<char *>(m_cq_ptr);
+            m_cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            m_cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            m_cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+            m_local_tail = *m_sq_tail;
+        }
+
+        ~ring()
+        {
+            release();
+        }
+
+        ring(const ring &) = delete;
+        ring &operator=(const ring &) = delete;
+
+        // a cleared submission entry, or nullptr when the submission queue is full
+        io_uring_sqe *get_sqe()
+        {
+            auto head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+            if (m_local_tail - head >= m_sq_entries)
+            {
+                return nullptr;
+            }
+
+            auto index = m_local_tail & m_sq_mask;
+            auto sqe = &m_sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+
+            m_sq_array[index] = index;
+            m_local_tail++;
+
+            return sqe;
+        }
+
+        static void prep_rw(io_uring_sqe *sqe, std::uint8_t op, int fd, const void *addr, unsigned len, std::uint64_t offset, std::uint64_t user_data)
+        {
+            sqe->opcode = op;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<std::uint64_t>(addr);
+            sqe->len = len;
+            sqe->off = offset;
+            sqe->user_data = user_data;
+        }
+
+        bool read(int fd, void *buf, unsigned len, std::uint64_t offset, std::uint64_t user_data)
+        {
+            auto sqe = get_sqe();
+            if (sqe == nullptr)
+            {
+                return false;
+            }
+
+            prep_rw(sqe, IORING_OP_READ, fd, buf, len, offset, user_data);
+            return true;
+        }
+
+        bool write(int fd, const void *buf, unsigned len, std::uint64_t offset, std::uint64_t user_data)
+        {
+            auto sqe = get_sqe();
+            if (sqe == nullptr)
+            {
+                return false;
+            }
+
+            prep_rw(sqe, IORING_OP_WRITE, fd, buf, len, offset, user_data);
+            return true;
+        }
+
+        // publishes the prepared entries and waits for at least 'wait' completions,
+        // returns the number of entries submitted.
+        // The kernel may consume fewer entries than published (e.g. out of memory for the requests):
+        // the rest stays between the SQ head and tail, and is submitted again by the next call
+        unsigned submit(unsigned wait = 0)
+        {
+            __atomic_store_n(m_sq_tail, m_local_tail, __ATOMIC_RELEASE);
+            auto to_submit = m_local_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+
+            if (to_submit == 0 && wait == 0)
+            {
+                return 0;
+            }
+
+            while (true)
+            {
+                auto ret = enter(m_fd, to_submit, wait, wait != 0 ? IORING_ENTER_GETEVENTS : 0);
+                if (ret >= 0)
+                {
+                    return static_cast<unsigned>(ret);
+                }
+
+                if (errno != EINTR)
+                {
+                    throw std::runtime_error(std::string("io_uring_enter: ") + strerror(errno));
+                }
+            }
+        }
+
+        // calls func(const io_uring_cqe &) for every available completion, returns their number
+        template <typename FUNC>
+        unsigned for_each_completion(FUNC func)
+        {
+            auto head = *m_cq_head;
+            auto tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+
+            unsigned count = 0;
+            for (; head != tail; head++, count++)
+            {
+                func(m_cqes[head & m_cq_mask]);
+            }
+
+            __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+            return count;
+        }
+
+        // takes one completion off the queue, false when there is none.
+        // Safe to call again from the handling of a completion (e.g. a callback submitting more)
+        bool next_completion(io_uring_cqe &cqe)
+        {
+            auto head = *m_cq_head;
+            if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE))
+            {
+                return false;
+            }
+
+            cqe = m_cqes[head & m_cq_mask];
+            __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+
+            return true;
+        }
+
+        void register_buffers(const iovec *iovs, unsigned count)
+        {
+            if (register_(m_fd, IORING_REGISTER_BUFFERS, iovs, count) == -1)
+            {
+                throw std::runtime_error(std::string("io_uring_register: ") + strerror(errno));
+            }
+        }
+
+        void register_files(const int *fds, unsigned count)
+        {
+            if (register_(m_fd, IORING_REGISTER_FILES, fds, count) == -1)
+            {
+                throw std::runtime_error(std::string("io_uring_register: ") + strerror(errno));
+            }
+        }
+
+        unsigned entries() const
+        {
+            return m_sq_entries;
+        }
+
+        int fd() const
+        {
+            return m_fd;
+        }
+
+    private:
+        void release()
+        {
+            if (m_sqes != nullptr)
+            {
+                munmap(m_sqes, m_sqes_size);
+            }
+            if (m_cq_ptr != nullptr && m_cq_ptr != m_sq_ptr)
+            {
+                munmap(m_cq_ptr, m_cq_size);
+            }
+            if (m_sq_ptr != nullptr)
+            {
+                munmap(m_sq_ptr, m_sq_size);
+            }
+            close(m_fd);
+        }
+
+        void *map(std::size_t size, off_t offset)
+        {
+            auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+            if (ptr == MAP_FAILED)
+            {
+                throw std::runtime_error(std::string("io_uring mmap: ") + strerror(errno));
+            }
+
+            return ptr;
+        }
+
+        int m_fd{-1};
+
+        void *m_sq_ptr{};
+        void *m_cq_ptr{};
+        std::size_t m_sq_size{};
+        std::size_t m_cq_size{};
+
+        io_uring_sqe *m_sqes{};
+        std::size_t m_sqes_size{};
+
+        unsigned *m_sq_head{};
+        unsigned *m_sq_tail{};
+        unsigned *m_sq_array{};
+        unsigned m_sq_mask{};
+        unsigned m_sq_entries{};
+        unsigned m_local_tail{};
+
+        unsigned *m_cq_head{};
+        unsigned *m_cq_tail{};
+        unsigned m_cq_mask{};
+        io_uring_cqe *m_cqes{};
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_URING_HPP
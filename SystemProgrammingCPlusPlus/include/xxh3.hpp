@@ -0,0 +1,507 @@
+/**
+ * @File    : xxh3.hpp
+ * @Brief   : XXH3-64 (xxHash 0.8) non-cryptographic hash, scalar and AVX2 accumulation
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include example.cpp
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** XXH3
+ * XXH3 (Y. Collet, xxHash 0.8) hashes large inputs at close to the memory bandwidth.
+ * The input is consumed in 64-byte stripes, every stripe is added to 8 64-bit accumulators
+ * with one 32x32->64 multiplication per lane: four lanes fit in one AVX2 register,
+ * so a stripe costs two _mm256_mul_epu32. Every 1KB block the accumulators are scrambled
+ * with the secret, at the end they are merged and avalanched into 64 bits.
+ * Inputs up to 240 bytes take dedicated short paths without the accumulators.
+ *
+ * xxh3::hash64() produces the values of XXH3_64bits() (seed 0, default secret),
+ * so the hashes can be compared with the xxhsum -H3 tool and the xxhash libraries.
+ * xxh3::state computes the same value over data that arrives in pieces of any size
+ * (XXH3_64bits_update()), it keeps the last 256 bytes so that the end of the input is handled as in hash64().
+ * It is not a cryptographic hash: it detects identical and corrupted data, not an attacker.
+ *
+ * AVX2 is selected at run time (__builtin_cpu_supports), the binary does not need -mavx2.
+ */
+
+#ifndef SYSTEM_PROGRAMMING_XXH3_HPP
+#define SYSTEM_PROGRAMMING_XXH3_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace xxh3
+{
+    namespace detail
+    {
+        constexpr std::uint64_t prime32_1 = 0x9E3779B1U;
+        constexpr std::uint64_t prime32_2 = 0x85EBCA77U;
+        constexpr std::uint64_t prime32_3 = 0xC2B2AE3DU;
+        constexpr std::uint64_t prime64_1 = 0x9E3779B185EBCA87ULL;
+        constexpr std::uint64_t prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+        constexpr std::uint64_t prime64_3 = 0x165667B19E3779F9ULL;
+        constexpr std::uint64_t prime64_4 = 0x85EBCA77C2B2AE63ULL;
+        constexpr std::uint64_t prime64_5 = 0x27D4EB2F165667C5ULL;
+        constexpr std::uint64_t prime_mx1 = 0x165667919E3779F9ULL;
+        constexpr std::uint64_t prime_mx2 = 0x9FB21C651E98DF25ULL;
+
+        constexpr std::size_t stripe_len = 64;
+        constexpr std::size_t secret_size = 192;
+        constexpr std::size_t stripes_per_block = (secret_size - stripe_len) / 8;
+        constexpr std::size_t block_len = stripe_len * stripes_per_block;
+
+        alignas(64) constexpr std::uint8_t secret[secret_size] = {
+            0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+            0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+            0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+            0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+            0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+            0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+            0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+            0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+            0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+            0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+            0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+            0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+        };
+
+        inline std::uint64_t read64(const void *p)
+        {
+            std::uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline std::uint32_t read32(const void *p)
+        {
+            std::uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline std::uint64_t rotl64(std::uint64_t x, int r)
+        {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        inline std::uint64_t mul128_fold64(std::uint64_t lhs, std::uint64_t rhs)
+        {
+            auto product = static_cast<unsigned __int128>(lhs) * rhs;
+            return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+        }
+
+        inline std::uint64_t xxh64_avalanche(std::uint64_t h)
+        {
+            h ^= h >> 33;
+            h *= prime64_2;
+            h ^= h >> 29;
+            h *= prime64_3;
+            return h ^ (h >> 32);
+        }
+
+        inline std::uint64_t avalanche(std::uint64_t h)
+        {
+            h ^= h >> 37;
+            h *= prime_mx1;
+            return h ^ (h >> 32);
+        }
+
+        inline std::uint64_t rrmxmx(std::uint64_t h, std::uint64_t len)
+        {
+            h ^= rotl64(h, 49) ^ rotl64(h, 24);
+            h *= prime_mx2;
+            h ^= (h >> 35) + len;
+            h *= prime_mx2;
+            return h ^ (h >> 28);
+        }
+
+        inline std::uint64_t mix16(const std::uint8_t *input, const std::uint8_t *key)
+        {
+            return mul128_fold64(read64(input) ^ read64(key), read64(input + 8) ^ read64(key + 8));
+        }
+
+        // ---------------------------------------
+        // inputs up to 240 bytes
+        // ---------------------------------------
+        inline std::uint64_t hash_0to16(const std::uint8_t *input, std::size_t len)
+        {
+            if (len > 8)
+            {
+                auto lo = read64(input) ^ (read64(secret + 24) ^ read64(secret + 32));
+                auto hi = read64(input + len - 8) ^ (read64(secret + 40) ^ read64(secret + 48));
+                auto acc = len + __builtin_bswap64(lo) + hi + mul128_fold64(lo, hi);
+                return avalanche(acc);
+            }
+
+            if (len >= 4)
+            {
+                auto input64 = read32(input + len - 4) + (static_cast<std::uint64_t>(read32(input)) << 32);
+                return rrmxmx(input64 ^ (read64(secret + 8) ^ read64(secret + 16)), len);
+            }
+
+            if (len > 0)
+            {
+                auto combined = (static_cast<std::uint32_t>(input[0]) << 16) | (static_cast<std::uint32_t>(input[len >> 1]) << 24) |
+                                static_cast<std::uint32_t>(input[len - 1]) | (static_cast<std::uint32_t>(len) << 8);
+                return xxh64_avalanche(combined ^ static_cast<std::uint64_t>(read32(secret) ^ read32(secret + 4)));
+            }
+
+            return xxh64_avalanche(read64(secret + 56) ^ read64(secret + 64));
+        }
+
+        inline std::uint64_t hash_17to128(const std::uint8_t *input, std::size_t len)
+        {
+            std::uint64_t acc = len * prime64_1;
+
+            if (len > 32)
+            {
+                if (len > 64)
+                {
+                    if (len > 96)
+                    {
+                        acc += mix16(input + 48, secret + 96);
+                        acc += mix16(input + len - 64, secret + 112);
+                    }
+                    acc += mix16(input + 32, secret + 64);
+                    acc += mix16(input + len - 48, secret + 80);
+                }
+                acc += mix16(input + 16, secret + 32);
+                acc += mix16(input + len - 32, secret + 48);
+            }
+            acc += mix16(input, secret);
+            acc += mix16(input + len - 16, secret + 16);
+
+            return avalanche(acc);
+        }
+
+        inline std::uint64_t hash_129to240(const std::uint8_t *input, std::size_t len)
+        {
+            std::uint64_t acc = len * prime64_1;
+
+            for (std::size_t i = 0; i < 8; i++)
+            {
+                acc += mix16(input + 16 * i, secret + 16 * i);
+            }
+            acc = avalanche(acc);
+
+            for (std::size_t i = 8; i < len / 16; i++)
+            {
+                acc += mix16(input + 16 * i, secret + 16 * (i - 8) + 3);
+            }
+            acc += mix16(input + len - 16, secret + 136 - 17);
+
+            return avalanche(acc);
+        }
+
+        // ---------------------------------------
+        // long inputs: 8 accumulators over 64-byte stripes
+        // ---------------------------------------
+        inline void accumulate_scalar(std::uint64_t *acc, const std::uint8_t *input, const std::uint8_t *key, std::size_t stripes)
+        {
+            for (std::size_t s = 0; s < stripes; s++, input += stripe_len, key += 8)
+            {
+                for (std::size_t i = 0; i < 8; i++)
+                {
+                    auto value = read64(input + 8 * i);
+                    auto keyed = value ^ read64(key + 8 * i);
+                    acc[i ^ 1] += value;
+                    acc[i] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+                }
+            }
+        }
+
+        inline void scramble_scalar(std::uint64_t *acc, const std::uint8_t *key)
+        {
+            for (std::size_t i = 0; i < 8; i++)
+            {
+                auto a = acc[i];
+                a ^= a >> 47;
+                a ^= read64(key + 8 * i);
+                acc[i] = a * prime32_1;
+            }
+        }
+
+#if defined(__x86_64__)
+        __attribute__((target("avx2"))) inline void accumulate_avx2(std::uint64_t *acc, const std::uint8_t *input, const std::uint8_t *key, std::size_t stripes)
+        {
+            auto a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc));
+            auto a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + 4));
+
+            for (std::size_t s = 0; s < stripes; s++, input += stripe_len, key += 8)
+            {
+                auto d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input));
+                auto d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + 32));
+                auto k0 = _mm256_xor_si256(d0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(key)));
+                auto k1 = _mm256_xor_si256(d1, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(key + 32)));
+
+                // low 32 bits times high 32 bits of every lane, plus the neighbouring lane of the data
+                auto p0 = _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32));
+                auto p1 = _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32));
+
+                a0 = _mm256_add_epi64(a0, _mm256_add_epi64(p0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2))));
+                a1 = _mm256_add_epi64(a1, _mm256_add_epi64(p1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2))));
+            }
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc), a0);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + 4), a1);
+        }
+
+        __attribute__((target("avx2"))) inline void scramble_avx2(std::uint64_t *acc, const std::uint8_t *key)
+        {
+            const auto prime = _mm256_set1_epi32(static_cast<int>(prime32_1));
+
+            for (std::size_t i = 0; i < 8; i += 4)
+            {
+                auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + i));
+                a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+                a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(key + 8 * i)));
+
+                auto lo = _mm256_mul_epu32(a, prime);
+                auto hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + i), _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+            }
+        }
+
+        inline bool has_avx2()
+        {
+            static const bool avx2 = __builtin_cpu_supports("avx2");
+            return avx2;
+        }
+#endif
+
+        inline void accumulate(std::uint64_t *acc, const std::uint8_t *input, const std::uint8_t *key, std::size_t stripes, bool avx2)
+        {
+#if defined(__x86_64__)
+            if (avx2)
+            {
+                accumulate_avx2(acc, input, key, stripes);
+                return;
+            }
+#endif
+            (void)avx2;
+            accumulate_scalar(acc, input, key, stripes);
+        }
+
+        inline void scramble(std::uint64_t *acc, const std::uint8_t *key, bool avx2)
+        {
+#if defined(__x86_64__)
+            if (avx2)
+            {
+                scramble_avx2(acc, key);
+                return;
+            }
+#endif
+            (void)avx2;
+            scramble_scalar(acc, key);
+        }
+
+        inline void init_acc(std::uint64_t *acc)
+        {
+            const std::uint64_t init[8] = {prime32_3, prime64_1, prime64_2, prime64_3, prime64_4, prime32_2, prime64_5, prime32_1};
+            std::memcpy(acc, init, sizeof(init));
+        }
+
+        inline std::uint64_t merge(const std::uint64_t *acc, std::uint64_t len)
+        {
+            std::uint64_t result = len * prime64_1;
+            for (std::size_t i = 0; i < 4; i++)
+            {
+                result += mul128_fold64(acc[2 * i] ^ read64(secret + 11 + 16 * i), acc[2 * i + 1] ^ read64(secret + 11 + 16 * i + 8));
+            }
+
+            return avalanche(result);
+        }
+
+        inline std::uint64_t hash_long(const std::uint8_t *input, std::size_t len, bool avx2)
+        {
+            alignas(32) std::uint64_t acc[8];
+            init_acc(acc);
+
+            auto blocks = (len - 1) / block_len;
+            for (std::size_t b = 0; b < blocks; b++)
+            {
+                accumulate(acc, input + b * block_len, secret, stripes_per_block, avx2);
+                scramble(acc, secret + secret_size - stripe_len, avx2);
+            }
+
+            // the stripes of the last partial block, then the last 64 bytes (overlapping)
+            auto stripes = ((len - 1) - block_len * blocks) / stripe_len;
+            accumulate(acc, input + blocks * block_len, secret, stripes, avx2);
+            accumulate(acc, input + len - stripe_len, secret + secret_size - stripe_len - 7, 1, avx2);
+
+            return merge(acc, len);
+        }
+    }
+
+    enum class isa
+    {
+        generic,
+        avx2
+    };
+
+    inline isa best_isa()
+    {
+#if defined(__x86_64__)
+        return detail::has_avx2() ? isa::avx2 : isa::generic;
+#else
+        return isa::generic;
+#endif
+    }
+
+    // XXH3_64bits() of [data, data + size)
+    inline std::uint64_t hash64(const void *data, std::size_t size, isa use = best_isa())
+    {
+        auto input = static_cast<const std::uint8_t *>(data);
+
+        if (size <= 16)
+        {
+            return detail::hash_0to16(input, size);
+        }
+
+        if (size <= 128)
+        {
+            return detail::hash_17to128(input, size);
+        }
+
+        if (size <= 240)
+        {
+            return detail::hash_129to240(input, size);
+        }
+
+        return detail::hash_long(input, size, use == isa::avx2);
+    }
+
+    // streaming XXH3_64bits(): update() with the pieces, digest() at any time
+    class state
+    {
+    public:
+        explicit state(isa use = best_isa()) : m_avx2{use == isa::avx2}
+        {
+            reset();
+        }
+
+        void reset()
+        {
+            detail::init_acc(m_acc);
+            m_buffered = 0;
+            m_stripes = 0;
+            m_total = 0;
+        }
+
+        void update(const void *data, std::size_t size)
+        {
+            auto input = static_cast<const std::uint8_t *>(data);
+            auto end = input + size;
+            m_total += size;
+
+            if (m_buffered + size <= buffer_size)
+            {
+                std::memcpy(m_buffer + m_buffered, input, size);
+                m_buffered += size;
+                return;
+            }
+
+            // at least one byte stays in the buffer: the last stripe is only known in digest()
+            if (m_buffered != 0)
+            {
+                auto load = buffer_size - m_buffered;
+                std::memcpy(m_buffer + m_buffered, input, load);
+                input += load;
+                consume(m_buffer, buffer_size / detail::stripe_len);
+                m_buffered = 0;
+            }
+
+            if (static_cast<std::size_t>(end - input) > buffer_size)
+            {
+                do
+                {
+                    consume(input, buffer_size / detail::stripe_len);
+                    input += buffer_size;
+                } while (input < end - buffer_size);
+
+                // the previous stripe, for a last stripe that reaches back before the buffered bytes
+                std::memcpy(m_buffer + buffer_size - detail::stripe_len, input - detail::stripe_len, detail::stripe_len);
+            }
+
+            std::memcpy(m_buffer, input, static_cast<std::size_t>(end - input));
+            m_buffered = static_cast<std::size_t>(end - input);
+        }
+
+        std::uint64_t digest() const
+        {
+            if (m_total <= 240)
+            {
+                return hash64(m_buffer, m_total);
+            }
+
+            alignas(32) std::uint64_t acc[8];
+            std::memcpy(acc, m_acc, sizeof(acc));
+            auto stripes = m_stripes;
+
+            const std::uint8_t *last = nullptr;
+            std::uint8_t last_stripe[detail::stripe_len];
+
+            if (m_buffered >= detail::stripe_len)
+            {
+                consume(acc, stripes, m_buffer, (m_buffered - 1) / detail::stripe_len, m_avx2);
+                last = m_buffer + m_buffered - detail::stripe_len;
+            }
+            else
+            {
+                auto catchup = detail::stripe_len - m_buffered;
+                std::memcpy(last_stripe, m_buffer + buffer_size - catchup, catchup);
+                std::memcpy(last_stripe + catchup, m_buffer, m_buffered);
+                last = last_stripe;
+            }
+
+            detail::accumulate(acc, last, detail::secret + detail::secret_size - detail::stripe_len - 7, 1, m_avx2);
+            return detail::merge(acc, m_total);
+        }
+
+        std::uint64_t size() const
+        {
+            return m_total;
+        }
+
+    private:
+        static constexpr std::size_t buffer_size = 256;
+
+        void consume(const std::uint8_t *input, std::size_t stripes)
+        {
+            consume(m_acc, m_stripes, input, stripes, m_avx2);
+        }
+
+        // the stripes continue the current block, the accumulators are scrambled at the end of every block
+        static void consume(std::uint64_t *acc, std::size_t &done, const std::uint8_t *input, std::size_t stripes, bool avx2)
+        {
+            if (detail::stripes_per_block - done <= stripes)
+            {
+                auto to_end = detail::stripes_per_block - done;
+                detail::accumulate(acc, input, detail::secret + done * 8, to_end, avx2);
+                detail::scramble(acc, detail::secret + detail::secret_size - detail::stripe_len, avx2);
+                detail::accumulate(acc, input + to_end * detail::stripe_len, detail::secret, stripes - to_end, avx2);
+                done = stripes - to_end;
+            }
+            else
+            {
+                detail::accumulate(acc, input, detail::secret + done * 8, stripes, avx2);
+                done += stripes;
+            }
+        }
+
+        alignas(32) std::uint64_t m_acc[8];
+        alignas(32) std::uint8_t m_buffer[buffer_size];
+        std::size_t m_buffered{};
+        std::size_t m_stripes{};
+        std::uint64_t m_total{};
+        bool m_avx2;
+    };
+}
+
+#endif // SYSTEM_PROGRAMMING_XXH3_HPP
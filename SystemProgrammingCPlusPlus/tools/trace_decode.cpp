@@ -0,0 +1,353 @@
+/**
+ * @File    : trace_decode.cpp
+ * @Brief   : Decodes the binary trace files of include/trace.hpp into Chrome trace JSON
+ * ---------------------------------
+ * @Command : g++ -std=c++2a -O2 -I../include trace_decode.cpp -o trace_decode
+ * @Command : ./trace_decode trace.bin > trace.json
+ * ---------------------------------
+ * @Author  : Wei Li
+ * @Date    : 2026-10-19
+*/
+
+/** Offline decoding
+ * The traced program only stores raw timestamps, descriptor ids and 64-bit arguments.
+ * Everything that is expensive happens here, long after the hot path has moved on:
+ * converting TSC ticks to microseconds, looking up names and source locations,
+ * formatting the arguments according to their recorded types, and writing JSON.
+ *
+ * The output follows the Chrome "Trace Event Format" (JSON object format),
+ * which can be opened with chrome://tracing or https://ui.perfetto.dev
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "trace.hpp"
+
+struct decoded_descriptor
+{
+    std::uint32_t line{};
+    char phase{};
+    std::uint8_t num_args{};
+    std::array<char, trace::max_args> arg_types{};
+    std::string category;
+    std::string name;
+    std::string file;
+    std::vector<std::string> arg_names;
+};
+
+struct decoded_event
+{
+    std::uint32_t tid{};
+    std::uint64_t tsc{};
+    std::uint32_t id{};
+    std::array<std::uint64_t, trace::max_args> args{};
+};
+
+struct dropped_events
+{
+    std::uint32_t tid{};
+    std::uint64_t tsc{};
+    std::uint64_t count{};
+};
+
+class reader
+{
+public:
+    explicit reader(const std::string &filename) : m_file{filename, std::ios::in | std::ios::binary}
+    {
+        if (!m_file)
+        {
+            throw std::runtime_error("failed to open " + filename);
+        }
+    }
+
+    template <typename T>
+    bool get(T &value)
+    {
+        return static_cast<bool>(m_file.read(reinterpret_cast<char *>(&value), sizeof(value)));
+    }
+
+    template <typename T>
+    T get()
+    {
+        T value{};
+        if (!get(value))
+        {
+            throw std::runtime_error("truncated trace file");
+        }
+
+        return value;
+    }
+
+    std::string get_string()
+    {
+        auto len = get<std::uint32_t>();
+
+        std::string str(len, '\0');
+        if (!m_file.read(str.data(), len))
+        {
+            throw std::runtime_error("truncated trace file");
+        }
+
+        return str;
+    }
+
+private:
+    std::fstream m_file;
+};
+
+// splits the stringified macro arguments "a, b" into names
+std::vector<std::string> split_names(const std::string &str)
+{
+    std::vector<std::string> names;
+    std::string current;
+    auto depth = 0;
+
+    for (auto c : str)
+    {
+        if (c == '(' || c == '[')
+        {
+            depth++;
+        }
+        else if (c == ')' || c == ']')
+        {
+            depth--;
+        }
+
+        if (c == ',' && depth == 0)
+        {
+            names.push_back(current);
+            current.clear();
+            continue;
+        }
+
+        if (c != ' ' || !current.empty())
+        {
+            current += c;
+        }
+    }
+
+    if (!current.empty())
+    {
+        names.push_back(current);
+    }
+
+    return names;
+}
+
+void write_escaped(std::ostream &os, const std::string &str)
+{
+    os << '"';
+    for (auto c : str)
+    {
+        switch (c)
+        {
+        case '"':
+            os << "\\\"";
+            break;
+        case '\\':
+            os << "\\\\";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                os << ' ';
+            }
+            else
+            {
+                os << c;
+            }
+        }
+    }
+    os << '"';
+}
+
+void write_arg(std::ostream &os, char type, std::uint64_t raw)
+{
+    switch (type)
+    {
+    case 'i':
+        os << static_cast<std::int64_t>(raw);
+        break;
+    case 'f':
+    {
+        double d;
+        std::memcpy(&d, &raw, sizeof(d));
+        // JSON has no nan or inf: written as the strings "nan", "inf", "-inf"
+        if (std::isfinite(d))
+        {
+            os << d;
+        }
+        else
+        {
+            os << '"' << (std::isnan(d) ? "nan" : d > 0 ? "inf" : "-inf") << '"';
+        }
+        break;
+    }
+    case 'p':
+        os << "\"0x" << std::hex << raw << std::dec << '"';
+        break;
+    default:
+        os << raw;
+        break;
+    }
+}
+
+int protected_main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "usage: trace_decode <trace.bin>\n";
+        return EXIT_FAILURE;
+    }
+
+    reader in{argv[1]};
+
+    // Step 1. header
+    if (in.get<std::uint32_t>() != trace::file_magic)
+    {
+        throw std::runtime_error("not a trace file");
+    }
+
+    if (auto version = in.get<std::uint32_t>(); version != trace::file_version)
+    {
+        throw std::runtime_error("unsupported trace file version " + std::to_string(version));
+    }
+
+    auto ticks_per_us = in.get<double>();
+    auto pid = in.get<std::uint32_t>();
+
+    // Step 2. descriptor table
+    std::vector<decoded_descriptor> descriptors(in.get<std::uint32_t>());
+    for (std::size_t i = 0; i < descriptors.size(); i++)
+    {
+        auto id = in.get<std::uint32_t>();
+        auto &d = descriptors.at(id);
+
+        d.line = in.get<std::uint32_t>();
+        d.phase = static_cast<char>(in.get<std::uint8_t>());
+        d.num_args = in.get<std::uint8_t>();
+        d.arg_types = in.get<std::array<char, trace::max_args>>();
+        d.category = in.get_string();
+        d.name = in.get_string();
+        d.file = in.get_string();
+        d.arg_names = split_names(in.get_string());
+    }
+
+    // Step 3. event chunks, in the order they were flushed
+    std::vector<decoded_event> events;
+    std::vector<dropped_events> drops;
+
+    std::uint32_t tid{};
+    while (in.get(tid))
+    {
+        auto dropped = in.get<std::uint64_t>();
+        auto count = in.get<std::uint32_t>();
+
+        for (std::uint32_t i = 0; i < count; i++)
+        {
+            decoded_event e{};
+            e.tid = tid;
+            e.tsc = in.get<std::uint64_t>();
+            e.id = in.get<std::uint32_t>();
+            e.args = in.get<std::array<std::uint64_t, trace::max_args>>();
+
+            events.push_back(e);
+        }
+
+        if (dropped != 0)
+        {
+            drops.push_back({tid, events.empty() ? 0 : events.back().tsc, dropped});
+        }
+    }
+
+    auto base = events.empty() ? 0 : std::min_element(events.begin(), events.end(), [](auto &a, auto &b)
+                                                      { return a.tsc < b.tsc; })
+                                         ->tsc;
+
+    auto to_us = [&](std::uint64_t tsc)
+    {
+        return static_cast<double>(tsc - std::min(tsc, base)) / ticks_per_us;
+    };
+
+    // Step 4. Chrome trace JSON
+    auto &os = std::cout;
+    os << std::fixed << std::setprecision(3);
+    os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+
+    auto first = true;
+    for (const auto &e : events)
+    {
+        const auto &d = descriptors.at(e.id);
+
+        os << (first ? "" : ",\n") << "{\"name\": ";
+        write_escaped(os, d.name);
+        os << ", \"cat\": ";
+        write_escaped(os, d.category);
+        os << ", \"ph\": \"" << d.phase << "\", \"ts\": " << to_us(e.tsc)
+           << ", \"pid\": " << pid << ", \"tid\": " << e.tid;
+
+        if (d.phase == static_cast<char>(trace::phase::complete))
+        {
+            os << ", \"dur\": " << to_us(e.args[0]) - to_us(e.tsc);
+        }
+        else
+        {
+            os << ", \"s\": \"t\"";
+        }
+
+        os << ", \"args\": {\"location\": ";
+        write_escaped(os, d.file + ":" + std::to_string(d.line));
+        for (std::size_t i = 0; i < d.num_args; i++)
+        {
+            os << ", ";
+            write_escaped(os, i < d.arg_names.size() ? d.arg_names[i] : "arg" + std::to_string(i));
+            os << ": ";
+            write_arg(os, d.arg_types[i], e.args[i]);
+        }
+        os << "}}";
+
+        first = false;
+    }
+
+    for (const auto &drop : drops)
+    {
+        os << (first ? "" : ",\n") << "{\"name\": \"dropped events\", \"cat\": \"trace\", \"ph\": \"i\", \"s\": \"t\""
+           << ", \"ts\": " << to_us(drop.tsc) << ", \"pid\": " << pid << ", \"tid\": " << drop.tid
+           << ", \"args\": {\"count\": " << drop.count << "}}";
+
+        first = false;
+    }
+
+    os << "\n]}\n";
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return protected_main(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught unhandled exception:\n";
+        std::cerr << " - what(): " << e.what() << '\n';
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+    }
+
+    return EXIT_FAILURE;
+}